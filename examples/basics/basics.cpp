@@ -95,6 +95,12 @@ void setup()
 
     // Initialisation de l'objet Domokit
     Domokit.begin();
+
+    // Tâche planifiée par Domokit : envoi d'une valeur aléatoire sur le graphique toutes les 5s
+    Domokit.getScheduler().every("test_graph", 5000, []() {
+        if (Domokit.getStateProgram())
+            Domokit.SendtoTile("test_graph", String(random(0,100)));
+    });
 #endif
     
     // ---------------------------------------------------------
@@ -138,6 +144,12 @@ void loop()
     // Gestion des actions via le scheduler
     Scheduler(Task_10us,Task_1ms,Task_1s);
 
+    // Domokit : réception MQTT, connexion, évènements et tâches planifiées
+    #ifdef __DOMOKIT_H__
+    Domokit.poll();
+    Domokit_Start = Domokit.getStateProgram();
+    #endif
+
     if (Domokit_Start == true)
     {
         // Gestion des interruptions GPIO (exemple)
@@ -172,11 +184,13 @@ void Interruption_GPIO(uint8 * myflag)
     {
         SET_BIT(Registre_GPIO->STATUS_W1TC,BUT_1); // clear de l'interruption
         *myflag = 1;
+        Domokit.pushEvent(1,0); // publié par Domokit.poll(), aucun appui perdu
     }
     if (READ_BIT(Registre_GPIO->STATUS,BUT_2) == 1)
     {
         SET_BIT(Registre_GPIO->STATUS_W1TC,BUT_2); // clear de l'interruption
         *myflag = 2;
+        Domokit.pushEvent(2,0);
     }
 }
 
@@ -230,14 +244,10 @@ void Task_1ms()
     //GPIO_Toggle(LED_R);
 
     // Action(s) dès qu'un compteur virtuel tombe à zéro
+    // (la réception MQTT est gérée par Domokit.poll() dans loop())
     if (Compteur_virtuel_ms[0].valeur == 0)
     {
         Compteur_virtuel_ms[0].valeur = 200; // Nombre de ms avant le prochain déclenchement
-
-        // Routine permettant la réception des messages MQTT sur les topics souscrits
-        #ifdef __DOMOKIT_H__
-        Domokit.verifierMQTT_Receive();
-        #endif
     }
 
 
@@ -283,15 +293,8 @@ void Task_1s()
         Compteur_virtuel_s[0].valeur = 5; // Nombre de secondes avant le prochain déclenchement
         //UART_WriteString(MY_UART,"A");
 
-        // Vérification de la connexion au réseau Domokit
-        #ifdef __DOMOKIT_H__
-        Domokit_Start = Domokit.checkConnexion(); 
-        #endif
-
         // code ici
-        // Envoi d'une valeur aléatoire sur la jauge de l'application mobile
-        String mPayload = String(random(0,100));
-        Domokit.SendtoTile("test_graph",mPayload);
+        // (la vérification de la connexion Domokit est planifiée par la librairie)
     }
     /*
     // ##############################################################
@@ -13,21 +13,29 @@
 // ################################################################################
 // 									Objets / Dépendances
 // ################################################################################
-WiFiClient espClient;
-PubSubClient client(espClient);
+// Transport MQTT par défaut (voir DomoKit_Transport.h)
+#ifdef DOMOKIT_TRANSPORT_ASYNC
+Transport_Async transport_defaut;
+#else
+Transport_PubSub transport_defaut;
+#endif
+
+// Destination par défaut des mises à jour OTA et image de référence des deltas (voir DomoKit_OTA.h)
+OTA_Cible_Update ota_defaut;
+OTA_Source_Flash ota_source_defaut;
 
 // ################################################################################
 // 									Variables globales
 // ################################################################################
 // Clef de chiffrement du serveur
-String KEY_SERVEUR;
+char KEY_SERVEUR[TAILLE_CLEF];
 boolean key_serveur_dispo;
 
 
 // ################################################################################
 // 									Constructeur
 // ################################################################################
-Domokit::Domokit(String Nom_Appareil)
+Domokit::Domokit(Domokit_Texte Nom_Appareil)
 {
 	// Affectations des paramètres
 	_Wifi_Appairage_SSID 		  = SSID_WIFI_APPAIRAGE;
@@ -41,8 +49,47 @@ Domokit::Domokit(String Nom_Appareil)
 	
 	_MQTT_Main_Topic= MAIN_TOPIC;
 	
+	// Topics créés par Create_Topics
+	_Taille_Arene       = 0;
+  _Taille_Prefixe     = 0;
+  _QoS1_Topics_Objet  = 0;
+  for (int i = 0; i < NB_TOPICS; i++)
+  {
+    _Topics[i].ptr = "";
+    _Topics[i].len = 0;
+  }
+  topic_instruction   = "";
+  topic_donnees       = "";
+  topic_interruption  = "";
+  topic_connexion     = "";
+  topic_connect       = "";
+  topic_presence      = "";
+  topic_debug         = "";
+  topic_tile          = "";
+  topic_set_tile      = "";
+  topic_metriques     = "";
+  topic_ota           = "";
+
 	// Initialisation des autres variables
+  _Wifi_SSID      = _Wifi_Appairage_SSID;
+  _Wifi_Password  = _Wifi_Appairage_Password;
 	_TileID = 0;
+  _Transport = &transport_defaut;
+  _Alias_Autorise = false;
+  _Diffusion_Autorisee = false;
+  _OTA_Autorise = false;
+  _OTA.setCible(&ota_defaut);
+  _OTA.setSource(&ota_source_defaut);
+  _Journal_Flash = NULL;   // aucune zone par défaut : voir setOfflineLogFlash
+  _Journal_Autorise = false;
+  _Alias = -1;
+  _Latence_Max_us = 0;
+  _Latence_Moy_us = 0;
+  _Led_Allumee = false;
+  _Latence_Cmd_Max_us = 0;
+  _Latence_Cmd_Moy_us = 0;
+  for (uint8_t i = 0; i < CAPTEURS_NB_CANAUX; i++)
+    _Canaux[i].utilise = false;
 
   // Témoin lumineux (désactivé par défaut)
 	_LED_WIFI = false;
@@ -56,16 +103,31 @@ Domokit::Domokit(String Nom_Appareil)
   _LED_B = LED_B_PIN;
   #endif
 	
-	_NOM_APPAREIL 	= Nom_Appareil;
+	_NOM_APPAREIL 	= Domokit_CStr(Nom_Appareil);
 	_Program_Start	= false;
+  _Tache_Auth     = SCHEDULER_AUCUNE_TACHE;
+  _Auth_Delai_ms  = AUTH_DELAI_INITIAL_MS;
+  _Auth_Tentatives = 0;
+  _Auth_Debut_ms  = 0;
+  _Auth_Duree_ms  = 0;
+  _Sync_Demande   = -1;
+  _Tache_Horloge  = SCHEDULER_AUCUNE_TACHE;
+  _Nb_Mesures     = 0;
+  _Tache_Mesures  = SCHEDULER_AUCUNE_TACHE;
+  _Tache_Fenetre  = SCHEDULER_AUCUNE_TACHE;
+  _Differes       = 0;
+  _Tache_Connexion  = SCHEDULER_AUCUNE_TACHE;
+  _Tache_Demarrage  = SCHEDULER_AUCUNE_TACHE;
+  _Wifi_Association = -1;
+  _Wifi_Debut_ms    = 0;
 
   // Obtention de l'adresse MAC du client
   uint8_t mac[6];
   WiFi.macAddress(mac);
-  _ADDR_MAC = macToStr(mac);
+  macToStr(mac);
 
   // Génération du nom client à partir de l'adresse MAC de l'objet et de son nom
-  _CLIENT_NAME = _NOM_APPAREIL + '_' + _ADDR_MAC;
+  _CLIENT_NAME.format("%s_%s", _NOM_APPAREIL.c_str(), _ADDR_MAC.c_str());
 }
 
 
@@ -93,13 +155,124 @@ void Domokit::disableLedWifi(void)
 }
 
 // Défini le nom de l'appareil
-void Domokit::setName(String Name)
+void Domokit::setName(Domokit_Texte Name)
+{
+	_NOM_APPAREIL = Domokit_CStr(Name);
+}
+
+// Défini le transport MQTT utilisé par l'objet (à appeler avant begin)
+void Domokit::setTransport(Domokit_Transport* transport)
+{
+  _Transport = transport;
+}
+
+// Autorise le serveur à attribuer un alias court aux topics de l'objet
+void Domokit::enableTopicAlias(void)
+{
+  _Alias_Autorise = true;
+}
+
+// Autorise la mise à jour du firmware par MQTT (instructions OTA)
+void Domokit::enableOTA(void)
+{
+  _OTA_Autorise = true;
+}
+
+/*===============================================================================
+  Nom 			: enableRadioWindows
+  
+  Description	: Place le wifi en modem sleep et regroupe les émissions de
+                l'objet dans des fenêtres périodiques (voir DomoKit_Radio.h)
+  
+  Paramètre(s) 	: periode_ms : période souhaitée des fenêtres
+                  dtim : intervalle d'écoute du modem sleep (en beacons)
+  
+  Retour		: période retenue (multiple de l'intervalle DTIM)
+===============================================================================*/
+unsigned long Domokit::enableRadioWindows(unsigned long periode_ms, uint8_t dtim)
+{
+  unsigned long periode = _Radio.configure(periode_ms, dtim);
+
+  WiFi.setSleepMode(WIFI_MODEM_SLEEP, dtim);
+
+  if (_Tache_Fenetre != SCHEDULER_AUCUNE_TACHE)
+    _Scheduler.setPeriod(_Tache_Fenetre, periode);
+  else
+    _Tache_Fenetre = _Scheduler.every("radio", periode, [this] () {
+      this->openWindow();
+    });
+  return periode;
+}
+
+// Reçoit les instructions adressées à tous les objets (<MAIN_TOPIC>/instruction/tous)
+// Seules CONNECT, SNAPSHOT, STOP et ATTENTE y sont acceptées (voir isGroupInstruction)
+void Domokit::enableBroadcast(void)
+{
+  _Diffusion_Autorisee = true;
+  if (_Transport->connected() && _Topics[TOPIC_DIFFUSION].len > 0)
+    this->MQTT_Subscribe(_Topics[TOPIC_DIFFUSION].ptr);
+}
+
+/*===============================================================================
+  Nom 			: joinGroup
+  
+  Description	: Reçoit les instructions adressées à un groupe d'objets
+                (<MAIN_TOPIC>/instruction/groupe/<nom>), limitées aux mêmes
+                instructions que la diffusion (voir isGroupInstruction)
+  
+  Paramètre(s) 	: groupe : nom du groupe
+  
+  Retour		: false si l'objet appartient déjà à NB_GROUPES_MAX groupes
+===============================================================================*/
+bool Domokit::joinGroup(Domokit_Texte groupe)
+{
+  for (uint8_t i = 0; i < NB_GROUPES_MAX; i++)
+  {
+    if (_Topics_Groupes[i].length() > 0)
+      continue;
+
+    _Topics_Groupes[i].format("%s/instruction/%s/%s", _MQTT_Main_Topic, GROUPE_TOPIC, Domokit_CStr(groupe));
+    if (_Transport->connected())
+      this->MQTT_Subscribe(_Topics_Groupes[i].c_str());
+    return true;
+  }
+  return false;
+}
+
+// Enregistre en flash les valeurs envoyées aux tiles hors connexion, renvoyées à la reconnexion
+// (nécessite une zone flash dédiée, fournie par setOfflineLogFlash avant begin)
+void Domokit::enableOfflineLog(void)
+{
+  _Journal_Autorise = true;
+}
+
+// Défini la zone flash réservée au journal hors connexion (effacée par le journal,
+// voir DomoKit_Journal.h pour la réserver). Sans zone, le journal reste inactif
+void Domokit::setOfflineLogFlash(Domokit_Flash* flash)
+{
+  _Journal_Flash = flash;
+}
+
+// Défini la destination des mises à jour OTA (par défaut : Updater de l'ESP8266)
+void Domokit::setOTATarget(Domokit_OTA_Cible* cible)
 {
-	_NOM_APPAREIL = Name;
+  _OTA.setCible(cible);
+}
+
+// Défini l'image de référence des mises à jour différentielles (par défaut : sketch en flash)
+void Domokit::setOTASource(Domokit_OTA_Source* source)
+{
+  _OTA.setSource(source);
+}
+
+// Modèle de consommation (NULL : Modele_ESP8266), voir DomoKit_Energie.h
+void Domokit::setEnergyModel(Domokit_Modele_Energie* modele)
+{
+  _Energie.setModel(modele);
 }
 
 // Défini le SSID/Password de la box Domokit (en mode de fonctionnement normal)
-void Domokit::setWifi(String Wifi_SSID , String Wifi_Password)
+void Domokit::setWifi(const char* Wifi_SSID , const char* Wifi_Password)
 {
   _Wifi_Normal_SSID = Wifi_SSID;
   _Wifi_Normal_Password = Wifi_Password;
@@ -114,8 +287,8 @@ void Domokit::setWifiMode(int Mode)
   {
     // Mode normal
     case 0 : 
-      _Wifi_SSID      = _Wifi_Normal_SSID;
-      _Wifi_Password  = _Wifi_Normal_Password;
+      _Wifi_SSID      = _Wifi_Normal_SSID.c_str();
+      _Wifi_Password  = _Wifi_Normal_Password.c_str();
     break;
 
     // Mode appairage
@@ -132,13 +305,49 @@ void Domokit::setWifiMode(int Mode)
 // Active le programme
 void Domokit::startProgram()
 {
+  // fin des demandes d'authentification
+  if (!_Program_Start)
+    _Auth_Duree_ms = millis() - _Auth_Debut_ms;
+  _Scheduler.cancel(_Tache_Auth);
+  _Tache_Auth = SCHEDULER_AUCUNE_TACHE;
+  _Auth_Delai_ms = AUTH_DELAI_INITIAL_MS;
+
 	_Program_Start = true;
+  _Demarrage.end(DEMARRAGE_AUTH);
+
+  // Synchronisation de l'horloge dès l'authentification
+  _Scheduler.trigger(_Tache_Horloge);
 }
 
 // Arrête le programme
 void Domokit::stopProgram()
 {
 	_Program_Start = false;
+
+  // l'alias sera renégocié lors de la prochaine authentification
+  setAlias(-1);
+
+  _Auth_Tentatives = 0;
+  _Auth_Debut_ms = millis();
+  _Auth_Duree_ms = 0;
+}
+
+// Défini l'alias attribué par le serveur (-1 = pas d'alias)
+void Domokit::setAlias(int alias)
+{
+  _Alias = alias;
+  if (alias < 0)
+  {
+    _Topic_Alias.clear();
+    _Topic_Alias_Instruction.clear();
+    return;
+  }
+  _Topic_Alias.format("%s/%s/%d", _MQTT_Main_Topic, ALIAS_TOPIC, alias);
+  _Topic_Alias_Instruction.format("%s/instruction/%s/%d", _MQTT_Main_Topic, ALIAS_TOPIC, alias);
+
+  // Commandes adressées par alias : <MAIN_TOPIC>/instruction/a/<alias>/<id tile>
+  if (_Transport->connected())
+    this->subscribeSubtree(_Topic_Alias_Instruction.c_str());
 }
 
 // ################################################################################
@@ -151,9 +360,57 @@ boolean Domokit::getStateProgram()
 }
 
 // Renvoie l'adresse MAC de l'objet
-String Domokit::getAddrMac()
+const char* Domokit::getAddrMac()
 {
-  return _ADDR_MAC;
+  return _ADDR_MAC.c_str();
+}
+
+// Renvoie un topic de l'objet (vue sur l'arène des topics)
+Protocole_Vue Domokit::getTopic(Domokit_TopicId id)
+{
+  return _Topics[id];
+}
+
+// Renvoie la session de mise à jour OTA (progression, erreurs)
+Domokit_OTA& Domokit::getOTA()
+{
+  return _OTA;
+}
+
+Domokit_Journal& Domokit::getOfflineLog()
+{
+  return _Journal;
+}
+
+Domokit_Horloge& Domokit::getClock()
+{
+  return _Horloge;
+}
+
+Domokit_Liaison& Domokit::getLink()
+{
+  return _Liaison;
+}
+
+Domokit_Radio& Domokit::getRadio()
+{
+  return _Radio;
+}
+
+Domokit_Energie& Domokit::getEnergy()
+{
+  return _Energie;
+}
+
+Domokit_Demarrage& Domokit::getBootTimeline()
+{
+  return _Demarrage;
+}
+
+// Renvoie l'ordonnanceur de l'objet (pour y ajouter les tâches de l'application)
+Domokit_Scheduler& Domokit::getScheduler()
+{
+  return _Scheduler;
 }
 
 
@@ -216,6 +473,7 @@ void Domokit::allumerLedWifi(Statut_Wifi Mode)
 ===============================================================================*/
 void Domokit::clignoterLedWifi(Statut_Wifi Mode,int Nb_clignotement, int Duree_clignotement_ms)
 {
+  PROFIL_PORTEE("clignoterLedWifi");
 if(_LED_WIFI == true)
   {
     // la led Wifi clignote tant que l'objet n'est pas authentifié auprès du serveur
@@ -240,44 +498,281 @@ if(_LED_WIFI == true)
 /*===============================================================================
   Nom 			: 	begin
   
-  Description	: 	routine d'initialisation de l'objet Domokit
+  Description	: 	routine d'initialisation de l'objet Domokit.
+					L'association wifi est lancée sans être attendue : la
+					préparation de l'objet (topics, QoS 1, règles, journal) puis
+					le reste du setup() de l'application (capteurs...) se font
+					pendant l'association. La connexion au broker est tentée dès
+					l'adresse IP obtenue (voir serviceBoot).
   
   Paramètre(s) 	: 	aucun
   
   Retour		: 	aucun
 ===============================================================================*/
 void Domokit::begin(){
+  PROFIL_PORTEE("begin");
 	DEBUG_PRINT("Librairie Domokit Version "); DEBUG_PRINTLN(VERSION_DOMOKIT);
   
   
   // Témoin d'activité wifi
   allumerLedWifi(APPAIRAGE);
 
+  // Temps jusqu'à la première télémétrie : mesuré depuis begin()
+  _Demarrage.start(DEMARRAGE_TELEMETRIE);
+
   // Récupération du SSID et du Password en mémoire de l'objet
+  _Demarrage.start(DEMARRAGE_EEPROM);
   this->Wifi_Data_EEPROM();
+  _Demarrage.end(DEMARRAGE_EEPROM);
 
+  // Chronologie : association au point d'accès, puis obtention de l'adresse IP
+  _Evt_Wifi_Associe = WiFi.onStationModeConnected([this] (const WiFiEventStationModeConnected&) {
+    _Demarrage.end(DEMARRAGE_WIFI);
+    _Demarrage.start(DEMARRAGE_DHCP);
+  });
+  _Evt_Wifi_IP = WiFi.onStationModeGotIP([this] (const WiFiEventStationModeGotIP&) {
+    _Demarrage.end(DEMARRAGE_DHCP);
+  });
 
   // Si des paramètres de connexion ont été trouvé, alors on tente de se connecter au wifi domokit
-  if (_Wifi_Normal_Password != "")
+  if (_Wifi_Normal_Password.length() > 0)
   {
     DEBUG_PRINTLN("Connexion au réseau wifi Domokit...");
-    this->ConnexionWifi(NB_TENTATIVE_CONNEXION,WIFI_MODE_NORMAL);
+    this->startWifi(WIFI_MODE_NORMAL);
   }
   // Sinon on tente de se connecter au wifi appairage
 	else
 	{
     DEBUG_PRINTLN("Aucune configuration Wifi trouvée. Connexion au réseau wifi Appairage...");
-    this->ConnexionWifi(NB_TENTATIVE_CONNEXION,WIFI_MODE_APPAIRAGE);
-    //this->setWifiMode(1);
-    //this->setup_wifi();
+    this->startWifi(WIFI_MODE_APPAIRAGE);
 	}
-  
 
-  // Connexion au serveur mqtt
-  this->setup_mqtt();
+  // Préparation de l'objet pendant l'association
+  _Demarrage.start(DEMARRAGE_PREPARATION);
 
   // Création des topics mqtt 
   this->Create_Topics();
+
+  // Paramètres du serveur mqtt (la connexion est faite par la tâche de connexion)
+  this->setup_mqtt();
+
+  // Récupération des messages QoS 1 non acquittés avant le redémarrage
+  #ifdef DOMOKIT_QOS_PERSISTANT
+    _Inflight.restore();
+  #endif
+
+  // Règles locales : actives avant même la connexion au serveur
+  _Regles.restore();
+
+  // Journal hors connexion : reprise du renvoi après le dernier enregistrement renvoyé
+  if (_Journal_Autorise && !_Journal.begin(_Journal_Flash))
+    DEBUG_PRINTLN("Journal hors connexion : aucune zone flash dédiée (voir setOfflineLogFlash)");
+
+  _Demarrage.end(DEMARRAGE_PREPARATION);
+
+  // Tâches internes exécutées par poll()
+  this->startTasks();
+}
+
+/*===============================================================================
+  Nom 			: 	serviceBoot
+  
+  Description	: 	Tâche de démarrage : dès que le wifi est connecté, déclenche
+					la tâche de connexion (broker puis authentification) sans
+					attendre sa prochaine échéance, puis se supprime
+  
+  Paramètre(s) 	: 	aucun
+  
+  Retour		: 	aucun
+===============================================================================*/
+void Domokit::serviceBoot()
+{
+  if (WiFi.status() != WL_CONNECTED)
+    return;
+
+  _Demarrage.end(DEMARRAGE_WIFI);
+  _Demarrage.end(DEMARRAGE_DHCP);
+
+  _Scheduler.trigger(_Tache_Connexion);
+  _Scheduler.cancel(_Tache_Demarrage);
+  _Tache_Demarrage = SCHEDULER_AUCUNE_TACHE;
+}
+
+/*===============================================================================
+  Nom 			: 	reportOverruns
+  
+  Description	: 	Signale les sites de profilage ayant dépassé le budget depuis
+					le dernier signalement, sur Serial (debug) et topic_metriques :
+					profil=site;duree_max=µs;p99=µs;appels=n;depassements=n;dernier=µs
+  
+  Paramètre(s) 	: 	aucun
+  
+  Retour		: 	aucun
+===============================================================================*/
+void Domokit::reportOverruns()
+{
+#ifdef DOMOKIT_PROFIL
+  char payload[TAILLE_TRAME];
+  int8_t site = 0;
+
+  while (profil_domokit.nextOverrun(&site))
+  {
+    const Profil_Site* s = profil_domokit.getSite(site);
+
+    snprintf(payload, sizeof(payload), "profil=%s;duree_max=%lu;p99=%lu;appels=%lu;depassements=%lu;dernier=%lu",
+             s->nom, (unsigned long)s->duree_max_us, (unsigned long)profil_domokit.getPercentile(site, 99),
+             (unsigned long)s->nb_appels, (unsigned long)s->nb_depassements, (unsigned long)s->dernier_depassement_us);
+
+    DEBUG_PRINT("Blocage : "); DEBUG_PRINTLN(payload);
+    if (_Transport->connected())
+      this->MQTT_Send(topic_metriques, payload);
+    site++;
+  }
+#endif
+}
+
+// Publie la chronologie du démarrage sur topic_metriques (une seule fois)
+void Domokit::publishBootTimeline()
+{
+  char payload[2 * TAILLE_TRAME];
+
+  if (!_Transport->connected())
+    return;
+  if (_Demarrage.encode(payload, sizeof(payload)) > 0)
+    this->MQTT_Send(topic_metriques, payload);
+
+  #ifdef DEBUG_DOMOKIT
+    _Demarrage.print(Serial);
+  #endif
+}
+
+/*===============================================================================
+  Nom 			: 	startTasks
+  
+  Description	: 	Enregistre les tâches internes de la librairie dans l'ordonnanceur.
+                  Elles sont exécutées par poll(), avec les tâches de l'application.
+  
+  Paramètre(s) 	: 	aucun
+  
+  Retour		: 	aucun
+===============================================================================*/
+void Domokit::startTasks()
+{
+  // Connexion wifi / MQTT et authentification auprès du serveur
+  _Tache_Connexion = _Scheduler.every("connexion", PERIODE_CONNEXION_MS, [this] () {
+    this->checkConnexion();
+  });
+
+  // Démarrage : connexion au broker dès que le wifi est prêt
+  _Tache_Demarrage = _Scheduler.every("demarrage", PERIODE_DEMARRAGE_MS, [this] () {
+    this->serviceBoot();
+  });
+
+  // Signalement des appels plus longs que le budget (voir DomoKit_Profil.h)
+  #ifdef DOMOKIT_PROFIL
+  _Scheduler.every("profil", PROFIL_PERIODE_RAPPORT_MS, [this] () {
+    this->reportOverruns();
+  });
+  #endif
+
+  // Témoin lumineux : clignote tant que l'objet n'est pas authentifié
+  _Scheduler.every("led", PERIODE_LED_MS, [this] () {
+    if (_Program_Start)
+      return;
+    _Led_Allumee = !_Led_Allumee;
+    allumerLedWifi(_Led_Allumee ? APPAIRAGE : ETEINT);
+  });
+
+  // Renvois des messages QoS 1 non acquittés
+  _Scheduler.every("qos", PERIODE_QOS_MS, [this] () {
+    _Inflight.service(_Transport);
+  });
+
+  // Publication périodique des métriques
+  _Scheduler.every("metriques", PERIODE_METRIQUES_MS, [this] () {
+    if (_Transport->connected() && !this->deferToWindow(DIFFERE_METRIQUES))
+      this->publishMetrics();
+  });
+
+  // Signal de présence spontané (même trame que la réponse à CONNECT)
+  _Scheduler.every("heartbeat", PERIODE_HEARTBEAT_MS, [this] () {
+    if (!this->deferToWindow(DIFFERE_PRESENCE))
+      this->sendHeartbeat();
+  });
+
+  // Ping, détection des liaisons mortes et publication des valeurs regroupées
+  _Scheduler.every("liaison", LIAISON_PERIODE_MS, [this] () {
+    this->serviceLink();
+  });
+
+  // Synchronisation de l'horloge sur l'heure du serveur
+  _Tache_Horloge = _Scheduler.every("horloge", HORLOGE_PERIODE_SYNC_MS, [this] () {
+    if (!this->deferToWindow(DIFFERE_HORLOGE))
+      this->syncClock();
+  });
+
+  // Renvoi du journal hors connexion, une trame par période
+  if (_Journal.isActive())
+  {
+    _Scheduler.every("backfill", JOURNAL_PERIODE_BACKFILL_MS, [this] () {
+      if (!this->deferToWindow(DIFFERE_BACKFILL))
+        this->publishBackfill();
+    });
+  }
+}
+
+// Signal de présence : deux premières lettres de l'@mac sur topic_connect
+void Domokit::sendHeartbeat()
+{
+  if (!_Program_Start || !_Transport->connected())
+    return;
+  char presence[3] = { _ADDR_MAC[0], _ADDR_MAC[1], '\0' };
+  this->MQTT_Send(topic_connect, presence);
+}
+
+// Vrai si la tâche doit attendre la prochaine fenêtre d'émission (elle y sera exécutée)
+bool Domokit::deferToWindow(uint8_t tache)
+{
+  if (_Radio.isOpen())
+    return false;
+  _Differes |= tache;
+  return true;
+}
+
+/*===============================================================================
+  Nom 			: 	openWindow
+  
+  Description	: 	Ouvre une fenêtre d'émission : exécute les tâches différées,
+					publie les valeurs en attente des tiles et les pings, puis
+					ferme la fenêtre après RADIO_DUREE_FENETRE_MS (réception des
+					acquittements et des réponses)
+  
+  Paramètre(s) 	: 	aucun
+  
+  Retour		: 	aucun
+===============================================================================*/
+void Domokit::openWindow()
+{
+  uint8_t differes = _Differes;
+
+  _Radio.open();
+  _Differes = 0;
+
+  if ((differes & DIFFERE_METRIQUES) && _Transport->connected())
+    this->publishMetrics();
+  if (differes & DIFFERE_PRESENCE)
+    this->sendHeartbeat();
+  if (differes & DIFFERE_HORLOGE)
+    this->syncClock();
+  if (differes & DIFFERE_MESURES)
+    this->publishSamples();
+  if (differes & DIFFERE_BACKFILL)
+    this->publishBackfill();
+  this->serviceLink();
+
+  _Scheduler.once("fenetre", RADIO_DUREE_FENETRE_MS, [this] () {
+    _Radio.close();
+  });
 }
 
 
@@ -291,28 +786,36 @@ void Domokit::begin(){
   Retour		: 	aucun (complète des variables globales)
 ===============================================================================*/
 void Domokit::Wifi_Data_EEPROM(){
-  String Buffer_EEPROM;
-  Buffer_EEPROM = Read_STR_EEPROM(510,EEPROM_ADDR_WIFI);
+  char Buffer_EEPROM[TAILLE_WIFI_DATA + 1];
+  Protocole_Vue champs[3];
+  size_t nb_champs;
+
+  Read_EEPROM(Buffer_EEPROM, TAILLE_WIFI_DATA, EEPROM_ADDR_WIFI);
 
   DEBUG_PRINT("eeprom : ");DEBUG_PRINTLN(Buffer_EEPROM);
 
-  _Wifi_Normal_SSID = ParseString(Buffer_EEPROM,';',0);
-  _Wifi_Normal_Password = ParseString(Buffer_EEPROM,';',1);
-  KEY_SERVEUR = ParseString(Buffer_EEPROM,';',2);
+  // Format : ssid;password[;clef]
+  nb_champs = Protocole_Split(Buffer_EEPROM, strlen(Buffer_EEPROM), champs, 3);
+  _Wifi_Normal_SSID.clear();
+  _Wifi_Normal_Password.clear();
+  KEY_SERVEUR[0] = '\0';
+  if (nb_champs > 0) _Wifi_Normal_SSID.set(champs[0].ptr, champs[0].len);
+  if (nb_champs > 1) _Wifi_Normal_Password.set(champs[1].ptr, champs[1].len);
+  if (nb_champs > 2) Protocole_VueCopy(champs[2], KEY_SERVEUR, sizeof(KEY_SERVEUR));
 
     
   // affichage au terminal
   #ifdef DEBUG_WIFI_DATA
     DEBUG_PRINT("SSID eeprom : ");
-    DEBUG_PRINTLN(_Wifi_Normal_SSID);
+    DEBUG_PRINTLN(_Wifi_Normal_SSID.c_str());
     DEBUG_PRINT("Password eeprom : ");
-    DEBUG_PRINTLN(_Wifi_Normal_Password);
+    DEBUG_PRINTLN(_Wifi_Normal_Password.c_str());
     DEBUG_PRINT("Clef de chiffrement (serveur) eeprom :");
     DEBUG_PRINTLN(KEY_SERVEUR);
   #endif
 
   // Vérification de la clef de chiffrement serveur (pour le cryptage des données)
-  key_serveur_dispo = (KEY_SERVEUR != "")? true:false;
+  key_serveur_dispo = (KEY_SERVEUR[0] != '\0')? true:false;
 }
 
 // ################################################################################
@@ -328,10 +831,10 @@ void Domokit::Wifi_Data_EEPROM(){
   
   Retour		: 	aucun
 ===============================================================================*/
-void Domokit::Debug_MQTT_Print(String message)
+void Domokit::Debug_MQTT_Print(Domokit_Texte message)
 {
   #ifdef DEBUG_DOMOKIT
-    this->MQTT_Send(topic_debug,message);
+    this->MQTT_Send(topic_debug,Domokit_CStr(message));
   #endif
 }
 
@@ -346,6 +849,7 @@ void Domokit::Debug_MQTT_Print(String message)
 ===============================================================================*/
 void Domokit::setup_wifi() 
 {
+  PROFIL_PORTEE("setup_wifi");
   //delay(10);
   
   // On masque le point d'accès wifi généré par l'ESP et on passe en mode station
@@ -355,7 +859,7 @@ void Domokit::setup_wifi()
   //delay(10);
 
   // Connexion au point d'accès wifi
-  WiFi.begin((char*)_Wifi_SSID.c_str(), (char*)_Wifi_Password.c_str());
+  WiFi.begin((char*)_Wifi_SSID, (char*)_Wifi_Password);
   allumerLedWifi(NON_CONNECTE);
 
   // affichage au terminal
@@ -396,33 +900,16 @@ void Domokit::setup_wifi()
 ===============================================================================*/
 boolean Domokit::ConnexionWifi(int nb_tentative,int mode)
 {
+  PROFIL_PORTEE("ConnexionWifi");
   int i = 0;
+  unsigned long debut = millis();
 
   // Mise à jour des informations wifi si on se connecte en mode normal
   if(mode == WIFI_MODE_NORMAL){
     this->Wifi_Data_EEPROM();
   }
 
-  // On défini le mode du wifi
-  this->setWifiMode(mode);
-  
-  // On se déconnecte du wifi actuel
-  WiFi.disconnect();
-  
-  // On prépare les nouveaux paramètres de connexion
-  WiFi.mode(WIFI_STA);
-  WiFi.hostname((char*)_CLIENT_NAME.c_str());
-
-  // Affichage au terminal
-  #ifdef DEBUG_WIFI_DATA
-    DEBUG_PRINTLN();
-    DEBUG_PRINT("Connexion au hostspot "); DEBUG_PRINTLN(_Wifi_SSID);
-    DEBUG_PRINT("Password : ");           DEBUG_PRINTLN(_Wifi_Password);
-    DEBUG_PRINT("En tant que ");          DEBUG_PRINTLN(WiFi.hostname());
-    DEBUG_PRINTLN();
-  #endif
-
-  WiFi.begin((char*)_Wifi_SSID.c_str(), (char*)_Wifi_Password.c_str());
+  this->startWifi(mode);
 
   //delay(10);
   // On essaye de se connecter au wifi Domokit
@@ -431,6 +918,8 @@ boolean Domokit::ConnexionWifi(int nb_tentative,int mode)
       // Si la connexion fonctionne, on peut sortir de la fonction
     if (WiFi.status() == WL_CONNECTED)
     {
+      _Energie.countWifiAttempt(millis() - debut);
+      _Wifi_Association = -1;
       DEBUG_PRINTLN();
       DEBUG_PRINTLN("connexion au wifi Domokit OK");
       DEBUG_PRINT("Adresse IP : ["); DEBUG_PRINT(WiFi.localIP()); DEBUG_PRINTLN("]");
@@ -442,6 +931,9 @@ boolean Domokit::ConnexionWifi(int nb_tentative,int mode)
     DEBUG_PRINT(".");
   }
     
+    _Energie.countWifiAttempt(millis() - debut);
+    _Wifi_Association = -1;
+
     // Si aucune tentative n'a marché, alors on bascule sur l'autre réseau'
     if(mode == WIFI_MODE_APPAIRAGE)
     {
@@ -456,6 +948,42 @@ boolean Domokit::ConnexionWifi(int nb_tentative,int mode)
     return true;
 }
 
+/*===============================================================================
+  Nom 			: 	startWifi
+  
+  Description	: 	Lance l'association au wifi choisi, sans attendre la connexion
+  
+  Paramètre(s) 	: 	mode : mode de connexion (0 = normal / 1 = appairage)
+  
+  Retour		: 	aucun
+===============================================================================*/
+void Domokit::startWifi(int mode)
+{
+  // On défini le mode du wifi
+  this->setWifiMode(mode);
+  
+  // On se déconnecte du wifi actuel
+  WiFi.disconnect();
+  
+  // On prépare les nouveaux paramètres de connexion
+  WiFi.mode(WIFI_STA);
+  WiFi.hostname((char*)_CLIENT_NAME.c_str());
+
+  // Affichage au terminal
+  #ifdef DEBUG_WIFI_DATA
+    DEBUG_PRINTLN();
+    DEBUG_PRINT("Connexion au hostspot "); DEBUG_PRINTLN(_Wifi_SSID);
+    DEBUG_PRINT("Password : ");           DEBUG_PRINTLN(_Wifi_Password);
+    DEBUG_PRINT("En tant que ");          DEBUG_PRINTLN(WiFi.hostname());
+    DEBUG_PRINTLN();
+  #endif
+
+  _Wifi_Association = mode;
+  _Wifi_Debut_ms = millis();
+  _Demarrage.start(DEMARRAGE_WIFI);
+  WiFi.begin((char*)_Wifi_SSID, (char*)_Wifi_Password);
+}
+
 /*===============================================================================
   Nom 			: 	checkConnexion
   
@@ -472,10 +1000,11 @@ boolean Domokit::checkConnexion()
 
   if (_Program_Start == false)
   {
-      // Trame d'initialisation : le client envoie ses informations principales au serveur
-      MQTT_Send(topic_connexion,(_ADDR_MAC + ";" + _CLIENT_NAME));
-      
-      DEBUG_PRINTLN("Authentification en cours..."); 
+      // Première demande d'authentification étalée sur AUTH_DELAI_INITIAL_MS :
+      // après une coupure de courant, les objets ne se présentent pas tous
+      // en même temps au serveur
+      if (_Tache_Auth == SCHEDULER_AUCUNE_TACHE)
+        scheduleAuth(random(_Auth_Delai_ms + 1));
       
       // Clignotement de la led wifi tant qu'on est pas authentifié
       //clignoterLedWifi(APPAIRAGE,3,1000);
@@ -492,6 +1021,70 @@ boolean Domokit::checkConnexion()
 }
 
 
+/*===============================================================================
+  Nom 			: 	scheduleAuth
+  
+  Description	: 	Planifie la prochaine demande d'authentification
+  
+  Paramètre(s) 	: 	delai_ms : délai avant l'envoi de la trame de connexion
+  
+  Retour		: 	aucun
+===============================================================================*/
+void Domokit::scheduleAuth(unsigned long delai_ms)
+{
+  _Scheduler.cancel(_Tache_Auth);
+  _Tache_Auth = _Scheduler.once("auth", delai_ms, [this] () {
+    this->sendAuthRequest();
+  });
+}
+
+/*===============================================================================
+  Nom 			: 	sendAuthRequest
+  
+  Description	: 	Envoie la trame de connexion au serveur, puis planifie la
+					demande suivante (si START n'est pas reçu d'ici là) après un
+					délai tiré entre la moitié et la totalité du délai courant,
+					qui double à chaque tentative jusqu'à AUTH_DELAI_MAX_MS.
+					Le tirage aléatoire (générateur matériel de l'ESP8266)
+					désynchronise les objets qui ont démarré ensemble.
+  
+  Paramètre(s) 	: 	aucun
+  
+  Retour		: 	aucun
+===============================================================================*/
+void Domokit::sendAuthRequest()
+{
+  _Tache_Auth = SCHEDULER_AUCUNE_TACHE;
+  if (_Program_Start)
+    return;
+
+  // Pas de connexion au broker : checkConnexion replanifie la demande
+  if (!_Transport->connected())
+    return;
+
+  // Trame d'initialisation : le client envoie ses informations principales au serveur
+  // (le champ ALIAS indique que l'objet accepte les alias de topics)
+  char trame[TAILLE_TRAME];
+  if (Protocole_EncodeConnexion(trame, sizeof(trame), _ADDR_MAC.c_str(), _CLIENT_NAME.c_str(), _Alias_Autorise) > 0)
+    MQTT_Send(topic_connexion,trame);
+  _Auth_Tentatives++;
+
+  DEBUG_PRINT("Authentification en cours... tentative "); DEBUG_PRINTLN(_Auth_Tentatives);
+
+  _Auth_Delai_ms = (_Auth_Delai_ms >= AUTH_DELAI_MAX_MS / 2) ? AUTH_DELAI_MAX_MS : _Auth_Delai_ms * 2;
+  scheduleAuth(_Auth_Delai_ms / 2 + random(_Auth_Delai_ms / 2 + 1));
+}
+
+uint16_t Domokit::getAuthAttempts()
+{
+  return _Auth_Tentatives;
+}
+
+unsigned long Domokit::getAuthDuration()
+{
+  return _Auth_Duree_ms;
+}
+
 /*===============================================================================
   Nom 			: Check_Connexion_Wifi
   
@@ -508,43 +1101,490 @@ boolean Domokit::Check_Connexion_Wifi()
   // Vérification de la connexion wifi
   if(WiFi.status() != WL_CONNECTED)
   {
+    // Association lancée par begin() : on la laisse aboutir, puis on bascule
+    // sur l'autre réseau comme ConnexionWifi
+    if (_Wifi_Association >= 0)
+    {
+      int mode = _Wifi_Association;
+      if (millis() - _Wifi_Debut_ms < WIFI_DUREE_ASSOCIATION_MS)
+        return false;
+
+      _Energie.countWifiAttempt(millis() - _Wifi_Debut_ms);
+      _Wifi_Association = -1;
+      DEBUG_PRINTLN("Impossible de se connecter au wifi. Changement de réseau");
+      ConnexionWifi(NB_TENTATIVE_CONNEXION, (mode == WIFI_MODE_NORMAL) ? WIFI_MODE_APPAIRAGE : WIFI_MODE_NORMAL);
+      return false;
+    }
+
     ConnexionWifi(NB_TENTATIVE_CONNEXION,WIFI_MODE_NORMAL);
     return false;
   }
 
+  // Fin de l'association lancée par begin()
+  if (_Wifi_Association >= 0)
+  {
+    _Energie.countWifiAttempt(millis() - _Wifi_Debut_ms);
+    _Wifi_Association = -1;
+    DEBUG_PRINT("Adresse IP : ["); DEBUG_PRINT(WiFi.localIP()); DEBUG_PRINTLN("]");
+  }
+
   // Vérification de la connexion au serveur MQTT
-  if (!client.connected()) {
+  if (!_Transport->connected()) {
     if (!reconnect_mqtt());
       return false;
   }
   
-  return client.loop();
+  _Inflight.service(_Transport);
+  return _Transport->loop();
 }
 
 
 void Domokit::verifierMQTT_Receive()
 { 
-  client.loop();
+  _Transport->loop();
+  _Inflight.service(_Transport);
 }
+
 /*===============================================================================
-  Nom 			: 	macToStr
+  Nom 			: poll
   
-  Description	: 	permet de convertir une adresse mac contenue dans un tableau d'octets
-					en une chaîne de caractère de type String.
+  Description	: Routine à appeler dans loop() : réception MQTT, tâches de
+                l'ordonnanceur (connexion, témoin lumineux, renvois QoS 1,
+                présence, tâches de l'application) et publication des
+                évènements remontés par les interruptions.
+                Chaque évènement est publié sur la tile associée à sa source
+                (routeEventToTile), sinon sur topic_interruption au format
+                source;valeur;délai depuis l'interruption (µs)
   
-  Paramètre(s) 	: 	aucun
+  Paramètre(s) 	: aucun
+  
+  Retour		: aucun
+===============================================================================*/
+void Domokit::poll()
+{
+  Domokit_Evenement evenement;
+  uint32_t latence;
+  uint32_t debut = micros();
+  PROFIL_PORTEE("poll");
+
+  // Réception MQTT à chaque appel : tous les messages en attente sont traités
+  // tant que le budget de temps n'est pas dépassé
+  do
+  {
+    PROFIL_PORTEE("mqtt");
+    _Transport->loop();
+  } while (_Transport->available() > 0 && (micros() - debut) < POLL_BUDGET_US);
+
+  _Scheduler.run();
+
+  // Suivi du débordement de millis() par l'horloge monotone
+  _Horloge.monotonic();
+
+  while (_Evenements.pop(&evenement))
+  {
+    this->runRules(DECLENCHEUR_EVENEMENT, evenement.source, evenement.valeur);
+
+    latence = micros() - evenement.date_us;
+    this->publishEvent(evenement.source, evenement.valeur, latence);
+
+    // Latence interruption -> publication
+    latence = micros() - evenement.date_us;
+    if (latence > _Latence_Max_us) _Latence_Max_us = latence;
+    _Latence_Moy_us = (_Latence_Moy_us == 0) ? latence : (_Latence_Moy_us * 7 + latence) / 8;
+  }
+
+  // Temps CPU de la librairie pour cette boucle
+  _Energie.countLoop(micros() - debut);
+}
+
+// Publie un évènement sur la tile associée à sa source, sinon sur topic_interruption
+void Domokit::publishEvent(uint8_t source, int32_t valeur, uint32_t latence)
+{
+  char payload[TAILLE_TRAME];
+
+  if (source < EVENEMENTS_NB_SOURCES && _Routes_Evenements[source].length() > 0)
+  {
+    snprintf(payload, sizeof(payload), "%ld", (long)valeur);
+    SendtoTile(_Routes_Evenements[source].c_str(), payload);
+  }
+  else
+  {
+    snprintf(payload, sizeof(payload), "%u;%ld;%lu", source, (long)valeur, (unsigned long)latence);
+    MQTT_Send(topic_interruption, payload);
+  }
+}
+
+/*===============================================================================
+  Nom 			: pushEvent
+  
+  Description	: Ajoute un évènement dans la file de l'objet.
+                Fonction placée en RAM : à appeler depuis une interruption.
+  
+  Paramètre(s) 	: source : identifiant de la source (0 à EVENEMENTS_NB_SOURCES-1
+                           pour pouvoir être routée vers une tile)
+                  valeur : donnée associée
+  
+  Retour		: false si la file est pleine
+===============================================================================*/
+bool ICACHE_RAM_ATTR Domokit::pushEvent(uint8_t source, int32_t valeur)
+{
+  return _Evenements.push(source, valeur);
+}
+
+// Publie les évènements d'une source sur une tile plutôt que sur topic_interruption
+void Domokit::routeEventToTile(uint8_t source, Domokit_Texte TileTopic)
+{
+  if (source < EVENEMENTS_NB_SOURCES)
+    _Routes_Evenements[source] = Domokit_CStr(TileTopic);
+}
+
+// Latence max / moyenne entre l'interruption et la publication (µs)
+uint32_t Domokit::getEventLatencyMax()
+{
+  return _Latence_Max_us;
+}
+
+uint32_t Domokit::getEventLatencyMoy()
+{
+  return _Latence_Moy_us;
+}
+
+// Nombre d'évènements perdus (file pleine)
+uint32_t Domokit::getNbEventsPerdus()
+{
+  return _Evenements.getNbPertes();
+}
+
+// ################################################################################
+// 						                  CAPTEURS
+// ################################################################################
+
+/*===============================================================================
+  Nom 			: addSensor
   
-  Retour		: 	String contenant l'adresse mac
+  Description	: Déclare un canal d'acquisition : le capteur est lu toutes les
+                periode_ms par l'ordonnanceur, filtré, et la valeur filtrée est
+                publiée sur la tile selon sa politique de publication
+                (setTilePolicy)
+  
+  Paramètre(s) 	: 
+  * TileTopic 	: topic de la tile de destination
+  * periode_ms	: période d'échantillonnage
+  * lecture		: fonction de lecture du capteur (virgule fixe)
+  * filtre		: FILTRE_AUCUN, FILTRE_MOYENNE, FILTRE_EMA ou FILTRE_MEDIANE
+  * parametre	: paramètre du filtre (voir DomoKit_Capteurs.h)
+  * decimales	: nombre de décimales de la valeur lue
+  
+  Retour		: numéro du canal (CAPTEURS_AUCUN_CANAL si table pleine)
 ===============================================================================*/
-String Domokit::macToStr(const uint8_t* mac)
+int Domokit::addSensor(Domokit_Texte TileTopic, unsigned long periode_ms, Capteur_Lecture lecture, uint8_t filtre, uint8_t parametre, uint8_t decimales)
 {
-  String result;
-  for (int i = 0; i < 6; ++i) {
-    result += String(mac[i], 16);
-    if (i < 5)
-      result += ':';
+  for (int canal = 0; canal < CAPTEURS_NB_CANAUX; canal++)
+  {
+    Domokit_Canal* c = &_Canaux[canal];
+    if (c->utilise)
+      continue;
+
+    c->tache = _Scheduler.every("capteur", periode_ms, [this, canal] () {
+      this->sampleSensor(canal);
+    });
+    if (c->tache == SCHEDULER_AUCUNE_TACHE)
+      return CAPTEURS_AUCUN_CANAL;
+
+    c->utilise          = true;
+    c->topic            = Domokit_CStr(TileTopic);
+    c->lecture          = lecture;
+    c->decimales        = decimales;
+    c->valeur           = 0;
+    c->publiee          = false;
+    c->nb_echantillons  = 0;
+    c->nb_publications  = 0;
+    c->filtre.configure(filtre, parametre);
+    return canal;
   }
-  return result;
+
+  DEBUG_PRINTLN("Capteurs : table des canaux pleine");
+  return CAPTEURS_AUCUN_CANAL;
+}
+
+// Supprime un canal d'acquisition
+void Domokit::removeSensor(int canal)
+{
+  if (canal < 0 || canal >= CAPTEURS_NB_CANAUX || !_Canaux[canal].utilise)
+    return;
+
+  _Scheduler.cancel(_Canaux[canal].tache);
+  _Canaux[canal].utilise = false;
+  _Canaux[canal].lecture = nullptr;
+}
+
+// Dernière valeur filtrée d'un canal (virgule fixe)
+int32_t Domokit::getSensorValue(int canal)
+{
+  if (canal < 0 || canal >= CAPTEURS_NB_CANAUX || !_Canaux[canal].utilise)
+    return 0;
+  return _Canaux[canal].valeur;
+}
+
+/*===============================================================================
+  Nom 			: sampleSensor
+  
+  Description	: Lit et filtre un échantillon, puis publie la valeur filtrée.
+                Si la tile est publiée sur changement et que la valeur n'a pas
+                changé, la valeur n'est ni formatée ni envoyée.
+  
+  Paramètre(s) 	: canal : numéro du canal
+  
+  Retour		: aucun
+===============================================================================*/
+void Domokit::sampleSensor(int canal)
+{
+  Domokit_Canal* c = &_Canaux[canal];
+  char payload[16];
+
+  if (!c->utilise || !c->lecture)
+    return;
+
+  c->valeur = c->filtre.ajouter(c->lecture());
+  c->nb_echantillons++;
+  this->runRules(DECLENCHEUR_CAPTEUR, canal, c->valeur);
+
+  int index = getTileIndex(c->topic.c_str());
+  if (index >= 0 && _Tiles[index].politique == PUBLICATION_SUR_CHANGEMENT && c->publiee && c->valeur == c->valeur_publiee)
+    return;
+
+  Capteurs_Format(payload, sizeof(payload), c->valeur, c->decimales);
+  SendtoTile(c->topic.c_str(), payload);
+  c->publiee = true;
+  c->valeur_publiee = c->valeur;
+  c->nb_publications++;
+}
+
+// ################################################################################
+// 						                  REGLES
+// ################################################################################
+
+/*===============================================================================
+  Nom 			: addRuleOutput
+  
+  Description	: Autorise les règles à piloter une broche (configurée en sortie).
+                A appeler avant begin() : le programme sauvegardé en EEPROM est
+                vérifié au démarrage avec les sorties déjà déclarées.
+  
+  Paramètre(s) 	: broche : numéro de la broche (GPIO)
+  
+  Retour		: false si REGLES_NB_SORTIES broches sont déjà déclarées
+===============================================================================*/
+bool Domokit::addRuleOutput(uint8_t broche)
+{
+  if (!_Regles.addOutput(broche))
+    return false;
+  pinMode(broche, OUTPUT);
+  return true;
+}
+
+/*===============================================================================
+  Nom 			: setRules
+  
+  Description	: Charge un programme de règles (bytecode, voir DomoKit_Regles.h)
+                et le sauvegarde en EEPROM. Le programme peut aussi être envoyé
+                par le serveur (instruction REGLES).
+  
+  Paramètre(s) 	: programme, taille : bytecode (taille 0 : efface les règles)
+  
+  Retour		: REGLES_OK, sinon position de la première instruction invalide
+===============================================================================*/
+int Domokit::setRules(const uint8_t* programme, size_t taille)
+{
+  int resultat = _Regles.load(programme, taille);
+  if (resultat == REGLES_OK)
+    _Regles.save();
+  return resultat;
+}
+
+Domokit_Regles& Domokit::getRules()
+{
+  return _Regles;
+}
+
+// Exécute les règles pour un évènement, un échantillon ou une commande reçue
+void Domokit::runRules(uint8_t type, uint8_t source, int32_t valeur)
+{
+  Regles_Declencheur declencheur;
+
+  if (_Regles.getTaille() == 0)
+    return;
+
+  declencheur.type   = type;
+  declencheur.source = source;
+  declencheur.valeur = valeur;
+  if (!_Regles.run(declencheur, this))
+    DEBUG_PRINTLN("Règles : erreur d'exécution");
+}
+
+/*===============================================================================
+  Nom 			: isTileEcho
+  
+  Description	: La télémétrie d'une tile est publiée sur le topic auquel l'objet
+                est abonné pour ses commandes : le broker la lui renvoie. Un
+                message identique à la dernière valeur publiée est un écho, et
+                ne déclenche ni les règles ni la mesure de latence.
+  
+  Paramètre(s) 	: index : tile destinataire
+                  payload : message reçu
+  
+  Retour		: true si le message est l'écho de la dernière publication
+===============================================================================*/
+bool Domokit::isTileEcho(int index, const char* payload)
+{
+  bool echo = _Tiles[index].echo && _Tiles[index].valeur == payload;
+
+  // Un seul écho attendu par publication : une commande identique reçue ensuite est traitée
+  _Tiles[index].echo = false;
+  return echo;
+}
+
+// Données et actions accessibles aux règles
+int32_t Domokit::regleCapteur(uint8_t canal)
+{
+  return getSensorValue(canal);
+}
+
+int32_t Domokit::regleTile(uint8_t tile)
+{
+  if (tile >= _TileID || tile >= NB_TILES_MAX)
+    return 0;
+  return Regles_TexteToInt(_Tiles[tile].valeur.c_str(), _Tiles[tile].valeur.length());
+}
+
+// Seules les sorties déclarées par addRuleOutput sont pilotées (vérifiées aussi au chargement)
+void Domokit::regleSortie(uint8_t broche, int32_t valeur)
+{
+  if (_Regles.isOutput(broche))
+    digitalWrite(broche, (valeur != 0) ? HIGH : LOW);
+}
+
+void Domokit::reglePublier(uint8_t tile, int32_t valeur, uint8_t decimales)
+{
+  char payload[16];
+
+  if (tile >= _TileID || tile >= NB_TILES_MAX)
+    return;
+  Capteurs_Format(payload, sizeof(payload), valeur, decimales);
+  SendtoTile(_Tiles[tile].topic.c_str(), payload);
+}
+
+// Publié directement (sans passer par la file) : ne redéclenche pas les règles
+void Domokit::regleEvenement(uint8_t source, int32_t valeur)
+{
+  this->publishEvent(source, valeur, 0);
+}
+
+// Mesure de la latence entre la réception d'une commande et son callback
+void Domokit::measureCommandLatency()
+{
+  uint32_t latence = micros() - _Transport->getDateReception();
+
+  if (latence > _Latence_Cmd_Max_us) _Latence_Cmd_Max_us = latence;
+  _Latence_Cmd_Moy_us = (_Latence_Cmd_Moy_us == 0) ? latence : (_Latence_Cmd_Moy_us * 7 + latence) / 8;
+}
+
+// Latence max / moyenne entre la réception d'une commande et callBack_Tile (µs)
+uint32_t Domokit::getCommandLatencyMax()
+{
+  return _Latence_Cmd_Max_us;
+}
+
+uint32_t Domokit::getCommandLatencyMoy()
+{
+  return _Latence_Cmd_Moy_us;
+}
+
+/*===============================================================================
+  Nom 			: publishMetrics
+  
+  Description	: Publie les métriques de l'objet sur topic_metriques
+                format : clé=valeur;clé=valeur;...
+                (latences en µs, durée d'authentification en ms, consommation
+                estimée en µAh par heure, voir DomoKit_Energie.h)
+  
+  Paramètre(s) 	: aucun
+  
+  Retour		: aucun
+===============================================================================*/
+void Domokit::publishMetrics()
+{
+  char payload[4 * TAILLE_TRAME];
+
+  _Energie.compute(_Radio.getDutyCycle());
+
+  snprintf(payload, sizeof(payload),
+           "cmd_lat_max=%lu;cmd_lat_moy=%lu;evt_lat_max=%lu;evt_lat_moy=%lu;evt_perdus=%lu;qos_attente=%lu;qos_renvois=%lu;auth_tentatives=%u;auth_duree=%lu"
+           ";rtt=%lu;rtt_var=%lu;debit=%u;regroupees=%lu;pings_perdus=%lu;radio_pm=%u"
+           ";octets_tx=%lu;octets_rx=%lu;cnx_wifi=%u;cnx_mqtt=%u;cpu_us=%lu;cpu_us_max=%lu;conso_uah_h=%lu;charge_uah=%lu",
+           (unsigned long)_Latence_Cmd_Max_us, (unsigned long)_Latence_Cmd_Moy_us,
+           (unsigned long)_Latence_Max_us, (unsigned long)_Latence_Moy_us,
+           (unsigned long)_Evenements.getNbPertes(),
+           (unsigned long)_Inflight.getNbEnAttente(), (unsigned long)_Inflight.getNbRenvois(),
+           (unsigned)_Auth_Tentatives, _Auth_Duree_ms,
+           (unsigned long)_Liaison.getRTT(), (unsigned long)_Liaison.getRTTVar(), (unsigned)_Liaison.getRate(),
+           _Liaison.getNbRegroupees(), _Liaison.getNbPingsPerdus(), (unsigned)_Radio.getDutyCycle(),
+           _Energie.getOctetsEmis(), _Energie.getOctetsRecus(),
+           (unsigned)_Energie.getNbConnexionsWifi(), (unsigned)_Energie.getNbConnexionsMQTT(),
+           (unsigned long)_Energie.getLoopTime(), (unsigned long)_Energie.getLoopTimeMax(),
+           (unsigned long)_Energie.getAverageCurrent(), (unsigned long)_Energie.getCharge());
+
+  this->MQTT_Send(topic_metriques, payload);
+}
+
+/*===============================================================================
+  Nom 			: printMemoryReport
+  
+  Description	: Affiche l'occupation mémoire statique de l'objet (taille de
+                chaque bloc, fixée à la compilation) et le tas disponible
+  
+  Paramètre(s) 	: sortie : flux d'affichage (ex : Serial)
+  
+  Retour		: aucun
+===============================================================================*/
+void Domokit::printMemoryReport(Print& sortie)
+{
+  sortie.print("Domokit\t\t\t");          sortie.print(sizeof(Domokit));            sortie.println(" octets");
+  sortie.print("  topics (arène)\t\t");   sortie.print(_Taille_Arene);
+  sortie.print(" / ");                     sortie.print(sizeof(_Arene_Topics));      sortie.println(" octets");
+  sortie.print("  tiles\t\t\t");          sortie.print(sizeof(_Tiles));             sortie.println(" octets");
+  sortie.print("  fenêtre QoS 1\t\t");    sortie.print(sizeof(_Inflight));          sortie.println(" octets");
+  sortie.print("  évènements\t\t");       sortie.print(sizeof(_Evenements) + sizeof(_Routes_Evenements)); sortie.println(" octets");
+  sortie.print("  ordonnanceur\t\t");     sortie.print(sizeof(_Scheduler));         sortie.println(" octets");
+  sortie.print("  capteurs\t\t");         sortie.print(sizeof(_Canaux));            sortie.println(" octets");
+  sortie.print("  règles\t\t\t");        sortie.print(sizeof(_Regles));            sortie.println(" octets");
+  sortie.print("  journal\t\t");          sortie.print(sizeof(_Journal));           sortie.println(" octets");
+  sortie.print("  mesures\t\t");          sortie.print(sizeof(_Mesures));           sortie.println(" octets");
+  if (_Journal.isActive())
+  {
+    sortie.print("  journal : ");           sortie.print(_Journal.getNbEnAttente());  sortie.print(" en attente, ");
+    sortie.print(_Journal.getNbPertes());   sortie.print(" perdus, ");
+    sortie.print(_Journal.getNbRejets());   sortie.print(" rejetés, ");
+    sortie.print(_Journal.getOctetsEcrits()); sortie.print(" octets écrits pour ");
+    sortie.print(_Journal.getOctetsUtiles()); sortie.print(" utiles, ");
+    sortie.print(_Journal.getNbEffacements()); sortie.println(" secteurs effacés");
+  }
+  sortie.print("Clef serveur\t\t");       sortie.print(sizeof(KEY_SERVEUR));       sortie.println(" octets");
+  sortie.print("Tas libre\t\t");          sortie.print(ESP.getFreeHeap());         sortie.println(" octets");
+}
+/*===============================================================================
+  Nom 			: 	macToStr
+  
+  Description	: 	permet de convertir une adresse mac contenue dans un tableau d'octets
+					en une chaîne de caractère (rangée dans _ADDR_MAC).
+  
+  Paramètre(s) 	: 	mac : adresse mac (6 octets)
+  
+  Retour		: 	aucun
+===============================================================================*/
+void Domokit::macToStr(const uint8_t* mac)
+{
+  _ADDR_MAC.format("%x:%x:%x:%x:%x:%x", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
 }
 
 // ################################################################################
@@ -562,12 +1602,14 @@ String Domokit::macToStr(const uint8_t* mac)
 ===============================================================================*/
 void Domokit::setup_mqtt()
 {
-  client.setServer((char*)_MQTT_Serveur.c_str(), _MQTT_Port);
-  client.setCallback([this] (char* topic, byte* payload, unsigned int length) { this->MQTT_Receive(topic, payload, length); });
+  _Transport->setServer(_MQTT_Serveur, _MQTT_Port);
+  _Transport->setCallback([this] (char* topic, byte* payload, unsigned int length) { this->MQTT_Receive(topic, payload, length); });
+  _Transport->setConnectCallback([this] () { this->onConnexionMQTT(); });
+  _Transport->setAckCallback([this] (uint16_t packetId) { _Inflight.acknowledge(packetId); });
 
   // Affichage de Debug
   DEBUG_PRINTLN("Connexion au serveur MQTT réussie");
-  DEBUG_PRINTLN("Connecté en tant que " + _CLIENT_NAME);
+  DEBUG_PRINT("Connecté en tant que "); DEBUG_PRINTLN(_CLIENT_NAME.c_str());
   DEBUG_PRINTLN();
 }
 
@@ -583,25 +1625,31 @@ void Domokit::setup_mqtt()
   Retour		: 	aucun
 ===============================================================================*/
 bool Domokit::reconnect_mqtt() {
+  PROFIL_PORTEE("reconnect_mqtt");
   // Loop until we're reconnected
-  if (!client.connected()) 
+  if (!_Transport->connected()) 
   {
     DEBUG_PRINT("Connexion au broker MQTT ");   DEBUG_PRINTLN(_MQTT_Serveur);
-    DEBUG_PRINT("En tant que ");                DEBUG_PRINTLN(_CLIENT_NAME);
+    DEBUG_PRINT("En tant que ");                DEBUG_PRINTLN(_CLIENT_NAME.c_str());
     
-    // Connexion
-    if (client.connect((char*) _CLIENT_NAME.c_str() , (char*)_MQTT_User.c_str(), (char*)_MQTT_Password.c_str()))
+    // Connexion (les abonnements sont faits dans onConnexionMQTT)
+    _Demarrage.start(DEMARRAGE_MQTT);
+    unsigned long debut = millis();
+    bool connecte = _Transport->connect(_CLIENT_NAME.c_str(), _MQTT_User, _MQTT_Password);
+    _Energie.countMqttAttempt(millis() - debut);
+
+    if (connecte)
     {
-      DEBUG_PRINTLN("Connexion au broker MQTT réussie");
-      
-      // inscription au topic d'instructionx<
-      String mTopic = _MQTT_Main_Topic + "/instruction/#";
-      client.subscribe((char*)mTopic.c_str());
       return true;
     } 
+    else if (_Transport->state() == TRANSPORT_CONNEXION_EN_COURS)
+    {
+      DEBUG_PRINTLN("Connexion au broker MQTT en cours...");
+      return false;
+    }
     else 
     {
-      DEBUG_PRINT("Echec de connexion au broker MQTT ! rc="); DEBUG_PRINTLN(client.state());
+      DEBUG_PRINT("Echec de connexion au broker MQTT ! rc="); DEBUG_PRINTLN(_Transport->state());
       DEBUG_PRINTLN("Nouvelle tentative dans 5 secondes...");
       //delay(5000);
       return false;
@@ -613,10 +1661,114 @@ bool Domokit::reconnect_mqtt() {
   }
 }
 
+/*===============================================================================
+  Nom 			: 	onConnexionMQTT
+  
+  Description	: 	Fonction appelée par le transport dès que la connexion au broker
+					est établie (immédiatement pour un transport bloquant, depuis
+					loop() pour un transport asynchrone)
+  
+  Paramètre(s) 	: 	aucun
+  
+  Retour		: 	aucun
+===============================================================================*/
+void Domokit::onConnexionMQTT()
+{
+  DEBUG_PRINTLN("Connexion au broker MQTT réussie");
+  _Demarrage.end(DEMARRAGE_MQTT);
+  _Demarrage.start(DEMARRAGE_AUTH);
+
+  this->subscribeTopics();
+  this->publishBirth();
+  _Liaison.reset();
+
+  // Première demande d'authentification sans attendre la tâche de connexion
+  // (transport asynchrone : connexion établie entre deux vérifications)
+  if (!_Program_Start && _Tache_Auth == SCHEDULER_AUCUNE_TACHE)
+    scheduleAuth(random(_Auth_Delai_ms + 1));
+
+  // Les messages QoS 1 non acquittés sont renvoyés sur la nouvelle connexion
+  _Inflight.restart();
+}
+
+/*===============================================================================
+  Nom 			: 	publishBirth
+  
+  Description	: 	Publie le message de naissance (retenu) sur topic_presence :
+					EN_LIGNE suivi des informations de connexion de l'objet.
+					Avec le testament HORS_LIGNE enregistré à la connexion, le
+					broker conserve l'état de présence de chaque objet : le
+					serveur n'a plus besoin d'interroger les objets (CONNECT).
+  
+  Paramètre(s) 	: 	aucun
+  
+  Retour		: 	aucun
+===============================================================================*/
+void Domokit::publishBirth()
+{
+  char trame[TAILLE_TRAME];
+  size_t taille = Protocole_EncodePresence(trame, sizeof(trame), _ADDR_MAC.c_str(), _CLIENT_NAME.c_str(), _Alias_Autorise);
+
+  if (taille > 0 && _Topics[TOPIC_PRESENCE].len > 0)
+  {
+    _Transport->publishRetained(topic_presence, (const uint8_t*)trame, taille);
+    _Energie.countSent(_Topics[TOPIC_PRESENCE].len, taille);
+  }
+}
+
+/*===============================================================================
+  Nom 			: 	subscribeTopics
+  
+  Description	: 	Abonne l'objet à ses propres topics d'instruction uniquement
+					(et non à <MAIN_TOPIC>/instruction/#) : le broker ne lui
+					transmet pas les instructions et commandes des autres objets.
+					  - <MAIN_TOPIC>/instruction/<@mac>
+					  - <MAIN_TOPIC>/instruction/tile/<@mac>/#
+					  - <MAIN_TOPIC>/ping/<@mac>                 (ping renvoyé par le broker)
+					  - <MAIN_TOPIC>/instruction/ota/<@mac>      (si OTA autorisée)
+					  - <MAIN_TOPIC>/instruction/a/<alias>/#     (si alias attribué)
+					  - <MAIN_TOPIC>/instruction/tous            (si diffusion autorisée)
+					  - <MAIN_TOPIC>/instruction/groupe/<nom>    (groupes rejoints)
+  
+  Paramètre(s) 	: 	aucun
+  
+  Retour		: 	aucun
+===============================================================================*/
+void Domokit::subscribeTopics()
+{
+  this->MQTT_Subscribe(topic_instruction);
+  this->subscribeSubtree(topic_tile);
+  this->MQTT_Subscribe(_Topics[TOPIC_PING].ptr);
+
+  if (_OTA_Autorise)
+    this->MQTT_Subscribe(_Topics[TOPIC_OTA_BLOCS].ptr);
+  if (_Alias >= 0)
+    this->subscribeSubtree(_Topic_Alias_Instruction.c_str());
+  if (_Diffusion_Autorisee)
+    this->MQTT_Subscribe(_Topics[TOPIC_DIFFUSION].ptr);
+
+  for (uint8_t i = 0; i < NB_GROUPES_MAX; i++)
+  {
+    if (_Topics_Groupes[i].length() > 0)
+      this->MQTT_Subscribe(_Topics_Groupes[i].c_str());
+  }
+}
+
+// Abonnement à un topic et à tous ses sous-topics (<topic>/#)
+void Domokit::subscribeSubtree(const char* topic)
+{
+  char mTopic[TAILLE_TOPIC];
+  snprintf(mTopic, sizeof(mTopic), "%s/#", topic);
+  this->MQTT_Subscribe(mTopic);
+}
+
 /*===============================================================================
   Nom 			: Create_Topics
   
-  Description	: Génère la liste des topics MQTT utiles pour l'objet 
+  Description	: Génère la liste des topics MQTT utiles pour l'objet.
+                Les topics sont écrits les uns à la suite des autres dans
+                _Arene_Topics (aucune allocation sur le tas) ; leur taille
+                est mémorisée pour les comparaisons (voir matchTopic).
   
   Paramètre(s) 	: aucun
   
@@ -624,19 +1776,35 @@ bool Domokit::reconnect_mqtt() {
 ===============================================================================*/
 void Domokit::Create_Topics()
 {
-  // Création des topics MQTT
-  topic_instruction   = _MQTT_Main_Topic + "/instruction/"  + _ADDR_MAC;
-  topic_donnees       = _MQTT_Main_Topic + "/donnees/"      + _ADDR_MAC;
-  topic_interruption  = _MQTT_Main_Topic + "/interruption/" + _ADDR_MAC;
-  topic_connexion     = _MQTT_Main_Topic + "/connexion";
-  topic_connect       = _MQTT_Main_Topic + "/connect/"  	+ _ADDR_MAC;
+  _Taille_Arene = 0;
+  _Taille_Prefixe = strlen(_MQTT_Main_Topic) + 1;
 
-  topic_tile          = _MQTT_Main_Topic + "/instruction/tile/" + _ADDR_MAC;
-  topic_set_tile      = _MQTT_Main_Topic + "/set_tile/"  	+ _ADDR_MAC;
+  // Création des topics MQTT
+  topic_instruction   = addTopic(TOPIC_INSTRUCTION,   "instruction",   true);
+  topic_donnees       = addTopic(TOPIC_DONNEES,       "donnees",       true);
+  topic_interruption  = addTopic(TOPIC_INTERRUPTION,  "interruption",  true);
+  topic_connexion     = addTopic(TOPIC_CONNEXION,     "connexion",     false);
+  topic_connect       = addTopic(TOPIC_CONNECT,       "connect",       true);
+
+  topic_tile          = addTopic(TOPIC_TILE,          "instruction/tile", true);
+  topic_set_tile      = addTopic(TOPIC_SET_TILE,      "set_tile",      true);
+  topic_metriques     = addTopic(TOPIC_METRIQUES,     "metriques",     true);
+  topic_ota           = addTopic(TOPIC_OTA,           "ota",           true);
+  addTopic(TOPIC_OTA_BLOCS, "instruction/ota", true);
+  addTopic(TOPIC_DIFFUSION, "instruction/" DIFFUSION_TOPIC, false);
+  topic_presence      = addTopic(TOPIC_PRESENCE,      "presence",      true);
+  addTopic(TOPIC_PING, "ping", true);
 
   #ifdef DEBUG_DOMOKIT
-  topic_debug         = _MQTT_Main_Topic + "/debug/"  	+ _ADDR_MAC;
+  topic_debug         = addTopic(TOPIC_DEBUG,         "debug",         true);
   #endif
+
+  // Les alarmes ne doivent pas être perdues : QoS 1 par défaut
+  setTopicQoS(topic_interruption, 1);
+
+  // Testament : le broker publie HORS_LIGNE (retenu) si l'objet disparaît
+  if (_Topics[TOPIC_PRESENCE].len > 0)
+    _Transport->setWill(topic_presence, PROTOCOLE_HORS_LIGNE);
   
   // Affichage de Debug
   DEBUG_PRINTLN("Liste des topics :");
@@ -650,6 +1818,133 @@ void Domokit::Create_Topics()
   DEBUG_PRINTLN();
 }
 
+/*===============================================================================
+  Nom 			: addTopic
+  
+  Description	: Ajoute un topic <MAIN_TOPIC>/<catégorie>[/<@mac>] dans l'arène
+                des topics
+  
+  Paramètre(s) 	: 
+  * id        : index du topic dans la table des topics
+  * categorie : catégorie du topic (ex : "donnees")
+  * avec_mac  : ajoute l'adresse MAC de l'objet à la fin du topic
+  
+  Retour		: topic créé ("" si l'arène est pleine)
+===============================================================================*/
+const char* Domokit::addTopic(Domokit_TopicId id, const char* categorie, bool avec_mac)
+{
+  char* topic = &_Arene_Topics[_Taille_Arene];
+  size_t reste = sizeof(_Arene_Topics) - _Taille_Arene;
+  int taille;
+
+  if (avec_mac)
+    taille = snprintf(topic, reste, "%s/%s/%s", _MQTT_Main_Topic, categorie, _ADDR_MAC.c_str());
+  else
+    taille = snprintf(topic, reste, "%s/%s", _MQTT_Main_Topic, categorie);
+
+  if (taille < 0 || (size_t)taille >= reste)
+  {
+    DEBUG_PRINT("Arène des topics pleine : "); DEBUG_PRINTLN(categorie);
+    if (reste > 0) *topic = '\0';
+    _Topics[id].ptr = "";
+    _Topics[id].len = 0;
+    return "";
+  }
+
+  _Taille_Arene += taille + 1;
+  _Topics[id].ptr = topic;
+  _Topics[id].len = taille;
+  return topic;
+}
+
+/*===============================================================================
+  Nom 			: matchTopic
+  
+  Description	: Compare un topic reçu avec un topic de l'objet, sans copie.
+                Le préfixe commun <MAIN_TOPIC>/ doit avoir été vérifié par
+                l'appelant : seule la suite du topic est comparée.
+  
+  Paramètre(s) 	: 
+  * topic   : topic à comparer (préfixe déjà vérifié)
+  * taille  : taille du topic
+  * id      : topic de l'objet
+  * exact   : true = égalité, false = topic de l'objet suivi de /...
+  
+  Retour		: true si le topic correspond
+===============================================================================*/
+bool Domokit::matchTopic(const char* topic, size_t taille, Domokit_TopicId id, bool exact)
+{
+  const Protocole_Vue* vue = &_Topics[id];
+
+  if (vue->len < _Taille_Prefixe || taille < vue->len)
+    return false;
+  if (exact ? (taille != vue->len) : (taille > vue->len && topic[vue->len] != '/'))
+    return false;
+
+  return memcmp(topic + _Taille_Prefixe, vue->ptr + _Taille_Prefixe, vue->len - _Taille_Prefixe) == 0;
+}
+
+// Vrai si le topic est celui de la diffusion ou d'un groupe rejoint par l'objet
+bool Domokit::matchGroupTopic(const char* topic, size_t taille)
+{
+  if (_Diffusion_Autorisee && matchTopic(topic, taille, TOPIC_DIFFUSION, true))
+    return true;
+
+  for (uint8_t i = 0; i < NB_GROUPES_MAX; i++)
+  {
+    if (_Topics_Groupes[i].length() == taille && taille > 0
+        && memcmp(topic + _Taille_Prefixe, _Topics_Groupes[i].c_str() + _Taille_Prefixe, taille - _Taille_Prefixe) == 0)
+      return true;
+  }
+  return false;
+}
+
+/*
+ * Instructions acceptées sur la diffusion et les groupes : celles qui ne
+ * changent ni la configuration, ni le firmware, ni les règles, ni
+ * l'authentification d'un objet (WIFI_DATA, OTA, REGLES, START... ne sont
+ * acceptées que sur instruction/<@mac>)
+ */
+bool Domokit::isGroupInstruction(Protocole_Instruction instruction)
+{
+  switch (instruction)
+  {
+    case INSTRUCTION_CONNECT :
+    case INSTRUCTION_SNAPSHOT :
+    case INSTRUCTION_STOP :
+    case INSTRUCTION_ATTENTE :
+      return true;
+
+    default :
+      return false;
+  }
+}
+
+// Renvoie l'index d'un topic de l'objet (TOPIC_AUCUN si ce n'est pas un topic de l'objet)
+int Domokit::getTopicId(const char* topic)
+{
+  size_t taille;
+
+  // Cas courant : topic_xxx passé directement (comparaison des pointeurs)
+  for (int id = 0; id < NB_TOPICS; id++)
+  {
+    if (topic == _Topics[id].ptr && _Topics[id].len > 0)
+      return id;
+  }
+
+  // Copie d'un topic de l'objet
+  taille = strlen(topic);
+  if (_Taille_Prefixe == 0 || taille < _Taille_Prefixe || memcmp(topic, _Arene_Topics, _Taille_Prefixe) != 0)
+    return TOPIC_AUCUN;
+
+  for (int id = 0; id < NB_TOPICS; id++)
+  {
+    if (matchTopic(topic, taille, (Domokit_TopicId)id, true))
+      return id;
+  }
+  return TOPIC_AUCUN;
+}
+
 /*===============================================================================
   Nom 			: MQTT_Subscribe
   
@@ -660,9 +1955,9 @@ void Domokit::Create_Topics()
   
   Retour		: aucun
 ===============================================================================*/
-void Domokit::MQTT_Subscribe(String topic)
+void Domokit::MQTT_Subscribe(const char* topic)
 {
-  client.subscribe((char*)topic.c_str());
+  _Transport->subscribe(topic);
 }
 
 /*===============================================================================
@@ -674,15 +1969,28 @@ void Domokit::MQTT_Subscribe(String topic)
   * topic 		: topic du message MQTT
   * payload		: payload du message MQTT
   
-  Retour		: aucun
+  Retour		: true si le message a été confié au transport
+                (topics critiques : accepté dans la fenêtre QoS 1)
 ===============================================================================*/
-void Domokit::MQTT_Send(String topic, String Payload)
+bool Domokit::MQTT_Send(const char* topic, const char* Payload)
 {
   // Cryptage des données
-  String Crypt_Payload = Cryptage((char*)Payload.c_str(),KEY_SERVEUR);
+  char Crypt_Payload[TAILLE_MESSAGE];
+  size_t taille = Cryptage(Payload, Crypt_Payload, sizeof(Crypt_Payload), KEY_SERVEUR);
+
+  // Emission hors fenêtre (topics critiques, réponses) : réveil de la radio
+  _Radio.wake();
+
+  // Envoi des données cryptées (topics critiques : fenêtre QoS 1)
+  bool envoye;
+  if (getTopicQoS(topic) > 0)
+    envoye = _Inflight.send(_Transport,topic,(const uint8_t*)Crypt_Payload,taille);
+  else
+    envoye = _Transport->publish(topic,(const uint8_t*)Crypt_Payload,taille);
 
-  // Envoi des données cryptées
-  client.publish((char*)topic.c_str(),(char*)Crypt_Payload.c_str());
+  // Seuls les messages réellement émis sont comptés dans le bilan énergétique
+  if (envoye)
+    _Energie.countSent(strlen(topic), taille);
   
   // Affichage au terminal
   #ifdef DEBUG_MQTT_SEND
@@ -690,12 +1998,89 @@ void Domokit::MQTT_Send(String topic, String Payload)
     DEBUG_PRINT("\tTopic = [");DEBUG_PRINT(topic); DEBUG_PRINT("]");
     DEBUG_PRINT("\tPayload = [");DEBUG_PRINT(Payload); DEBUG_PRINTLN("]");
   #endif
+  return envoye;
 }
 
+#ifndef DOMOKIT_SANS_STRING
+bool Domokit::MQTT_Send(String topic, String Payload)
+{
+  return this->MQTT_Send(topic.c_str(), Payload.c_str());
+}
+#endif
+
 
 
 
 
+/*===============================================================================
+  Nom 			: setTopicQoS
+  
+  Description	: Défini le QoS utilisé pour publier sur un topic
+  
+  Paramètre(s) 	: 
+  * topic 		: topic concerné
+  * qos		    : 0 = au plus une fois / 1 = au moins une fois (acquitté)
+                  Le QoS 1 nécessite un transport qui reçoit les PUBACK
+                  (Transport_Async) : avec Transport_PubSub (par défaut),
+                  le message est considéré comme livré dès l'envoi TCP
+  
+  Retour		: aucun
+===============================================================================*/
+void Domokit::setTopicQoS(const char* topic, uint8_t qos)
+{
+  int libre = -1;
+  int id = getTopicId(topic);
+
+  // Topic de l'objet
+  if (id != TOPIC_AUCUN)
+  {
+    if (qos > 0) _QoS1_Topics_Objet |= (1 << id);
+    else         _QoS1_Topics_Objet &= ~(1 << id);
+    return;
+  }
+
+  for (int i = 0; i < QOS_NB_TOPICS; i++)
+  {
+    if (_Topics_QoS1[i] == topic)
+    {
+      if (qos == 0) _Topics_QoS1[i].clear();
+      return;
+    }
+    if (libre < 0 && _Topics_QoS1[i].length() == 0)
+      libre = i;
+  }
+
+  if (qos > 0 && libre >= 0)
+    _Topics_QoS1[libre] = topic;
+}
+
+// Renvoie le QoS utilisé pour publier sur un topic
+uint8_t Domokit::getTopicQoS(const char* topic)
+{
+  int id = getTopicId(topic);
+  if (id != TOPIC_AUCUN)
+    return (_QoS1_Topics_Objet >> id) & 1;
+
+  for (int i = 0; i < QOS_NB_TOPICS; i++)
+  {
+    if (_Topics_QoS1[i].length() > 0 && _Topics_QoS1[i] == topic)
+      return 1;
+  }
+  return 0;
+}
+
+#ifndef DOMOKIT_SANS_STRING
+void Domokit::setTopicQoS(String topic, uint8_t qos)
+{
+  this->setTopicQoS(topic.c_str(), qos);
+}
+
+uint8_t Domokit::getTopicQoS(String topic)
+{
+  return this->getTopicQoS(topic.c_str());
+}
+#endif
+
 /*===============================================================================
   Nom 			: 	MQTT_Receive
   
@@ -711,17 +2096,36 @@ void Domokit::MQTT_Send(String topic, String Payload)
 ===============================================================================*/
 void Domokit::MQTT_Receive(char* topic, byte* payload, unsigned int length) 
 {
-  char str_payload[512];
-  String mTopic = String(topic);
-  String decrypt_payload;
-  memset(str_payload, 0, sizeof(str_payload));
+  char str_payload[TAILLE_MESSAGE];
+  char decrypt_payload[TAILLE_MESSAGE];
+  size_t taille;
 
-  // Réception des données
-  for (unsigned int i = 0; i < length; i++)
-    str_payload[i] = payload[i];
+  _Energie.countReceived(strlen(topic), length);
+
+  // Blocs OTA : trames binaires (non cryptées), écrites directement en flash
+  if (_OTA.getStatut() == OTA_EN_COURS && getTopicId(topic) == TOPIC_OTA_BLOCS)
+  {
+    this->receiveOTABlock(payload, length);
+    return;
+  }
+
+  // Ping renvoyé par le broker (non crypté)
+  if (length > 0 && payload[0] == PROTOCOLE_PING[0] && getTopicId(topic) == TOPIC_PING)
+  {
+    int32_t numero;
+    if (Protocole_DecodePing((const char*)payload, length, &numero))
+      _Liaison.pong((uint16_t)numero);
+    return;
+  }
+
+  // Réception des données (tronquées à la taille du buffer)
+  if (length > sizeof(str_payload) - 1)
+    length = sizeof(str_payload) - 1;
+  memcpy(str_payload, payload, length);
+  str_payload[length] = '\0';
 
   // Décryptage des données
-  decrypt_payload = Decryptage((char*)str_payload,KEY_SERVEUR);
+  taille = Decryptage(str_payload, decrypt_payload, sizeof(decrypt_payload), KEY_SERVEUR);
 
   // Affichage au terminal
   #ifdef DEBUG_MQTT_RECEIVE
@@ -732,7 +2136,7 @@ void Domokit::MQTT_Receive(char* topic, byte* payload, unsigned int length)
   #endif
 
   // Décodage de l'instruction
-  this->Decode_Instruction(decrypt_payload,topic);
+  this->Decode_Instruction(decrypt_payload,taille,topic);
 }
 
 /*===============================================================================
@@ -741,95 +2145,311 @@ void Domokit::MQTT_Receive(char* topic, byte* payload, unsigned int length)
   Description	: 	Permet d'appeler une fonction de callback, selon l'instruction
 					reçue via MQTT
 					
-  Paramètre(s) 	: 	Instruction = instruction à décoder
+  Paramètre(s) 	: 	Instruction = instruction à décoder (terminée par '\0')
+                    taille = taille de l'instruction
+                    Topic = topic de réception
   
   Retour		: 	aucun
 ===============================================================================*/
-void Domokit::Decode_Instruction(String Instruction,String Topic)
+void Domokit::Decode_Instruction(const char* Instruction, size_t taille, const char* Topic)
 {
-      String Data;
-      String wifi_ssid;
-      String wifi_password;
-      String key_serveur;
-      DEBUG_PRINTLN("Topic  : " + Topic);
-      DEBUG_PRINTLN("Instruction reçue : " + Instruction);
+      char Data[TAILLE_WIFI_DATA];
+      char presence[3];
+      Trame_WifiData wifi;
+      Trame_OTA ota;
+      int32_t alias;
+      int32_t attente;
+      Trame_Heure heure;
+      uint8_t programme[REGLES_TAILLE_PROGRAMME];
+      size_t taille_programme;
+      int resultat;
+      char reponse[TAILLE_TRAME];
+      const char* trame = Instruction;
+      size_t taille_topic = strlen(Topic);
+      size_t taille_alias = _Topic_Alias_Instruction.length();
+      DEBUG_PRINT("Topic  : "); DEBUG_PRINTLN(Topic);
+      DEBUG_PRINT("Instruction reçue : "); DEBUG_PRINTLN(Instruction);
+
+    // Préfixe commun à tous les topics de l'objet (<MAIN_TOPIC>/) : vérifié une seule fois
+    if (_Taille_Prefixe == 0 || taille_topic < _Taille_Prefixe || memcmp(Topic, _Arene_Topics, _Taille_Prefixe) != 0)
+      return;
 
     /* =========================================
         Commandes envoyées par le serveur
     * ========================================= */  
-    if (Topic.equals(topic_instruction))
+    bool commande_objet = matchTopic(Topic, taille_topic, TOPIC_INSTRUCTION, true);
+    if (commande_objet || matchGroupTopic(Topic, taille_topic))
     {
+      Protocole_Instruction instruction = Protocole_DecodeInstruction(trame, taille);
+
+      // Diffusion / groupes : sous-ensemble sans risque pour une flotte entière
+      if (!commande_objet && !this->isGroupInstruction(instruction))
+      {
+        DEBUG_PRINTLN("Instruction refusée sur un topic de groupe");
+        return;
+      }
+
+      switch (instruction)
+      {
       /* =========================================
       * START
       * Autorise le programme à démarrer
       * ========================================= */
-      if(Instruction == START)
-      {
+      case INSTRUCTION_START :
             this->startProgram();
-            init_Tile();
+            _TileID = 0; // les tiles sont redéclarées avec les mêmes ID
+            _Demarrage.start(DEMARRAGE_TILES);
+            {
+              PROFIL_PORTEE("init_Tile");
+              init_Tile();
+            }
+            _Demarrage.end(DEMARRAGE_TILES);
             DEBUG_PRINTLN("Authentification réussie. Début du programme.");
-      }
+      break;
 
       /* =========================================
       * STOP
       * Interdit au programme de s'exécuter
       * ========================================= */
-      else if(Instruction == STOP)
-      {
+      case INSTRUCTION_STOP :
             this->stopProgram();
             DEBUG_PRINTLN("L'objet n'est plus authentifié. Fin du programme."); 
-      }
+      break;
+
+      /* =========================================
+      * ATTENTE;ms
+      * Le serveur est surchargé : prochaine demande d'authentification
+      * dans ms (plafonné), avec une marge aléatoire de 25 %
+      * ========================================= */
+      case INSTRUCTION_ATTENTE :
+        if (!_Program_Start && Protocole_DecodeAttente(trame, taille, &attente))
+        {
+          unsigned long delai = ((unsigned long)attente > AUTH_DELAI_MAX_MS) ? AUTH_DELAI_MAX_MS : (unsigned long)attente;
+          if (delai > _Auth_Delai_ms)
+            _Auth_Delai_ms = delai;
+          scheduleAuth(delai + random(delai / 4 + 1));
+        }
+      break;
+
       /* =========================================
       * CONNECT
       * Le serveur veut savoir si l'objet est connecté
+      * (compatibilité : la présence est désormais tenue par le broker,
+      * voir publishBirth et le testament enregistré dans Create_Topics)
       * ========================================= */
-      else if(Instruction == CONNECT)
-      {
-        String Adresse_MAC = this->getAddrMac();
+      case INSTRUCTION_CONNECT :
         // on envoie les deux premières lettres de l'@mac pour indiquer la bonne présence de l'objet
-        this->MQTT_Send(this->topic_connect,Adresse_MAC.substring(0,2));
-      } 
+        presence[0] = _ADDR_MAC[0];
+        presence[1] = _ADDR_MAC[1];
+        presence[2] = '\0';
+        this->MQTT_Send(this->topic_connect,presence);
+      break;
+
+      /* =========================================
+      * HEURE;t1;t2;t3
+      * Réponse du serveur à la dernière demande de synchronisation
+      * (la réception est datée à l'arrivée du message dans le transport)
+      * ========================================= */
+      case INSTRUCTION_HEURE :
+        if (Protocole_DecodeHeure(trame, taille, &heure) && heure.t2 >= 0 && heure.t1 == _Sync_Demande)
+        {
+          uint64_t t4 = _Horloge.monotonic() - (micros() - _Transport->getDateReception()) / 1000;
+          _Sync_Demande = -1;
+          if (_Horloge.update(heure.t1, heure.t2, heure.t3, t4))
+          {
+            DEBUG_PRINT("Horloge synchronisée, aller-retour (ms) : "); DEBUG_PRINTLN(_Horloge.getRTT());
+          }
+        }
+      break;
 
       /* =========================================
       * WIFI_DATA;ssid;password;cle_cryptage
       * L'objet connecté reçoit les infos de connexion wifi (SSID/PASSWORD)
       * et doit les enregistrer dans sa mémoire EEPROM
       * ========================================= */
-      else if(Instruction.startsWith(WIFI_DATA))
-      {
-          wifi_ssid     = ParseString(Instruction, ';' , 1);
-          wifi_password = ParseString(Instruction, ';' , 2);
-          key_serveur   = ParseString(Instruction, ';' , 3);
+      case INSTRUCTION_WIFI_DATA :
+          if (!Protocole_DecodeWifiData(trame, taille, &wifi))
+            break;
 
           #ifdef DEBUG_WIFI_DATA
             DEBUG_PRINT("SSID :");
-            DEBUG_PRINTLN(wifi_ssid);
+            DEBUG_PRINTLN(String(wifi.ssid.ptr).substring(0, wifi.ssid.len));
             DEBUG_PRINT("PASSWORD :");
-            DEBUG_PRINTLN(wifi_password);
+            DEBUG_PRINTLN(String(wifi.password.ptr).substring(0, wifi.password.len));
             DEBUG_PRINT("CLEF DE CHIFFREMENT : ");
-            DEBUG_PRINTLN(key_serveur);
+            DEBUG_PRINTLN(String(wifi.clef.ptr).substring(0, wifi.clef.len));
           #endif
-          Data = wifi_ssid + ";";
-          Data += wifi_password;
 
-          if(key_serveur.length()>0){
-              Data += ";" + key_serveur;
+          // Format EEPROM : ssid;password[;clef]
+          memset(Data, 0, sizeof(Data));
+          if (wifi.clef.len > 0)
+            snprintf(Data, sizeof(Data), "%.*s;%.*s;%.*s", (int)wifi.ssid.len, wifi.ssid.ptr,
+                     (int)wifi.password.len, wifi.password.ptr, (int)wifi.clef.len, wifi.clef.ptr);
+          else
+            snprintf(Data, sizeof(Data), "%.*s;%.*s", (int)wifi.ssid.len, wifi.ssid.ptr,
+                     (int)wifi.password.len, wifi.password.ptr);
+          Write_STR_EEPROM(Data,sizeof(Data),EEPROM_ADDR_WIFI);
+      break;
+
+      /* =========================================
+      * ALIAS;n
+      * Le serveur attribue un alias numérique à l'objet.
+      * Les tiles sont ensuite adressées par <MAIN_TOPIC>/a/<n>/<id tile>
+      * ========================================= */
+      case INSTRUCTION_ALIAS :
+          if (_Alias_Autorise && Protocole_DecodeAlias(trame, taille, &alias))
+          {
+            this->setAlias(alias);
+            DEBUG_PRINT("Alias de topic : "); DEBUG_PRINTLN(_Topic_Alias.c_str());
+          }
+      break;
+
+      /* =========================================
+      * SNAPSHOT
+      * Le serveur demande les dernières valeurs de toutes les tiles
+      * ========================================= */
+      case INSTRUCTION_SNAPSHOT :
+          this->publishSnapshot();
+      break;
+
+      /* =========================================
+      * OTA;taille;md5[;DELTA]
+      * Début (ou reprise) d'une mise à jour du firmware
+      * (image complète, ou delta par rapport à l'image actuelle).
+      * Les blocs de l'image sont ensuite reçus sur
+      * <MAIN_TOPIC>/instruction/ota/<@mac> (voir DomoKit_OTA.h)
+      * ========================================= */
+      case INSTRUCTION_OTA :
+          if (!_OTA_Autorise || !Protocole_DecodeOTA(trame, taille, &ota))
+            break;
+
+          if (_OTA.begin(ota.taille, ota.md5, ota.delta))
+            this->sendOTAStatus(PROTOCOLE_OTA_PRET, _OTA.getBlocAttendu(), OTA_TAILLE_BLOC);
+          else
+            this->sendOTAStatus(PROTOCOLE_OTA_ERREUR, _OTA.getErreur(), -1);
+      break;
+
+      /* =========================================
+      * OTA_FIN
+      * Vérification de l'image puis redémarrage
+      * ========================================= */
+      case INSTRUCTION_OTA_FIN :
+          if (!_OTA_Autorise)
+            break;
+
+          if (_OTA.end())
+          {
+            DEBUG_PRINT("OTA : "); DEBUG_PRINT(_OTA.getTaille()); DEBUG_PRINT(" octets en ");
+            DEBUG_PRINT(_OTA.getDuree()); DEBUG_PRINTLN(" ms. Redémarrage...");
+            this->sendOTAStatus(PROTOCOLE_OTA_OK, -1, -1);
+            _Scheduler.once("ota", OTA_DELAI_REDEMARRAGE_MS, [] () { ESP.restart(); });
           }
-          Write_STR_EEPROM((char*)Data.c_str(),100,EEPROM_ADDR_WIFI);
+          else
+            this->sendOTAStatus(PROTOCOLE_OTA_ERREUR, _OTA.getErreur(), -1);
+      break;
+
+      /* =========================================
+      * OTA_ANNULE
+      * Abandon de la mise à jour en cours
+      * ========================================= */
+      case INSTRUCTION_OTA_ANNULE :
+          _OTA.abort();
+      break;
+
+      /* =========================================
+      * REGLES[;programme]
+      * Nouveau programme du moteur de règles local
+      * (voir DomoKit_Regles.h), REGLES seul l'efface
+      * ========================================= */
+      case INSTRUCTION_REGLES :
+          if (!Protocole_DecodeRegles(trame, taille, programme, sizeof(programme), &taille_programme))
+            resultat = 0;
+          else
+            resultat = this->setRules(programme, taille_programme);
+
+          Protocole_EncodeReponseRegles(reponse, sizeof(reponse), resultat == REGLES_OK,
+                                        (resultat == REGLES_OK) ? (int32_t)taille_programme : resultat);
+          this->MQTT_Send(topic_donnees, reponse);
+      break;
+
+      default :
+      break;
+      }
+    }
+
+    /* =========================================
+        Commandes utilisateur adressées par alias
+    * ========================================= */ 
+    else if(_Alias >= 0 && taille_topic > taille_alias && Topic[taille_alias] == '/'
+            && memcmp(Topic + _Taille_Prefixe, _Topic_Alias_Instruction.c_str() + _Taille_Prefixe, taille_alias - _Taille_Prefixe) == 0)
+    {
+      int index = atoi(Topic + taille_alias + 1);
+      if (index >= 0 && index < _TileID && index < NB_TILES_MAX)
+      {
+        if (!this->isTileEcho(index, Instruction))
+        {
+          this->measureCommandLatency();
+          this->runRules(DECLENCHEUR_COMMANDE, index, Regles_TexteToInt(Instruction, taille));
+        }
+        PROFIL_PORTEE("callBack_Tile");
+        callBack_Tile(_Tiles[index].topic.c_str(),Instruction);
       }
     }
 
     /* =========================================
         Commandes envoyées par l'utilisateur
     * ========================================= */ 
-    else if(Topic.startsWith(topic_tile))
+    else if(matchTopic(Topic, taille_topic, TOPIC_TILE, false))
     {
-      String TileTopic = Topic.substring(topic_tile.length()+1);
+      const char* TileTopic = (taille_topic > _Topics[TOPIC_TILE].len) ? Topic + _Topics[TOPIC_TILE].len + 1 : "";
+      int index = getTileIndex(TileTopic);
+      if (index < 0 || !this->isTileEcho(index, Instruction))
+      {
+        this->measureCommandLatency();
+        if (index >= 0)
+          this->runRules(DECLENCHEUR_COMMANDE, index, Regles_TexteToInt(Instruction, taille));
+      }
+      PROFIL_PORTEE("callBack_Tile");
       callBack_Tile(TileTopic,Instruction);
     }
 }
 
 
+/*===============================================================================
+  Nom 			: 	receiveOTABlock
+  
+  Description	: 	Traite un bloc de l'image OTA et acquitte les blocs reçus
+					selon la fenêtre de contrôle de flux (voir DomoKit_OTA.h)
+  
+  Paramètre(s) 	: 	trame, taille : bloc reçu (trame binaire)
+  
+  Retour		: 	aucun
+===============================================================================*/
+void Domokit::receiveOTABlock(const uint8_t* trame, size_t taille)
+{
+  switch (_OTA.write(trame, taille))
+  {
+    case OTA_BLOC_ACQUITTER :
+      this->sendOTAStatus(PROTOCOLE_OTA_ACK, _OTA.getBlocAttendu(), -1);
+    break;
+
+    case OTA_BLOC_ERREUR :
+      this->sendOTAStatus(PROTOCOLE_OTA_ERREUR, _OTA.getErreur(), -1);
+    break;
+
+    default :
+    break;
+  }
+}
+
+// Envoie une réponse OTA au serveur (valeurs négatives omises)
+void Domokit::sendOTAStatus(const char* etat, int32_t valeur1, int32_t valeur2)
+{
+  char trame[TAILLE_TRAME];
+  if (Protocole_EncodeReponseOTA(trame, sizeof(trame), etat, valeur1, valeur2) > 0)
+    this->MQTT_Send(topic_ota, trame);
+}
+
 // ################################################################################
 // 						                    TILE DASHBOARD
 // ################################################################################ 
@@ -845,15 +2465,377 @@ void Domokit::Decode_Instruction(String Instruction,String Topic)
     
     Retour		: aucun
   ===============================================================================*/
-  void Domokit::SendtoTile(String topic, String Payload)
+  void Domokit::SendtoTile(const char* topic, const char* Payload)
   {
-    String mTopic = topic_tile + "/" + topic;
+    char mTopic[TAILLE_TOPIC];
+    int index = getTileIndex(topic);
+
+    // Mise à jour du cache de la tile (publication ignorée si la valeur n'a pas changé)
+    if (index >= 0)
+    {
+      if (_Tiles[index].politique == PUBLICATION_SUR_CHANGEMENT && _Tiles[index].valeur == Payload)
+        return;
+      _Tiles[index].valeur = Payload;
+    }
+
+    // Hors connexion : valeur enregistrée dans le journal, renvoyée à la reconnexion
+    if (index >= 0 && _Journal.isActive() && !_Transport->connected())
+    {
+      _Journal.append(index, millis(), Payload);
+      return;
+    }
+
+    if (index >= 0)
+    {
+      // Débit dépassé ou hors fenêtre d'émission : seule la dernière valeur
+      // sera publiée (serviceLink)
+      if (_Tiles[index].en_attente || !_Radio.isOpen() || !_Liaison.acquire())
+      {
+        if (_Tiles[index].en_attente)
+          _Liaison.coalesce();
+        _Tiles[index].en_attente = true;
+        return;
+      }
+      this->publishTile(index);
+      return;
+    }
+
+    snprintf(mTopic, sizeof(mTopic), "%s/%s", topic_tile, topic);
     this->MQTT_Send(mTopic,Payload);
   }
 
+  // Publie la dernière valeur d'une tile déclarée
+  void Domokit::publishTile(int index)
+  {
+    char mTopic[TAILLE_TOPIC];
+
+    // Alias négocié : topic court <MAIN_TOPIC>/a/<alias>/<id tile>
+    if (_Alias >= 0)
+      snprintf(mTopic, sizeof(mTopic), "%s/%d", _Topic_Alias.c_str(), index);
+    else
+      snprintf(mTopic, sizeof(mTopic), "%s/%s", topic_tile, _Tiles[index].topic.c_str());
+    _Tiles[index].en_attente = false;
+
+    // Écho attendu seulement sur topic_tile (l'objet n'est pas abonné au topic d'alias
+    // des valeurs) et si le message est parti : sinon une vraie commande serait ignorée
+    bool envoye = this->MQTT_Send(mTopic, _Tiles[index].valeur.c_str());
+    _Tiles[index].echo = envoye && (_Alias < 0);
+
+    // Première télémétrie : chronologie du démarrage publiée une seule fois
+    if (!_Demarrage.isDone(DEMARRAGE_TELEMETRIE))
+    {
+      _Demarrage.end(DEMARRAGE_TELEMETRIE);
+      _Scheduler.once("demarrage", 0, [this] () {
+        this->publishBootTimeline();
+      });
+    }
+  }
+
+  /*===============================================================================
+    Nom 			: serviceLink
+    
+    Description	: Tâche de la liaison (voir DomoKit_Liaison.h) :
+                - relève les signes de congestion (wifi, tampon d'émission,
+                  fenêtre QoS 1) et envoie les pings
+                - ferme une connexion dont les pings restent sans réponse :
+                  elle sera rétablie par la tâche de connexion
+                - publie les valeurs en attente selon les jetons disponibles
+    
+    Paramètre(s) 	: aucun
+    
+    Retour		: aucun
+  ===============================================================================*/
+  void Domokit::serviceLink()
+  {
+    char trame[TAILLE_TRAME];
+    uint16_t numero;
+
+    // Fenêtres d'émission : pings et valeurs en attente dans les fenêtres uniquement
+    if (!_Transport->connected() || !_Radio.isOpen())
+      return;
+
+    _Liaison.observe(WiFi.RSSI(), _Transport->availableForWrite(), _Inflight.getNbEnAttente(), QOS_TAILLE_FENETRE);
+
+    if (_Liaison.nextPing(&numero))
+    {
+      size_t taille = Protocole_EncodePing(trame, sizeof(trame), numero);
+      _Transport->publish(_Topics[TOPIC_PING].ptr, (const uint8_t*)trame, taille);
+      _Energie.countSent(_Topics[TOPIC_PING].len, taille);
+    }
+
+    if (_Liaison.isDead())
+    {
+      DEBUG_PRINTLN("Liaison morte (pings sans réponse) : déconnexion du broker");
+      _Transport->disconnect();
+      _Liaison.reset();
+      return;
+    }
+
+    for (int i = 0; i < _TileID && i < NB_TILES_MAX; i++)
+    {
+      if (_Tiles[i].en_attente && _Liaison.acquire())
+        this->publishTile(i);
+    }
+  }
+
+#ifndef DOMOKIT_SANS_STRING
+  void Domokit::SendtoTile(String topic, String Payload)
+  {
+    this->SendtoTile(topic.c_str(), Payload.c_str());
+  }
+#endif
+
+  /*===============================================================================
+    Nom 			: setTilePolicy
+    
+    Description	: Défini la politique de publication d'une tile déclarée
+    
+    Paramètre(s) 	: 
+    * topic 		: topic de la tile
+    * politique	: PUBLICATION_TOUJOURS ou PUBLICATION_SUR_CHANGEMENT
+    
+    Retour		: aucun
+  ===============================================================================*/
+  void Domokit::setTilePolicy(Domokit_Texte topic, uint8_t politique)
+  {
+    int index = getTileIndex(Domokit_CStr(topic));
+    if (index >= 0)
+      _Tiles[index].politique = politique;
+  }
+
+  /*===============================================================================
+    Nom 			: publishSnapshot
+    
+    Description	: Publie les dernières valeurs envoyées à chaque tile, groupées
+                dans une trame SNAPSHOT (voir DomoKit_Protocole.h) sur
+                topic_donnees. Si les valeurs ne tiennent pas dans une trame,
+                plusieurs trames SNAPSHOT sont envoyées.
+    
+    Paramètre(s) 	: aucun
+    
+    Retour		: aucun
+  ===============================================================================*/
+  void Domokit::publishSnapshot()
+  {
+    char trame[TAILLE_SNAPSHOT];
+    size_t taille = Protocole_EncodeSnapshotHeader(trame, sizeof(trame));
+    size_t taille_entete = taille;
+
+    for (int i = 0; i < _TileID && i < NB_TILES_MAX; i++)
+    {
+      if (_Tiles[i].valeur.length() == 0)
+        continue;
+
+      size_t suite = Protocole_AppendSnapshotEntry(trame, sizeof(trame), taille, i, _Tiles[i].topic.c_str(), _Tiles[i].valeur.c_str());
+
+      // Trame pleine : envoi puis nouvelle trame
+      if (suite == 0 && taille > taille_entete)
+      {
+        trame[taille] = '\0';
+        this->MQTT_Send(topic_donnees, trame);
+        taille = Protocole_EncodeSnapshotHeader(trame, sizeof(trame));
+        suite = Protocole_AppendSnapshotEntry(trame, sizeof(trame), taille, i, _Tiles[i].topic.c_str(), _Tiles[i].valeur.c_str());
+      }
+      if (suite > 0)
+        taille = suite;
+    }
+
+    trame[taille] = '\0';
+    this->MQTT_Send(topic_donnees, trame);
+  }
+
+  /*===============================================================================
+    Nom 			: publishBackfill
+    
+    Description	: Renvoie les valeurs enregistrées hors connexion, groupées
+                dans une trame BACKFILL (voir DomoKit_Protocole.h) sur
+                topic_donnees. Les enregistrements ne sont confirmés dans le
+                journal que si la trame a été émise et que la connexion est
+                toujours établie après l'envoi (sinon ils seront renvoyés).
+    
+    Paramètre(s) 	: aucun
+    
+    Retour		: aucun
+  ===============================================================================*/
+  void Domokit::publishBackfill()
+  {
+    // Taille max d'une entrée : \n id ; age ; valeur
+    const size_t taille_entree = 1 + 3 + 1 + 11 + 1 + JOURNAL_TAILLE_VALEUR;
+    char trame[TAILLE_SNAPSHOT];
+    Journal_Enregistrement enregistrement;
+    size_t taille;
+    int nb = 0;
+
+    if (!_Program_Start || !_Transport->connected() || _Journal.getNbEnAttente() == 0)
+      return;
+
+    taille = Protocole_EncodeBackfillHeader(trame, sizeof(trame));
+    while (taille + taille_entree < sizeof(trame) && _Journal.read(&enregistrement))
+    {
+      int32_t age = enregistrement.ancien ? -1 : (int32_t)(millis() - enregistrement.date);
+      taille = Protocole_AppendBackfillEntry(trame, sizeof(trame), taille, enregistrement.tile, age, enregistrement.valeur);
+      nb++;
+    }
+    if (nb == 0)
+      return;
+
+    // Enregistrements supprimés du journal seulement si la trame a été émise
+    if (this->MQTT_Send(topic_donnees, trame) && _Transport->connected())
+      _Journal.commit();
+    else
+      _Journal.rewind();
+  }
+
+  /*===============================================================================
+    Nom 			: SendtoTileAt
+    
+    Description	: Envoie une valeur horodatée à une tile déclarée. Les valeurs
+                sont regroupées (au plus MESURES_NB_MAX) et publiées par
+                publishSamples : le retard de publication ne change pas la
+                date de la mesure. Hors connexion, la valeur est enregistrée
+                dans le journal (s'il est activé).
+    
+    Paramètre(s) 	: 
+    * topic 		: topic de la tile
+    * payload	  : valeur
+    * date	    : date de la mesure (getClock().monotonic())
+    
+    Retour		: false si la tile est inconnue
+  ===============================================================================*/
+  bool Domokit::SendtoTileAt(Domokit_Texte topic, Domokit_Texte payload, uint64_t date)
+  {
+    const char* valeur = Domokit_CStr(payload);
+    int index = getTileIndex(Domokit_CStr(topic));
+
+    if (index < 0)
+      return false;
+
+    if (_Tiles[index].politique == PUBLICATION_SUR_CHANGEMENT && _Tiles[index].valeur == valeur)
+      return true;
+    _Tiles[index].valeur = valeur;
+
+    if (_Journal.isActive() && !_Transport->connected())
+    {
+      _Journal.append(index, (uint32_t)date, valeur);
+      return true;
+    }
+
+    if (_Nb_Mesures == MESURES_NB_MAX)
+      this->publishSamples();
+
+    Domokit_Mesure* mesure = &_Mesures[_Nb_Mesures++];
+    mesure->tile = index;
+    mesure->date = date;
+    mesure->valeur = valeur;
+
+    if (_Tache_Mesures == SCHEDULER_AUCUNE_TACHE)
+    {
+      _Tache_Mesures = _Scheduler.once("mesures", MESURES_DELAI_MAX_MS, [this] () {
+        _Tache_Mesures = SCHEDULER_AUCUNE_TACHE;
+        if (!this->deferToWindow(DIFFERE_MESURES))
+          this->publishSamples();
+      });
+    }
+    return true;
+  }
+
+  /*===============================================================================
+    Nom 			: publishSamples
+    
+    Description	: Publie les valeurs horodatées en attente sur topic_donnees :
+                trame MESURES (heure du serveur) si l'horloge est synchronisée,
+                sinon trame BACKFILL (âge de chaque valeur à l'envoi).
+                Hors connexion, les valeurs passent dans le journal (s'il est
+                activé), sinon elles sont perdues.
+    
+    Paramètre(s) 	: aucun
+    
+    Retour		: aucun
+  ===============================================================================*/
+  void Domokit::publishSamples()
+  {
+    char trame[TAILLE_SNAPSHOT];
+    size_t taille;
+    uint64_t maintenant = _Horloge.monotonic();
+    bool synchronise = _Horloge.isSynchronized();
+
+    _Scheduler.cancel(_Tache_Mesures);
+    _Tache_Mesures = SCHEDULER_AUCUNE_TACHE;
+    if (_Nb_Mesures == 0)
+      return;
+
+    if (!_Transport->connected())
+    {
+      for (uint8_t i = 0; i < _Nb_Mesures && _Journal.isActive(); i++)
+        _Journal.append(_Mesures[i].tile, (uint32_t)_Mesures[i].date, _Mesures[i].valeur.c_str());
+      _Nb_Mesures = 0;
+      return;
+    }
+
+    auto entete = [&] () {
+      return synchronise ? Protocole_EncodeMesuresHeader(trame, sizeof(trame)) : Protocole_EncodeBackfillHeader(trame, sizeof(trame));
+    };
+    auto ajouter = [&] (size_t position, const Domokit_Mesure* mesure) {
+      if (synchronise)
+        return Protocole_AppendMesureEntry(trame, sizeof(trame), position, mesure->tile, _Horloge.toServerTime(mesure->date), mesure->valeur.c_str());
+      return Protocole_AppendBackfillEntry(trame, sizeof(trame), position, mesure->tile, (int32_t)(maintenant - mesure->date), mesure->valeur.c_str());
+    };
+
+    taille = entete();
+    size_t taille_entete = taille;
+    for (uint8_t i = 0; i < _Nb_Mesures; i++)
+    {
+      size_t suite = ajouter(taille, &_Mesures[i]);
+
+      // Trame pleine (valeurs longues) : envoi puis nouvelle trame, comme publishSnapshot
+      if (suite == 0 && taille > taille_entete)
+      {
+        trame[taille] = '\0';
+        this->MQTT_Send(topic_donnees, trame);
+        taille = entete();
+        suite = ajouter(taille, &_Mesures[i]);
+      }
+      // Valeur trop longue même seule dans une trame : ignorée
+      if (suite > 0)
+        taille = suite;
+    }
+    _Nb_Mesures = 0;
+
+    if (taille > taille_entete)
+    {
+      trame[taille] = '\0';
+      this->MQTT_Send(topic_donnees, trame);
+    }
+  }
+
+  // Envoie une demande de synchronisation de l'horloge (HEURE;t1 sur topic_donnees)
+  void Domokit::syncClock()
+  {
+    char trame[TAILLE_TRAME];
+
+    if (!_Program_Start || !_Transport->connected())
+      return;
+
+    _Sync_Demande = (int64_t)_Horloge.monotonic();
+    if (Protocole_EncodeHeure(trame, sizeof(trame), _Sync_Demande) > 0)
+      this->MQTT_Send(topic_donnees, trame);
+  }
+
+  // Renvoie l'ID d'une tile à partir de son topic (-1 si la tile est inconnue)
+  int Domokit::getTileIndex(const char* Topic)
+  {
+    for (int i = 0; i < _TileID && i < NB_TILES_MAX; i++)
+    {
+      if (_Tiles[i].topic == Topic)
+        return i;
+    }
+    return -1;
+  }
+
 
   void Domokit::resetTile()
   {
+    PROFIL_PORTEE("resetTile");
     composeSetTilePayload("delete",""); delay(1000);
   }
     /*===============================================================================
@@ -871,22 +2853,42 @@ void Domokit::Decode_Instruction(String Instruction,String Topic)
 
     Retour		: rien
   ===============================================================================*/
-  void Domokit::setTile(String Titre, int Type, String Topic, int levelMin, int levelMax, String onIcon, String offIcon)
+  void Domokit::setTile(const char* Titre, int Type, const char* Topic, int levelMin, int levelMax, const char* onIcon, const char* offIcon)
   {
-      String mTopic = topic_tile + "/" + Topic; 
+      char mTopic[TAILLE_TOPIC];
+      char nombre[12];
+      PROFIL_PORTEE("setTile");
+
+      snprintf(mTopic, sizeof(mTopic), "%s/%s", topic_tile, Topic);
       composeSetTilePayload("Titre",Titre);
-      composeSetTilePayload("Type",String(Type));
+      snprintf(nombre, sizeof(nombre), "%d", Type);
+      composeSetTilePayload("Type",nombre);
       composeSetTilePayload("Topic",mTopic);
       
-      composeSetTilePayload("LevelMin",String(levelMin));
-      composeSetTilePayload("LevelMax",String(levelMax));
+      snprintf(nombre, sizeof(nombre), "%d", levelMin);
+      composeSetTilePayload("LevelMin",nombre);
+      snprintf(nombre, sizeof(nombre), "%d", levelMax);
+      composeSetTilePayload("LevelMax",nombre);
       
 
-      if(onIcon != "")
+      if(onIcon[0] != '\0')
         composeSetTilePayload("OnIcon",onIcon);
-      if(offIcon != "")
+      if(offIcon[0] != '\0')
         composeSetTilePayload("OffIcon",offIcon);
 
+      // Mémorisation de la tile (table des alias de topics et cache des valeurs)
+      if (_TileID < NB_TILES_MAX)
+      {
+        if (_Tiles[_TileID].topic != Topic)
+        {
+          _Tiles[_TileID].valeur.clear();
+          _Tiles[_TileID].politique = PUBLICATION_TOUJOURS;
+        }
+        _Tiles[_TileID].topic = Topic;
+        _Tiles[_TileID].en_attente = false;
+        _Tiles[_TileID].echo = false;
+      }
+
       _TileID++;
       delay(10);
   }
@@ -902,10 +2904,11 @@ void Domokit::Decode_Instruction(String Instruction,String Topic)
   
   Retour		: aucun
 ===============================================================================*/
-  void Domokit::composeSetTilePayload(String attribut, String valeur)
+  void Domokit::composeSetTilePayload(const char* attribut, const char* valeur)
   {
-      String payload = String(_TileID) + ";" + attribut + ";" + valeur;
-      this->MQTT_Send(topic_set_tile,payload);
+      char payload[TAILLE_TRAME];
+      if (Protocole_EncodeSetTile(payload, sizeof(payload), _TileID, attribut, valeur) > 0)
+        this->MQTT_Send(topic_set_tile,payload);
   }
 
 /*===============================================================================
@@ -913,15 +2916,15 @@ void Domokit::Decode_Instruction(String Instruction,String Topic)
     
     Description	: Définit une Tile de type Texte (pilotable ou affichage uniquement )
   ===============================================================================*/
-  void Domokit::setTileText(String Titre, String Topic, bool enablePub)
+  void Domokit::setTileText(Domokit_Texte Titre, Domokit_Texte Topic, bool enablePub)
   {
     if (enablePub)
     {
-      this->setTile(Titre,TILE_TEXT_DRIVE,Topic,0,0,"","");
+      this->setTile(Domokit_CStr(Titre),TILE_TEXT_DRIVE,Domokit_CStr(Topic),0,0,"","");
     }
     else
     {
-      this->setTile(Titre,TILE_TEXT_DISPLAY,Topic,0,0,"","");
+      this->setTile(Domokit_CStr(Titre),TILE_TEXT_DISPLAY,Domokit_CStr(Topic),0,0,"","");
     }
   }
 
@@ -930,9 +2933,9 @@ void Domokit::Decode_Instruction(String Instruction,String Topic)
     
     Description	: Définit une Tile de type Switch
   ===============================================================================*/
-  void Domokit::setTileSwitch(String Titre, String Topic)
+  void Domokit::setTileSwitch(Domokit_Texte Titre, Domokit_Texte Topic)
   {
-      this->setTile(Titre,TILE_SWITCH,Topic,0,0,"","");
+      this->setTile(Domokit_CStr(Titre),TILE_SWITCH,Domokit_CStr(Topic),0,0,"","");
   }
 
   /*===============================================================================
@@ -940,9 +2943,9 @@ void Domokit::Decode_Instruction(String Instruction,String Topic)
     
     Description	: Définit une Tile de type Switch
   ===============================================================================*/
-  void Domokit::setTileGraph(String Titre, String Topic,int levelMin,int levelMax)
+  void Domokit::setTileGraph(Domokit_Texte Titre, Domokit_Texte Topic,int levelMin,int levelMax)
   {
-      this->setTile(Titre,TILE_GRAPH,Topic,levelMin,levelMax,"","");
+      this->setTile(Domokit_CStr(Titre),TILE_GRAPH,Domokit_CStr(Topic),levelMin,levelMax,"","");
   }
 
   /*===============================================================================
@@ -950,15 +2953,15 @@ void Domokit::Decode_Instruction(String Instruction,String Topic)
     
     Description	: Définit une Tile de type Jauge
   ===============================================================================*/
-  void Domokit::setTileJauge(String Titre, String Topic, bool enablePub,int levelMin,int levelMax)
+  void Domokit::setTileJauge(Domokit_Texte Titre, Domokit_Texte Topic, bool enablePub,int levelMin,int levelMax)
   {
     if (enablePub)
     {
-      this->setTile(Titre,TILE_JAUGE_DRIVE,Topic,levelMin,levelMax,"","");
+      this->setTile(Domokit_CStr(Titre),TILE_JAUGE_DRIVE,Domokit_CStr(Topic),levelMin,levelMax,"","");
     }
     else
     {
-      this->setTile(Titre,TILE_JAUGE_DISPLAY,Topic,levelMin,levelMax,"","");
+      this->setTile(Domokit_CStr(Titre),TILE_JAUGE_DISPLAY,Domokit_CStr(Topic),levelMin,levelMax,"","");
     }
       
   }
@@ -972,9 +2975,9 @@ void Domokit::Decode_Instruction(String Instruction,String Topic)
     https://fontawesome.com/v4.7.0/cheatsheet/
     ex : fa-android , fa-ban , fa-circle-o , etc...
   ===============================================================================*/
-  void Domokit::setTileRadioButton(String Titre, String Topic, String onIcon, String offIcon)
+  void Domokit::setTileRadioButton(Domokit_Texte Titre, Domokit_Texte Topic, Domokit_Texte onIcon, Domokit_Texte offIcon)
   {
-    this->setTile(Titre,TILE_RADIOBUTTON,Topic,0,0,onIcon,offIcon);
+    this->setTile(Domokit_CStr(Titre),TILE_RADIOBUTTON,Domokit_CStr(Topic),0,0,Domokit_CStr(onIcon),Domokit_CStr(offIcon));
   }
 
     /*===============================================================================
@@ -986,9 +2989,9 @@ void Domokit::Decode_Instruction(String Instruction,String Topic)
     https://fontawesome.com/v4.7.0/cheatsheet/
     ex : fa-android , fa-ban , fa-circle-o , etc...
   ===============================================================================*/
-  void Domokit::setTileIcon(String Titre, String Topic)
+  void Domokit::setTileIcon(Domokit_Texte Titre, Domokit_Texte Topic)
   {
-    this->setTile(Titre,TILE_ICON,Topic,0,0,"","");
+    this->setTile(Domokit_CStr(Titre),TILE_ICON,Domokit_CStr(Topic),0,0,"","");
   }
 
     /*===============================================================================
@@ -1003,10 +3006,11 @@ void Domokit::Decode_Instruction(String Instruction,String Topic)
     la couleur doit être au format :
     #RRGGBB #AARRGGBB 'red', 'blue', 'green', 'black', 'white', 'gray', 'cyan', 'magenta', 'yellow', 'lightgray', 'darkgray' 
   ===============================================================================*/
-  void Domokit::SendIconToTile(String topic, String fa_icon, String color)
+  void Domokit::SendIconToTile(Domokit_Texte topic, Domokit_Texte fa_icon, Domokit_Texte color)
   {
-      String payload = fa_icon + ";" + color;
-      SendtoTile(topic,payload);
+      char payload[TAILLE_TRAME];
+      if (Protocole_EncodeIcone(payload, sizeof(payload), Domokit_CStr(fa_icon), Domokit_CStr(color)) > 0)
+        SendtoTile(Domokit_CStr(topic),payload);
   }
 
 // ################################################################################
@@ -1044,27 +3048,42 @@ String ParseString(String data, char separator, int index)
 
 
 /*===============================================================================
-  Nom 			: 	  Read_STR_EEPROM
+  Nom 			: 	  Read_EEPROM
   
-  Description	: 	Permet de lire une partie de la mémoire EEPROM sous forme de String
+  Description	: 	Permet de lire une partie de la mémoire EEPROM dans un buffer
 					
-  Paramètre(s) 	: taille : nombre d'octets à lire
+  Paramètre(s) 	: dest : buffer de taille+1 octets (terminé par '\0')
+                  taille : nombre d'octets à lire
                   addr_debut : adresse mémoire où on va lire
   
-  Retour		: 	  Contenu de la mémoire sous forme de String
+  Retour		: 	  aucun
 ===============================================================================*/
-String Read_STR_EEPROM(int taille, int addr_debut)
+void Read_EEPROM(char* dest, int taille, int addr_debut)
 {
   DEBUG_PRINTLN("Read EEPROM ! ");
- char str[taille];
-	EEPROM.begin(taille);
+	EEPROM.begin(EEPROM_TAILLE);
 
  for (int j=0; j<taille; j++) 
  {
-   str[j] =  char(EEPROM.read(j + addr_debut));
+   dest[j] =  char(EEPROM.read(j + addr_debut));
  }
- str[taille] = '\0';
+ dest[taille] = '\0';
+}
 
+/*===============================================================================
+  Nom 			: 	  Read_STR_EEPROM
+  
+  Description	: 	Permet de lire une partie de la mémoire EEPROM sous forme de String
+					
+  Paramètre(s) 	: taille : nombre d'octets à lire
+                  addr_debut : adresse mémoire où on va lire
+  
+  Retour		: 	  Contenu de la mémoire sous forme de String
+===============================================================================*/
+String Read_STR_EEPROM(int taille, int addr_debut)
+{
+ char str[taille+1];
+ Read_EEPROM(str, taille, addr_debut);
  return String(str);
 }
 
@@ -1082,7 +3101,7 @@ String Read_STR_EEPROM(int taille, int addr_debut)
 void Write_STR_EEPROM(char str[], int taille, int addr_debut)
 {
   DEBUG_PRINTLN("Write EEPROM ! ");
-  EEPROM.begin(taille);
+  EEPROM.begin(EEPROM_TAILLE); // taille totale : préserve les autres zones au commit
 
   for (int i=0; i<taille; i++) {
      EEPROM.write(i + addr_debut,str[i]);
@@ -1094,57 +3113,82 @@ void Write_STR_EEPROM(char str[], int taille, int addr_debut)
 /*===============================================================================
   Nom 			: 	  Cryptage
   
-  Description	: 	Permet de crypter une chaîne de caractère (String), selon une clé de chiffrement
+  Description	: 	Permet de crypter une chaîne de caractère, selon une clé de chiffrement
 					
   Paramètre(s) 	: src : chaîne à crypter
+                  dest : buffer de sortie (terminé par '\0', tronqué si trop petit)
+                  taille_dest : taille du buffer de sortie
                   key : clé de chiffrement
   
-  Retour		: 	  Chaîne cryptée
+  Retour		: 	  taille de la chaîne cryptée
 ===============================================================================*/
-String Cryptage(char* src, String key)
+size_t Cryptage(const char* src, char* dest, size_t taille_dest, const char* key)
 {
-  char Dest[512];
+  size_t taille = strlen(src);
+  if (taille > taille_dest - 1)
+    taille = taille_dest - 1;
+
   if (key_serveur_dispo)
   {
-    for (unsigned int i=0 ; i < strlen(src) ; i++)
+    for (size_t i=0 ; i < taille ; i++)
     {
       // Mettre algo de cryptage ici
-      Dest[i] = src[i];
+      dest[i] = src[i];
     }
-    Dest[strlen(src)] = '\0';
-    return String(Dest);
   }
   else
   {
-    return String(src);
+    memcpy(dest, src, taille);
   }
+  dest[taille] = '\0';
+  return taille;
 }
 
 /*===============================================================================
   Nom 			: 	  Decryptage
   
-  Description	: 	Permet de décrypter une chaîne de caractère (String), selon une clé de chiffrement
+  Description	: 	Permet de décrypter une chaîne de caractère, selon une clé de chiffrement
 					
   Paramètre(s) 	: src : chaîne à décrypter
+                  dest : buffer de sortie (terminé par '\0', tronqué si trop petit)
+                  taille_dest : taille du buffer de sortie
                   key : clé de chiffrement
   
-  Retour		: 	  Chaîne décryptée
+  Retour		: 	  taille de la chaîne décryptée
 ===============================================================================*/
-String Decryptage(char* src, String key)
+size_t Decryptage(const char* src, char* dest, size_t taille_dest, const char* key)
 {
-  char Dest [512];
+  size_t taille = strlen(src);
+  if (taille > taille_dest - 1)
+    taille = taille_dest - 1;
+
   if (key_serveur_dispo)
   {
-    for (unsigned int i=0 ; i < strlen(src) ; i++)
+    for (size_t i=0 ; i < taille ; i++)
     {
       // Mettre algo de décryptage ici
-      Dest[i] = src[i];
+      dest[i] = src[i];
     }
-    Dest[strlen(src)] = '\0';
-    return String(Dest);
   }
   else
   {
-    return String(src);
+    memcpy(dest, src, taille);
   }
+  dest[taille] = '\0';
+  return taille;
+}
+
+// Versions String (compatibilité)
+String Cryptage(char* src, String key)
+{
+  char Dest[TAILLE_MESSAGE];
+  Cryptage(src, Dest, sizeof(Dest), key.c_str());
+  return String(Dest);
+}
+
+String Decryptage(char* src, String key)
+{
+  char Dest[TAILLE_MESSAGE];
+  Decryptage(src, Dest, sizeof(Dest), key.c_str());
+  return String(Dest);
 }
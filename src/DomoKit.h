@@ -29,8 +29,24 @@
   #include "Arduino.h"
 #endif
   #include <ESP8266WiFi.h>
-  #include <PubSubClient.h>
   #include <EEPROM.h>
+  #include "DomoKit_Protocole.h"
+  #include "DomoKit_Transport.h"
+  #include "DomoKit_Trace.h"
+  #include "DomoKit_Memoire.h"
+  #include "DomoKit_QoS.h"
+  #include "DomoKit_Evenements.h"
+  #include "DomoKit_Profil.h"
+  #include "DomoKit_Scheduler.h"
+  #include "DomoKit_OTA.h"
+  #include "DomoKit_Capteurs.h"
+  #include "DomoKit_Regles.h"
+  #include "DomoKit_Journal.h"
+  #include "DomoKit_Horloge.h"
+  #include "DomoKit_Liaison.h"
+  #include "DomoKit_Radio.h"
+  #include "DomoKit_Energie.h"
+  #include "DomoKit_Demarrage.h"
 
 // ################################################################################
 // 				VERSION DE LA LIBRAIRIE
@@ -40,15 +56,17 @@
 
 // ################################################################################
 // 				Jeu d'instruction interprétable par l'objet domokit
+// 				(codec et trames du protocole : voir DomoKit_Protocole.h)
 // ################################################################################
-  #define START       "START"
-  #define STOP        "STOP"
-  #define ON          "ON"
-  #define OFF         "OFF"
-  #define DATA        "DATA"
-  #define CONNECT     "CONNECT"
-  #define COMMANDE    "CMD"
-  #define WIFI_DATA   "WIFI_DATA"
+  #define START       PROTOCOLE_START
+  #define STOP        PROTOCOLE_STOP
+  #define ON          PROTOCOLE_ON
+  #define OFF         PROTOCOLE_OFF
+  #define DATA        PROTOCOLE_DATA
+  #define CONNECT     PROTOCOLE_CONNECT
+  #define COMMANDE    PROTOCOLE_COMMANDE
+  #define WIFI_DATA   PROTOCOLE_WIFI_DATA
+  #define ALIAS       PROTOCOLE_ALIAS
 
 // ################################################################################
 // 				Définition des "Tile" existantes pour les Dashboards
@@ -62,20 +80,39 @@
   #define TILE_JAUGE_DRIVE    6
   #define TILE_RADIOBUTTON    7
   #define TILE_ICON           8
+
+  #define NB_TILES_MAX        16  // nombre max de tiles déclarées par l'objet
+
+  // Politique de publication d'une tile (SendtoTile)
+  #define PUBLICATION_TOUJOURS        0 // chaque appel est publié
+  #define PUBLICATION_SUR_CHANGEMENT  1 // publié uniquement si la valeur a changé
+
+  #define TAILLE_SNAPSHOT     512 // taille max d'une trame SNAPSHOT
+
+  // Valeurs horodatées (SendtoTileAt) : regroupées puis publiées dans une trame
+  // MESURES, au plus tard MESURES_DELAI_MAX_MS après la première valeur
+  #define MESURES_NB_MAX          8
+  #define MESURES_TAILLE_VALEUR   17
+  #define MESURES_DELAI_MAX_MS    10000
   
 // ################################################################################
 // 				Defines , définition et variables globales
 // ################################################################################
   #define _PARSE  ";" // Caractère pour parser les trames MQTT
+  #define TAILLE_TRAME 128 // taille max des trames encodées par l'objet
   
   #define SSID_WIFI_APPAIRAGE "<Domokit_Appairage>"
   #define PASSWORD_WIFI_APPAIRAGE "domokit_appairage"
   #define NB_TENTATIVE_CONNEXION 30
+  #define WIFI_DUREE_ASSOCIATION_MS (NB_TENTATIVE_CONNEXION * 500) // avant de changer de réseau
   #define WIFI_MODE_NORMAL 0
   #define WIFI_MODE_APPAIRAGE 1
 
   // Mapping mémoire EEPROM
+  #define EEPROM_TAILLE    2048   // taille totale réservée (commune à toutes les zones)
   #define EEPROM_ADDR_WIFI 0x0000
+  #define EEPROM_ADDR_QOS  0x0200 // fenêtre QoS 1 (voir DomoKit_QoS.h)
+  #define EEPROM_ADDR_REGLES 0x0600 // programme du moteur de règles (voir DomoKit_Regles.h)
 
   // Pins pour la led RGB
   #define LED_R_PIN 0x0C 
@@ -93,6 +130,32 @@
   // Topic principal MQTT
   #define MAIN_TOPIC    "domokit"
 
+  // Alias de topics : <MAIN_TOPIC>/a/<alias objet>/<id tile>
+  #define ALIAS_TOPIC   "a"
+
+  // Instructions adressées à plusieurs objets (abonnements optionnels)
+  // <MAIN_TOPIC>/instruction/groupe/<nom> et <MAIN_TOPIC>/instruction/tous
+  #define GROUPE_TOPIC      "groupe"
+  #define DIFFUSION_TOPIC   "tous"
+  #define NB_GROUPES_MAX    2
+
+  // Périodes des tâches internes de la librairie (ordonnanceur)
+  #define PERIODE_CONNEXION_MS  5000   // vérification connexion / authentification
+  #define PERIODE_LED_MS        500    // témoin lumineux (clignotement pendant l'authentification)
+  #define PERIODE_QOS_MS        100    // renvois de la fenêtre QoS 1
+  #define PERIODE_HEARTBEAT_MS  60000  // signal de présence spontané
+  #define PERIODE_METRIQUES_MS  60000  // publication des métriques sur topic_metriques
+  #define PERIODE_DEMARRAGE_MS  50     // attente du wifi au démarrage (connexion au broker dès l'IP obtenue)
+
+  // Demandes d'authentification (trame de connexion) : délai aléatoire, doublé
+  // à chaque tentative jusqu'au plafond. Le serveur peut imposer un délai
+  // (ATTENTE;ms), lui aussi plafonné et étalé aléatoirement.
+  #define AUTH_DELAI_INITIAL_MS 2000
+  #define AUTH_DELAI_MAX_MS     120000
+
+  // Budget de poll() pour traiter les messages MQTT en attente
+  #define POLL_BUDGET_US        2000
+
 
   // Fonctions associées au mode Debug
   #ifdef DEBUG_DOMOKIT
@@ -113,16 +176,60 @@
 // Liste des états de la connexion wifi
 typedef enum{NON_CONNECTE,APPAIRAGE,CONNECTE,ETEINT} Statut_Wifi;
 
+// Tile déclarée par l'objet et dernière valeur envoyée
+typedef struct
+{
+  Domokit_Chaine<TAILLE_TOPIC_TILE>  topic;
+  Domokit_Chaine<TAILLE_VALEUR_TILE> valeur;
+  uint8_t politique;
+  bool    en_attente;   // valeur non publiée (débit limité, voir DomoKit_Liaison.h)
+  bool    echo;         // valeur publiée, renvoyée par le broker sur le topic d'abonnement
+} Domokit_Tile;
+
+// Valeur horodatée en attente de publication
+typedef struct
+{
+  uint8_t  tile;
+  uint64_t date;    // horloge monotone de l'objet (ms)
+  Domokit_Chaine<MESURES_TAILLE_VALEUR> valeur;
+} Domokit_Mesure;
+
+// Topics de l'objet (index dans la table des topics, voir Create_Topics)
+typedef enum
+{
+  TOPIC_INSTRUCTION,
+  TOPIC_DONNEES,
+  TOPIC_INTERRUPTION,
+  TOPIC_CONNEXION,
+  TOPIC_CONNECT,
+  TOPIC_DEBUG,
+  TOPIC_TILE,
+  TOPIC_SET_TILE,
+  TOPIC_METRIQUES,
+  TOPIC_OTA,          // réponses de l'objet pendant une mise à jour
+  TOPIC_OTA_BLOCS,    // blocs de l'image (serveur -> objet)
+  TOPIC_DIFFUSION,    // instructions adressées à tous les objets
+  TOPIC_PRESENCE,     // naissance / testament (messages retenus)
+  TOPIC_PING,         // ping renvoyé par le broker (qualité de la liaison)
+  NB_TOPICS
+} Domokit_TopicId;
+
+  #define TOPIC_AUCUN -1
+
 // ################################################################################
 // 								Fonctions de callback
 // ################################################################################
   extern void init_Tile();
+#ifdef DOMOKIT_SANS_STRING
+  extern void callBack_Tile(const char* TileTopic, const char* payload);
+#else
   extern void callBack_Tile(String TileTopic, String payload);
+#endif
   
 // ################################################################################
 // 									Classes
 // ################################################################################
-	class Domokit
+	class Domokit : private Domokit_Regles_Hote
 	{
 
 // ================================================================================
@@ -132,23 +239,45 @@ typedef enum{NON_CONNECTE,APPAIRAGE,CONNECTE,ETEINT} Statut_Wifi;
       // -------------------------
 			// Constructeur
       // -------------------------
-      Domokit(String Nom_Appareil);
+      Domokit(Domokit_Texte Nom_Appareil);
 			
 			// -------------------------
       // Setters
       // -------------------------
 			void enableLedWifi(void);
       void disableLedWifi(void);
-			void setName(String Name);
+			void setName(Domokit_Texte Name);
+      void setTransport(Domokit_Transport* transport);
+      void enableTopicAlias(void);
+      void enableBroadcast(void);
+      bool joinGroup(Domokit_Texte groupe);
+      void enableOTA(void);
+      void setOTATarget(Domokit_OTA_Cible* cible);
+      void setOTASource(Domokit_OTA_Source* source);
+      void enableOfflineLog(void);
+      void setOfflineLogFlash(Domokit_Flash* flash);
+      unsigned long enableRadioWindows(unsigned long periode_ms, uint8_t dtim);
+      void setEnergyModel(Domokit_Modele_Energie* modele);
 			void startProgram();
 			void stopProgram();
-			void Debug_MQTT_Print(String message);
+			void Debug_MQTT_Print(Domokit_Texte message);
       void Create_Topics();
 			// -------------------------
       // Getters
       // -------------------------
 			boolean getStateProgram();
-			String  getAddrMac();
+			const char* getAddrMac();
+      Domokit_Scheduler& getScheduler();
+      Protocole_Vue getTopic(Domokit_TopicId id);
+      Domokit_OTA& getOTA();
+      Domokit_Journal& getOfflineLog();
+      Domokit_Horloge& getClock();
+      Domokit_Liaison& getLink();
+      Domokit_Radio& getRadio();
+      Domokit_Energie& getEnergy();
+      Domokit_Demarrage& getBootTimeline();
+      uint16_t getAuthAttempts();           // demandes d'authentification envoyées
+      unsigned long getAuthDuration();      // ms entre le démarrage (ou STOP) et START, 0 si non authentifié
       
 			// -------------------------
       // Fonctions DomoKit
@@ -157,33 +286,85 @@ typedef enum{NON_CONNECTE,APPAIRAGE,CONNECTE,ETEINT} Statut_Wifi;
       void Wifi_Data_EEPROM(); 
 			boolean checkConnexion();
       void verifierMQTT_Receive();
-      void MQTT_Send(String topic, String Payload);
+      void poll();
+      bool MQTT_Send(const char* topic, const char* Payload);
+      // ATTENTION : le transport par défaut (Transport_PubSub, PubSubClient) ne publie
+      // qu'en QoS 0 et ne reçoit pas de PUBACK. Un topic en QoS 1 y est considéré comme
+      // livré dès l'envoi TCP réussi (aucun renvoi). Pour une vraie livraison QoS 1,
+      // compiler avec DOMOKIT_TRANSPORT_ASYNC (Transport_Async) ; un avertissement est
+      // affiché une fois si le transport ne gère pas le QoS 1.
+      void setTopicQoS(const char* topic, uint8_t qos);
+      uint8_t getTopicQoS(const char* topic);
+    #ifndef DOMOKIT_SANS_STRING
+      bool MQTT_Send(String topic, String Payload);
+      void setTopicQoS(String topic, uint8_t qos);
+      uint8_t getTopicQoS(String topic);
+    #endif
       
+      // Evènements remontés par les interruptions
+      bool pushEvent(uint8_t source, int32_t valeur);
+      void routeEventToTile(uint8_t source, Domokit_Texte TileTopic);
+      uint32_t getEventLatencyMax();
+      uint32_t getEventLatencyMoy();
+      uint32_t getNbEventsPerdus();
+
+      // Acquisition de capteurs filtrée, publiée sur une tile (voir DomoKit_Capteurs.h)
+      int  addSensor(Domokit_Texte TileTopic, unsigned long periode_ms, Capteur_Lecture lecture, uint8_t filtre, uint8_t parametre, uint8_t decimales);
+      void removeSensor(int canal);
+      int32_t getSensorValue(int canal);
+
+      // Moteur de règles local (voir DomoKit_Regles.h)
+      bool addRuleOutput(uint8_t broche);
+      int  setRules(const uint8_t* programme, size_t taille);
+      Domokit_Regles& getRules();
+
+      // Métriques (latence réception -> callBack_Tile, évènements, QoS)
+      uint32_t getCommandLatencyMax();
+      uint32_t getCommandLatencyMoy();
+      void publishMetrics();
+
+      // Occupation mémoire statique de l'objet et tas disponible
+      void printMemoryReport(Print& sortie);
+
       void allumerLedWifi(Statut_Wifi Mode);
       void clignoterLedWifi(Statut_Wifi Mode,int Nb_clignotement, int Duree_clignotement_ms);
 
       // Gestion des Tiles
       void resetTile();
+      void SendtoTile(const char* topic, const char* payload);
+    #ifndef DOMOKIT_SANS_STRING
       void SendtoTile(String topic, String payload);
-      void SendIconToTile(String topic, String fa_icon, String color);
+    #endif
+      void SendIconToTile(Domokit_Texte topic, Domokit_Texte fa_icon, Domokit_Texte color);
+      void setTilePolicy(Domokit_Texte topic, uint8_t politique);
+      void publishSnapshot();
+      void publishBackfill();
+
+      // Valeurs horodatées (date = getClock().monotonic() à l'acquisition)
+      bool SendtoTileAt(Domokit_Texte topic, Domokit_Texte payload, uint64_t date);
+      void publishSamples();
+      void syncClock();
       
-      void setTileText(String Titre, String Topic, bool enablePub);
-      void setTileSwitch(String Titre, String Topic);
-      void setTileGraph(String Titre, String Topic, int levelMin,int levelMax);
-      void setTileJauge(String Titre, String Topic, bool enablePub,int levelMin,int levelMax);
-      void setTileRadioButton(String Titre, String Topic, String onIcon, String offIcon);
-      void setTileIcon(String Titre, String Topic);
-
-
-      // Variables
-      String topic_instruction;
-      String topic_donnees;
-      String topic_interruption;
-      String topic_connexion;
-      String topic_connect;
-      String topic_debug;
-      String topic_tile;
-      String topic_set_tile;
+      void setTileText(Domokit_Texte Titre, Domokit_Texte Topic, bool enablePub);
+      void setTileSwitch(Domokit_Texte Titre, Domokit_Texte Topic);
+      void setTileGraph(Domokit_Texte Titre, Domokit_Texte Topic, int levelMin,int levelMax);
+      void setTileJauge(Domokit_Texte Titre, Domokit_Texte Topic, bool enablePub,int levelMin,int levelMax);
+      void setTileRadioButton(Domokit_Texte Titre, Domokit_Texte Topic, Domokit_Texte onIcon, Domokit_Texte offIcon);
+      void setTileIcon(Domokit_Texte Titre, Domokit_Texte Topic);
+
+
+      // Variables (topics rangés dans _Arene_Topics, voir Create_Topics)
+      const char* topic_instruction;
+      const char* topic_donnees;
+      const char* topic_interruption;
+      const char* topic_connexion;
+      const char* topic_connect;
+      const char* topic_debug;
+      const char* topic_tile;
+      const char* topic_set_tile;
+      const char* topic_metriques;
+      const char* topic_ota;
+      const char* topic_presence;
       
 
 // ================================================================================
@@ -194,34 +375,122 @@ typedef enum{NON_CONNECTE,APPAIRAGE,CONNECTE,ETEINT} Statut_Wifi;
       // Paramètres Wifi
       // -------------------------
       // Wifi en cours d'utilisation
-      String _Wifi_SSID;
-      String _Wifi_Password;
-      // Wifi normal de la box Domokit
-			String 	_Wifi_Normal_SSID;
-			String 	_Wifi_Normal_Password;
+      const char* _Wifi_SSID;
+      const char* _Wifi_Password;
+      // Wifi normal de la box Domokit (lu en EEPROM)
+			Domokit_Chaine<TAILLE_SSID> 	    _Wifi_Normal_SSID;
+			Domokit_Chaine<TAILLE_PASSWORD> 	_Wifi_Normal_Password;
 
       // Wifi d'appairage de la box Domokit
-      String 	_Wifi_Appairage_SSID;
-			String 	_Wifi_Appairage_Password;
+      const char* 	_Wifi_Appairage_SSID;
+			const char* 	_Wifi_Appairage_Password;
 			
 			// -------------------------
       // Paramètres MQTT
       // -------------------------
-			String 	_MQTT_Serveur;
-			int 	  _MQTT_Port;
-			String 	_MQTT_User;
-			String 	_MQTT_Password;
-			String  _MQTT_Main_Topic;
+			const char* _MQTT_Serveur;
+			int 	      _MQTT_Port;
+			const char* _MQTT_User;
+			const char* _MQTT_Password;
+			const char* _MQTT_Main_Topic;
+
+      // Topics de l'objet, les uns à la suite des autres, et vues sur l'arène
+      // (tous commencent par le préfixe <MAIN_TOPIC>/ de _Taille_Prefixe octets)
+      char   _Arene_Topics[TAILLE_ARENE_TOPICS];
+      size_t _Taille_Arene;
+      size_t _Taille_Prefixe;
+      Protocole_Vue _Topics[NB_TOPICS];
+
+      // Transport MQTT utilisé par l'objet
+      Domokit_Transport* _Transport;
+
+      // Topics publiés en QoS 1 (topics de l'objet : 1 bit par topic, autres
+      // topics : liste) et messages en attente d'acquittement
+      uint16_t _QoS1_Topics_Objet;
+      Domokit_Chaine<TAILLE_TOPIC> _Topics_QoS1[QOS_NB_TOPICS];
+      Domokit_Inflight _Inflight;
 
       int _TileID;
+
+      // Ordonnanceur des tâches de la librairie et de l'application
+      Domokit_Scheduler _Scheduler;
+      boolean _Led_Allumee;
+
+      // File d'évènements (interruptions -> poll) et statistiques de latence
+      Domokit_FileEvenements _Evenements;
+      Domokit_Chaine<TAILLE_TOPIC_TILE> _Routes_Evenements[EVENEMENTS_NB_SOURCES];
+      uint32_t _Latence_Max_us;
+      uint32_t _Latence_Moy_us;
+
+      // Canaux d'acquisition de capteurs
+      Domokit_Canal _Canaux[CAPTEURS_NB_CANAUX];
+
+      // Programme du moteur de règles
+      Domokit_Regles _Regles;
+
+      // Latence entre la réception d'un message et l'appel à callBack_Tile
+      uint32_t _Latence_Cmd_Max_us;
+      uint32_t _Latence_Cmd_Moy_us;
+
+      // Table des tiles déclarées (index = ID de la tile) et dernières valeurs envoyées
+      Domokit_Tile _Tiles[NB_TILES_MAX];
+
+      // Horloge de l'objet, synchronisée sur l'heure du serveur
+      Domokit_Horloge _Horloge;
+      int64_t         _Sync_Demande;    // t1 de la demande en cours, -1 si aucune
+      int             _Tache_Horloge;
+
+      // Qualité de la liaison et débit des valeurs envoyées aux tiles
+      Domokit_Liaison _Liaison;
+
+      // Fenêtres d'émission radio (désactivées par défaut) et tâches différées
+      Domokit_Radio   _Radio;
+      int             _Tache_Fenetre;
+      uint8_t         _Differes;
+
+      // Trafic, connexions, temps CPU et consommation estimée
+      Domokit_Energie _Energie;
+
+      // Chronologie du démarrage et association wifi non bloquante lancée par begin()
+      Domokit_Demarrage _Demarrage;
+      int               _Tache_Connexion;
+      int               _Tache_Demarrage;
+      int               _Wifi_Association;  // mode du wifi en cours d'association, -1 si aucune
+      unsigned long     _Wifi_Debut_ms;
+      WiFiEventHandler  _Evt_Wifi_Associe;
+      WiFiEventHandler  _Evt_Wifi_IP;
+
+      // Valeurs horodatées en attente de publication
+      Domokit_Mesure  _Mesures[MESURES_NB_MAX];
+      uint8_t         _Nb_Mesures;
+      int             _Tache_Mesures;
+
+      // Journal en flash des valeurs envoyées aux tiles hors connexion (désactivé par défaut)
+      Domokit_Journal _Journal;
+      Domokit_Flash*  _Journal_Flash;
+      boolean         _Journal_Autorise;
+
+      // Mise à jour du firmware par MQTT (désactivée par défaut)
+      Domokit_OTA _OTA;
+      boolean     _OTA_Autorise;
+
+      // Alias de topics négociés avec le serveur
+      boolean _Alias_Autorise;
+      int     _Alias;                     // -1 tant que le serveur n'a pas attribué d'alias
+      Domokit_Chaine<TAILLE_TOPIC> _Topic_Alias;               // <MAIN_TOPIC>/a/<alias>
+      Domokit_Chaine<TAILLE_TOPIC> _Topic_Alias_Instruction;   // <MAIN_TOPIC>/instruction/a/<alias>
+
+      // Instructions de groupe et de diffusion (abonnements optionnels)
+      boolean _Diffusion_Autorisee;
+      Domokit_Chaine<TAILLE_TOPIC> _Topics_Groupes[NB_GROUPES_MAX];
       // ------------------- 
       // Caractéristiques 
       // ------------------- 
 
       // Configuration de la connexion wifi
-			String 	_NOM_APPAREIL;
-			String  _ADDR_MAC;
-      String _CLIENT_NAME;
+			Domokit_Chaine<TAILLE_NOM_APPAREIL> _NOM_APPAREIL;
+			Domokit_Chaine<TAILLE_MAC>          _ADDR_MAC;
+      Domokit_Chaine<TAILLE_NOM_CLIENT>   _CLIENT_NAME;
 
       // Led
       boolean 	_LED_WIFI; // indique si on utilise ou non le témoin lumineux RGB
@@ -236,22 +505,64 @@ typedef enum{NON_CONNECTE,APPAIRAGE,CONNECTE,ETEINT} Statut_Wifi;
       // --------------------
 			boolean _Program_Start;
 
+      // Demandes d'authentification (voir scheduleAuth)
+      int           _Tache_Auth;
+      unsigned long _Auth_Delai_ms;
+      uint16_t      _Auth_Tentatives;
+      unsigned long _Auth_Debut_ms;
+      unsigned long _Auth_Duree_ms;
+
       // -------------------------
       // Fonctions privées
       // -------------------------
-      void MQTT_Subscribe(String topic);
+      void MQTT_Subscribe(const char* topic);
       void setup_wifi() ;
       void setup_mqtt();
       bool reconnect_mqtt();
+      void onConnexionMQTT();
+      void subscribeTopics();
+      void serviceLink();
+      void openWindow();
+      bool deferToWindow(uint8_t tache);
+      void sendHeartbeat();
+      void publishTile(int index);
+      void publishBirth();
+      void subscribeSubtree(const char* topic);
+      bool matchGroupTopic(const char* topic, size_t taille);
+      bool isGroupInstruction(Protocole_Instruction instruction);
+      void startTasks();
+      void startWifi(int mode);
+      void serviceBoot();
+      void publishBootTimeline();
+      void reportOverruns();
+      void scheduleAuth(unsigned long delai_ms);
+      void sendAuthRequest();
+      void measureCommandLatency();
+      void sampleSensor(int canal);
+      void publishEvent(uint8_t source, int32_t valeur, uint32_t latence);
+      void runRules(uint8_t type, uint8_t source, int32_t valeur);
+      bool isTileEcho(int index, const char* payload);
+      int32_t regleCapteur(uint8_t canal);
+      int32_t regleTile(uint8_t tile);
+      void    regleSortie(uint8_t broche, int32_t valeur);
+      void    reglePublier(uint8_t tile, int32_t valeur, uint8_t decimales);
+      void    regleEvenement(uint8_t source, int32_t valeur);
       boolean Check_Connexion_Wifi();
-      String macToStr(const uint8_t* mac);
+      void macToStr(const uint8_t* mac);
+      const char* addTopic(Domokit_TopicId id, const char* categorie, bool avec_mac);
+      int  getTopicId(const char* topic);
+      bool matchTopic(const char* topic, size_t taille, Domokit_TopicId id, bool exact);
       void setWifiMode(int Mode);
-      void setWifi(String Wifi_SSID, String Wifi_Password);
+      void setWifi(const char* Wifi_SSID, const char* Wifi_Password);
       boolean ConnexionWifi(int nb_tentative, int mode);
       void MQTT_Receive(char* topic, byte* payload, unsigned int length);
-      void Decode_Instruction(String Instruction,String Topic);
-      void composeSetTilePayload(String attribut, String valeur);
-      void setTile(String Titre, int Type, String Topic , int levelMin, int levelMax,String onIcon, String offIcon);
+      void Decode_Instruction(const char* Instruction, size_t taille, const char* Topic);
+      void composeSetTilePayload(const char* attribut, const char* valeur);
+      int  getTileIndex(const char* Topic);
+      void setAlias(int alias);
+      void receiveOTABlock(const uint8_t* trame, size_t taille);
+      void sendOTAStatus(const char* etat, int32_t valeur1, int32_t valeur2);
+      void setTile(const char* Titre, int Type, const char* Topic , int levelMin, int levelMax, const char* onIcon, const char* offIcon);
 	};
   
   
@@ -263,10 +574,13 @@ typedef enum{NON_CONNECTE,APPAIRAGE,CONNECTE,ETEINT} Statut_Wifi;
 String ParseString(String data, char separator, int index);
 
 // Manipulation mémoire EEPROM
+void Read_EEPROM(char* dest, int taille, int addr_debut);
 String Read_STR_EEPROM(int taille, int addr_debut);
 void Write_STR_EEPROM(char str[], int taille, int addr_debut);
 
-// Cryptage des données
+// Cryptage des données (versions buffer : renvoient la taille écrite)
+size_t Cryptage(const char* src, char* dest, size_t taille_dest, const char* key);
+size_t Decryptage(const char* src, char* dest, size_t taille_dest, const char* key);
 String Cryptage(char* src, String key);
 String Decryptage(char* src, String key);
 #endif
@@ -0,0 +1,150 @@
+/*
+ *  =============================================================================================================================================
+ *  Titre : DomoKit_Capteurs.cpp
+ *  Auteur : Thomas Broussard
+ *  ---------------------------------------------------------------------------------------------------------------------------------------------
+ *  Description :
+ *  Filtres en virgule fixe des canaux d'acquisition
+ * =============================================================================================================================================
+ */
+
+#include "DomoKit.h"
+
+// ################################################################################
+// 									Constructeur
+// ################################################################################
+Domokit_Filtre::Domokit_Filtre()
+{
+  configure(FILTRE_AUCUN, 1);
+}
+
+/*===============================================================================
+  Nom 			: configure
+
+  Description	: Défini le type de filtre et vide son état
+
+  Paramètre(s) 	: type : FILTRE_AUCUN, FILTRE_MOYENNE, FILTRE_EMA ou FILTRE_MEDIANE
+                  parametre : nombre d'échantillons (moyenne, médiane) ou
+                              N pour un coefficient 1/2^N (EMA)
+
+  Retour		: aucun
+===============================================================================*/
+void Domokit_Filtre::configure(uint8_t type, uint8_t parametre)
+{
+  uint8_t maximum = (type == FILTRE_EMA) ? 16 : CAPTEURS_TAILLE_FENETRE;
+
+  if (parametre < 1)       parametre = 1;
+  if (parametre > maximum) parametre = maximum;
+
+  _Type = type;
+  _Parametre = parametre;
+  reset();
+}
+
+void Domokit_Filtre::reset()
+{
+  _Index = 0;
+  _Nb = 0;
+  _Etat = 0;
+}
+
+// ################################################################################
+// 									Filtrage
+// ################################################################################
+
+/*===============================================================================
+  Nom 			: ajouter
+
+  Description	: Ajoute un échantillon au filtre
+
+  Paramètre(s) 	: echantillon : valeur lue (virgule fixe)
+
+  Retour		: valeur filtrée (même échelle que l'échantillon)
+===============================================================================*/
+int32_t Domokit_Filtre::ajouter(int32_t echantillon)
+{
+  switch (_Type)
+  {
+    case FILTRE_MOYENNE :
+      // Somme glissante : l'échantillon le plus ancien est retiré
+      if (_Nb == _Parametre)
+        _Etat -= _Fenetre[_Index];
+      else
+        _Nb++;
+      _Fenetre[_Index] = echantillon;
+      _Etat += echantillon;
+      _Index = (_Index + 1) % _Parametre;
+      return (_Etat >= 0) ? (_Etat + _Nb / 2) / _Nb : (_Etat - _Nb / 2) / _Nb;
+
+    case FILTRE_EMA :
+      // Etat avec CAPTEURS_FRACTION_EMA bits de fraction, initialisé au premier échantillon
+      if (_Nb == 0)
+      {
+        _Etat = echantillon * (1 << CAPTEURS_FRACTION_EMA);
+        _Nb = 1;
+      }
+      else
+      {
+        _Etat += (echantillon * (1 << CAPTEURS_FRACTION_EMA) - _Etat) / (1 << _Parametre);
+      }
+      return (_Etat + (1 << (CAPTEURS_FRACTION_EMA - 1))) >> CAPTEURS_FRACTION_EMA;
+
+    case FILTRE_MEDIANE :
+      _Fenetre[_Index] = echantillon;
+      _Index = (_Index + 1) % _Parametre;
+      if (_Nb < _Parametre)
+        _Nb++;
+      return mediane();
+
+    default :
+      return echantillon;
+  }
+}
+
+// Médiane des échantillons de la fenêtre (tri par insertion d'une copie)
+int32_t Domokit_Filtre::mediane()
+{
+  int32_t tri[CAPTEURS_TAILLE_FENETRE];
+
+  for (uint8_t i = 0; i < _Nb; i++)
+  {
+    int32_t valeur = _Fenetre[i];
+    uint8_t j = i;
+    while (j > 0 && tri[j - 1] > valeur)
+    {
+      tri[j] = tri[j - 1];
+      j--;
+    }
+    tri[j] = valeur;
+  }
+
+  // Nombre pair d'échantillons : moyenne des deux valeurs centrales
+  if ((_Nb & 1) == 0)
+    return tri[_Nb / 2 - 1] + (tri[_Nb / 2] - tri[_Nb / 2 - 1]) / 2;
+  return tri[_Nb / 2];
+}
+
+// ################################################################################
+// 									Format
+// ################################################################################
+size_t Capteurs_Format(char* buffer, size_t taille, int32_t valeur, uint8_t decimales)
+{
+  uint32_t absolue = (valeur < 0) ? (uint32_t)0 - (uint32_t)valeur : (uint32_t)valeur;
+  uint32_t diviseur = 1;
+  int n;
+
+  if (decimales > 9)
+    decimales = 9;
+  for (uint8_t i = 0; i < decimales; i++)
+    diviseur *= 10;
+
+  if (decimales == 0)
+    n = snprintf(buffer, taille, "%ld", (long)valeur);
+  else
+    n = snprintf(buffer, taille, "%s%lu.%0*lu", (valeur < 0) ? "-" : "",
+                 (unsigned long)(absolue / diviseur), (int)decimales, (unsigned long)(absolue % diviseur));
+
+  if (n < 0)
+    return 0;
+  return ((size_t)n < taille) ? (size_t)n : taille - 1;
+}
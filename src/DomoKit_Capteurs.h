@@ -0,0 +1,95 @@
+/*
+ *  =============================================================================================================================================
+ *  Titre : DomoKit_Capteurs.h
+ *  Auteur : Thomas Broussard
+ *  ---------------------------------------------------------------------------------------------------------------------------------------------
+ *  Description :
+ *  Acquisition de capteurs : chaque canal lit un capteur à intervalle régulier
+ *  (tâche de l'ordonnanceur), filtre les échantillons et publie la valeur
+ *  filtrée sur une tile (voir Domokit::addSensor).
+ *
+ *  Les échantillons sont des entiers en virgule fixe : la fonction de lecture
+ *  renvoie la valeur multipliée par 10^decimales (ex : 2153 pour 21.53 °C avec
+ *  decimales = 2). Les filtres n'utilisent ni flottant ni allocation :
+ *  - FILTRE_MOYENNE : moyenne glissante sur les N derniers échantillons
+ *  - FILTRE_EMA     : moyenne exponentielle, coefficient 1/2^N
+ *  - FILTRE_MEDIANE : médiane des N derniers échantillons (rejet des pics)
+ * =============================================================================================================================================
+ */
+
+#ifndef __DOMOKIT_CAPTEURS_H__
+#define __DOMOKIT_CAPTEURS_H__
+
+// ################################################################################
+// 									Librairies
+// ################################################################################
+  #include "Arduino.h"
+  #include <functional>
+  #include "DomoKit_Memoire.h"
+
+// ################################################################################
+// 				Defines , définition et variables globales
+// ################################################################################
+  #define CAPTEURS_NB_CANAUX        8   // nombre max de canaux déclarés
+  #define CAPTEURS_TAILLE_FENETRE   8   // nombre max d'échantillons (moyenne, médiane)
+  #define CAPTEURS_FRACTION_EMA     4   // bits de fraction de l'état du filtre EMA
+  #define CAPTEURS_AUCUN_CANAL      -1
+
+  // Filtres
+  #define FILTRE_AUCUN    0
+  #define FILTRE_MOYENNE  1 // paramètre : nombre d'échantillons (1 à CAPTEURS_TAILLE_FENETRE)
+  #define FILTRE_EMA      2 // paramètre : N, coefficient 1/2^N (1 à 16)
+  #define FILTRE_MEDIANE  3 // paramètre : nombre d'échantillons (1 à CAPTEURS_TAILLE_FENETRE)
+
+// Lecture d'un capteur (valeur en virgule fixe)
+typedef std::function<int32_t(void)> Capteur_Lecture;
+
+// ################################################################################
+// 									Classes
+// ################################################################################
+
+// Filtre d'un canal (état de taille fixe)
+class Domokit_Filtre
+{
+  public:
+    Domokit_Filtre();
+
+    void    configure(uint8_t type, uint8_t parametre);
+    void    reset();
+    int32_t ajouter(int32_t echantillon);
+
+  private:
+    int32_t mediane();
+
+    uint8_t _Type;
+    uint8_t _Parametre;
+    uint8_t _Index;     // prochaine case de la fenêtre
+    uint8_t _Nb;        // échantillons dans la fenêtre
+    int32_t _Fenetre[CAPTEURS_TAILLE_FENETRE];
+    int32_t _Etat;      // somme de la fenêtre (moyenne) ou état du filtre EMA
+};
+
+// Canal d'acquisition
+typedef struct
+{
+  bool            utilise;
+  Domokit_Chaine<TAILLE_TOPIC_TILE> topic;  // tile de destination
+  Capteur_Lecture lecture;
+  Domokit_Filtre  filtre;
+  uint8_t         decimales;
+  int             tache;            // tâche de l'ordonnanceur
+  int32_t         valeur;           // dernière valeur filtrée
+  bool            publiee;          // valeur_publiee valide
+  int32_t         valeur_publiee;
+  unsigned long   nb_echantillons;
+  unsigned long   nb_publications;
+} Domokit_Canal;
+
+// ################################################################################
+// 									Fonctions
+// ################################################################################
+
+// Ecrit une valeur en virgule fixe (ex : 2153, 2 décimales -> "21.53")
+size_t Capteurs_Format(char* buffer, size_t taille, int32_t valeur, uint8_t decimales);
+
+#endif
@@ -0,0 +1,141 @@
+/*
+ *  =============================================================================================================================================
+ *  Titre : DomoKit_Demarrage.cpp
+ *  Auteur : Thomas Broussard
+ *  ---------------------------------------------------------------------------------------------------------------------------------------------
+ *  Description :
+ *  Chronologie du démarrage de l'objet
+ * =============================================================================================================================================
+ */
+
+#include "DomoKit.h"
+
+// Noms des phases (trame et affichage)
+static const char* const NOMS_PHASES[NB_PHASES_DEMARRAGE] =
+{
+  "eeprom", "preparation", "wifi", "dhcp", "mqtt", "auth", "tiles", "telemetrie"
+};
+
+// ################################################################################
+// 									Constructeur
+// ################################################################################
+Domokit_Demarrage::Domokit_Demarrage()
+{
+  _Commencees = 0;
+  _Terminees = 0;
+  memset(_Debut_ms, 0, sizeof(_Debut_ms));
+  memset(_Fin_ms, 0, sizeof(_Fin_ms));
+}
+
+// ################################################################################
+// 									Phases
+// ################################################################################
+
+void Domokit_Demarrage::start(uint8_t phase)
+{
+  if (phase >= NB_PHASES_DEMARRAGE || isStarted(phase))
+    return;
+
+  _Debut_ms[phase] = millis();
+  _Commencees |= (1 << phase);
+}
+
+void Domokit_Demarrage::end(uint8_t phase)
+{
+  if (phase >= NB_PHASES_DEMARRAGE || isDone(phase))
+    return;
+
+  start(phase);
+  _Fin_ms[phase] = millis();
+  _Terminees |= (1 << phase);
+}
+
+bool Domokit_Demarrage::isStarted(uint8_t phase)
+{
+  return (phase < NB_PHASES_DEMARRAGE) && (_Commencees & (1 << phase));
+}
+
+bool Domokit_Demarrage::isDone(uint8_t phase)
+{
+  return (phase < NB_PHASES_DEMARRAGE) && (_Terminees & (1 << phase));
+}
+
+unsigned long Domokit_Demarrage::getStart(uint8_t phase)
+{
+  return isStarted(phase) ? _Debut_ms[phase] : 0;
+}
+
+unsigned long Domokit_Demarrage::getEnd(uint8_t phase)
+{
+  return isDone(phase) ? _Fin_ms[phase] : 0;
+}
+
+unsigned long Domokit_Demarrage::getDuration(uint8_t phase)
+{
+  return isDone(phase) ? _Fin_ms[phase] - _Debut_ms[phase] : 0;
+}
+
+unsigned long Domokit_Demarrage::getTimeToFirstTelemetry()
+{
+  return getEnd(DEMARRAGE_TELEMETRIE);
+}
+
+// ################################################################################
+// 									Restitution
+// ################################################################################
+
+/*===============================================================================
+  Nom 			: encode
+
+  Description	: Encode la chronologie : demarrage_<phase>=durée (ms) pour chaque
+                phase terminée, puis demarrage_total=temps jusqu'à la première
+                télémétrie (ms depuis la mise sous tension)
+
+  Paramètre(s) 	: trame : buffer de sortie
+                  taille : taille du buffer
+
+  Retour		: taille de la trame (0 si le buffer est trop petit)
+===============================================================================*/
+size_t Domokit_Demarrage::encode(char* trame, size_t taille)
+{
+  size_t n = 0;
+  int ecrit;
+
+  for (uint8_t phase = 0; phase < DEMARRAGE_TELEMETRIE; phase++)
+  {
+    if (!isDone(phase))
+      continue;
+    ecrit = snprintf(trame + n, taille - n, "%sdemarrage_%s=%lu", (n > 0) ? _PARSE : "", NOMS_PHASES[phase], getDuration(phase));
+    if (ecrit < 0 || (size_t)ecrit >= taille - n)
+      return 0;
+    n += ecrit;
+  }
+
+  ecrit = snprintf(trame + n, taille - n, "%sdemarrage_total=%lu", (n > 0) ? _PARSE : "", getTimeToFirstTelemetry());
+  if (ecrit < 0 || (size_t)ecrit >= taille - n)
+    return 0;
+  return n + ecrit;
+}
+
+// Affiche la chronologie : début, fin et durée de chaque phase (ms)
+void Domokit_Demarrage::print(Print& sortie)
+{
+  sortie.println("Démarrage\t\tdébut\tfin\tdurée (ms)");
+  for (uint8_t phase = 0; phase < NB_PHASES_DEMARRAGE; phase++)
+  {
+    sortie.print("  ");   sortie.print(NOMS_PHASES[phase]);  sortie.print("\t\t");
+    if (!isStarted(phase))
+    {
+      sortie.println("-");
+      continue;
+    }
+    sortie.print(getStart(phase));  sortie.print("\t");
+    if (!isDone(phase))
+    {
+      sortie.println("en cours");
+      continue;
+    }
+    sortie.print(getEnd(phase));    sortie.print("\t");
+    sortie.println(getDuration(phase));
+  }
+}
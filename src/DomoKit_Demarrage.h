@@ -0,0 +1,74 @@
+/*
+ *  =============================================================================================================================================
+ *  Titre : DomoKit_Demarrage.h
+ *  Auteur : Thomas Broussard
+ *  ---------------------------------------------------------------------------------------------------------------------------------------------
+ *  Description :
+ *  Chronologie du démarrage de l'objet, de la mise sous tension à la
+ *  première valeur publiée sur une tile (temps jusqu'à la première
+ *  télémétrie).
+ *
+ *  Chaque phase a une date de début et de fin (ms depuis la mise sous
+ *  tension) ; seul le premier démarrage est mesuré (les reconnexions ne
+ *  modifient pas la chronologie). Les phases se recouvrent : begin() lance
+ *  l'association wifi sans l'attendre, et prépare les topics, la fenêtre
+ *  QoS 1, les règles et le journal pendant que le wifi s'associe.
+ * =============================================================================================================================================
+ */
+
+#ifndef __DOMOKIT_DEMARRAGE_H__
+#define __DOMOKIT_DEMARRAGE_H__
+
+// ################################################################################
+// 									Librairies
+// ################################################################################
+  #include "Arduino.h"
+
+// ################################################################################
+// 				Defines , définition et variables globales
+// ################################################################################
+typedef enum
+{
+  DEMARRAGE_EEPROM,       // lecture de la configuration wifi
+  DEMARRAGE_PREPARATION,  // topics, QoS 1, règles, journal (pendant l'association)
+  DEMARRAGE_WIFI,         // association au point d'accès
+  DEMARRAGE_DHCP,         // obtention de l'adresse IP
+  DEMARRAGE_MQTT,         // connexion au broker
+  DEMARRAGE_AUTH,         // demandes d'authentification jusqu'à START
+  DEMARRAGE_TILES,        // déclaration des tiles (init_Tile)
+  DEMARRAGE_TELEMETRIE,   // de begin() à la première valeur publiée
+  NB_PHASES_DEMARRAGE
+} Demarrage_Phase;
+
+// ################################################################################
+// 									Classes
+// ################################################################################
+class Domokit_Demarrage
+{
+  public:
+    Domokit_Demarrage();
+
+    // Seul le premier appel pour chaque phase est pris en compte. Une phase
+    // terminée sans avoir été commencée dure 0 ms.
+    void start(uint8_t phase);
+    void end(uint8_t phase);
+
+    bool          isStarted(uint8_t phase);
+    bool          isDone(uint8_t phase);
+    unsigned long getStart(uint8_t phase);      // ms depuis la mise sous tension
+    unsigned long getEnd(uint8_t phase);
+    unsigned long getDuration(uint8_t phase);
+    unsigned long getTimeToFirstTelemetry();    // ms depuis la mise sous tension, 0 tant qu'aucune valeur n'a été publiée
+
+    // Trame clé=valeur;... (durée de chaque phase et temps jusqu'à la première télémétrie)
+    size_t encode(char* trame, size_t taille);
+    void   print(Print& sortie);
+
+  private:
+    uint16_t      _Commencees;
+    uint16_t      _Terminees;
+    unsigned long _Debut_ms[NB_PHASES_DEMARRAGE];
+    unsigned long _Fin_ms[NB_PHASES_DEMARRAGE];
+};
+
+#endif
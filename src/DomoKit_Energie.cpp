@@ -0,0 +1,197 @@
+/*
+ *  =============================================================================================================================================
+ *  Titre : DomoKit_Energie.cpp
+ *  Auteur : Thomas Broussard
+ *  ---------------------------------------------------------------------------------------------------------------------------------------------
+ *  Description :
+ *  Temps radio, trafic, connexions, temps CPU et consommation estimée
+ * =============================================================================================================================================
+ */
+
+#include "DomoKit.h"
+
+// ################################################################################
+// 									Modèle par défaut
+// ################################################################################
+uint32_t Modele_ESP8266::getCurrent(uint8_t etat)
+{
+  switch (etat)
+  {
+    case ENERGIE_VEILLE:    return 15000;
+    case ENERGIE_CPU:       return 20000;
+    case ENERGIE_RECEPTION: return 56000;
+    case ENERGIE_EMISSION:  return 170000;
+    case ENERGIE_CONNEXION: return 80000;
+    default:                return 0;
+  }
+}
+
+// ################################################################################
+// 									Constructeur
+// ################################################################################
+Domokit_Energie::Domokit_Energie()
+{
+  _Modele = &_Modele_Defaut;
+  reset();
+}
+
+void Domokit_Energie::setModel(Domokit_Modele_Energie* modele)
+{
+  _Modele = (modele != NULL) ? modele : &_Modele_Defaut;
+}
+
+void Domokit_Energie::reset()
+{
+  _Debut_ms = millis();
+  _Octets_Emis = 0;
+  _Octets_Recus = 0;
+  _Nb_Emis = 0;
+  _Nb_Recus = 0;
+  _Nb_Connexions_Wifi = 0;
+  _Nb_Connexions_MQTT = 0;
+  _Connexion_ms = 0;
+  _CPU_us = 0;
+  _Nb_Boucles = 0;
+  _Boucle_Max_us = 0;
+  memset(_Durees_ms, 0, sizeof(_Durees_ms));
+  _Duree_Totale_ms = 0;
+  _Charge_uA_ms = 0;
+}
+
+// ################################################################################
+// 									Relevés
+// ################################################################################
+
+void Domokit_Energie::countSent(size_t taille_topic, size_t taille_payload)
+{
+  _Octets_Emis += taille_topic + taille_payload + ENERGIE_ENTETE_MESSAGE;
+  _Nb_Emis++;
+}
+
+void Domokit_Energie::countReceived(size_t taille_topic, size_t taille_payload)
+{
+  _Octets_Recus += taille_topic + taille_payload + ENERGIE_ENTETE_MESSAGE;
+  _Nb_Recus++;
+}
+
+void Domokit_Energie::countWifiAttempt(unsigned long duree_ms)
+{
+  _Nb_Connexions_Wifi++;
+  _Connexion_ms += duree_ms;
+}
+
+void Domokit_Energie::countMqttAttempt(unsigned long duree_ms)
+{
+  _Nb_Connexions_MQTT++;
+  _Connexion_ms += duree_ms;
+}
+
+void Domokit_Energie::countLoop(uint32_t duree_us)
+{
+  _CPU_us += duree_us;
+  _Nb_Boucles++;
+  if (duree_us > _Boucle_Max_us)
+    _Boucle_Max_us = duree_us;
+}
+
+/*===============================================================================
+  Nom 			: compute
+
+  Description	: Répartit le temps écoulé depuis reset() entre les états, puis
+                calcule la charge consommée selon le modèle
+
+  Paramètre(s) 	: radio_pm : radio allumée, en pour mille du temps écoulé
+
+  Retour		: aucun
+===============================================================================*/
+void Domokit_Energie::compute(uint16_t radio_pm)
+{
+  uint32_t total = millis() - _Debut_ms;
+  uint32_t reste = total;
+  uint64_t emission = ((uint64_t)_Octets_Emis * ENERGIE_EMISSION_US_OCTET + (uint64_t)_Nb_Emis * ENERGIE_EMISSION_US_MESSAGE) / 1000;
+  uint64_t radio = (uint64_t)total * radio_pm / 1000;
+  uint64_t cpu = _CPU_us / 1000;
+
+  // Etats par priorité : chacun est borné par le temps restant
+  _Durees_ms[ENERGIE_EMISSION] = (emission < reste) ? (uint32_t)emission : reste;
+  reste -= _Durees_ms[ENERGIE_EMISSION];
+
+  _Durees_ms[ENERGIE_CONNEXION] = (_Connexion_ms < reste) ? _Connexion_ms : reste;
+  reste -= _Durees_ms[ENERGIE_CONNEXION];
+
+  // Radio allumée hors émission
+  radio = (radio > _Durees_ms[ENERGIE_EMISSION]) ? radio - _Durees_ms[ENERGIE_EMISSION] : 0;
+  _Durees_ms[ENERGIE_RECEPTION] = (radio < reste) ? (uint32_t)radio : reste;
+  reste -= _Durees_ms[ENERGIE_RECEPTION];
+
+  // Temps CPU radio éteinte (le CPU est actif indépendamment de la radio)
+  cpu = cpu * (1000 - ((radio_pm > 1000) ? 1000 : radio_pm)) / 1000;
+  _Durees_ms[ENERGIE_CPU] = (cpu < reste) ? (uint32_t)cpu : reste;
+  reste -= _Durees_ms[ENERGIE_CPU];
+
+  _Durees_ms[ENERGIE_VEILLE] = reste;
+
+  _Duree_Totale_ms = total;
+  _Charge_uA_ms = 0;
+  for (uint8_t etat = 0; etat < NB_ETATS_ENERGIE; etat++)
+    _Charge_uA_ms += (uint64_t)_Modele->getCurrent(etat) * _Durees_ms[etat];
+}
+
+// ################################################################################
+// 									Getters
+// ################################################################################
+
+uint32_t Domokit_Energie::getDuration(uint8_t etat)
+{
+  return (etat < NB_ETATS_ENERGIE) ? _Durees_ms[etat] : 0;
+}
+
+uint32_t Domokit_Energie::getCharge()
+{
+  return (uint32_t)(_Charge_uA_ms / 3600000);
+}
+
+uint32_t Domokit_Energie::getAverageCurrent()
+{
+  return (_Duree_Totale_ms > 0) ? (uint32_t)(_Charge_uA_ms / _Duree_Totale_ms) : 0;
+}
+
+unsigned long Domokit_Energie::getOctetsEmis()
+{
+  return _Octets_Emis;
+}
+
+unsigned long Domokit_Energie::getOctetsRecus()
+{
+  return _Octets_Recus;
+}
+
+unsigned long Domokit_Energie::getNbMessagesEmis()
+{
+  return _Nb_Emis;
+}
+
+unsigned long Domokit_Energie::getNbMessagesRecus()
+{
+  return _Nb_Recus;
+}
+
+uint16_t Domokit_Energie::getNbConnexionsWifi()
+{
+  return _Nb_Connexions_Wifi;
+}
+
+uint16_t Domokit_Energie::getNbConnexionsMQTT()
+{
+  return _Nb_Connexions_MQTT;
+}
+
+uint32_t Domokit_Energie::getLoopTime()
+{
+  return (_Nb_Boucles > 0) ? (uint32_t)(_CPU_us / _Nb_Boucles) : 0;
+}
+
+uint32_t Domokit_Energie::getLoopTimeMax()
+{
+  return _Boucle_Max_us;
+}
@@ -0,0 +1,130 @@
+/*
+ *  =============================================================================================================================================
+ *  Titre : DomoKit_Energie.h
+ *  Auteur : Thomas Broussard
+ *  ---------------------------------------------------------------------------------------------------------------------------------------------
+ *  Description :
+ *  Estimation de la consommation de l'objet, pour comparer deux firmwares.
+ *
+ *  La librairie relève :
+ *    - les octets émis et reçus (topic + payload) et le nombre de messages
+ *    - les tentatives de connexion au wifi (ConnexionWifi) et au broker
+ *      (reconnect_mqtt), et leur durée
+ *    - le temps CPU passé dans poll() à chaque boucle
+ *    - le rapport cyclique de la radio (voir DomoKit_Radio.h ; sans fenêtres
+ *      d'émission, la radio est considérée allumée en permanence)
+ *
+ *  Le temps écoulé est réparti entre des états exclusifs, par priorité :
+ *  émission (durée estimée à partir des octets émis), connexion, radio
+ *  allumée (réception), CPU actif radio éteinte, veille. La charge est la
+ *  somme des durées pondérées par le courant de chaque état, fourni par un
+ *  modèle (Modele_ESP8266 par défaut, voir Domokit::setEnergyModel).
+ * =============================================================================================================================================
+ */
+
+#ifndef __DOMOKIT_ENERGIE_H__
+#define __DOMOKIT_ENERGIE_H__
+
+// ################################################################################
+// 									Librairies
+// ################################################################################
+  #include "Arduino.h"
+
+// ################################################################################
+// 				Defines , définition et variables globales
+// ################################################################################
+  // Durée d'émission estimée : 1 Mbit/s (débit de base 802.11b) + préambule,
+  // acquittement et en-têtes TCP/IP/MQTT par message
+  #define ENERGIE_EMISSION_US_OCTET     8
+  #define ENERGIE_EMISSION_US_MESSAGE   400
+  #define ENERGIE_ENTETE_MESSAGE        4     // en-tête MQTT (PUBLISH) par message
+
+// Etats de l'objet (exclusifs)
+typedef enum
+{
+  ENERGIE_VEILLE,       // modem sleep, CPU au repos
+  ENERGIE_CPU,          // CPU actif, radio éteinte
+  ENERGIE_RECEPTION,    // radio allumée (écoute, beacons)
+  ENERGIE_EMISSION,     // radio en émission
+  ENERGIE_CONNEXION,    // association wifi / connexion au broker
+  NB_ETATS_ENERGIE
+} Energie_Etat;
+
+// ################################################################################
+// 									Classes
+// ################################################################################
+
+// --------------------------------------------------------------------------------
+// Modèle de consommation : courant (µA) dans chaque état
+// --------------------------------------------------------------------------------
+class Domokit_Modele_Energie
+{
+  public:
+    virtual ~Domokit_Modele_Energie() {}
+
+    virtual uint32_t getCurrent(uint8_t etat) = 0;
+};
+
+// Valeurs typiques de la datasheet ESP8266EX (module seul, 3,3 V)
+class Modele_ESP8266 : public Domokit_Modele_Energie
+{
+  public:
+    uint32_t getCurrent(uint8_t etat);
+};
+
+// --------------------------------------------------------------------------------
+// Comptabilité
+// --------------------------------------------------------------------------------
+class Domokit_Energie
+{
+  public:
+    Domokit_Energie();
+
+    void setModel(Domokit_Modele_Energie* modele);
+    void reset();
+
+    // Relevés de la librairie
+    void countSent(size_t taille_topic, size_t taille_payload);
+    void countReceived(size_t taille_topic, size_t taille_payload);
+    void countWifiAttempt(unsigned long duree_ms);
+    void countMqttAttempt(unsigned long duree_ms);
+    void countLoop(uint32_t duree_us);
+
+    // Répartition du temps écoulé depuis reset() (radio_pm : rapport cyclique de la radio)
+    void     compute(uint16_t radio_pm);
+    uint32_t getDuration(uint8_t etat);   // ms, au dernier compute()
+    uint32_t getCharge();                 // µAh consommés
+    uint32_t getAverageCurrent();         // µA moyens (= µAh par heure)
+
+    unsigned long getOctetsEmis();
+    unsigned long getOctetsRecus();
+    unsigned long getNbMessagesEmis();
+    unsigned long getNbMessagesRecus();
+    uint16_t getNbConnexionsWifi();
+    uint16_t getNbConnexionsMQTT();
+    uint32_t getLoopTime();               // temps CPU moyen par boucle (µs)
+    uint32_t getLoopTimeMax();
+
+  private:
+    Modele_ESP8266          _Modele_Defaut;
+    Domokit_Modele_Energie* _Modele;
+
+    unsigned long _Debut_ms;
+
+    unsigned long _Octets_Emis;
+    unsigned long _Octets_Recus;
+    unsigned long _Nb_Emis;
+    unsigned long _Nb_Recus;
+    uint16_t      _Nb_Connexions_Wifi;
+    uint16_t      _Nb_Connexions_MQTT;
+    uint32_t      _Connexion_ms;
+    uint64_t      _CPU_us;
+    uint32_t      _Nb_Boucles;
+    uint32_t      _Boucle_Max_us;
+
+    uint32_t      _Durees_ms[NB_ETATS_ENERGIE];
+    uint32_t      _Duree_Totale_ms;
+    uint64_t      _Charge_uA_ms;
+};
+
+#endif
@@ -0,0 +1,80 @@
+/*
+ *  =============================================================================================================================================
+ *  Titre : DomoKit_Evenements.cpp
+ *  Auteur : Thomas Broussard
+ *  ---------------------------------------------------------------------------------------------------------------------------------------------
+ *  Description :
+ *  File d'évènements entre interruptions et boucle principale
+ * =============================================================================================================================================
+ */
+
+#include "DomoKit.h"
+
+// Barrière compilateur : les données de l'évènement sont écrites avant l'index
+#define BARRIERE_MEMOIRE() __asm__ __volatile__("" ::: "memory")
+
+Domokit_FileEvenements::Domokit_FileEvenements()
+{
+  _Tete = 0;
+  _Queue = 0;
+  _Nb_Pertes = 0;
+}
+
+/*===============================================================================
+  Nom 			: push
+
+  Description	: Ajoute un évènement horodaté dans la file.
+                Fonction placée en RAM : appelable depuis une interruption.
+
+  Paramètre(s) 	: source : identifiant de la source
+                  valeur : donnée associée
+
+  Retour		: false si la file est pleine (l'évènement est compté comme perdu)
+===============================================================================*/
+bool ICACHE_RAM_ATTR Domokit_FileEvenements::push(uint8_t source, int32_t valeur)
+{
+  uint8_t tete = _Tete;
+
+  if ((uint8_t)(tete - _Queue) >= EVENEMENTS_TAILLE)
+  {
+    _Nb_Pertes++;
+    return false;
+  }
+
+  Domokit_Evenement* evenement = &_File[tete & (EVENEMENTS_TAILLE - 1)];
+  evenement->source  = source;
+  evenement->valeur  = valeur;
+  evenement->date_us = micros();
+
+  BARRIERE_MEMOIRE();
+  _Tete = tete + 1;
+  return true;
+}
+
+/*===============================================================================
+  Nom 			: pop
+
+  Description	: Retire le plus ancien évènement de la file (boucle principale)
+
+  Retour		: false si la file est vide
+===============================================================================*/
+bool Domokit_FileEvenements::pop(Domokit_Evenement* evenement)
+{
+  uint8_t queue = _Queue;
+
+  if (queue == _Tete)
+    return false;
+
+  BARRIERE_MEMOIRE();
+  *evenement = _File[queue & (EVENEMENTS_TAILLE - 1)];
+
+  BARRIERE_MEMOIRE();
+  _Queue = queue + 1;
+  return true;
+}
+
+// Nombre d'évènements perdus (file pleine)
+uint32_t Domokit_FileEvenements::getNbPertes()
+{
+  return _Nb_Pertes;
+}
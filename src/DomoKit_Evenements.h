@@ -0,0 +1,60 @@
+/*
+ *  =============================================================================================================================================
+ *  Titre : DomoKit_Evenements.h
+ *  Auteur : Thomas Broussard
+ *  ---------------------------------------------------------------------------------------------------------------------------------------------
+ *  Description :
+ *  File d'évènements sans verrou (un producteur / un consommateur) entre les
+ *  routines d'interruption et la boucle principale.
+ *  - producteur   : routine d'interruption (push)
+ *  - consommateur : Domokit::poll() (pop)
+ * =============================================================================================================================================
+ */
+
+#ifndef __DOMOKIT_EVENEMENTS_H__
+#define __DOMOKIT_EVENEMENTS_H__
+
+// ################################################################################
+// 									Librairies
+// ################################################################################
+  #include "Arduino.h"
+
+// ################################################################################
+// 				Defines , définition et variables globales
+// ################################################################################
+  #define EVENEMENTS_TAILLE     16  // taille de la file (puissance de 2)
+  #define EVENEMENTS_NB_SOURCES 8   // nombre de sources pouvant être routées vers une tile
+
+  #if (EVENEMENTS_TAILLE & (EVENEMENTS_TAILLE - 1)) != 0
+    #error "EVENEMENTS_TAILLE doit être une puissance de 2"
+  #endif
+
+// Evènement horodaté au moment de l'interruption
+typedef struct
+{
+  uint8_t   source;   // identifiant de la source (ex : n° du bouton)
+  int32_t   valeur;   // donnée associée
+  uint32_t  date_us;  // micros() au moment de l'interruption
+} Domokit_Evenement;
+
+// ################################################################################
+// 									Classes
+// ################################################################################
+class Domokit_FileEvenements
+{
+  public:
+    Domokit_FileEvenements();
+
+    bool push(uint8_t source, int32_t valeur); // appelable depuis une interruption
+    bool pop(Domokit_Evenement* evenement);
+
+    uint32_t getNbPertes();
+
+  private:
+    Domokit_Evenement _File[EVENEMENTS_TAILLE];
+    volatile uint8_t  _Tete;   // modifié uniquement par le producteur
+    volatile uint8_t  _Queue;  // modifié uniquement par le consommateur
+    volatile uint32_t _Nb_Pertes;
+};
+
+#endif
@@ -0,0 +1,153 @@
+/*
+ *  =============================================================================================================================================
+ *  Titre : DomoKit_Horloge.cpp
+ *  Auteur : Thomas Broussard
+ *  ---------------------------------------------------------------------------------------------------------------------------------------------
+ *  Description :
+ *  Horloge monotone 64 bits et synchronisation sur l'heure du serveur
+ * =============================================================================================================================================
+ */
+
+#include "DomoKit.h"
+
+// ################################################################################
+// 									Constructeur
+// ################################################################################
+Domokit_Horloge::Domokit_Horloge()
+{
+  _Dernier_Millis = 0;
+  _Nb_Debordements = 0;
+  reset();
+}
+
+// Oublie la synchronisation (l'horloge monotone n'est pas modifiée)
+void Domokit_Horloge::reset()
+{
+  _Synchronise = false;
+  _Reference = 0;
+  _Decalage = 0;
+  _Derive_ppm = 0;
+  _Derive_Estimee = false;
+  _RTT = 0;
+  _RTT_Min = 0;
+  _Nb_Sync = 0;
+  _Nb_Rejets = 0;
+}
+
+// ################################################################################
+// 									Horloge
+// ################################################################################
+
+uint64_t Domokit_Horloge::monotonic()
+{
+  uint32_t maintenant = millis();
+
+  if (maintenant < _Dernier_Millis)
+    _Nb_Debordements++;
+  _Dernier_Millis = maintenant;
+
+  return ((uint64_t)_Nb_Debordements << 32) | maintenant;
+}
+
+int64_t Domokit_Horloge::toServerTime(uint64_t date)
+{
+  if (!_Synchronise)
+    return -1;
+
+  int64_t ecart = (int64_t)(date - _Reference);
+  return (int64_t)date + _Decalage + ecart * _Derive_ppm / 1000000;
+}
+
+int64_t Domokit_Horloge::now()
+{
+  return toServerTime(monotonic());
+}
+
+/*===============================================================================
+  Nom 			: update
+
+  Description	: Prend en compte un échange de synchronisation
+
+  Paramètre(s) 	: t1 : envoi de la demande (horloge monotone)
+                  t2 : réception de la demande (heure serveur)
+                  t3 : envoi de la réponse (heure serveur)
+                  t4 : réception de la réponse (horloge monotone)
+
+  Retour		: false si l'échange est ignoré (incohérent ou aller-retour trop long)
+===============================================================================*/
+bool Domokit_Horloge::update(int64_t t1, int64_t t2, int64_t t3, uint64_t t4)
+{
+  if (t1 < 0 || (int64_t)t4 < t1 || t3 < t2)
+  {
+    _Nb_Rejets++;
+    return false;
+  }
+
+  int64_t aller_retour = ((int64_t)t4 - t1) - (t3 - t2);
+  uint32_t rtt = (aller_retour < 0) ? 0 : (uint32_t)aller_retour;
+  int64_t decalage = ((t2 - t1) + (t3 - (int64_t)t4)) / 2;
+
+  // Aller-retour anormalement long : le décalage mesuré est peu fiable.
+  // Le meilleur aller-retour est relevé à chaque rejet pour suivre un
+  // changement durable des conditions du réseau.
+  if (_Synchronise && rtt > 2 * _RTT_Min + HORLOGE_MARGE_RTT_MS)
+  {
+    _RTT_Min += _RTT_Min / 8 + 1;
+    _Nb_Rejets++;
+    return false;
+  }
+  if (!_Synchronise || rtt < _RTT_Min)
+    _RTT_Min = rtt;
+
+  // Dérive : écart entre le décalage mesuré et le décalage de la référence
+  if (_Synchronise && t4 - _Reference >= HORLOGE_DUREE_MIN_DERIVE_MS)
+  {
+    int64_t mesure = (decalage - _Decalage) * 1000000 / (int64_t)(t4 - _Reference);
+    if (mesure >  HORLOGE_DERIVE_MAX_PPM) mesure =  HORLOGE_DERIVE_MAX_PPM;
+    if (mesure < -HORLOGE_DERIVE_MAX_PPM) mesure = -HORLOGE_DERIVE_MAX_PPM;
+
+    _Derive_ppm = _Derive_Estimee ? (int32_t)((3 * (int64_t)_Derive_ppm + mesure) / 4) : (int32_t)mesure;
+    _Derive_Estimee = true;
+  }
+
+  _Reference = t4;
+  _Decalage = decalage;
+  _RTT = rtt;
+  _Synchronise = true;
+  _Nb_Sync++;
+  return true;
+}
+
+// ################################################################################
+// 									Getters
+// ################################################################################
+
+bool Domokit_Horloge::isSynchronized()
+{
+  return _Synchronise;
+}
+
+int64_t Domokit_Horloge::getOffset()
+{
+  return _Decalage;
+}
+
+int32_t Domokit_Horloge::getDrift()
+{
+  return _Derive_ppm;
+}
+
+uint32_t Domokit_Horloge::getRTT()
+{
+  return _RTT;
+}
+
+uint16_t Domokit_Horloge::getNbSync()
+{
+  return _Nb_Sync;
+}
+
+uint16_t Domokit_Horloge::getNbRejets()
+{
+  return _Nb_Rejets;
+}
@@ -0,0 +1,84 @@
+/*
+ *  =============================================================================================================================================
+ *  Titre : DomoKit_Horloge.h
+ *  Auteur : Thomas Broussard
+ *  ---------------------------------------------------------------------------------------------------------------------------------------------
+ *  Description :
+ *  Horloge de l'objet :
+ *  - horloge monotone 64 bits en ms (millis() étendu, sans débordement)
+ *  - synchronisation sur l'heure du serveur (ms depuis le 01/01/1970)
+ *
+ *  Echange de synchronisation (même principe que NTP) :
+ *    objet -> serveur : HEURE;t1              (topic_donnees, t1 = horloge monotone)
+ *    serveur -> objet : HEURE;t1;t2;t3        (topic_instruction, t2 = réception
+ *                                              de la demande, t3 = envoi de la réponse)
+ *    à la réception (t4) : décalage = ((t2 - t1) + (t3 - t4)) / 2
+ *                          aller-retour = (t4 - t1) - (t3 - t2)
+ *  Les échanges dont l'aller-retour est bien plus long que le meilleur
+ *  aller-retour observé sont ignorés (file d'attente dans le réseau ou le
+ *  broker). La dérive de l'horloge de l'objet est estimée entre deux
+ *  synchronisations espacées d'au moins HORLOGE_DUREE_MIN_DERIVE_MS.
+ * =============================================================================================================================================
+ */
+
+#ifndef __DOMOKIT_HORLOGE_H__
+#define __DOMOKIT_HORLOGE_H__
+
+// ################################################################################
+// 									Librairies
+// ################################################################################
+  #include "Arduino.h"
+
+// ################################################################################
+// 				Defines , définition et variables globales
+// ################################################################################
+  #define HORLOGE_PERIODE_SYNC_MS         900000  // synchronisation toutes les 15 min
+  #define HORLOGE_DELAI_SYNC_MS           1000    // première synchronisation après START
+  #define HORLOGE_DUREE_MIN_DERIVE_MS     600000  // intervalle min pour estimer la dérive
+  #define HORLOGE_DERIVE_MAX_PPM          500     // dérive max acceptée (quartz ESP8266 : ~ 50 ppm)
+  #define HORLOGE_MARGE_RTT_MS            20      // aller-retour accepté : 2 x meilleur + marge
+
+// ################################################################################
+// 									Classes
+// ################################################################################
+class Domokit_Horloge
+{
+  public:
+    Domokit_Horloge();
+
+    // Horloge monotone (ms depuis le démarrage). A appeler au moins une fois
+    // tous les 49 jours (débordement de millis()) : fait par Domokit::poll()
+    uint64_t monotonic();
+
+    // Heure du serveur (ms depuis le 01/01/1970) d'une date de l'horloge
+    // monotone, -1 tant que l'horloge n'est pas synchronisée
+    int64_t toServerTime(uint64_t date);
+    int64_t now();
+
+    // Résultat d'un échange de synchronisation (t4 = réception de la réponse)
+    bool update(int64_t t1, int64_t t2, int64_t t3, uint64_t t4);
+    void reset();
+
+    bool     isSynchronized();
+    int64_t  getOffset();     // décalage à la dernière synchronisation (ms)
+    int32_t  getDrift();      // dérive estimée (ppm)
+    uint32_t getRTT();        // aller-retour de la dernière synchronisation (ms)
+    uint16_t getNbSync();
+    uint16_t getNbRejets();
+
+  private:
+    uint32_t _Dernier_Millis;
+    uint32_t _Nb_Debordements;
+
+    bool     _Synchronise;
+    uint64_t _Reference;          // date (horloge monotone) de la dernière synchronisation
+    int64_t  _Decalage;           // heure serveur - horloge monotone, à _Reference
+    int32_t  _Derive_ppm;
+    bool     _Derive_Estimee;
+    uint32_t _RTT;
+    uint32_t _RTT_Min;
+    uint16_t _Nb_Sync;
+    uint16_t _Nb_Rejets;
+};
+
+#endif
@@ -0,0 +1,461 @@
+/*
+ *  =============================================================================================================================================
+ *  Titre : DomoKit_Journal.cpp
+ *  Auteur : Thomas Broussard
+ *  ---------------------------------------------------------------------------------------------------------------------------------------------
+ *  Description :
+ *  Journal circulaire en flash (enregistrement hors connexion et renvoi)
+ * =============================================================================================================================================
+ */
+
+#include "DomoKit.h"
+
+// Taille d'un enregistrement en flash (valeur complétée à un multiple de 4)
+#define TAILLE_ENREGISTREMENT(taille)  (8 + (((taille) + 3) & ~3))
+
+// La taille de la valeur est enregistrée sur un octet
+#if JOURNAL_TAILLE_VALEUR > 255
+  #error "TAILLE_VALEUR_TILE trop grand pour le journal hors connexion"
+#endif
+
+// ################################################################################
+// 						Zone flash de l'ESP8266
+// ################################################################################
+Flash_ESP::Flash_ESP(uint32_t premier_secteur, uint32_t nb_secteurs)
+{
+  _Premier_Secteur = premier_secteur;
+  _Nb_Secteurs = nb_secteurs;
+}
+
+bool Flash_ESP::read(uint32_t adresse, uint32_t* dest, size_t taille)
+{
+  return ESP.flashRead(_Premier_Secteur * JOURNAL_TAILLE_SECTEUR + adresse, dest, taille);
+}
+
+bool Flash_ESP::write(uint32_t adresse, const uint32_t* src, size_t taille)
+{
+  return ESP.flashWrite(_Premier_Secteur * JOURNAL_TAILLE_SECTEUR + adresse, (uint32_t*)src, taille);
+}
+
+bool Flash_ESP::erase(uint32_t secteur)
+{
+  return ESP.flashEraseSector(_Premier_Secteur + secteur);
+}
+
+uint32_t Flash_ESP::getNbSecteurs()
+{
+  return _Nb_Secteurs;
+}
+
+// ################################################################################
+// 									CRC8
+// ################################################################################
+
+// CRC-8 (polynôme 0x07) : détecte un enregistrement interrompu par une coupure
+static uint8_t CRC8(uint8_t crc, const uint8_t* donnees, size_t taille)
+{
+  for (size_t i = 0; i < taille; i++)
+  {
+    crc ^= donnees[i];
+    for (uint8_t bit = 0; bit < 8; bit++)
+      crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+  }
+  return crc;
+}
+
+static uint8_t CRC_Enregistrement(uint8_t tile, uint8_t taille, uint32_t date, const uint8_t* valeur)
+{
+  uint8_t entete[2] = {tile, taille};
+  uint8_t crc = CRC8(0, entete, 2);
+  crc = CRC8(crc, (const uint8_t*)&date, 4);
+  return CRC8(crc, valeur, taille);
+}
+
+// ################################################################################
+// 									Constructeur
+// ################################################################################
+Domokit_Journal::Domokit_Journal()
+{
+  _Flash = NULL;
+  _Nb_Secteurs = 0;
+  _Nb_En_Attente = 0;
+  _Nb_Anciens = 0;
+  _Nb_Lus = 0;
+  _Nb_Anciens_Lus = 0;
+  _Dernier_Lu = false;
+  _Nb_Pertes = 0;
+  _Nb_Rejets = 0;
+  _Octets_Utiles = 0;
+  _Octets_Ecrits = 0;
+  _Nb_Effacements = 0;
+}
+
+/*===============================================================================
+  Nom 			: begin
+
+  Description	: Monte le journal : retrouve le secteur le plus récent (écriture)
+                et le premier enregistrement non renvoyé (lecture). Une zone
+                vierge est initialisée.
+
+  Paramètre(s) 	: flash : zone flash du journal (2 secteurs minimum)
+
+  Retour		: false si la zone est inutilisable
+===============================================================================*/
+bool Domokit_Journal::begin(Domokit_Flash* flash)
+{
+  Journal_Enregistrement enregistrement;
+  uint32_t sequence, plus_ancien = 0, plus_recent = 0;
+  uint32_t sequence_min = 0xFFFFFFFF, sequence_max = 0;
+  uint32_t secteur, offset;
+  uint8_t etat;
+  bool trouve = false;
+
+  _Flash = flash;
+  _Nb_Secteurs = (flash != NULL) ? flash->getNbSecteurs() : 0;
+  if (_Nb_Secteurs > JOURNAL_NB_SECTEURS_MAX)
+    _Nb_Secteurs = JOURNAL_NB_SECTEURS_MAX;
+  if (_Nb_Secteurs < 2)
+  {
+    _Nb_Secteurs = 0;
+    return false;
+  }
+
+  // Secteurs le plus ancien et le plus récent (numéros de séquence)
+  for (secteur = 0; secteur < _Nb_Secteurs; secteur++)
+  {
+    if (!lireEnTete(secteur, &sequence))
+      continue;
+    trouve = true;
+    if (sequence < sequence_min) { sequence_min = sequence; plus_ancien = secteur; }
+    if (sequence >= sequence_max) { sequence_max = sequence; plus_recent = secteur; }
+  }
+
+  _Nb_Lus = 0;
+  _Nb_Anciens_Lus = 0;
+  _Dernier_Lu = false;
+
+  if (!trouve)
+  {
+    _Secteur_Ecriture = 0;
+    _Secteur_Lecture = 0;
+    _Offset_Lecture = JOURNAL_TAILLE_ENTETE;
+    _Secteur_Curseur = 0;
+    _Offset_Curseur = JOURNAL_TAILLE_ENTETE;
+    _Nb_En_Attente = 0;
+    _Nb_Anciens = 0;
+    return ouvrirSecteur(0, 1);
+  }
+
+  // Fin des enregistrements du secteur le plus récent
+  _Secteur_Ecriture = plus_recent;
+  _Sequence = sequence_max;
+  offset = JOURNAL_TAILLE_ENTETE;
+  {
+    size_t taille;
+    uint32_t mot;
+    while (lireEnregistrement(plus_recent, offset, &enregistrement, &taille, &etat))
+      offset += taille;
+
+    // Enregistrement interrompu : les écritures reprennent dans le secteur suivant
+    if (offset + 4 <= JOURNAL_TAILLE_SECTEUR && (!_Flash->read(plus_recent * JOURNAL_TAILLE_SECTEUR + offset, &mot, 4) || mot != 0xFFFFFFFF))
+      offset = JOURNAL_TAILLE_SECTEUR;
+  }
+  _Offset_Ecriture = offset;
+
+  // Premier enregistrement après le dernier enregistrement marqué comme renvoyé
+  _Secteur_Lecture = plus_ancien;
+  _Offset_Lecture = JOURNAL_TAILLE_ENTETE;
+  _Nb_En_Attente = 0;
+  secteur = plus_ancien;
+  offset = JOURNAL_TAILLE_ENTETE;
+  while (suivant(&secteur, &offset, &enregistrement, &etat, NULL))
+  {
+    _Nb_En_Attente++;
+    if (etat == JOURNAL_ENVOYE)
+    {
+      _Secteur_Lecture = secteur;
+      _Offset_Lecture = offset;
+      _Nb_En_Attente = 0;
+    }
+  }
+
+  _Nb_Anciens = _Nb_En_Attente;
+  _Secteur_Curseur = _Secteur_Lecture;
+  _Offset_Curseur = _Offset_Lecture;
+  return true;
+}
+
+// ################################################################################
+// 									Ecriture
+// ################################################################################
+
+/*===============================================================================
+  Nom 			: append
+
+  Description	: Ajoute un enregistrement. Si le secteur courant est plein, le
+                secteur suivant de l'anneau est effacé : s'il contenait des
+                enregistrements non renvoyés, ils sont perdus.
+
+  Paramètre(s) 	: tile : ID de la tile
+                  date : date de la valeur (millis)
+                  valeur : texte envoyé à la tile (au plus JOURNAL_TAILLE_VALEUR
+                           caractères : une valeur tronquée remplacerait la vraie
+                           valeur sur le serveur, elle est rejetée et comptée)
+
+  Retour		: false si la valeur est trop longue ou si l'écriture en flash a échoué
+===============================================================================*/
+bool Domokit_Journal::append(uint8_t tile, uint32_t date, const char* valeur)
+{
+  uint32_t mots[2 + (JOURNAL_TAILLE_VALEUR + 3) / 4];
+  uint8_t* octets = (uint8_t*)mots;
+  size_t taille = strlen(valeur);
+  size_t total;
+
+  if (_Nb_Secteurs == 0)
+    return false;
+
+  if (taille > JOURNAL_TAILLE_VALEUR)
+  {
+    _Nb_Rejets++;
+    return false;
+  }
+  total = TAILLE_ENREGISTREMENT(taille);
+
+  // Secteur plein : passage au secteur suivant de l'anneau
+  if (_Offset_Ecriture + total > JOURNAL_TAILLE_SECTEUR)
+  {
+    uint32_t secteur = (_Secteur_Ecriture + 1) % _Nb_Secteurs;
+
+    // Le secteur contient les plus anciens enregistrements non renvoyés
+    if (secteur == _Secteur_Lecture)
+    {
+      unsigned long perdus = compter(_Secteur_Lecture, _Offset_Lecture);
+      _Nb_Pertes += perdus;
+      _Nb_En_Attente -= (perdus < _Nb_En_Attente) ? perdus : _Nb_En_Attente;
+      _Nb_Anciens -= (perdus < _Nb_Anciens) ? perdus : _Nb_Anciens;
+      _Secteur_Lecture = (secteur + 1) % _Nb_Secteurs;
+      _Offset_Lecture = JOURNAL_TAILLE_ENTETE;
+      this->rewind();
+    }
+
+    if (!ouvrirSecteur(secteur, _Sequence + 1))
+      return false;
+  }
+
+  memset(mots, 0xFF, sizeof(mots));
+  octets[0] = tile;
+  octets[1] = (uint8_t)taille;
+  octets[2] = CRC_Enregistrement(tile, (uint8_t)taille, date, (const uint8_t*)valeur);
+  octets[3] = JOURNAL_NON_ENVOYE;
+  mots[1] = date;
+  memcpy(&octets[8], valeur, taille);
+
+  if (!_Flash->write(_Secteur_Ecriture * JOURNAL_TAILLE_SECTEUR + _Offset_Ecriture, mots, total))
+    return false;
+
+  _Offset_Ecriture += total;
+  _Nb_En_Attente++;
+  _Octets_Utiles += 5 + taille;
+  _Octets_Ecrits += total;
+  return true;
+}
+
+// Efface un secteur et écrit son en-tête
+bool Domokit_Journal::ouvrirSecteur(uint32_t secteur, uint32_t sequence)
+{
+  uint32_t entete[2] = {JOURNAL_MAGIC, sequence};
+
+  _Nb_Effacements++;
+  if (!_Flash->erase(secteur) || !_Flash->write(secteur * JOURNAL_TAILLE_SECTEUR, entete, sizeof(entete)))
+    return false;
+
+  _Octets_Ecrits += sizeof(entete);
+  _Secteur_Ecriture = secteur;
+  _Offset_Ecriture = JOURNAL_TAILLE_ENTETE;
+  _Sequence = sequence;
+  return true;
+}
+
+// ################################################################################
+// 									Lecture
+// ################################################################################
+
+// Lit l'enregistrement suivant (curseur de lecture)
+bool Domokit_Journal::read(Journal_Enregistrement* enregistrement)
+{
+  uint8_t etat;
+
+  if (_Nb_Secteurs == 0 || !suivant(&_Secteur_Curseur, &_Offset_Curseur, enregistrement, &etat, &_Adresse_Dernier_Lu))
+    return false;
+
+  enregistrement->ancien = (_Nb_Anciens_Lus < _Nb_Anciens);
+  if (enregistrement->ancien)
+    _Nb_Anciens_Lus++;
+  _Nb_Lus++;
+  _Dernier_Lu = true;
+  return true;
+}
+
+// Confirme les enregistrements lus : le dernier est marqué comme renvoyé
+void Domokit_Journal::commit()
+{
+  uint32_t mot;
+
+  if (!_Dernier_Lu)
+    return;
+
+  if (_Flash->read(_Adresse_Dernier_Lu, &mot, 4))
+  {
+    ((uint8_t*)&mot)[3] = JOURNAL_ENVOYE;
+    _Flash->write(_Adresse_Dernier_Lu, &mot, 4);
+    _Octets_Ecrits += 4;
+  }
+
+  _Secteur_Lecture = _Secteur_Curseur;
+  _Offset_Lecture = _Offset_Curseur;
+  _Nb_En_Attente -= (_Nb_Lus < _Nb_En_Attente) ? _Nb_Lus : _Nb_En_Attente;
+  _Nb_Anciens -= (_Nb_Anciens_Lus < _Nb_Anciens) ? _Nb_Anciens_Lus : _Nb_Anciens;
+  _Nb_Lus = 0;
+  _Nb_Anciens_Lus = 0;
+  _Dernier_Lu = false;
+}
+
+// Revient au premier enregistrement non confirmé
+void Domokit_Journal::rewind()
+{
+  _Secteur_Curseur = _Secteur_Lecture;
+  _Offset_Curseur = _Offset_Lecture;
+  _Nb_Lus = 0;
+  _Nb_Anciens_Lus = 0;
+  _Dernier_Lu = false;
+}
+
+// En-tête d'un secteur : false si le secteur n'appartient pas au journal
+bool Domokit_Journal::lireEnTete(uint32_t secteur, uint32_t* sequence)
+{
+  uint32_t entete[2];
+
+  if (!_Flash->read(secteur * JOURNAL_TAILLE_SECTEUR, entete, sizeof(entete)) || entete[0] != JOURNAL_MAGIC)
+    return false;
+  *sequence = entete[1];
+  return true;
+}
+
+/*===============================================================================
+  Nom 			: lireEnregistrement
+
+  Description	: Lit l'enregistrement situé à une position donnée
+
+  Paramètre(s) 	: secteur, offset : position
+                  enregistrement : enregistrement lu
+                  taille : taille occupée en flash
+                  etat : JOURNAL_NON_ENVOYE ou JOURNAL_ENVOYE
+
+  Retour		: false en fin de secteur (zone effacée ou enregistrement interrompu)
+===============================================================================*/
+bool Domokit_Journal::lireEnregistrement(uint32_t secteur, uint32_t offset, Journal_Enregistrement* enregistrement, size_t* taille, uint8_t* etat)
+{
+  uint32_t mots[2 + (JOURNAL_TAILLE_VALEUR + 3) / 4];
+  uint8_t* octets = (uint8_t*)mots;
+  uint32_t adresse = secteur * JOURNAL_TAILLE_SECTEUR + offset;
+
+  if (offset + 8 > JOURNAL_TAILLE_SECTEUR || !_Flash->read(adresse, mots, 8) || mots[0] == 0xFFFFFFFF)
+    return false;
+
+  if (octets[1] > JOURNAL_TAILLE_VALEUR)
+    return false;
+  *taille = TAILLE_ENREGISTREMENT(octets[1]);
+  if (offset + *taille > JOURNAL_TAILLE_SECTEUR)
+    return false;
+  if (*taille > 8 && !_Flash->read(adresse + 8, &mots[2], *taille - 8))
+    return false;
+  if (CRC_Enregistrement(octets[0], octets[1], mots[1], &octets[8]) != octets[2])
+    return false;
+
+  enregistrement->tile = octets[0];
+  enregistrement->date = mots[1];
+  enregistrement->ancien = false;
+  memcpy(enregistrement->valeur, &octets[8], octets[1]);
+  enregistrement->valeur[octets[1]] = '\0';
+  *etat = octets[3];
+  return true;
+}
+
+// Enregistrement suivant dans l'anneau (jusqu'à la position d'écriture)
+bool Domokit_Journal::suivant(uint32_t* secteur, uint32_t* offset, Journal_Enregistrement* enregistrement, uint8_t* etat, uint32_t* adresse)
+{
+  size_t taille;
+
+  for (;;)
+  {
+    if (*secteur == _Secteur_Ecriture && *offset >= _Offset_Ecriture)
+      return false;
+
+    if (lireEnregistrement(*secteur, *offset, enregistrement, &taille, etat))
+    {
+      if (adresse != NULL)
+        *adresse = *secteur * JOURNAL_TAILLE_SECTEUR + *offset;
+      *offset += taille;
+      return true;
+    }
+
+    if (*secteur == _Secteur_Ecriture)
+      return false;
+    *secteur = (*secteur + 1) % _Nb_Secteurs;
+    *offset = JOURNAL_TAILLE_ENTETE;
+  }
+}
+
+// Nombre d'enregistrements d'un secteur à partir d'une position
+uint32_t Domokit_Journal::compter(uint32_t secteur, uint32_t offset)
+{
+  Journal_Enregistrement enregistrement;
+  uint32_t nb = 0;
+  size_t taille;
+  uint8_t etat;
+
+  while (lireEnregistrement(secteur, offset, &enregistrement, &taille, &etat))
+  {
+    offset += taille;
+    nb++;
+  }
+  return nb;
+}
+
+// ################################################################################
+// 									Getters
+// ################################################################################
+bool Domokit_Journal::isActive()
+{
+  return _Nb_Secteurs > 0;
+}
+
+unsigned long Domokit_Journal::getNbEnAttente()
+{
+  return _Nb_En_Attente;
+}
+
+unsigned long Domokit_Journal::getNbPertes()
+{
+  return _Nb_Pertes;
+}
+
+unsigned long Domokit_Journal::getNbRejets()
+{
+  return _Nb_Rejets;
+}
+
+unsigned long Domokit_Journal::getOctetsUtiles()
+{
+  return _Octets_Utiles;
+}
+
+unsigned long Domokit_Journal::getOctetsEcrits()
+{
+  return _Octets_Ecrits;
+}
+
+unsigned long Domokit_Journal::getNbEffacements()
+{
+  return _Nb_Effacements;
+}
@@ -0,0 +1,166 @@
+/*
+ *  =============================================================================================================================================
+ *  Titre : DomoKit_Journal.h
+ *  Auteur : Thomas Broussard
+ *  ---------------------------------------------------------------------------------------------------------------------------------------------
+ *  Description :
+ *  Journal circulaire en flash des valeurs envoyées aux tiles pendant une
+ *  coupure (wifi ou serveur MQTT). Les valeurs enregistrées sont renvoyées au
+ *  serveur à la reconnexion, groupées dans des trames BACKFILL, à débit
+ *  limité (voir Domokit::enableOfflineLog).
+ *
+ *  Organisation de la flash (zone de nb secteurs de 4 Ko utilisés en anneau) :
+ *    secteur       : magic (4) | numéro de séquence (4) | enregistrements...
+ *    enregistrement: id tile (1) | taille (1) | crc8 (1) | état (1) | date (4)
+ *                    | valeur (taille octets, complétée à un multiple de 4)
+ *  Les enregistrements sont ajoutés à la suite, sans jamais réécrire un
+ *  secteur : un secteur n'est effacé que lorsque l'anneau le réutilise (les
+ *  données les plus anciennes sont alors perdues si elles n'ont pas été
+ *  renvoyées). L'état du dernier enregistrement de chaque trame renvoyée
+ *  passe de 0xFF à 0x00 (écriture sans effacement) : après un redémarrage,
+ *  le renvoi reprend après le dernier enregistrement marqué.
+ *
+ *  Zone flash : aucune zone n'est utilisée par défaut, car le journal efface
+ *  ses secteurs. L'application réserve une zone dédiée (2 à
+ *  JOURNAL_NB_SECTEURS_MAX secteurs) et la fournit à Domokit::setOfflineLogFlash
+ *  avant begin() ; sinon le journal reste inactif. Par exemple :
+ *  - le sketch n'utilise pas de système de fichiers (ni SPIFFS ni LittleFS) :
+ *    les premiers secteurs de la zone FS de la carte peuvent servir au journal
+ *      extern "C" uint32_t _FS_start;
+ *      Flash_ESP journal(((uint32_t)&_FS_start - 0x40200000) / JOURNAL_TAILLE_SECTEUR, 4);
+ *  - le sketch utilise un système de fichiers : choisir un script d'édition de
+ *    liens (board_build.ldscript) dont la zone FS se termine quelques secteurs
+ *    avant la zone EEPROM, et passer ces secteurs libres à Flash_ESP.
+ *
+ *  Statistiques : octets utiles (tile, date, valeur), octets écrits en flash
+ *  et secteurs effacés, d'où l'amplification d'écriture.
+ * =============================================================================================================================================
+ */
+
+#ifndef __DOMOKIT_JOURNAL_H__
+#define __DOMOKIT_JOURNAL_H__
+
+// ################################################################################
+// 									Librairies
+// ################################################################################
+  #include "Arduino.h"
+  #include "DomoKit_Memoire.h"
+
+// ################################################################################
+// 				Defines , définition et variables globales
+// ################################################################################
+  #define JOURNAL_MAGIC               0x444B4A31  // "DKJ1"
+  #define JOURNAL_TAILLE_SECTEUR      4096
+  #define JOURNAL_TAILLE_ENTETE       8           // en-tête d'un secteur
+  #define JOURNAL_TAILLE_VALEUR       (TAILLE_VALEUR_TILE - 1)  // taille max d'une valeur (celle d'une tile)
+  #define JOURNAL_NB_SECTEURS_MAX     16          // taille max de la zone (temps de montage borné)
+  #define JOURNAL_PERIODE_BACKFILL_MS 200         // une trame BACKFILL par période
+  #define JOURNAL_NON_ENVOYE          0xFF
+  #define JOURNAL_ENVOYE              0x00
+
+// Enregistrement lu dans le journal
+typedef struct
+{
+  uint8_t  tile;
+  uint32_t date;                            // millis() à l'enregistrement
+  bool     ancien;                          // enregistré avant le dernier démarrage (date inconnue)
+  char     valeur[JOURNAL_TAILLE_VALEUR + 1];
+} Journal_Enregistrement;
+
+// ################################################################################
+// 									Classes
+// ################################################################################
+
+// --------------------------------------------------------------------------------
+// Zone flash du journal (adresses relatives au début de la zone, multiples de 4).
+// Aucune zone par défaut : une zone réservée (Flash_ESP) ou simulée doit être
+// fournie par Domokit::setOfflineLogFlash (voir l'en-tête de ce fichier)
+// --------------------------------------------------------------------------------
+class Domokit_Flash
+{
+  public:
+    virtual ~Domokit_Flash() {}
+
+    virtual bool     read(uint32_t adresse, uint32_t* dest, size_t taille) = 0;
+    virtual bool     write(uint32_t adresse, const uint32_t* src, size_t taille) = 0; // bits 1 -> 0 uniquement
+    virtual bool     erase(uint32_t secteur) = 0;
+    virtual uint32_t getNbSecteurs() = 0;
+};
+
+class Flash_ESP : public Domokit_Flash
+{
+  public:
+    Flash_ESP(uint32_t premier_secteur, uint32_t nb_secteurs);
+
+    bool     read(uint32_t adresse, uint32_t* dest, size_t taille);
+    bool     write(uint32_t adresse, const uint32_t* src, size_t taille);
+    bool     erase(uint32_t secteur);
+    uint32_t getNbSecteurs();
+
+  private:
+    uint32_t _Premier_Secteur;
+    uint32_t _Nb_Secteurs;
+};
+
+// --------------------------------------------------------------------------------
+// Journal
+// --------------------------------------------------------------------------------
+class Domokit_Journal
+{
+  public:
+    Domokit_Journal();
+
+    bool begin(Domokit_Flash* flash);
+    bool append(uint8_t tile, uint32_t date, const char* valeur);
+
+    // Lecture pour le renvoi : read() avance un curseur, commit() confirme les
+    // enregistrements lus, rewind() revient au dernier enregistrement confirmé
+    bool read(Journal_Enregistrement* enregistrement);
+    void commit();
+    void rewind();
+
+    bool          isActive();
+    unsigned long getNbEnAttente();
+    unsigned long getNbPertes();      // enregistrements écrasés avant d'être renvoyés
+    unsigned long getNbRejets();      // valeurs trop longues, non enregistrées
+    unsigned long getOctetsUtiles();
+    unsigned long getOctetsEcrits();
+    unsigned long getNbEffacements();
+
+  private:
+    bool   lireEnTete(uint32_t secteur, uint32_t* sequence);
+    bool   ouvrirSecteur(uint32_t secteur, uint32_t sequence);
+    bool   lireEnregistrement(uint32_t secteur, uint32_t offset, Journal_Enregistrement* enregistrement, size_t* taille, uint8_t* etat);
+    bool   suivant(uint32_t* secteur, uint32_t* offset, Journal_Enregistrement* enregistrement, uint8_t* etat, uint32_t* adresse);
+    uint32_t compter(uint32_t secteur, uint32_t offset);
+
+    Domokit_Flash* _Flash;
+    uint32_t _Nb_Secteurs;
+
+    // Position d'écriture
+    uint32_t _Secteur_Ecriture;
+    uint32_t _Offset_Ecriture;
+    uint32_t _Sequence;
+
+    // Premier enregistrement non confirmé, et curseur de lecture
+    uint32_t _Secteur_Lecture;
+    uint32_t _Offset_Lecture;
+    uint32_t _Secteur_Curseur;
+    uint32_t _Offset_Curseur;
+    uint32_t _Adresse_Dernier_Lu;   // en-tête du dernier enregistrement lu (marqué par commit)
+    bool     _Dernier_Lu;
+
+    // Enregistrements en attente (et parmi eux, enregistrés avant le démarrage)
+    unsigned long _Nb_En_Attente;
+    unsigned long _Nb_Anciens;
+    unsigned long _Nb_Lus;
+    unsigned long _Nb_Anciens_Lus;
+
+    unsigned long _Nb_Pertes;
+    unsigned long _Nb_Rejets;
+    unsigned long _Octets_Utiles;
+    unsigned long _Octets_Ecrits;
+    unsigned long _Nb_Effacements;
+};
+
+#endif
@@ -0,0 +1,230 @@
+/*
+ *  =============================================================================================================================================
+ *  Titre : DomoKit_Liaison.cpp
+ *  Auteur : Thomas Broussard
+ *  ---------------------------------------------------------------------------------------------------------------------------------------------
+ *  Description :
+ *  Ping applicatif, détection des liaisons mortes et débit adaptatif (AIMD)
+ * =============================================================================================================================================
+ */
+
+#include "DomoKit.h"
+
+// ################################################################################
+// 									Constructeur
+// ################################################################################
+Domokit_Liaison::Domokit_Liaison()
+{
+  _Numero = 0;
+  _Nb_Pings = 0;
+  _Nb_Pings_Perdus = 0;
+  _Nb_Regroupees = 0;
+  _Nb_Reductions = 0;
+  reset();
+}
+
+void Domokit_Liaison::reset()
+{
+  unsigned long maintenant = millis();
+
+  _Ping_En_Cours = false;
+  _Date_Ping_ms = maintenant;
+  _Prochain_Ping_ms = maintenant + LIAISON_PERIODE_SONDE_MS;
+  _Nb_Pertes = 0;
+
+  _SRTT = 0;
+  _RTTVar = 0;
+  _RTT_Min = 0;
+  _Congestion = false;
+
+  _Debit = LIAISON_DEBIT_MAX;
+  _Jetons = LIAISON_DEBIT_MAX;
+  _Date_Jetons_ms = maintenant;
+}
+
+// ################################################################################
+// 									Ping
+// ################################################################################
+
+/*===============================================================================
+  Nom 			: nextPing
+
+  Description	: Détecte la perte du ping en cours et indique s'il faut envoyer
+                un nouveau ping (à appeler périodiquement)
+
+  Paramètre(s) 	: numero : numéro du ping à envoyer
+
+  Retour		: true si un ping doit être envoyé
+===============================================================================*/
+bool Domokit_Liaison::nextPing(uint16_t* numero)
+{
+  unsigned long maintenant = millis();
+
+  if (_Ping_En_Cours)
+  {
+    uint32_t delai = _SRTT + 4 * _RTTVar;
+    if (delai < LIAISON_DELAI_PING_MIN_MS)
+      delai = LIAISON_DELAI_PING_MIN_MS;
+    if (maintenant - _Date_Ping_ms < delai)
+      return false;
+
+    // Ping perdu : nouvelle sonde immédiatement
+    _Ping_En_Cours = false;
+    _Nb_Pertes++;
+    _Nb_Pings_Perdus++;
+    _Prochain_Ping_ms = maintenant;
+    decrease();
+  }
+
+  if ((long)(maintenant - _Prochain_Ping_ms) < 0)
+    return false;
+
+  _Numero++;
+  _Ping_En_Cours = true;
+  _Date_Ping_ms = maintenant;
+  _Prochain_Ping_ms = maintenant + ((_Nb_Pertes > 0) ? LIAISON_PERIODE_SONDE_MS : LIAISON_PERIODE_PING_MS);
+  _Nb_Pings++;
+  *numero = _Numero;
+  return true;
+}
+
+// Réception d'un ping renvoyé par le broker
+void Domokit_Liaison::pong(uint16_t numero)
+{
+  if (!_Ping_En_Cours || numero != _Numero)
+    return;
+
+  uint32_t rtt = millis() - _Date_Ping_ms;
+  _Ping_En_Cours = false;
+  _Nb_Pertes = 0;
+
+  // Lissage de l'aller-retour (même calcul que TCP)
+  if (_SRTT == 0)
+  {
+    _SRTT = rtt;
+    _RTTVar = rtt / 2;
+  }
+  else
+  {
+    uint32_t ecart = (rtt > _SRTT) ? rtt - _SRTT : _SRTT - rtt;
+    _RTTVar = (3 * _RTTVar + ecart) / 4;
+    _SRTT = (7 * _SRTT + rtt) / 8;
+  }
+
+  // Meilleur aller-retour, relevé lentement pour suivre un changement de chemin
+  if (_RTT_Min == 0 || rtt < _RTT_Min)
+    _RTT_Min = rtt;
+  else
+    _RTT_Min += _RTT_Min / 16 + 1;
+
+  if (_Congestion || rtt > LIAISON_FACTEUR_RTT * _RTT_Min + LIAISON_MARGE_RTT_MS)
+    decrease();
+  else
+    increase();
+}
+
+bool Domokit_Liaison::isDead()
+{
+  return _Nb_Pertes >= LIAISON_NB_PERTES_MAX;
+}
+
+void Domokit_Liaison::observe(int32_t rssi, int tampon_libre, uint8_t qos_en_attente, uint8_t qos_max)
+{
+  _Congestion = (rssi < LIAISON_RSSI_FAIBLE)
+             || (tampon_libre >= 0 && tampon_libre < LIAISON_TAMPON_MIN)
+             || (qos_max > 0 && 2 * qos_en_attente > qos_max);
+}
+
+// ################################################################################
+// 									Débit
+// ################################################################################
+
+void Domokit_Liaison::decrease()
+{
+  _Debit = (_Debit / 2 < LIAISON_DEBIT_MIN) ? LIAISON_DEBIT_MIN : _Debit / 2;
+  if (_Jetons > _Debit)
+    _Jetons = _Debit;
+  _Nb_Reductions++;
+}
+
+void Domokit_Liaison::increase()
+{
+  _Debit = (_Debit + LIAISON_PAS_DEBIT > LIAISON_DEBIT_MAX) ? LIAISON_DEBIT_MAX : _Debit + LIAISON_PAS_DEBIT;
+}
+
+// Ajoute les jetons acquis depuis le dernier appel (au plus une seconde de débit)
+void Domokit_Liaison::refill()
+{
+  unsigned long maintenant = millis();
+  uint32_t capacite = (_Debit < 10) ? 10 : _Debit;
+  uint32_t gain = (uint32_t)_Debit * (maintenant - _Date_Jetons_ms) / 1000;
+
+  if (gain == 0)
+    return;
+
+  _Jetons += gain;
+  _Date_Jetons_ms += gain * 1000 / _Debit;   // le reste est conservé pour l'appel suivant
+  if (_Jetons >= capacite)
+  {
+    _Jetons = capacite;
+    _Date_Jetons_ms = maintenant;
+  }
+}
+
+bool Domokit_Liaison::acquire()
+{
+  refill();
+  if (_Jetons < 10)
+    return false;
+  _Jetons -= 10;
+  return true;
+}
+
+void Domokit_Liaison::coalesce()
+{
+  _Nb_Regroupees++;
+}
+
+// ################################################################################
+// 									Getters
+// ################################################################################
+
+uint32_t Domokit_Liaison::getRTT()
+{
+  return _SRTT;
+}
+
+uint32_t Domokit_Liaison::getRTTVar()
+{
+  return _RTTVar;
+}
+
+uint32_t Domokit_Liaison::getRTTMin()
+{
+  return _RTT_Min;
+}
+
+uint16_t Domokit_Liaison::getRate()
+{
+  return _Debit;
+}
+
+unsigned long Domokit_Liaison::getNbPings()
+{
+  return _Nb_Pings;
+}
+
+unsigned long Domokit_Liaison::getNbPingsPerdus()
+{
+  return _Nb_Pings_Perdus;
+}
+
+unsigned long Domokit_Liaison::getNbRegroupees()
+{
+  return _Nb_Regroupees;
+}
+
+unsigned long Domokit_Liaison::getNbReductions()
+{
+  return _Nb_Reductions;
+}
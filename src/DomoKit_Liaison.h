@@ -0,0 +1,116 @@
+/*
+ *  =============================================================================================================================================
+ *  Titre : DomoKit_Liaison.h
+ *  Auteur : Thomas Broussard
+ *  ---------------------------------------------------------------------------------------------------------------------------------------------
+ *  Description :
+ *  Qualité de la liaison avec le broker et débit de publication adaptatif.
+ *
+ *  - Ping applicatif : l'objet publie PING;n sur son propre topic
+ *    <MAIN_TOPIC>/ping/<@mac>, auquel il est abonné : le broker le lui renvoie.
+ *    L'aller-retour est lissé comme celui de TCP (moyenne et variation).
+ *  - Liaison morte : après LIAISON_NB_PERTES_MAX pings sans réponse, la
+ *    connexion est considérée comme à demi ouverte (TCP encore établi côté
+ *    objet, plus rien ne passe) et fermée par l'objet, sans attendre que le
+ *    transport le détecte. Après une perte, les pings sont rapprochés.
+ *  - Débit des valeurs envoyées aux tiles (AIMD) : à chaque ping acquitté sans
+ *    signe de congestion, le débit autorisé augmente de LIAISON_PAS_DEBIT ; il
+ *    est divisé par deux sur un ping perdu, un aller-retour anormalement long,
+ *    un tampon d'émission presque plein, une fenêtre QoS 1 chargée ou un
+ *    signal wifi faible. Les publications sont limitées par un seau à jetons ;
+ *    sans jeton, seule la dernière valeur de chaque tile est conservée et
+ *    publiée dès qu'un jeton est disponible (valeurs regroupées).
+ * =============================================================================================================================================
+ */
+
+#ifndef __DOMOKIT_LIAISON_H__
+#define __DOMOKIT_LIAISON_H__
+
+// ################################################################################
+// 									Librairies
+// ################################################################################
+  #include "Arduino.h"
+
+// ################################################################################
+// 				Defines , définition et variables globales
+// ################################################################################
+  #define LIAISON_PERIODE_MS          250     // jetons, publications en attente, pings
+  #define LIAISON_PERIODE_PING_MS     5000    // ping sur une liaison saine
+  #define LIAISON_PERIODE_SONDE_MS    1000    // ping après une perte
+  #define LIAISON_DELAI_PING_MIN_MS   1000    // délai min avant de considérer un ping perdu
+  #define LIAISON_NB_PERTES_MAX       3       // pings perdus consécutifs : liaison morte
+
+  // Débit en dixièmes de message par seconde
+  #define LIAISON_DEBIT_MAX           200     // 20 messages/s
+  #define LIAISON_DEBIT_MIN           2       // 1 message toutes les 5 s
+  #define LIAISON_PAS_DEBIT           10      // augmentation additive (1 message/s)
+
+  // Signes de congestion
+  #define LIAISON_FACTEUR_RTT         3       // aller-retour > 3 x meilleur aller-retour...
+  #define LIAISON_MARGE_RTT_MS        50      // ... + marge
+  #define LIAISON_TAMPON_MIN          512     // octets libres min dans le tampon d'émission
+  #define LIAISON_RSSI_FAIBLE         -80     // dBm
+
+// ################################################################################
+// 									Classes
+// ################################################################################
+class Domokit_Liaison
+{
+  public:
+    Domokit_Liaison();
+
+    void reset();   // nouvelle connexion : pings et débit réinitialisés
+
+    // Ping : renvoie vrai si un ping doit être envoyé (numéro dans *numero)
+    bool     nextPing(uint16_t* numero);
+    void     pong(uint16_t numero);
+    bool     isDead();
+
+    // Signes de congestion relevés par l'objet (tampon libre : -1 si inconnu)
+    void     observe(int32_t rssi, int tampon_libre, uint8_t qos_en_attente, uint8_t qos_max);
+
+    // Demande un jeton de publication (false : valeur à regrouper)
+    bool     acquire();
+    void     coalesce();
+
+    uint32_t getRTT();          // aller-retour lissé (ms), 0 si inconnu
+    uint32_t getRTTVar();
+    uint32_t getRTTMin();
+    uint16_t getRate();         // débit autorisé (dixièmes de message par seconde)
+    unsigned long getNbPings();
+    unsigned long getNbPingsPerdus();
+    unsigned long getNbRegroupees();
+    unsigned long getNbReductions();
+
+  private:
+    void     decrease();
+    void     increase();
+    void     refill();
+
+    // Ping en cours
+    bool          _Ping_En_Cours;
+    uint16_t      _Numero;
+    unsigned long _Date_Ping_ms;
+    unsigned long _Prochain_Ping_ms;
+    uint8_t       _Nb_Pertes;   // pertes consécutives
+
+    // Aller-retour (ms)
+    uint32_t      _SRTT;
+    uint32_t      _RTTVar;
+    uint32_t      _RTT_Min;
+
+    // Congestion
+    bool          _Congestion;
+
+    // Seau à jetons (dixièmes de message)
+    uint16_t      _Debit;
+    uint32_t      _Jetons;
+    unsigned long _Date_Jetons_ms;
+
+    unsigned long _Nb_Pings;
+    unsigned long _Nb_Pings_Perdus;
+    unsigned long _Nb_Regroupees;
+    unsigned long _Nb_Reductions;
+};
+
+#endif
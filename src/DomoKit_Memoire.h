@@ -0,0 +1,153 @@
+/*
+ *  =============================================================================================================================================
+ *  Titre : DomoKit_Memoire.h
+ *  Auteur : Thomas Broussard
+ *  ---------------------------------------------------------------------------------------------------------------------------------------------
+ *  Description :
+ *  Budget mémoire de la librairie Domokit.
+ *  Toutes les chaînes de l'objet (identifiants wifi, noms, topics, tiles)
+ *  sont stockées dans des buffers de taille fixe, dimensionnés à la
+ *  compilation : aucune allocation sur le tas n'est faite par la librairie
+ *  après begin(), ce qui évite la fragmentation mémoire de l'ESP8266.
+ *
+ *  Les tailles peuvent être redéfinies par des options de compilation
+ *  (ex : -DTAILLE_NOM_APPAREIL=16).
+ *
+ *  Option DOMOKIT_SANS_STRING : l'API publique (textes, callBack_Tile)
+ *  utilise des const char* au lieu de String. Sans cette option, les
+ *  fonctions acceptant des String restent disponibles (compatibilité),
+ *  mais callBack_Tile(String, String) construit deux String à chaque
+ *  commande reçue : seule la compilation avec DOMOKIT_SANS_STRING ne fait
+ *  aucune allocation après begin() (vérifié par test/test_tas.cpp).
+ * =============================================================================================================================================
+ */
+
+#ifndef __DOMOKIT_MEMOIRE_H__
+#define __DOMOKIT_MEMOIRE_H__
+
+// ################################################################################
+// 									Librairies
+// ################################################################################
+  #include "Arduino.h"
+  #include <stdarg.h>
+  #include <stdio.h>
+  #include <string.h>
+
+// ################################################################################
+// 				Tailles des buffers (caractère de fin '\0' compris)
+// ################################################################################
+#ifndef TAILLE_SSID
+  #define TAILLE_SSID           33
+#endif
+#ifndef TAILLE_PASSWORD
+  #define TAILLE_PASSWORD       65
+#endif
+#ifndef TAILLE_CLEF
+  #define TAILLE_CLEF           33  // clef de chiffrement du serveur
+#endif
+#ifndef TAILLE_WIFI_DATA
+  #define TAILLE_WIFI_DATA      100 // zone EEPROM wifi : ssid;password;clef
+#endif
+#ifndef TAILLE_NOM_APPAREIL
+  #define TAILLE_NOM_APPAREIL   32
+#endif
+  #define TAILLE_MAC            18  // xx:xx:xx:xx:xx:xx
+  #define TAILLE_NOM_CLIENT     (TAILLE_NOM_APPAREIL + TAILLE_MAC)
+#ifndef TAILLE_TOPIC_TILE
+  #define TAILLE_TOPIC_TILE     32  // topic relatif d'une tile (ex : "test_graph")
+#endif
+#ifndef TAILLE_VALEUR_TILE
+  #define TAILLE_VALEUR_TILE    48  // dernière valeur envoyée à une tile
+#endif
+#ifndef TAILLE_ARENE_TOPICS
+  #define TAILLE_ARENE_TOPICS   544 // ensemble des topics de l'objet
+#endif
+  #define TAILLE_TOPIC          TRANSPORT_TAILLE_TOPIC
+  #define TAILLE_MESSAGE        TRANSPORT_TAILLE_PAYLOAD
+
+// ################################################################################
+// 				Type des textes de l'API publique
+// ################################################################################
+#ifdef DOMOKIT_SANS_STRING
+  typedef const char*   Domokit_Texte;
+#else
+  typedef const String& Domokit_Texte;
+#endif
+
+  // Accès au texte d'un paramètre Domokit_Texte
+  inline const char* Domokit_CStr(const char* texte)    { return texte ? texte : ""; }
+  inline const char* Domokit_CStr(const String& texte)  { return texte.c_str(); }
+
+// ################################################################################
+// 									Classes
+// ################################################################################
+
+/*===============================================================================
+  Nom 			: Domokit_Chaine
+
+  Description	: Chaîne de caractères de capacité fixe (N octets, '\0' compris).
+                Les textes trop longs sont tronqués.
+===============================================================================*/
+template <size_t N>
+class Domokit_Chaine
+{
+  public:
+    Domokit_Chaine()
+    {
+      clear();
+    }
+
+    void set(const char* texte)
+    {
+      set(texte, (texte != NULL) ? strlen(texte) : 0);
+    }
+
+    void set(const char* texte, size_t longueur)
+    {
+      if (longueur > N - 1)
+        longueur = N - 1;
+      if (longueur > 0)
+        memmove(_Texte, texte, longueur);
+      _Texte[longueur] = '\0';
+      _Longueur = longueur;
+    }
+
+    // Ecriture formatée (printf)
+    size_t format(const char* modele, ...)
+    {
+      va_list arguments;
+      va_start(arguments, modele);
+      int taille = vsnprintf(_Texte, N, modele, arguments);
+      va_end(arguments);
+
+      _Longueur = (taille < 0) ? 0 : ((size_t)taille > N - 1) ? N - 1 : (size_t)taille;
+      _Texte[_Longueur] = '\0';
+      return _Longueur;
+    }
+
+    void clear()
+    {
+      _Texte[0] = '\0';
+      _Longueur = 0;
+    }
+
+    bool equals(const char* texte) const
+    {
+      return texte != NULL && strcmp(_Texte, texte) == 0;
+    }
+
+    Domokit_Chaine& operator=(const char* texte) { set(texte); return *this; }
+    bool operator==(const char* texte) const     { return equals(texte); }
+    bool operator!=(const char* texte) const     { return !equals(texte); }
+    char operator[](size_t index) const          { return (index < _Longueur) ? _Texte[index] : '\0'; }
+
+    const char* c_str() const    { return _Texte; }
+    size_t length() const        { return _Longueur; }
+    static size_t capacity()     { return N - 1; }
+
+  private:
+    char   _Texte[N];
+    size_t _Longueur;
+};
+
+#endif
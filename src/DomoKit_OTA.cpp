@@ -0,0 +1,509 @@
+/*
+ *  =============================================================================================================================================
+ *  Titre : DomoKit_OTA.cpp
+ *  Auteur : Thomas Broussard
+ *  ---------------------------------------------------------------------------------------------------------------------------------------------
+ *  Description :
+ *  Mise à jour du firmware par MQTT (réception des blocs, écriture en flash)
+ * =============================================================================================================================================
+ */
+
+#include "DomoKit.h"
+#include <Updater.h>
+
+// ################################################################################
+// 						Cible par défaut : Updater de l'ESP8266
+// ################################################################################
+// Remarque : l'Updater alloue un buffer d'un secteur flash (4 Ko) pendant la mise à jour
+
+bool OTA_Cible_Update::begin(uint32_t taille, const char* md5)
+{
+  if (!Update.begin(taille))
+    return false;
+  return Update.setMD5(md5);
+}
+
+size_t OTA_Cible_Update::write(const uint8_t* donnees, size_t taille)
+{
+  return Update.write((uint8_t*)donnees, taille);
+}
+
+bool OTA_Cible_Update::end()
+{
+  if (Update.end())
+    return true;
+
+  #ifdef DEBUG_DOMOKIT
+    Update.printError(Serial);
+  #endif
+  return false;
+}
+
+void OTA_Cible_Update::abort()
+{
+  // end(false) abandonne une image incomplète sans l'activer
+  if (Update.isRunning() && Update.remaining() > 0)
+    Update.end(false);
+}
+
+// ################################################################################
+// 						Source par défaut : sketch en flash
+// ################################################################################
+bool OTA_Source_Flash::read(uint32_t adresse, uint32_t* dest, size_t taille)
+{
+  return ESP.flashRead(adresse, dest, taille);
+}
+
+uint32_t OTA_Source_Flash::size()
+{
+  return ESP.getSketchSize();
+}
+
+// ################################################################################
+// 						Décodeur de delta
+// ################################################################################
+
+// Entier big-endian de 4 octets
+static uint32_t Lire32(const uint8_t* octets)
+{
+  return ((uint32_t)octets[0] << 24) | ((uint32_t)octets[1] << 16) | ((uint32_t)octets[2] << 8) | octets[3];
+}
+
+OTA_Cible_Delta::OTA_Cible_Delta()
+{
+  _Destination = NULL;
+  _Source      = NULL;
+  _Demarre     = false;
+  _Etat        = DELTA_FIN;
+}
+
+void OTA_Cible_Delta::setDestination(Domokit_OTA_Cible* destination)
+{
+  _Destination = destination;
+}
+
+void OTA_Cible_Delta::setSource(Domokit_OTA_Source* source)
+{
+  _Source = source;
+}
+
+// La destination n'est ouverte qu'à la réception de l'en-tête (taille de la nouvelle image)
+bool OTA_Cible_Delta::begin(uint32_t taille, const char* md5)
+{
+  strncpy(_MD5, md5, sizeof(_MD5) - 1);
+  _MD5[sizeof(_MD5) - 1] = '\0';
+
+  _Demarre      = false;
+  _Etat         = DELTA_ENTETE;
+  _Zeros        = false;
+  _Nb_Entete    = 0;
+  _Produit      = 0;
+  _Position     = 0;
+  _Reste_Diff   = 0;
+  _Reste_Extra  = 0;
+  _Saut         = 0;
+  _Cache_Valide = false;
+  _Nb_Sortie    = 0;
+  return _Destination != NULL && _Source != NULL;
+}
+
+// Renvoie le nombre d'octets du delta traités (inférieur à taille en cas d'erreur)
+size_t OTA_Cible_Delta::write(const uint8_t* donnees, size_t taille)
+{
+  for (size_t i = 0; i < taille; i++)
+  {
+    if (!decoder(donnees[i]))
+      return i;
+  }
+  return taille;
+}
+
+bool OTA_Cible_Delta::end()
+{
+  if (!_Demarre || _Etat != DELTA_FIN)
+    return false;
+  return _Destination->end();
+}
+
+void OTA_Cible_Delta::abort()
+{
+  if (_Demarre)
+    _Destination->abort();
+  _Demarre = false;
+  _Etat = DELTA_FIN;
+}
+
+/*===============================================================================
+  Nom 			: decoder
+
+  Description	: Traite un octet du delta (machine d'état, voir DomoKit_OTA.h)
+
+  Retour		: false si le delta est invalide ou si l'écriture échoue
+===============================================================================*/
+bool OTA_Cible_Delta::decoder(uint8_t octet)
+{
+  uint8_t ancien;
+
+  switch (_Etat)
+  {
+    case DELTA_ENTETE :
+      _Entete[_Nb_Entete++] = octet;
+      if (_Nb_Entete < OTA_DELTA_TAILLE_ENTETE)
+        return true;
+      _Nb_Entete = 0;
+
+      // Le delta doit avoir été calculé à partir de l'image en cours d'exécution
+      if (memcmp(_Entete, OTA_DELTA_MAGIC, 4) != 0)
+        return false;
+      _Taille_Ancienne = Lire32(&_Entete[4]);
+      _Taille_Nouvelle = Lire32(&_Entete[8]);
+      if (_Taille_Ancienne != _Source->size() || _Taille_Nouvelle == 0)
+        return false;
+
+      if (!_Destination->begin(_Taille_Nouvelle, _MD5))
+        return false;
+      _Demarre = true;
+      _Etat = DELTA_COMMANDE;
+      return true;
+
+    case DELTA_COMMANDE :
+      _Entete[_Nb_Entete++] = octet;
+      if (_Nb_Entete < OTA_DELTA_TAILLE_COMMANDE)
+        return true;
+      _Nb_Entete = 0;
+
+      _Reste_Diff  = Lire32(&_Entete[0]);
+      _Reste_Extra = Lire32(&_Entete[4]);
+      _Saut        = (int32_t)Lire32(&_Entete[8]);
+      if (_Reste_Diff > _Taille_Nouvelle - _Produit || _Reste_Extra > _Taille_Nouvelle - _Produit - _Reste_Diff)
+        return false;
+      return suivant();
+
+    case DELTA_DIFF :
+      // Suite de n+1 octets identiques à l'ancienne image
+      if (_Zeros)
+      {
+        uint32_t n = (uint32_t)octet + 1;
+        _Zeros = false;
+        if (n > _Reste_Diff)
+          return false;
+        _Reste_Diff -= n;
+        while (n-- > 0)
+        {
+          if (!lireAncien(&ancien) || !emettre(ancien))
+            return false;
+        }
+      }
+      else if (octet == 0)
+      {
+        _Zeros = true;
+        return true;
+      }
+      else
+      {
+        _Reste_Diff--;
+        if (!lireAncien(&ancien) || !emettre(ancien + octet))
+          return false;
+      }
+      return (_Reste_Diff > 0) ? true : suivant();
+
+    case DELTA_EXTRA :
+      _Reste_Extra--;
+      if (!emettre(octet))
+        return false;
+      return (_Reste_Extra > 0) ? true : suivant();
+
+    default :
+      // Données après la fin de la nouvelle image
+      return false;
+  }
+}
+
+// Passe à la section suivante de la commande en cours, ou à la commande suivante
+bool OTA_Cible_Delta::suivant()
+{
+  if (_Reste_Diff > 0)
+  {
+    _Etat = DELTA_DIFF;
+    return true;
+  }
+  if (_Reste_Extra > 0)
+  {
+    _Etat = DELTA_EXTRA;
+    return true;
+  }
+
+  // Commande terminée : déplacement dans l'ancienne image
+  _Position += _Saut;
+  _Saut = 0;
+
+  if (_Produit == _Taille_Nouvelle)
+  {
+    _Etat = DELTA_FIN;
+    return vider();
+  }
+  _Etat = DELTA_COMMANDE;
+  return true;
+}
+
+// Lit l'octet suivant de l'ancienne image (fenêtre alignée de OTA_DELTA_TAILLE_CACHE octets)
+bool OTA_Cible_Delta::lireAncien(uint8_t* octet)
+{
+  uint32_t position = _Position++;
+  uint32_t base = position & ~(uint32_t)(OTA_DELTA_TAILLE_CACHE - 1);
+
+  if (position >= _Taille_Ancienne)
+    return false;
+
+  if (!_Cache_Valide || base != _Base_Cache)
+  {
+    if (!_Source->read(base, _Cache, OTA_DELTA_TAILLE_CACHE))
+      return false;
+    _Base_Cache = base;
+    _Cache_Valide = true;
+  }
+
+  *octet = ((const uint8_t*)_Cache)[position - base];
+  return true;
+}
+
+// Ajoute un octet à la nouvelle image
+bool OTA_Cible_Delta::emettre(uint8_t octet)
+{
+  _Sortie[_Nb_Sortie++] = octet;
+  _Produit++;
+  if (_Nb_Sortie < OTA_DELTA_TAILLE_SORTIE)
+    return true;
+  return vider();
+}
+
+// Ecrit les octets produits dans la destination
+bool OTA_Cible_Delta::vider()
+{
+  uint8_t n = _Nb_Sortie;
+
+  _Nb_Sortie = 0;
+  if (n == 0)
+    return true;
+  return _Destination->write(_Sortie, n) == n;
+}
+
+// ################################################################################
+// 									Constructeur
+// ################################################################################
+Domokit_OTA::Domokit_OTA()
+{
+  _Cible        = NULL;
+  _Cible_Session = NULL;
+  _Session_Delta = false;
+  _Statut       = OTA_INACTIF;
+  _Erreur       = OTA_ERREUR_AUCUNE;
+  _MD5[0]       = '\0';
+  _Taille       = 0;
+  _Recu         = 0;
+  _Bloc_Attendu = 0;
+  _Debut_ms     = 0;
+  _Duree_ms     = 0;
+  _Nb_Rejets    = 0;
+}
+
+// Défini la destination de l'image (à appeler avant le début d'une mise à jour)
+void Domokit_OTA::setCible(Domokit_OTA_Cible* cible)
+{
+  _Cible = cible;
+}
+
+// Défini l'image de référence des mises à jour différentielles
+void Domokit_OTA::setSource(Domokit_OTA_Source* source)
+{
+  _Delta.setSource(source);
+}
+
+// ################################################################################
+// 									Fonctions
+// ################################################################################
+
+/*===============================================================================
+  Nom 			: begin
+
+  Description	: Démarre une mise à jour, ou reprend la mise à jour en cours
+                si la même image (taille et MD5) est annoncée
+
+  Paramètre(s) 	: taille : taille des données envoyées (image ou delta)
+                  md5 : MD5 de la nouvelle image (32 caractères hexadécimaux)
+                  delta : true si les données sont un delta par rapport
+                          à l'image en cours d'exécution
+
+  Retour		: false si la zone flash n'est pas disponible
+===============================================================================*/
+bool Domokit_OTA::begin(uint32_t taille, Protocole_Vue md5, bool delta)
+{
+  // Reprise : le prochain bloc attendu est renvoyé au serveur
+  if (_Statut == OTA_EN_COURS && taille == _Taille && delta == _Session_Delta && Protocole_VueEgale(md5, _MD5))
+    return true;
+
+  this->abort();
+
+  // Mise à jour différentielle : le décodeur écrit la nouvelle image dans la cible
+  _Session_Delta = delta;
+  _Delta.setDestination(_Cible);
+  _Cible_Session = delta ? &_Delta : _Cible;
+
+  Protocole_VueCopy(md5, _MD5, sizeof(_MD5));
+  _Taille       = taille;
+  _Recu         = 0;
+  _Bloc_Attendu = 0;
+  _Nb_Rejets    = 0;
+  _Erreur       = OTA_ERREUR_AUCUNE;
+  _Debut_ms     = millis();
+  _Duree_ms     = 0;
+
+  if (_Cible == NULL || !_Cible_Session->begin(taille, _MD5))
+  {
+    echec(OTA_ERREUR_DEBUT);
+    return false;
+  }
+
+  _Statut = OTA_EN_COURS;
+  return true;
+}
+
+/*===============================================================================
+  Nom 			: write
+
+  Description	: Traite un bloc reçu : vérification du CRC et de l'index,
+                puis écriture en flash. Seul le bloc attendu est écrit : un
+                bloc faux ou manquant demande au serveur de reprendre à
+                l'index attendu.
+
+  Paramètre(s) 	: trame, taille : bloc reçu (trame binaire)
+
+  Retour		: action à effectuer (voir Resultat_Bloc_OTA)
+===============================================================================*/
+Resultat_Bloc_OTA Domokit_OTA::write(const uint8_t* trame, size_t taille)
+{
+  Trame_BlocOTA bloc;
+
+  if (_Statut != OTA_EN_COURS)
+    return OTA_BLOC_ERREUR;
+
+  // Bloc faux ou trop grand : renvoi demandé
+  if (!Protocole_DecodeBlocOTA(trame, taille, &bloc) || bloc.taille > OTA_TAILLE_BLOC)
+  {
+    _Nb_Rejets++;
+    return OTA_BLOC_ACQUITTER;
+  }
+
+  // Bloc déjà écrit (renvoi par le serveur)
+  if ((int16_t)(bloc.index - _Bloc_Attendu) < 0)
+    return OTA_BLOC_IGNORE;
+
+  // Bloc manquant : le serveur doit reprendre au bloc attendu
+  if (bloc.index != _Bloc_Attendu)
+  {
+    _Nb_Rejets++;
+    return OTA_BLOC_ACQUITTER;
+  }
+
+  if (_Recu + bloc.taille > _Taille)
+  {
+    echec(OTA_ERREUR_TAILLE);
+    return OTA_BLOC_ERREUR;
+  }
+
+  if (_Cible_Session->write(bloc.donnees, bloc.taille) != bloc.taille)
+  {
+    echec(OTA_ERREUR_ECRITURE);
+    return OTA_BLOC_ERREUR;
+  }
+
+  _Recu += bloc.taille;
+  _Bloc_Attendu++;
+
+  // Fenêtre de contrôle de flux
+  if (_Recu == _Taille || (_Bloc_Attendu % OTA_FENETRE) == 0)
+    return OTA_BLOC_ACQUITTER;
+  return OTA_BLOC_ACCEPTE;
+}
+
+/*===============================================================================
+  Nom 			: end
+
+  Description	: Termine la mise à jour : l'image doit être complète et son
+                MD5 correct pour être activée au prochain démarrage
+
+  Retour		: true si l'image est valide
+===============================================================================*/
+bool Domokit_OTA::end()
+{
+  if (_Statut != OTA_EN_COURS)
+  {
+    if (_Statut != OTA_ECHEC) _Erreur = OTA_ERREUR_INACTIF;
+    return _Statut == OTA_TERMINE;
+  }
+
+  if (_Recu != _Taille || !_Cible_Session->end())
+  {
+    echec(OTA_ERREUR_VERIFICATION);
+    return false;
+  }
+
+  _Statut   = OTA_TERMINE;
+  _Duree_ms = millis() - _Debut_ms;
+  return true;
+}
+
+// Abandonne la mise à jour en cours (l'image reçue n'est pas activée)
+void Domokit_OTA::abort()
+{
+  if (_Statut == OTA_EN_COURS && _Cible_Session != NULL)
+    _Cible_Session->abort();
+  _Statut = OTA_INACTIF;
+}
+
+void Domokit_OTA::echec(Erreur_OTA erreur)
+{
+  if (_Statut == OTA_EN_COURS && _Cible_Session != NULL)
+    _Cible_Session->abort();
+  _Statut   = OTA_ECHEC;
+  _Erreur   = erreur;
+  _Duree_ms = millis() - _Debut_ms;
+}
+
+// ################################################################################
+// 									Getters
+// ################################################################################
+Statut_OTA Domokit_OTA::getStatut()
+{
+  return _Statut;
+}
+
+Erreur_OTA Domokit_OTA::getErreur()
+{
+  return _Erreur;
+}
+
+uint16_t Domokit_OTA::getBlocAttendu()
+{
+  return _Bloc_Attendu;
+}
+
+uint32_t Domokit_OTA::getRecu()
+{
+  return _Recu;
+}
+
+uint32_t Domokit_OTA::getTaille()
+{
+  return _Taille;
+}
+
+unsigned long Domokit_OTA::getDuree()
+{
+  return (_Statut == OTA_EN_COURS) ? millis() - _Debut_ms : _Duree_ms;
+}
+
+unsigned long Domokit_OTA::getNbRejets()
+{
+  return _Nb_Rejets;
+}
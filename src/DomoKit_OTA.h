@@ -0,0 +1,233 @@
+/*
+ *  =============================================================================================================================================
+ *  Titre : DomoKit_OTA.h
+ *  Auteur : Thomas Broussard
+ *  ---------------------------------------------------------------------------------------------------------------------------------------------
+ *  Description :
+ *  Mise à jour du firmware par MQTT (OTA).
+ *  L'image est envoyée par blocs (trames binaires, voir DomoKit_Protocole.h)
+ *  qui sont écrits directement dans la zone flash de la nouvelle application :
+ *  l'image n'est jamais stockée entièrement en RAM.
+ *
+ *  Déroulement (topics : voir Domokit::Create_Topics) :
+ *  1. serveur -> objet : OTA;taille;md5             (topic_instruction)
+ *     objet -> serveur : PRET;index attendu;taille max d'un bloc   (topic_ota)
+ *  2. serveur -> objet : blocs [index][crc32][données]   (<MAIN_TOPIC>/instruction/ota/<@mac>)
+ *     objet -> serveur : ACK;index attendu, tous les OTA_FENETRE blocs,
+ *                        sur le dernier bloc, et sur un bloc faux ou manquant.
+ *     Le serveur n'envoie pas plus de OTA_FENETRE blocs non acquittés, et
+ *     reprend à l'index indiqué par le dernier ACK.
+ *  3. serveur -> objet : OTA_FIN : vérification MD5 de l'image complète
+ *     objet -> serveur : OK (redémarrage sur la nouvelle image) ou ERREUR;code
+ *
+ *  Reprise : si la connexion est perdue, le serveur renvoie OTA;taille;md5
+ *  avec la même image ; l'objet répond PRET avec l'index du prochain bloc.
+ *
+ *  Mise à jour différentielle (OTA;taille;md5;DELTA) : les blocs contiennent
+ *  un delta par rapport à l'image en cours d'exécution (taille = taille du
+ *  delta, md5 = MD5 de la nouvelle image). Le delta est décodé au fil des
+ *  blocs, en lisant l'ancienne image en flash, avec une RAM bornée :
+ *    en-tête   : "DKD1" | taille ancienne image (4) | taille nouvelle image (4)
+ *    commandes : diff (4) | extra (4) | saut (4, signé)
+ *                puis diff octets ajoutés à l'ancienne image (un 0x00 suivi
+ *                de n code n+1 octets identiques), puis extra octets copiés
+ *                tels quels ; enfin la position dans l'ancienne image avance
+ *                du saut.
+ *  Les entiers sont en big-endian. L'ancienne image est lue telle qu'elle est
+ *  en flash : le delta doit être calculé à partir de l'image relue sur l'objet.
+ * =============================================================================================================================================
+ */
+
+#ifndef __DOMOKIT_OTA_H__
+#define __DOMOKIT_OTA_H__
+
+// ################################################################################
+// 									Librairies
+// ################################################################################
+  #include "Arduino.h"
+  #include "DomoKit_Protocole.h"
+
+// ################################################################################
+// 				Defines , définition et variables globales
+// ################################################################################
+#ifndef OTA_TAILLE_BLOC
+  #define OTA_TAILLE_BLOC           128   // taille max des données d'un bloc (buffer MQTT du transport)
+#endif
+  #define OTA_FENETRE               4     // nombre max de blocs envoyés sans acquittement
+  #define OTA_DELAI_REDEMARRAGE_MS  1000  // délai entre la réponse OK et le redémarrage
+
+  // Mise à jour différentielle
+  #define OTA_DELTA_MAGIC           "DKD1"
+  #define OTA_DELTA_TAILLE_ENTETE   12
+  #define OTA_DELTA_TAILLE_COMMANDE 12
+  #define OTA_DELTA_TAILLE_CACHE    64    // lecture de l'ancienne image (multiple de 4, puissance de 2)
+  #define OTA_DELTA_TAILLE_SORTIE   64    // écriture de la nouvelle image
+
+  #if (OTA_DELTA_TAILLE_CACHE & (OTA_DELTA_TAILLE_CACHE - 1)) != 0
+    #error "OTA_DELTA_TAILLE_CACHE doit être une puissance de 2"
+  #endif
+
+// Etat de la mise à jour
+typedef enum {OTA_INACTIF, OTA_EN_COURS, OTA_TERMINE, OTA_ECHEC} Statut_OTA;
+
+// Codes d'erreur (réponse ERREUR;code)
+typedef enum
+{
+  OTA_ERREUR_AUCUNE,
+  OTA_ERREUR_DEBUT,         // zone flash indisponible (image trop grande...)
+  OTA_ERREUR_ECRITURE,      // écriture flash impossible
+  OTA_ERREUR_TAILLE,        // plus de données que la taille annoncée
+  OTA_ERREUR_VERIFICATION,  // image incomplète, delta invalide ou MD5 faux
+  OTA_ERREUR_INACTIF        // aucune mise à jour en cours
+} Erreur_OTA;
+
+// Traitement d'un bloc reçu
+typedef enum
+{
+  OTA_BLOC_ACCEPTE,   // bloc écrit
+  OTA_BLOC_ACQUITTER, // bloc écrit ou rejeté : envoyer ACK;index attendu
+  OTA_BLOC_IGNORE,    // bloc déjà reçu
+  OTA_BLOC_ERREUR     // mise à jour en échec
+} Resultat_Bloc_OTA;
+
+// ################################################################################
+// 									Classes
+// ################################################################################
+
+// --------------------------------------------------------------------------------
+// Destination de l'image. La cible par défaut utilise l'Updater de l'ESP8266 ;
+// une autre cible (ex : flash simulée) peut être fournie par Domokit::setOTATarget
+// --------------------------------------------------------------------------------
+class Domokit_OTA_Cible
+{
+  public:
+    virtual ~Domokit_OTA_Cible() {}
+
+    virtual bool   begin(uint32_t taille, const char* md5) = 0;
+    virtual size_t write(const uint8_t* donnees, size_t taille) = 0;
+    virtual bool   end() = 0;   // vérifie l'image et l'active au prochain démarrage
+    virtual void   abort() = 0;
+};
+
+class OTA_Cible_Update : public Domokit_OTA_Cible
+{
+  public:
+    bool   begin(uint32_t taille, const char* md5);
+    size_t write(const uint8_t* donnees, size_t taille);
+    bool   end();
+    void   abort();
+};
+
+// --------------------------------------------------------------------------------
+// Image en cours d'exécution (référence des mises à jour différentielles).
+// La source par défaut lit le sketch en flash ; une autre source peut être
+// fournie par Domokit::setOTASource
+// --------------------------------------------------------------------------------
+class Domokit_OTA_Source
+{
+  public:
+    virtual ~Domokit_OTA_Source() {}
+
+    virtual bool     read(uint32_t adresse, uint32_t* dest, size_t taille) = 0; // adresse et taille multiples de 4
+    virtual uint32_t size() = 0;
+};
+
+class OTA_Source_Flash : public Domokit_OTA_Source
+{
+  public:
+    bool     read(uint32_t adresse, uint32_t* dest, size_t taille);
+    uint32_t size();
+};
+
+// --------------------------------------------------------------------------------
+// Décodeur de delta : reçoit le delta, écrit la nouvelle image dans la cible
+// --------------------------------------------------------------------------------
+typedef enum {DELTA_ENTETE, DELTA_COMMANDE, DELTA_DIFF, DELTA_EXTRA, DELTA_FIN} Etat_Delta;
+
+class OTA_Cible_Delta : public Domokit_OTA_Cible
+{
+  public:
+    OTA_Cible_Delta();
+
+    void setDestination(Domokit_OTA_Cible* destination);
+    void setSource(Domokit_OTA_Source* source);
+
+    bool   begin(uint32_t taille, const char* md5);
+    size_t write(const uint8_t* donnees, size_t taille);
+    bool   end();
+    void   abort();
+
+  private:
+    bool decoder(uint8_t octet);
+    bool suivant();
+    bool lireAncien(uint8_t* octet);
+    bool emettre(uint8_t octet);
+    bool vider();
+
+    Domokit_OTA_Cible*  _Destination;
+    Domokit_OTA_Source* _Source;
+    bool       _Demarre;          // destination ouverte (en-tête reçu)
+    char       _MD5[33];
+    Etat_Delta _Etat;
+    bool       _Zeros;            // 0x00 reçu : le prochain octet est une longueur
+    uint8_t    _Entete[OTA_DELTA_TAILLE_COMMANDE];
+    uint8_t    _Nb_Entete;
+
+    uint32_t   _Taille_Ancienne;
+    uint32_t   _Taille_Nouvelle;
+    uint32_t   _Produit;          // octets de la nouvelle image produits
+    uint32_t   _Position;         // position dans l'ancienne image
+    uint32_t   _Reste_Diff;
+    uint32_t   _Reste_Extra;
+    int32_t    _Saut;
+
+    uint32_t   _Cache[OTA_DELTA_TAILLE_CACHE / 4];
+    uint32_t   _Base_Cache;
+    bool       _Cache_Valide;
+    uint8_t    _Sortie[OTA_DELTA_TAILLE_SORTIE];
+    uint8_t    _Nb_Sortie;
+};
+
+// --------------------------------------------------------------------------------
+// Session de mise à jour
+// --------------------------------------------------------------------------------
+class Domokit_OTA
+{
+  public:
+    Domokit_OTA();
+
+    void setCible(Domokit_OTA_Cible* cible);
+    void setSource(Domokit_OTA_Source* source);
+
+    bool begin(uint32_t taille, Protocole_Vue md5, bool delta);
+    Resultat_Bloc_OTA write(const uint8_t* trame, size_t taille);
+    bool end();
+    void abort();
+
+    Statut_OTA    getStatut();
+    Erreur_OTA    getErreur();
+    uint16_t      getBlocAttendu();
+    uint32_t      getRecu();
+    uint32_t      getTaille();
+    unsigned long getDuree();     // ms depuis begin (jusqu'à end une fois terminée)
+    unsigned long getNbRejets();  // blocs faux (CRC) ou hors séquence
+
+  private:
+    void echec(Erreur_OTA erreur);
+
+    Domokit_OTA_Cible* _Cible;          // destination de l'image
+    Domokit_OTA_Cible* _Cible_Session;  // _Cible, ou _Delta pour une mise à jour différentielle
+    OTA_Cible_Delta    _Delta;
+    bool          _Session_Delta;
+    Statut_OTA    _Statut;
+    Erreur_OTA    _Erreur;
+    char          _MD5[33];
+    uint32_t      _Taille;
+    uint32_t      _Recu;
+    uint16_t      _Bloc_Attendu;
+    unsigned long _Debut_ms;
+    unsigned long _Duree_ms;
+    unsigned long _Nb_Rejets;
+};
+
+#endif
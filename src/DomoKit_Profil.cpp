@@ -0,0 +1,205 @@
+/*
+ *  =============================================================================================================================================
+ *  Titre : DomoKit_Profil.cpp
+ *  Auteur : Thomas Broussard
+ *  ---------------------------------------------------------------------------------------------------------------------------------------------
+ *  Description :
+ *  Profilage des blocages de la boucle principale (durée max et p99 par site)
+ * =============================================================================================================================================
+ */
+
+#include "DomoKit.h"
+
+#ifdef DOMOKIT_PROFIL
+Domokit_Profil profil_domokit;
+#endif
+
+// ################################################################################
+// 									Constructeur
+// ################################################################################
+Domokit_Profil::Domokit_Profil()
+{
+  _Nb_Sites = 0;
+  _Budget_us = PROFIL_BUDGET_US;
+  memset(_Sites, 0, sizeof(_Sites));
+}
+
+// Remet les statistiques à zéro (les sites sont conservés)
+void Domokit_Profil::reset()
+{
+  for (uint8_t i = 0; i < _Nb_Sites; i++)
+  {
+    const char* nom = _Sites[i].nom;
+    memset(&_Sites[i], 0, sizeof(Profil_Site));
+    _Sites[i].nom = nom;
+  }
+}
+
+int8_t Domokit_Profil::registerSite(const char* nom)
+{
+  for (uint8_t i = 0; i < _Nb_Sites; i++)
+  {
+    if (_Sites[i].nom == nom || strcmp(_Sites[i].nom, nom) == 0)
+      return i;
+  }
+
+  if (_Nb_Sites >= PROFIL_NB_SITES)
+  {
+    DEBUG_PRINT("Profil : table des sites pleine : "); DEBUG_PRINTLN(nom);
+    return PROFIL_AUCUN_SITE;
+  }
+
+  _Sites[_Nb_Sites].nom = nom;
+  return _Nb_Sites++;
+}
+
+// ################################################################################
+// 									Mesures
+// ################################################################################
+
+void Domokit_Profil::record(int8_t site, uint32_t duree_us)
+{
+  if (site < 0 || site >= _Nb_Sites)
+    return;
+
+  Profil_Site* s = &_Sites[site];
+  uint8_t classe = 0;
+
+  // Classe : position du bit de poids fort
+  for (uint32_t d = duree_us >> 1; d > 0 && classe < PROFIL_NB_CLASSES - 1; d >>= 1)
+    classe++;
+
+  // Compteur saturé : l'histogramme est divisé par deux (répartition conservée)
+  if (s->classes[classe] == 0xFFFF)
+  {
+    for (uint8_t k = 0; k < PROFIL_NB_CLASSES; k++)
+      s->classes[k] /= 2;
+  }
+  s->classes[classe]++;
+
+  s->nb_appels++;
+  if (duree_us > s->duree_max_us)
+    s->duree_max_us = duree_us;
+
+  if (duree_us > _Budget_us)
+  {
+    s->nb_depassements++;
+    s->dernier_depassement_us = duree_us;
+  }
+}
+
+void Domokit_Profil::setBudget(uint32_t budget_us)
+{
+  _Budget_us = budget_us;
+}
+
+uint32_t Domokit_Profil::getBudget()
+{
+  return _Budget_us;
+}
+
+// ################################################################################
+// 									Getters
+// ################################################################################
+
+uint8_t Domokit_Profil::getNbSites()
+{
+  return _Nb_Sites;
+}
+
+const Profil_Site* Domokit_Profil::getSite(int8_t site)
+{
+  return (site >= 0 && site < _Nb_Sites) ? &_Sites[site] : NULL;
+}
+
+/*===============================================================================
+  Nom 			: getPercentile
+
+  Description	: Durée sous laquelle se trouvent pourcentage % des appels du site
+
+  Paramètre(s) 	: site : site mesuré
+                  pourcentage : ex 99
+
+  Retour		: borne haute de la classe correspondante (µs), limitée à la
+                durée max ; 0 si aucun appel
+===============================================================================*/
+uint32_t Domokit_Profil::getPercentile(int8_t site, uint8_t pourcentage)
+{
+  const Profil_Site* s = getSite(site);
+  uint32_t total = 0;
+  uint32_t cumul = 0;
+
+  if (s == NULL)
+    return 0;
+
+  for (uint8_t k = 0; k < PROFIL_NB_CLASSES; k++)
+    total += s->classes[k];
+  if (total == 0)
+    return 0;
+
+  uint32_t rang = (total * pourcentage + 99) / 100;
+  for (uint8_t k = 0; k < PROFIL_NB_CLASSES; k++)
+  {
+    cumul += s->classes[k];
+    if (cumul >= rang)
+    {
+      uint32_t borne = (k < 31) ? (2UL << k) - 1 : 0xFFFFFFFF;
+      return (borne < s->duree_max_us) ? borne : s->duree_max_us;
+    }
+  }
+  return s->duree_max_us;
+}
+
+bool Domokit_Profil::nextOverrun(int8_t* site)
+{
+  for (int8_t i = (*site < 0) ? 0 : *site; i < _Nb_Sites; i++)
+  {
+    if (_Sites[i].nb_depassements != _Sites[i].nb_signales)
+    {
+      _Sites[i].nb_signales = _Sites[i].nb_depassements;
+      *site = i;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Affiche la table des sites : appels, durée max, p99 et dépassements
+void Domokit_Profil::print(Print& sortie)
+{
+  sortie.print("Profil (budget ");  sortie.print(_Budget_us);  sortie.println(" µs)");
+  sortie.println("  site\t\tappels\tmax (µs)\tp99 (µs)\tdépassements");
+  for (uint8_t i = 0; i < _Nb_Sites; i++)
+  {
+    sortie.print("  ");   sortie.print(_Sites[i].nom);           sortie.print("\t\t");
+    sortie.print(_Sites[i].nb_appels);                          sortie.print("\t");
+    sortie.print(_Sites[i].duree_max_us);                       sortie.print("\t\t");
+    sortie.print(getPercentile(i, 99));                         sortie.print("\t\t");
+    sortie.println(_Sites[i].nb_depassements);
+  }
+}
+
+// ################################################################################
+// 									Portée
+// ################################################################################
+
+Profil_Portee::Profil_Portee(int8_t site)
+{
+  _Site = site;
+  _Debut_ms = millis();
+  _Debut_cycles = ESP.getCycleCount();
+}
+
+Profil_Portee::~Profil_Portee()
+{
+#ifdef DOMOKIT_PROFIL
+  uint32_t cycles = ESP.getCycleCount() - _Debut_cycles;
+  unsigned long duree_ms = millis() - _Debut_ms;
+
+  // Le compteur de cycles (32 bits) déborde en quelques dizaines de secondes
+  if (duree_ms >= PROFIL_DUREE_CYCLES_MS)
+    profil_domokit.record(_Site, duree_ms * 1000);
+  else
+    profil_domokit.record(_Site, cycles / ESP.getCpuFreqMHz());
+#endif
+}
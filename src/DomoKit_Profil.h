@@ -0,0 +1,126 @@
+/*
+ *  =============================================================================================================================================
+ *  Titre : DomoKit_Profil.h
+ *  Auteur : Thomas Broussard
+ *  ---------------------------------------------------------------------------------------------------------------------------------------------
+ *  Description :
+ *  Profilage des blocages de la boucle principale.
+ *
+ *  PROFIL_PORTEE("nom") mesure la durée du bloc qui la contient (compteur de
+ *  cycles du CPU) et l'attribue au site "nom". La librairie mesure ses points
+ *  d'entrée (poll, réception MQTT, tâches de l'ordonnanceur, connexions,
+ *  déclaration des tiles...) et les fonctions de l'application qu'elle
+ *  appelle (init_Tile, callBack_Tile) ; l'application peut mesurer ses
+ *  propres blocs avec la même macro. Les mesures imbriquées sont attribuées
+ *  à chaque site (poll contient les tâches qu'il exécute).
+ *
+ *  Chaque site conserve, dans une table de taille fixe, le nombre d'appels,
+ *  la durée max et un histogramme par puissances de 2 (d'où le p99, à un
+ *  facteur 2 près). Un appel plus long que le budget (PROFIL_BUDGET_US,
+ *  modifiable par setBudget) est compté comme dépassement ; les sites en
+ *  dépassement sont signalés par Domokit (topic_metriques et Serial).
+ *
+ *  Désactivé par défaut : les macros ne génèrent aucun code.
+ * =============================================================================================================================================
+ */
+
+#ifndef __DOMOKIT_PROFIL_H__
+#define __DOMOKIT_PROFIL_H__
+
+// ################################################################################
+// 									Configuration
+// ################################################################################
+// Active le profilage (décommenter)
+//#define DOMOKIT_PROFIL
+
+// ################################################################################
+// 									Librairies
+// ################################################################################
+  #include "Arduino.h"
+
+// ################################################################################
+// 				Defines , définition et variables globales
+// ################################################################################
+  #define PROFIL_NB_SITES           32
+  #define PROFIL_NB_CLASSES         24      // classe k : durées de 2^k à 2^(k+1) - 1 µs
+  #define PROFIL_BUDGET_US          20000   // durée max d'un appel avant dépassement
+  #define PROFIL_PERIODE_RAPPORT_MS 5000    // signalement des dépassements
+  #define PROFIL_DUREE_CYCLES_MS    20000   // au-delà, durée mesurée avec millis() (débordement du compteur de cycles)
+  #define PROFIL_AUCUN_SITE         -1
+
+// Statistiques d'un site
+typedef struct
+{
+  const char* nom;
+  uint32_t    nb_appels;
+  uint32_t    duree_max_us;
+  uint32_t    nb_depassements;
+  uint32_t    nb_signales;            // dépassements déjà signalés
+  uint32_t    dernier_depassement_us;
+  uint16_t    classes[PROFIL_NB_CLASSES];
+} Profil_Site;
+
+// ################################################################################
+// 									Classes
+// ################################################################################
+class Domokit_Profil
+{
+  public:
+    Domokit_Profil();
+
+    // Site associé au nom (créé au premier appel), PROFIL_AUCUN_SITE si la table est pleine
+    int8_t   registerSite(const char* nom);
+    void     record(int8_t site, uint32_t duree_us);
+    void     reset();
+
+    void     setBudget(uint32_t budget_us);
+    uint32_t getBudget();
+
+    uint8_t  getNbSites();
+    const Profil_Site* getSite(int8_t site);
+    uint32_t getPercentile(int8_t site, uint8_t pourcentage);   // µs (borne haute de la classe)
+
+    // Site ayant des dépassements non signalés (à partir de *site), marqué comme signalé
+    bool     nextOverrun(int8_t* site);
+
+    void     print(Print& sortie);
+
+  private:
+    Profil_Site _Sites[PROFIL_NB_SITES];
+    uint8_t     _Nb_Sites;
+    uint32_t    _Budget_us;
+};
+
+// Mesure de la portée courante (durée enregistrée à la destruction)
+class Profil_Portee
+{
+  public:
+    Profil_Portee(int8_t site);
+    ~Profil_Portee();
+
+  private:
+    int8_t        _Site;
+    uint32_t      _Debut_cycles;
+    unsigned long _Debut_ms;
+};
+
+#ifdef DOMOKIT_PROFIL
+  extern Domokit_Profil profil_domokit;
+
+  #define PROFIL_CONCAT_(a, b)  a##b
+  #define PROFIL_CONCAT(a, b)   PROFIL_CONCAT_(a, b)
+
+  // Site résolu une seule fois (nom constant)
+  #define PROFIL_PORTEE(nom) \
+    static int8_t PROFIL_CONCAT(_profil_site_, __LINE__) = profil_domokit.registerSite(nom); \
+    Profil_Portee PROFIL_CONCAT(_profil_portee_, __LINE__)(PROFIL_CONCAT(_profil_site_, __LINE__))
+
+  // Site déjà résolu (ex : site d'une tâche de l'ordonnanceur)
+  #define PROFIL_PORTEE_SITE(site) \
+    Profil_Portee PROFIL_CONCAT(_profil_portee_, __LINE__)(site)
+#else
+  #define PROFIL_PORTEE(nom)
+  #define PROFIL_PORTEE_SITE(site)
+#endif
+
+#endif
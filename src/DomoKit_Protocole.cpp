@@ -0,0 +1,837 @@
+/*
+ *  =============================================================================================================================================
+ *  Titre : DomoKit_Protocole.cpp
+ *  Auteur : Thomas Broussard
+ *  ---------------------------------------------------------------------------------------------------------------------------------------------
+ *  Description :
+ *  Codec du protocole Domokit (indépendant de la plateforme)
+ * =============================================================================================================================================
+ */
+
+#include "DomoKit_Protocole.h"
+
+// ################################################################################
+// 									Fonctions internes
+// ################################################################################
+
+// Ajoute une chaîne au buffer. Renvoie la nouvelle position, ou taille si débordement
+static size_t Ajouter(char* buffer, size_t taille, size_t position, const char* str)
+{
+  while (*str != '\0')
+  {
+    if (position + 1 >= taille)
+      return taille;
+    buffer[position++] = *str++;
+  }
+  return position;
+}
+
+static size_t AjouterCaractere(char* buffer, size_t taille, size_t position, char c)
+{
+  if (position + 1 >= taille)
+    return taille;
+  buffer[position++] = c;
+  return position;
+}
+
+static size_t AjouterEntier(char* buffer, size_t taille, size_t position, int32_t valeur)
+{
+  char     chiffres[12];
+  uint8_t  n = 0;
+  uint32_t absolu = (valeur < 0) ? (uint32_t)(-(valeur + 1)) + 1 : (uint32_t)valeur;
+
+  if (valeur < 0)
+    position = AjouterCaractere(buffer, taille, position, '-');
+
+  do
+  {
+    chiffres[n++] = '0' + (absolu % 10);
+    absolu /= 10;
+  } while (absolu > 0);
+
+  while (n > 0 && position < taille)
+    position = AjouterCaractere(buffer, taille, position, chiffres[--n]);
+  return position;
+}
+
+// Entier 64 bits (dates en ms) : division 64 bits réservée à ces champs
+static size_t AjouterEntier64(char* buffer, size_t taille, size_t position, int64_t valeur)
+{
+  char     chiffres[21];
+  uint8_t  n = 0;
+  uint64_t absolu = (valeur < 0) ? (uint64_t)(-(valeur + 1)) + 1 : (uint64_t)valeur;
+
+  if (valeur < 0)
+    position = AjouterCaractere(buffer, taille, position, '-');
+
+  do
+  {
+    chiffres[n++] = '0' + (absolu % 10);
+    absolu /= 10;
+  } while (absolu > 0);
+
+  while (n > 0 && position < taille)
+    position = AjouterCaractere(buffer, taille, position, chiffres[--n]);
+  return position;
+}
+
+// Termine la trame. Renvoie sa taille, 0 en cas de débordement
+static size_t Terminer(char* buffer, size_t taille, size_t position)
+{
+  if (taille == 0 || position >= taille)
+    return 0;
+  buffer[position] = '\0';
+  return position;
+}
+
+// Vrai si la trame commence par le mot-clé, suivi de la fin de trame ou d'un séparateur
+static bool MotCle(const char* trame, size_t taille, const char* mot)
+{
+  size_t n = strlen(mot);
+  if (taille < n || memcmp(trame, mot, n) != 0)
+    return false;
+  return (taille == n) || (trame[n] == PROTOCOLE_SEPARATEUR);
+}
+
+// ################################################################################
+// 									CRC32
+// ################################################################################
+
+// Table réduite (4 bits) : 64 octets au lieu de 1 Ko
+static const uint32_t CRC32_Table[16] =
+{
+  0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+  0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+uint32_t Protocole_CRC32(uint32_t crc, const uint8_t* donnees, size_t taille)
+{
+  crc = ~crc;
+  for (size_t i = 0; i < taille; i++)
+  {
+    crc = CRC32_Table[(crc ^ donnees[i]) & 0x0F] ^ (crc >> 4);
+    crc = CRC32_Table[(crc ^ (donnees[i] >> 4)) & 0x0F] ^ (crc >> 4);
+  }
+  return ~crc;
+}
+
+// ################################################################################
+// 									Vues
+// ################################################################################
+
+// Compare une vue à une chaîne terminée par '\0'
+bool Protocole_VueEgale(Protocole_Vue vue, const char* str)
+{
+  return strlen(str) == vue.len && memcmp(vue.ptr, str, vue.len) == 0;
+}
+
+// Convertit une vue en entier (defaut si la vue n'est pas un entier valide ou hors limites)
+int32_t Protocole_VueToInt(Protocole_Vue vue, int32_t defaut)
+{
+  size_t  i = 0;
+  bool    negatif = false;
+  int64_t valeur = 0;
+
+  if (vue.len == 0)
+    return defaut;
+
+  if (vue.ptr[0] == '-' || vue.ptr[0] == '+')
+  {
+    negatif = (vue.ptr[0] == '-');
+    i = 1;
+    if (vue.len == 1)
+      return defaut;
+  }
+
+  for (; i < vue.len; i++)
+  {
+    char c = vue.ptr[i];
+    if (c < '0' || c > '9')
+      return defaut;
+    valeur = valeur * 10 + (c - '0');
+    if (valeur > INT32_MAX)
+      return defaut;
+  }
+  return (int32_t)(negatif ? -valeur : valeur);
+}
+
+int64_t Protocole_VueToInt64(Protocole_Vue vue, int64_t defaut)
+{
+  size_t  i = 0;
+  bool    negatif = false;
+  int64_t valeur = 0;
+
+  if (vue.len == 0 || vue.len > 20)
+    return defaut;
+
+  if (vue.ptr[0] == '-' || vue.ptr[0] == '+')
+  {
+    negatif = (vue.ptr[0] == '-');
+    i = 1;
+    if (vue.len == 1)
+      return defaut;
+  }
+
+  for (; i < vue.len; i++)
+  {
+    char c = vue.ptr[i];
+    if (c < '0' || c > '9' || valeur > (INT64_MAX - (c - '0')) / 10)
+      return defaut;
+    valeur = valeur * 10 + (c - '0');
+  }
+  return negatif ? -valeur : valeur;
+}
+
+// Copie une vue dans un buffer terminé par '\0' (tronquée si nécessaire)
+size_t Protocole_VueCopy(Protocole_Vue vue, char* dest, size_t taille_dest)
+{
+  size_t n = vue.len;
+
+  if (taille_dest == 0)
+    return 0;
+  if (n >= taille_dest)
+    n = taille_dest - 1;
+
+  memcpy(dest, vue.ptr, n);
+  dest[n] = '\0';
+  return n;
+}
+
+/*===============================================================================
+  Nom 			: Protocole_Split
+
+  Description	: Découpe une trame selon PROTOCOLE_SEPARATEUR, sans copie.
+                Le dernier champ demandé contient le reste de la trame.
+
+  Paramètre(s) 	: trame, taille : trame à découper
+                  champs : tableau de vues à remplir
+                  nb_max : nombre max de champs
+
+  Retour		: nombre de champs trouvés
+===============================================================================*/
+size_t Protocole_Split(const char* trame, size_t taille, Protocole_Vue* champs, size_t nb_max)
+{
+  size_t nb = 0;
+  size_t debut = 0;
+
+  if (nb_max == 0)
+    return 0;
+
+  for (size_t i = 0; i < taille && nb + 1 < nb_max; i++)
+  {
+    if (trame[i] == PROTOCOLE_SEPARATEUR)
+    {
+      champs[nb].ptr = trame + debut;
+      champs[nb].len = i - debut;
+      nb++;
+      debut = i + 1;
+    }
+  }
+
+  champs[nb].ptr = trame + debut;
+  champs[nb].len = taille - debut;
+  return nb + 1;
+}
+
+// ################################################################################
+// 									Décodage
+// ################################################################################
+
+// Identifie l'instruction envoyée par le serveur sur topic_instruction
+Protocole_Instruction Protocole_DecodeInstruction(const char* trame, size_t taille)
+{
+  if (taille == 0)
+    return INSTRUCTION_INCONNUE;
+
+  switch (trame[0])
+  {
+    case 'S' :
+      if (MotCle(trame, taille, PROTOCOLE_START) && taille == 5) return INSTRUCTION_START;
+      if (MotCle(trame, taille, PROTOCOLE_STOP)  && taille == 4) return INSTRUCTION_STOP;
+      if (MotCle(trame, taille, PROTOCOLE_SNAPSHOT) && taille == 8) return INSTRUCTION_SNAPSHOT;
+    break;
+
+    case 'C' :
+      if (MotCle(trame, taille, PROTOCOLE_CONNECT) && taille == 7) return INSTRUCTION_CONNECT;
+    break;
+
+    case 'W' :
+      if (MotCle(trame, taille, PROTOCOLE_WIFI_DATA)) return INSTRUCTION_WIFI_DATA;
+    break;
+
+    case 'A' :
+      if (MotCle(trame, taille, PROTOCOLE_ALIAS)) return INSTRUCTION_ALIAS;
+      if (MotCle(trame, taille, PROTOCOLE_ATTENTE)) return INSTRUCTION_ATTENTE;
+    break;
+
+    case 'O' :
+      if (MotCle(trame, taille, PROTOCOLE_OTA)) return INSTRUCTION_OTA;
+      if (MotCle(trame, taille, PROTOCOLE_OTA_FIN) && taille == 7) return INSTRUCTION_OTA_FIN;
+      if (MotCle(trame, taille, PROTOCOLE_OTA_ANNULE) && taille == 10) return INSTRUCTION_OTA_ANNULE;
+    break;
+
+    case 'R' :
+      if (MotCle(trame, taille, PROTOCOLE_REGLES)) return INSTRUCTION_REGLES;
+    break;
+
+    case 'H' :
+      if (MotCle(trame, taille, PROTOCOLE_HEURE)) return INSTRUCTION_HEURE;
+    break;
+  }
+  return INSTRUCTION_INCONNUE;
+}
+
+// connexion : mac;nom_client[;ALIAS]
+bool Protocole_DecodeConnexion(const char* trame, size_t taille, Trame_Connexion* sortie)
+{
+  Protocole_Vue champs[3];
+  size_t nb = Protocole_Split(trame, taille, champs, 3);
+
+  if (nb < 2 || champs[0].len == 0)
+    return false;
+
+  sortie->mac        = champs[0];
+  sortie->nom_client = champs[1];
+  sortie->alias      = (nb == 3) && Protocole_VueEgale(champs[2], PROTOCOLE_ALIAS);
+  return true;
+}
+
+// présence : EN_LIGNE;mac;nom_client[;ALIAS] | HORS_LIGNE
+// (les champs de connexion ne sont renseignés que pour EN_LIGNE)
+bool Protocole_DecodePresence(const char* trame, size_t taille, bool* en_ligne, Trame_Connexion* sortie)
+{
+  Protocole_Vue champs[2];
+  size_t nb = Protocole_Split(trame, taille, champs, 2);
+
+  if (nb == 1 && Protocole_VueEgale(champs[0], PROTOCOLE_HORS_LIGNE))
+  {
+    *en_ligne = false;
+    return true;
+  }
+
+  if (nb != 2 || !Protocole_VueEgale(champs[0], PROTOCOLE_EN_LIGNE))
+    return false;
+
+  *en_ligne = true;
+  return Protocole_DecodeConnexion(champs[1].ptr, champs[1].len, sortie);
+}
+
+// set_tile : id;attribut;valeur
+bool Protocole_DecodeSetTile(const char* trame, size_t taille, Trame_SetTile* sortie)
+{
+  Protocole_Vue champs[3];
+
+  if (Protocole_Split(trame, taille, champs, 3) != 3)
+    return false;
+
+  sortie->id = Protocole_VueToInt(champs[0], -1);
+  if (sortie->id < 0 || champs[1].len == 0)
+    return false;
+
+  sortie->attribut = champs[1];
+  sortie->valeur   = champs[2];
+  return true;
+}
+
+// WIFI_DATA;ssid;password[;clef]
+bool Protocole_DecodeWifiData(const char* trame, size_t taille, Trame_WifiData* sortie)
+{
+  Protocole_Vue champs[4];
+  size_t nb = Protocole_Split(trame, taille, champs, 4);
+
+  if (nb < 3 || !Protocole_VueEgale(champs[0], PROTOCOLE_WIFI_DATA))
+    return false;
+
+  sortie->ssid     = champs[1];
+  sortie->password = champs[2];
+  if (nb == 4)
+    sortie->clef = champs[3];
+  else
+  {
+    sortie->clef.ptr = trame + taille;
+    sortie->clef.len = 0;
+  }
+  return true;
+}
+
+// ALIAS;n
+bool Protocole_DecodeAlias(const char* trame, size_t taille, int32_t* alias)
+{
+  Protocole_Vue champs[2];
+
+  if (Protocole_Split(trame, taille, champs, 2) != 2 || !Protocole_VueEgale(champs[0], PROTOCOLE_ALIAS))
+    return false;
+
+  *alias = Protocole_VueToInt(champs[1], -1);
+  return *alias >= 0;
+}
+
+// PING;n
+bool Protocole_DecodePing(const char* trame, size_t taille, int32_t* numero)
+{
+  Protocole_Vue champs[2];
+
+  if (Protocole_Split(trame, taille, champs, 2) != 2 || !Protocole_VueEgale(champs[0], PROTOCOLE_PING))
+    return false;
+
+  *numero = Protocole_VueToInt(champs[1], -1);
+  return *numero >= 0;
+}
+
+// ATTENTE;délai (ms)
+bool Protocole_DecodeAttente(const char* trame, size_t taille, int32_t* delai_ms)
+{
+  Protocole_Vue champs[2];
+
+  if (Protocole_Split(trame, taille, champs, 2) != 2 || !Protocole_VueEgale(champs[0], PROTOCOLE_ATTENTE))
+    return false;
+
+  *delai_ms = Protocole_VueToInt(champs[1], -1);
+  return *delai_ms >= 0;
+}
+
+// icone;couleur
+bool Protocole_DecodeIcone(const char* trame, size_t taille, Trame_Icone* sortie)
+{
+  Protocole_Vue champs[2];
+
+  if (Protocole_Split(trame, taille, champs, 2) != 2)
+    return false;
+
+  sortie->icone   = champs[0];
+  sortie->couleur = champs[1];
+  return true;
+}
+
+/*===============================================================================
+  Nom 			: LigneSuivante
+
+  Description	: Parcourt les lignes à 3 champs d'une trame groupée
+                (SNAPSHOT, BACKFILL), sans copie
+
+  Paramètre(s) 	: trame, taille : trame complète (en-tête compris)
+                  entete : en-tête attendu
+                  position : position de lecture (0 au premier appel)
+                  champs : champs de la ligne suivante
+
+  Retour		: false lorsqu'il n'y a plus de ligne
+===============================================================================*/
+static bool LigneSuivante(const char* trame, size_t taille, const char* entete, size_t* position, Protocole_Vue* champs)
+{
+  // Premier appel : on saute l'en-tête
+  if (*position == 0)
+  {
+    size_t n = strlen(entete);
+    if (taille < n || memcmp(trame, entete, n) != 0)
+      return false;
+    *position = n;
+  }
+
+  while (*position < taille)
+  {
+    if (trame[*position] == PROTOCOLE_FIN_LIGNE)
+    {
+      (*position)++;
+      continue;
+    }
+
+    const char* ligne = trame + *position;
+    const char* fin = (const char*)memchr(ligne, PROTOCOLE_FIN_LIGNE, taille - *position);
+    size_t longueur = (fin != NULL) ? (size_t)(fin - ligne) : taille - *position;
+    *position += longueur;
+
+    if (Protocole_Split(ligne, longueur, champs, 3) == 3)
+      return true;
+  }
+  return false;
+}
+
+// Entrée suivante d'une trame SNAPSHOT (position = 0 au premier appel)
+bool Protocole_NextSnapshotEntry(const char* trame, size_t taille, size_t* position, Trame_Snapshot* sortie)
+{
+  Protocole_Vue champs[3];
+
+  if (!LigneSuivante(trame, taille, PROTOCOLE_SNAPSHOT, position, champs))
+    return false;
+
+  sortie->id     = Protocole_VueToInt(champs[0], -1);
+  sortie->topic  = champs[1];
+  sortie->valeur = champs[2];
+  return true;
+}
+
+// Entrée suivante d'une trame BACKFILL (position = 0 au premier appel)
+bool Protocole_NextBackfillEntry(const char* trame, size_t taille, size_t* position, Trame_Backfill* sortie)
+{
+  Protocole_Vue champs[3];
+
+  if (!LigneSuivante(trame, taille, PROTOCOLE_BACKFILL, position, champs))
+    return false;
+
+  sortie->id     = Protocole_VueToInt(champs[0], -1);
+  sortie->age    = Protocole_VueToInt(champs[1], -1);
+  sortie->valeur = champs[2];
+  return true;
+}
+
+// Entrée suivante d'une trame MESURES (position = 0 au premier appel)
+bool Protocole_NextMesureEntry(const char* trame, size_t taille, size_t* position, Trame_Mesure* sortie)
+{
+  Protocole_Vue champs[3];
+
+  if (!LigneSuivante(trame, taille, PROTOCOLE_MESURES, position, champs))
+    return false;
+
+  sortie->id     = Protocole_VueToInt(champs[0], -1);
+  sortie->date   = Protocole_VueToInt64(champs[1], -1);
+  sortie->valeur = champs[2];
+  return true;
+}
+
+// HEURE;t1 (demande) ou HEURE;t1;t2;t3 (réponse)
+bool Protocole_DecodeHeure(const char* trame, size_t taille, Trame_Heure* sortie)
+{
+  Protocole_Vue champs[4];
+  size_t nb = Protocole_Split(trame, taille, champs, 4);
+
+  if ((nb != 2 && nb != 4) || !Protocole_VueEgale(champs[0], PROTOCOLE_HEURE))
+    return false;
+
+  sortie->t1 = Protocole_VueToInt64(champs[1], -1);
+  sortie->t2 = (nb == 4) ? Protocole_VueToInt64(champs[2], -1) : -1;
+  sortie->t3 = (nb == 4) ? Protocole_VueToInt64(champs[3], -1) : -1;
+  if (nb == 4 && (sortie->t2 < 0 || sortie->t3 < 0))
+    return false;
+  return sortie->t1 >= 0;
+}
+
+// OTA;taille;md5[;DELTA]
+bool Protocole_DecodeOTA(const char* trame, size_t taille, Trame_OTA* sortie)
+{
+  Protocole_Vue champs[4];
+  size_t nb = Protocole_Split(trame, taille, champs, 4);
+
+  if (nb < 3 || !Protocole_VueEgale(champs[0], PROTOCOLE_OTA))
+    return false;
+
+  sortie->taille = Protocole_VueToInt(champs[1], -1);
+  sortie->md5    = champs[2];
+  sortie->delta  = (nb == 4) && Protocole_VueEgale(champs[3], PROTOCOLE_OTA_DELTA);
+  if (nb == 4 && !sortie->delta)
+    return false;
+  return sortie->taille > 0 && sortie->md5.len == 32;
+}
+
+/*===============================================================================
+  Nom 			: Protocole_DecodeBlocOTA
+
+  Description	: Décode un bloc d'image OTA (trame binaire), sans copie
+
+  Paramètre(s) 	: trame, taille : trame reçue
+                  sortie : bloc décodé (les données pointent dans la trame)
+
+  Retour		: false si la trame est trop courte ou si le CRC est faux
+===============================================================================*/
+bool Protocole_DecodeBlocOTA(const uint8_t* trame, size_t taille, Trame_BlocOTA* sortie)
+{
+  if (taille <= PROTOCOLE_ENTETE_BLOC_OTA)
+    return false;
+
+  sortie->index   = ((uint16_t)trame[0] << 8) | trame[1];
+  sortie->crc     = ((uint32_t)trame[2] << 24) | ((uint32_t)trame[3] << 16) | ((uint32_t)trame[4] << 8) | trame[5];
+  sortie->donnees = trame + PROTOCOLE_ENTETE_BLOC_OTA;
+  sortie->taille  = taille - PROTOCOLE_ENTETE_BLOC_OTA;
+
+  return Protocole_CRC32(0, sortie->donnees, sortie->taille) == sortie->crc;
+}
+
+// Valeur d'un chiffre hexadécimal (-1 si le caractère est invalide)
+static int Hexa(char c)
+{
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+/*===============================================================================
+  Nom 			: Protocole_DecodeRegles
+
+  Description	: Décode REGLES[;programme] (bytecode en hexadécimal)
+
+  Paramètre(s) 	: trame, taille : trame reçue
+                  programme, taille_max : buffer du bytecode
+                  taille_programme : taille du bytecode (0 : REGLES seul)
+
+  Retour		: false si la trame est invalide ou trop longue
+===============================================================================*/
+bool Protocole_DecodeRegles(const char* trame, size_t taille, uint8_t* programme, size_t taille_max, size_t* taille_programme)
+{
+  Protocole_Vue champs[2];
+  size_t nb = Protocole_Split(trame, taille, champs, 2);
+
+  if (nb < 1 || !Protocole_VueEgale(champs[0], PROTOCOLE_REGLES))
+    return false;
+
+  *taille_programme = 0;
+  if (nb == 1)
+    return true;
+
+  if ((champs[1].len & 1) != 0 || champs[1].len / 2 > taille_max)
+    return false;
+
+  for (size_t i = 0; i < champs[1].len / 2; i++)
+  {
+    int fort = Hexa(champs[1].ptr[2 * i]);
+    int faible = Hexa(champs[1].ptr[2 * i + 1]);
+    if (fort < 0 || faible < 0)
+      return false;
+    programme[i] = (uint8_t)((fort << 4) | faible);
+  }
+  *taille_programme = champs[1].len / 2;
+  return true;
+}
+
+// ################################################################################
+// 									Encodage
+// ################################################################################
+
+size_t Protocole_EncodeConnexion(char* buffer, size_t taille, const char* mac, const char* nom_client, bool alias)
+{
+  size_t p = Ajouter(buffer, taille, 0, mac);
+  p = AjouterCaractere(buffer, taille, p, PROTOCOLE_SEPARATEUR);
+  p = Ajouter(buffer, taille, p, nom_client);
+  if (alias)
+  {
+    p = AjouterCaractere(buffer, taille, p, PROTOCOLE_SEPARATEUR);
+    p = Ajouter(buffer, taille, p, PROTOCOLE_ALIAS);
+  }
+  return Terminer(buffer, taille, p);
+}
+
+// Message de naissance (retenu) : EN_LIGNE suivi de la trame de connexion
+size_t Protocole_EncodePresence(char* buffer, size_t taille, const char* mac, const char* nom_client, bool alias)
+{
+  size_t p = Ajouter(buffer, taille, 0, PROTOCOLE_EN_LIGNE);
+  p = AjouterCaractere(buffer, taille, p, PROTOCOLE_SEPARATEUR);
+  p = Ajouter(buffer, taille, p, mac);
+  p = AjouterCaractere(buffer, taille, p, PROTOCOLE_SEPARATEUR);
+  p = Ajouter(buffer, taille, p, nom_client);
+  if (alias)
+  {
+    p = AjouterCaractere(buffer, taille, p, PROTOCOLE_SEPARATEUR);
+    p = Ajouter(buffer, taille, p, PROTOCOLE_ALIAS);
+  }
+  return Terminer(buffer, taille, p);
+}
+
+size_t Protocole_EncodeSetTile(char* buffer, size_t taille, int32_t id, const char* attribut, const char* valeur)
+{
+  size_t p = AjouterEntier(buffer, taille, 0, id);
+  p = AjouterCaractere(buffer, taille, p, PROTOCOLE_SEPARATEUR);
+  p = Ajouter(buffer, taille, p, attribut);
+  p = AjouterCaractere(buffer, taille, p, PROTOCOLE_SEPARATEUR);
+  p = Ajouter(buffer, taille, p, valeur);
+  return Terminer(buffer, taille, p);
+}
+
+size_t Protocole_EncodeWifiData(char* buffer, size_t taille, const char* ssid, const char* password, const char* clef)
+{
+  size_t p = Ajouter(buffer, taille, 0, PROTOCOLE_WIFI_DATA);
+  p = AjouterCaractere(buffer, taille, p, PROTOCOLE_SEPARATEUR);
+  p = Ajouter(buffer, taille, p, ssid);
+  p = AjouterCaractere(buffer, taille, p, PROTOCOLE_SEPARATEUR);
+  p = Ajouter(buffer, taille, p, password);
+  if (clef != NULL && clef[0] != '\0')
+  {
+    p = AjouterCaractere(buffer, taille, p, PROTOCOLE_SEPARATEUR);
+    p = Ajouter(buffer, taille, p, clef);
+  }
+  return Terminer(buffer, taille, p);
+}
+
+size_t Protocole_EncodeAlias(char* buffer, size_t taille, int32_t alias)
+{
+  size_t p = Ajouter(buffer, taille, 0, PROTOCOLE_ALIAS);
+  p = AjouterCaractere(buffer, taille, p, PROTOCOLE_SEPARATEUR);
+  p = AjouterEntier(buffer, taille, p, alias);
+  return Terminer(buffer, taille, p);
+}
+
+size_t Protocole_EncodeAttente(char* buffer, size_t taille, int32_t delai_ms)
+{
+  size_t p = Ajouter(buffer, taille, 0, PROTOCOLE_ATTENTE);
+  p = AjouterCaractere(buffer, taille, p, PROTOCOLE_SEPARATEUR);
+  p = AjouterEntier(buffer, taille, p, delai_ms);
+  return Terminer(buffer, taille, p);
+}
+
+size_t Protocole_EncodeIcone(char* buffer, size_t taille, const char* icone, const char* couleur)
+{
+  size_t p = Ajouter(buffer, taille, 0, icone);
+  p = AjouterCaractere(buffer, taille, p, PROTOCOLE_SEPARATEUR);
+  p = Ajouter(buffer, taille, p, couleur);
+  return Terminer(buffer, taille, p);
+}
+
+// En-tête d'une trame SNAPSHOT (les entrées sont ajoutées par Protocole_AppendSnapshotEntry)
+size_t Protocole_EncodeSnapshotHeader(char* buffer, size_t taille)
+{
+  size_t p = Ajouter(buffer, taille, 0, PROTOCOLE_SNAPSHOT);
+  return Terminer(buffer, taille, p);
+}
+
+// Ajoute une entrée id;topic;valeur à une trame SNAPSHOT. Renvoie 0 si le buffer est plein
+size_t Protocole_AppendSnapshotEntry(char* buffer, size_t taille, size_t position, int32_t id, const char* topic, const char* valeur)
+{
+  size_t p = AjouterCaractere(buffer, taille, position, PROTOCOLE_FIN_LIGNE);
+  p = AjouterEntier(buffer, taille, p, id);
+  p = AjouterCaractere(buffer, taille, p, PROTOCOLE_SEPARATEUR);
+  p = Ajouter(buffer, taille, p, topic);
+  p = AjouterCaractere(buffer, taille, p, PROTOCOLE_SEPARATEUR);
+  p = Ajouter(buffer, taille, p, valeur);
+  return Terminer(buffer, taille, p);
+}
+
+// En-tête d'une trame BACKFILL (les entrées sont ajoutées par Protocole_AppendBackfillEntry)
+size_t Protocole_EncodeBackfillHeader(char* buffer, size_t taille)
+{
+  size_t p = Ajouter(buffer, taille, 0, PROTOCOLE_BACKFILL);
+  return Terminer(buffer, taille, p);
+}
+
+// Ajoute une entrée id;age;valeur à une trame BACKFILL. Renvoie 0 si le buffer est plein
+size_t Protocole_AppendBackfillEntry(char* buffer, size_t taille, size_t position, int32_t id, int32_t age, const char* valeur)
+{
+  size_t p = AjouterCaractere(buffer, taille, position, PROTOCOLE_FIN_LIGNE);
+  p = AjouterEntier(buffer, taille, p, id);
+  p = AjouterCaractere(buffer, taille, p, PROTOCOLE_SEPARATEUR);
+  p = AjouterEntier(buffer, taille, p, age);
+  p = AjouterCaractere(buffer, taille, p, PROTOCOLE_SEPARATEUR);
+  p = Ajouter(buffer, taille, p, valeur);
+  return Terminer(buffer, taille, p);
+}
+
+// En-tête d'une trame MESURES (les entrées sont ajoutées par Protocole_AppendMesureEntry)
+size_t Protocole_EncodeMesuresHeader(char* buffer, size_t taille)
+{
+  size_t p = Ajouter(buffer, taille, 0, PROTOCOLE_MESURES);
+  return Terminer(buffer, taille, p);
+}
+
+// Ajoute une entrée id;date;valeur à une trame MESURES. Renvoie 0 si le buffer est plein
+size_t Protocole_AppendMesureEntry(char* buffer, size_t taille, size_t position, int32_t id, int64_t date, const char* valeur)
+{
+  size_t p = AjouterCaractere(buffer, taille, position, PROTOCOLE_FIN_LIGNE);
+  p = AjouterEntier(buffer, taille, p, id);
+  p = AjouterCaractere(buffer, taille, p, PROTOCOLE_SEPARATEUR);
+  p = AjouterEntier64(buffer, taille, p, date);
+  p = AjouterCaractere(buffer, taille, p, PROTOCOLE_SEPARATEUR);
+  p = Ajouter(buffer, taille, p, valeur);
+  return Terminer(buffer, taille, p);
+}
+
+size_t Protocole_EncodeHeure(char* buffer, size_t taille, int64_t t1)
+{
+  size_t p = Ajouter(buffer, taille, 0, PROTOCOLE_HEURE);
+  p = AjouterCaractere(buffer, taille, p, PROTOCOLE_SEPARATEUR);
+  p = AjouterEntier64(buffer, taille, p, t1);
+  return Terminer(buffer, taille, p);
+}
+
+size_t Protocole_EncodePing(char* buffer, size_t taille, int32_t numero)
+{
+  size_t p = Ajouter(buffer, taille, 0, PROTOCOLE_PING);
+  p = AjouterCaractere(buffer, taille, p, PROTOCOLE_SEPARATEUR);
+  p = AjouterEntier(buffer, taille, p, numero);
+  return Terminer(buffer, taille, p);
+}
+
+size_t Protocole_EncodeReponseHeure(char* buffer, size_t taille, int64_t t1, int64_t t2, int64_t t3)
+{
+  size_t p = Ajouter(buffer, taille, 0, PROTOCOLE_HEURE);
+  p = AjouterCaractere(buffer, taille, p, PROTOCOLE_SEPARATEUR);
+  p = AjouterEntier64(buffer, taille, p, t1);
+  p = AjouterCaractere(buffer, taille, p, PROTOCOLE_SEPARATEUR);
+  p = AjouterEntier64(buffer, taille, p, t2);
+  p = AjouterCaractere(buffer, taille, p, PROTOCOLE_SEPARATEUR);
+  p = AjouterEntier64(buffer, taille, p, t3);
+  return Terminer(buffer, taille, p);
+}
+
+size_t Protocole_EncodeOTA(char* buffer, size_t taille, int32_t taille_image, const char* md5, bool delta)
+{
+  size_t p = Ajouter(buffer, taille, 0, PROTOCOLE_OTA);
+  p = AjouterCaractere(buffer, taille, p, PROTOCOLE_SEPARATEUR);
+  p = AjouterEntier(buffer, taille, p, taille_image);
+  p = AjouterCaractere(buffer, taille, p, PROTOCOLE_SEPARATEUR);
+  p = Ajouter(buffer, taille, p, md5);
+  if (delta)
+  {
+    p = AjouterCaractere(buffer, taille, p, PROTOCOLE_SEPARATEUR);
+    p = Ajouter(buffer, taille, p, PROTOCOLE_OTA_DELTA);
+  }
+  return Terminer(buffer, taille, p);
+}
+
+// Bloc OTA (côté serveur). Renvoie la taille de la trame, 0 si le buffer est trop petit
+size_t Protocole_EncodeBlocOTA(uint8_t* buffer, size_t taille, uint16_t index, const uint8_t* donnees, size_t taille_donnees)
+{
+  uint32_t crc = Protocole_CRC32(0, donnees, taille_donnees);
+
+  if (taille < PROTOCOLE_ENTETE_BLOC_OTA + taille_donnees)
+    return 0;
+
+  buffer[0] = index >> 8;
+  buffer[1] = index;
+  buffer[2] = crc >> 24;
+  buffer[3] = crc >> 16;
+  buffer[4] = crc >> 8;
+  buffer[5] = crc;
+  memcpy(buffer + PROTOCOLE_ENTETE_BLOC_OTA, donnees, taille_donnees);
+  return PROTOCOLE_ENTETE_BLOC_OTA + taille_donnees;
+}
+
+// REGLES;programme (côté serveur)
+size_t Protocole_EncodeRegles(char* buffer, size_t taille, const uint8_t* programme, size_t taille_programme)
+{
+  static const char chiffres[] = "0123456789ABCDEF";
+  size_t p = Ajouter(buffer, taille, 0, PROTOCOLE_REGLES);
+
+  if (taille_programme > 0)
+    p = AjouterCaractere(buffer, taille, p, PROTOCOLE_SEPARATEUR);
+  for (size_t i = 0; i < taille_programme; i++)
+  {
+    p = AjouterCaractere(buffer, taille, p, chiffres[programme[i] >> 4]);
+    p = AjouterCaractere(buffer, taille, p, chiffres[programme[i] & 0x0F]);
+  }
+  return Terminer(buffer, taille, p);
+}
+
+// REGLES;OK;taille | REGLES;ERREUR;position
+size_t Protocole_EncodeReponseRegles(char* buffer, size_t taille, bool ok, int32_t valeur)
+{
+  size_t p = Ajouter(buffer, taille, 0, PROTOCOLE_REGLES);
+  p = AjouterCaractere(buffer, taille, p, PROTOCOLE_SEPARATEUR);
+  p = Ajouter(buffer, taille, p, ok ? PROTOCOLE_OTA_OK : PROTOCOLE_OTA_ERREUR);
+  p = AjouterCaractere(buffer, taille, p, PROTOCOLE_SEPARATEUR);
+  p = AjouterEntier(buffer, taille, p, valeur);
+  return Terminer(buffer, taille, p);
+}
+
+// Réponse de l'objet : etat[;valeur1[;valeur2]] (valeurs négatives omises)
+size_t Protocole_EncodeReponseOTA(char* buffer, size_t taille, const char* etat, int32_t valeur1, int32_t valeur2)
+{
+  size_t p = Ajouter(buffer, taille, 0, etat);
+  if (valeur1 >= 0)
+  {
+    p = AjouterCaractere(buffer, taille, p, PROTOCOLE_SEPARATEUR);
+    p = AjouterEntier(buffer, taille, p, valeur1);
+  }
+  if (valeur2 >= 0)
+  {
+    p = AjouterCaractere(buffer, taille, p, PROTOCOLE_SEPARATEUR);
+    p = AjouterEntier(buffer, taille, p, valeur2);
+  }
+  return Terminer(buffer, taille, p);
+}
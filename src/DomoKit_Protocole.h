@@ -0,0 +1,248 @@
+/*
+ *  =============================================================================================================================================
+ *  Titre : DomoKit_Protocole.h
+ *  Auteur : Thomas Broussard
+ *  ---------------------------------------------------------------------------------------------------------------------------------------------
+ *  Description :
+ *  Codec du protocole Domokit (trames MQTT échangées entre objets et serveur).
+ *  Ce fichier ne dépend ni d'Arduino ni de l'ESP8266 : il peut être compilé
+ *  tel quel par un serveur (C++ standard).
+ *
+ *  Le décodage ne copie aucune donnée : les champs sont des vues
+ *  (pointeur + taille) sur la trame reçue, qui doit rester valide pendant
+ *  leur utilisation. L'encodage écrit dans un buffer fourni par l'appelant.
+ *
+ *  Trames :
+ *  - connexion   : mac;nom_client[;ALIAS]
+ *  - présence    : EN_LIGNE;mac;nom_client[;ALIAS] | HORS_LIGNE (messages retenus :
+ *                  naissance publiée à la connexion, testament publié par le broker)
+ *  - set_tile    : id;attribut;valeur
+ *  - instruction : START | STOP | CONNECT | WIFI_DATA;ssid;password;clef | ALIAS;n
+ *                  | ATTENTE;délai (ms) avant la prochaine demande d'authentification
+ *                  | HEURE;t1;t2;t3 (réponse à une demande de synchronisation)
+ *  - heure       : HEURE;t1 (demande de synchronisation, voir DomoKit_Horloge.h)
+ *  - ping        : PING;n (renvoyé à l'objet par le broker, voir DomoKit_Liaison.h)
+ *  - tile icône  : icone;couleur
+ *  - snapshot    : SNAPSHOT\nid;topic;valeur\nid;topic;valeur...
+ *  - backfill    : BACKFILL\nid;age;valeur\nid;age;valeur... (valeurs enregistrées
+ *                  hors connexion, age en ms, -1 si inconnu)
+ *  - mesures     : MESURES\nid;date;valeur\nid;date;valeur... (valeurs horodatées,
+ *                  date = heure du serveur en ms depuis le 01/01/1970)
+ *  - OTA         : OTA;taille;md5[;DELTA] | OTA_FIN | OTA_ANNULE
+ *  - bloc OTA    : [index (2 octets)][crc32 (4 octets)][données] (binaire, big-endian)
+ *  - réponse OTA : PRET;index;taille_bloc | ACK;index | OK | ERREUR;code
+ *  - règles      : REGLES[;programme en hexadécimal]
+ *  - réponse     : REGLES;OK;taille | REGLES;ERREUR;position
+ * =============================================================================================================================================
+ */
+
+#ifndef __DOMOKIT_PROTOCOLE_H__
+#define __DOMOKIT_PROTOCOLE_H__
+
+// ################################################################################
+// 									Librairies
+// ################################################################################
+  #include <stdint.h>
+  #include <stddef.h>
+  #include <string.h>
+
+// ################################################################################
+// 				Jeu d'instruction du protocole
+// ################################################################################
+  #define PROTOCOLE_START       "START"
+  #define PROTOCOLE_STOP        "STOP"
+  #define PROTOCOLE_ON          "ON"
+  #define PROTOCOLE_OFF         "OFF"
+  #define PROTOCOLE_DATA        "DATA"
+  #define PROTOCOLE_CONNECT     "CONNECT"
+  #define PROTOCOLE_COMMANDE    "CMD"
+  #define PROTOCOLE_WIFI_DATA   "WIFI_DATA"
+  #define PROTOCOLE_ALIAS       "ALIAS"
+  #define PROTOCOLE_SNAPSHOT    "SNAPSHOT"
+  #define PROTOCOLE_OTA         "OTA"
+  #define PROTOCOLE_OTA_FIN     "OTA_FIN"
+  #define PROTOCOLE_OTA_ANNULE  "OTA_ANNULE"
+  #define PROTOCOLE_OTA_DELTA   "DELTA"
+  #define PROTOCOLE_REGLES      "REGLES"
+  #define PROTOCOLE_BACKFILL    "BACKFILL"
+  #define PROTOCOLE_EN_LIGNE    "EN_LIGNE"
+  #define PROTOCOLE_ATTENTE     "ATTENTE"
+  #define PROTOCOLE_HEURE       "HEURE"
+  #define PROTOCOLE_MESURES     "MESURES"
+  #define PROTOCOLE_PING        "PING"
+  #define PROTOCOLE_HORS_LIGNE  "HORS_LIGNE"
+
+  // Réponses de l'objet pendant une mise à jour OTA
+  #define PROTOCOLE_OTA_PRET    "PRET"
+  #define PROTOCOLE_OTA_ACK     "ACK"
+  #define PROTOCOLE_OTA_OK      "OK"
+  #define PROTOCOLE_OTA_ERREUR  "ERREUR"
+
+  #define PROTOCOLE_ENTETE_BLOC_OTA  6 // index (2) + crc32 (4)
+
+  #define PROTOCOLE_SEPARATEUR  ';'
+  #define PROTOCOLE_FIN_LIGNE   '\n' // séparateur des entrées d'une trame groupée
+
+// Instructions reconnues sur topic_instruction
+typedef enum
+{
+  INSTRUCTION_INCONNUE,
+  INSTRUCTION_START,
+  INSTRUCTION_STOP,
+  INSTRUCTION_CONNECT,
+  INSTRUCTION_WIFI_DATA,
+  INSTRUCTION_ALIAS,
+  INSTRUCTION_SNAPSHOT,
+  INSTRUCTION_OTA,
+  INSTRUCTION_OTA_FIN,
+  INSTRUCTION_OTA_ANNULE,
+  INSTRUCTION_REGLES,
+  INSTRUCTION_ATTENTE,
+  INSTRUCTION_HEURE
+} Protocole_Instruction;
+
+// Vue sur une partie d'une trame (non terminée par '\0')
+typedef struct
+{
+  const char* ptr;
+  size_t      len;
+} Protocole_Vue;
+
+// connexion : mac;nom_client[;ALIAS]
+typedef struct
+{
+  Protocole_Vue mac;
+  Protocole_Vue nom_client;
+  bool          alias;
+} Trame_Connexion;
+
+// set_tile : id;attribut;valeur
+typedef struct
+{
+  int32_t       id;
+  Protocole_Vue attribut;
+  Protocole_Vue valeur;
+} Trame_SetTile;
+
+// WIFI_DATA;ssid;password;clef
+typedef struct
+{
+  Protocole_Vue ssid;
+  Protocole_Vue password;
+  Protocole_Vue clef;
+} Trame_WifiData;
+
+// icone;couleur
+typedef struct
+{
+  Protocole_Vue icone;
+  Protocole_Vue couleur;
+} Trame_Icone;
+
+// entrée d'un snapshot : id;topic;valeur
+typedef struct
+{
+  int32_t       id;
+  Protocole_Vue topic;
+  Protocole_Vue valeur;
+} Trame_Snapshot;
+
+// entrée d'un backfill : id;age;valeur
+typedef struct
+{
+  int32_t       id;
+  int32_t       age;
+  Protocole_Vue valeur;
+} Trame_Backfill;
+
+// entrée d'une trame de mesures : id;date;valeur
+typedef struct
+{
+  int32_t       id;
+  int64_t       date;
+  Protocole_Vue valeur;
+} Trame_Mesure;
+
+// HEURE;t1[;t2;t3]
+typedef struct
+{
+  int64_t       t1;
+  int64_t       t2;   // -1 pour une demande
+  int64_t       t3;
+} Trame_Heure;
+
+// OTA;taille;md5[;DELTA]
+typedef struct
+{
+  int32_t       taille;
+  Protocole_Vue md5;
+  bool          delta;
+} Trame_OTA;
+
+// bloc OTA (binaire)
+typedef struct
+{
+  uint16_t       index;
+  uint32_t       crc;
+  const uint8_t* donnees;
+  size_t         taille;
+} Trame_BlocOTA;
+
+// ################################################################################
+// 									Fonctions
+// ################################################################################
+
+// Vues
+bool    Protocole_VueEgale(Protocole_Vue vue, const char* str);
+int32_t Protocole_VueToInt(Protocole_Vue vue, int32_t defaut);
+int64_t Protocole_VueToInt64(Protocole_Vue vue, int64_t defaut);
+size_t  Protocole_VueCopy(Protocole_Vue vue, char* dest, size_t taille_dest);
+
+// CRC32 (même résultat que zlib.crc32 ; crc = 0 pour le premier appel)
+uint32_t Protocole_CRC32(uint32_t crc, const uint8_t* donnees, size_t taille);
+
+// Découpage d'une trame selon PROTOCOLE_SEPARATEUR (le dernier champ contient le reste)
+size_t  Protocole_Split(const char* trame, size_t taille, Protocole_Vue* champs, size_t nb_max);
+
+// Décodage
+Protocole_Instruction Protocole_DecodeInstruction(const char* trame, size_t taille);
+bool    Protocole_DecodeConnexion(const char* trame, size_t taille, Trame_Connexion* sortie);
+bool    Protocole_DecodePresence(const char* trame, size_t taille, bool* en_ligne, Trame_Connexion* sortie);
+bool    Protocole_DecodeSetTile(const char* trame, size_t taille, Trame_SetTile* sortie);
+bool    Protocole_DecodeWifiData(const char* trame, size_t taille, Trame_WifiData* sortie);
+bool    Protocole_DecodeAlias(const char* trame, size_t taille, int32_t* alias);
+bool    Protocole_DecodeAttente(const char* trame, size_t taille, int32_t* delai_ms);
+bool    Protocole_DecodeIcone(const char* trame, size_t taille, Trame_Icone* sortie);
+bool    Protocole_NextSnapshotEntry(const char* trame, size_t taille, size_t* position, Trame_Snapshot* sortie);
+bool    Protocole_NextBackfillEntry(const char* trame, size_t taille, size_t* position, Trame_Backfill* sortie);
+bool    Protocole_NextMesureEntry(const char* trame, size_t taille, size_t* position, Trame_Mesure* sortie);
+bool    Protocole_DecodeHeure(const char* trame, size_t taille, Trame_Heure* sortie);
+bool    Protocole_DecodePing(const char* trame, size_t taille, int32_t* numero);
+bool    Protocole_DecodeOTA(const char* trame, size_t taille, Trame_OTA* sortie);
+bool    Protocole_DecodeBlocOTA(const uint8_t* trame, size_t taille, Trame_BlocOTA* sortie);
+bool    Protocole_DecodeRegles(const char* trame, size_t taille, uint8_t* programme, size_t taille_max, size_t* taille_programme);
+
+// Encodage (renvoient la taille écrite hors '\0', 0 si le buffer est trop petit)
+size_t  Protocole_EncodeConnexion(char* buffer, size_t taille, const char* mac, const char* nom_client, bool alias);
+size_t  Protocole_EncodePresence(char* buffer, size_t taille, const char* mac, const char* nom_client, bool alias);
+size_t  Protocole_EncodeSetTile(char* buffer, size_t taille, int32_t id, const char* attribut, const char* valeur);
+size_t  Protocole_EncodeWifiData(char* buffer, size_t taille, const char* ssid, const char* password, const char* clef);
+size_t  Protocole_EncodeAlias(char* buffer, size_t taille, int32_t alias);
+size_t  Protocole_EncodeAttente(char* buffer, size_t taille, int32_t delai_ms);
+size_t  Protocole_EncodeIcone(char* buffer, size_t taille, const char* icone, const char* couleur);
+size_t  Protocole_EncodeSnapshotHeader(char* buffer, size_t taille);
+size_t  Protocole_AppendSnapshotEntry(char* buffer, size_t taille, size_t position, int32_t id, const char* topic, const char* valeur);
+size_t  Protocole_EncodeBackfillHeader(char* buffer, size_t taille);
+size_t  Protocole_AppendBackfillEntry(char* buffer, size_t taille, size_t position, int32_t id, int32_t age, const char* valeur);
+size_t  Protocole_EncodeMesuresHeader(char* buffer, size_t taille);
+size_t  Protocole_AppendMesureEntry(char* buffer, size_t taille, size_t position, int32_t id, int64_t date, const char* valeur);
+size_t  Protocole_EncodeHeure(char* buffer, size_t taille, int64_t t1);
+size_t  Protocole_EncodePing(char* buffer, size_t taille, int32_t numero);
+size_t  Protocole_EncodeReponseHeure(char* buffer, size_t taille, int64_t t1, int64_t t2, int64_t t3);
+size_t  Protocole_EncodeOTA(char* buffer, size_t taille, int32_t taille_image, const char* md5, bool delta);
+size_t  Protocole_EncodeBlocOTA(uint8_t* buffer, size_t taille, uint16_t index, const uint8_t* donnees, size_t taille_donnees);
+size_t  Protocole_EncodeReponseOTA(char* buffer, size_t taille, const char* etat, int32_t valeur1, int32_t valeur2);
+size_t  Protocole_EncodeRegles(char* buffer, size_t taille, const uint8_t* programme, size_t taille_programme);
+size_t  Protocole_EncodeReponseRegles(char* buffer, size_t taille, bool ok, int32_t valeur);
+
+#endif
@@ -0,0 +1,220 @@
+/*
+ *  =============================================================================================================================================
+ *  Titre : DomoKit_QoS.cpp
+ *  Auteur : Thomas Broussard
+ *  ---------------------------------------------------------------------------------------------------------------------------------------------
+ *  Description :
+ *  Fenêtre d'envoi QoS 1 (suivi des packet ID, renvoi avec délai croissant)
+ * =============================================================================================================================================
+ */
+
+#include "DomoKit.h"
+
+// ################################################################################
+// 									Constructeur
+// ################################################################################
+Domokit_Inflight::Domokit_Inflight()
+{
+  memset(_Fenetre, 0, sizeof(_Fenetre));
+  _Nb_Renvois = 0;
+  _Sans_Acquittement = false;
+  _A_Sauvegarder = false;
+  _Sauvegarde_ms = 0;
+}
+
+// ################################################################################
+// 									Fonctions
+// ################################################################################
+
+/*===============================================================================
+  Nom 			: send
+
+  Description	: Ajoute un message à la fenêtre QoS 1 et le transmet si possible.
+                Le message reste dans la fenêtre jusqu'à son acquittement.
+
+  Paramètre(s) 	:
+  * transport   : transport MQTT à utiliser
+  * topic       : topic du message
+  * payload     : données du message (déjà cryptées)
+  * length      : taille des données
+
+  Retour		: false si la fenêtre est pleine ou le message trop long
+===============================================================================*/
+bool Domokit_Inflight::send(Domokit_Transport* transport, const char* topic, const uint8_t* payload, unsigned int length)
+{
+  if (length > QOS_TAILLE_PAYLOAD || strlen(topic) >= QOS_TAILLE_TOPIC)
+    return false;
+
+  for (uint8_t i = 0; i < QOS_TAILLE_FENETRE; i++)
+  {
+    QoS_Message* msg = &_Fenetre[i];
+    if (msg->utilise)
+      continue;
+
+    msg->utilise   = true;
+    msg->packetId  = 0;
+    msg->nb_envois = 0;
+    msg->length    = length;
+    strcpy(msg->topic, topic);
+    memcpy(msg->payload, payload, length);
+
+    transmit(transport, msg);
+    if (msg->utilise)
+      _A_Sauvegarder = true;
+    return true;
+  }
+
+  DEBUG_PRINTLN("Fenêtre QoS 1 pleine : message non envoyé");
+  return false;
+}
+
+/*===============================================================================
+  Nom 			: acknowledge
+
+  Description	: Libère le message correspondant à un acquittement (PUBACK)
+===============================================================================*/
+void Domokit_Inflight::acknowledge(uint16_t packetId)
+{
+  for (uint8_t i = 0; i < QOS_TAILLE_FENETRE; i++)
+  {
+    if (_Fenetre[i].utilise && _Fenetre[i].packetId == packetId)
+    {
+      _Fenetre[i].utilise = false;
+      _A_Sauvegarder = true;
+      return;
+    }
+  }
+}
+
+/*===============================================================================
+  Nom 			: service
+
+  Description	: Renvoie les messages dont l'échéance est dépassée
+                (à appeler régulièrement depuis la boucle principale).
+                Avec DOMOKIT_QOS_PERSISTANT, sauvegarde la fenêtre modifiée
+                dès la déconnexion, sinon au plus une fois par
+                QOS_PERIODE_SAUVEGARDE_MS (usure de la flash)
+===============================================================================*/
+void Domokit_Inflight::service(Domokit_Transport* transport)
+{
+  unsigned long maintenant = millis();
+
+  #ifdef DOMOKIT_QOS_PERSISTANT
+    if (_A_Sauvegarder && (!transport->connected() || maintenant - _Sauvegarde_ms >= QOS_PERIODE_SAUVEGARDE_MS))
+      this->save();
+  #endif
+
+  for (uint8_t i = 0; i < QOS_TAILLE_FENETRE; i++)
+  {
+    QoS_Message* msg = &_Fenetre[i];
+    if (msg->utilise && (long)(maintenant - msg->echeance_ms) >= 0)
+    {
+      if (msg->nb_envois > 0) _Nb_Renvois++;
+      transmit(transport, msg);
+    }
+  }
+}
+
+/*===============================================================================
+  Nom 			: restart
+
+  Description	: Nouvelle connexion au broker : les packet ID précédents ne sont
+                plus valides, tous les messages en attente sont renvoyés
+===============================================================================*/
+void Domokit_Inflight::restart()
+{
+  for (uint8_t i = 0; i < QOS_TAILLE_FENETRE; i++)
+  {
+    _Fenetre[i].packetId = 0;
+    _Fenetre[i].echeance_ms = millis();
+  }
+}
+
+// Transmission d'un message de la fenêtre et calcul de son prochain renvoi
+void Domokit_Inflight::transmit(Domokit_Transport* transport, QoS_Message* msg)
+{
+  uint16_t packetId = 0;
+  unsigned long delai;
+
+  if (transport->connected() && transport->publish(msg->topic, msg->payload, msg->length, 1, &packetId))
+  {
+    // Transport sans QoS 1 : l'envoi TCP réussi vaut acquittement
+    if (packetId == 0)
+    {
+      if (!_Sans_Acquittement)
+      {
+        DEBUG_PRINTLN("QoS 1 non supporté par le transport (pas de PUBACK) : messages critiques envoyés en QoS 0");
+        _Sans_Acquittement = true;
+      }
+      msg->utilise = false;
+      return;
+    }
+    msg->packetId = packetId;
+  }
+
+  // Délai croissant : 1s, 2s, 4s, ... plafonné à QOS_DELAI_MAX_MS
+  delai = (msg->nb_envois < 16) ? ((unsigned long)QOS_DELAI_INITIAL_MS << msg->nb_envois) : QOS_DELAI_MAX_MS;
+  if (delai > QOS_DELAI_MAX_MS) delai = QOS_DELAI_MAX_MS;
+
+  if (msg->nb_envois < 255) msg->nb_envois++;
+  msg->echeance_ms = millis() + delai;
+}
+
+// Nombre de messages en attente d'acquittement
+uint8_t Domokit_Inflight::getNbEnAttente()
+{
+  uint8_t n = 0;
+  for (uint8_t i = 0; i < QOS_TAILLE_FENETRE; i++)
+    if (_Fenetre[i].utilise) n++;
+  return n;
+}
+
+// Nombre total de renvois effectués
+unsigned long Domokit_Inflight::getNbRenvois()
+{
+  return _Nb_Renvois;
+}
+
+// ################################################################################
+// 									Persistance EEPROM
+// ################################################################################
+
+/*===============================================================================
+  Nom 			: save
+
+  Description	: Sauvegarde la fenêtre en EEPROM (les messages non acquittés
+                seront renvoyés après un redémarrage)
+===============================================================================*/
+void Domokit_Inflight::save()
+{
+  uint8_t* data = (uint8_t*)_Fenetre;
+
+  EEPROM.begin(EEPROM_TAILLE);
+  EEPROM.write(EEPROM_ADDR_QOS, QOS_MAGIC);
+  for (unsigned int i = 0; i < sizeof(_Fenetre); i++)
+    EEPROM.write(EEPROM_ADDR_QOS + 1 + i, data[i]);
+  EEPROM.commit();
+
+  _A_Sauvegarder = false;
+  _Sauvegarde_ms = millis();
+}
+
+/*===============================================================================
+  Nom 			: restore
+
+  Description	: Recharge les messages non acquittés sauvegardés en EEPROM
+===============================================================================*/
+void Domokit_Inflight::restore()
+{
+  uint8_t* data = (uint8_t*)_Fenetre;
+
+  EEPROM.begin(EEPROM_TAILLE);
+  if (EEPROM.read(EEPROM_ADDR_QOS) != QOS_MAGIC)
+    return;
+
+  for (unsigned int i = 0; i < sizeof(_Fenetre); i++)
+    data[i] = EEPROM.read(EEPROM_ADDR_QOS + 1 + i);
+
+  this->restart();
+  DEBUG_PRINT("Messages QoS 1 restaurés : "); DEBUG_PRINTLN(getNbEnAttente());
+}
@@ -0,0 +1,90 @@
+/*
+ *  =============================================================================================================================================
+ *  Titre : DomoKit_QoS.h
+ *  Auteur : Thomas Broussard
+ *  ---------------------------------------------------------------------------------------------------------------------------------------------
+ *  Description :
+ *  Fenêtre d'envoi QoS 1 pour les topics critiques (ex : topic_interruption).
+ *  Les messages restent en mémoire jusqu'à leur acquittement (PUBACK) et sont
+ *  renvoyés avec un délai croissant. Ils peuvent être sauvegardés en EEPROM
+ *  pour survivre à un redémarrage (à la déconnexion, sinon au plus une fois
+ *  par QOS_PERIODE_SAUVEGARDE_MS).
+ *  Transport sans QoS 1 (Transport_PubSub) : packetId nul, le message est
+ *  libéré dès l'envoi TCP réussi (QoS 0 de fait, signalé une fois).
+ * =============================================================================================================================================
+ */
+
+#ifndef __DOMOKIT_QOS_H__
+#define __DOMOKIT_QOS_H__
+
+// ################################################################################
+// 									Configuration
+// ################################################################################
+// Sauvegarde des messages non acquittés en EEPROM (commenter pour désactiver)
+//#define DOMOKIT_QOS_PERSISTANT
+
+// ################################################################################
+// 									Librairies
+// ################################################################################
+  #include "Arduino.h"
+  #include "DomoKit_Transport.h"
+
+// ################################################################################
+// 				Defines , définition et variables globales
+// ################################################################################
+  #define QOS_TAILLE_FENETRE    4     // nombre max de messages en attente d'acquittement
+  #define QOS_TAILLE_TOPIC      TRANSPORT_TAILLE_TOPIC
+  #define QOS_TAILLE_PAYLOAD    128
+  #define QOS_NB_TOPICS         4     // nombre de topics pouvant être déclarés en QoS 1
+
+  #define QOS_DELAI_INITIAL_MS  1000  // délai avant le premier renvoi
+  #define QOS_DELAI_MAX_MS      30000 // délai max entre deux renvois
+
+  // Sauvegarde EEPROM de la fenêtre : chaque commit efface un secteur flash,
+  // la fenêtre n'est donc sauvegardée qu'à la déconnexion ou au plus une fois par période
+  #define QOS_MAGIC                   0xD1
+  #define QOS_PERIODE_SAUVEGARDE_MS   60000
+
+// Message en attente d'acquittement
+typedef struct
+{
+  bool          utilise;
+  uint16_t      packetId;      // 0 = pas encore transmis sur la connexion actuelle
+  uint8_t       nb_envois;
+  unsigned long echeance_ms;   // date du prochain renvoi
+  char          topic[QOS_TAILLE_TOPIC];
+  uint8_t       payload[QOS_TAILLE_PAYLOAD];
+  uint16_t      length;
+} QoS_Message;
+
+// ################################################################################
+// 									Classes
+// ################################################################################
+class Domokit_Inflight
+{
+  public:
+    Domokit_Inflight();
+
+    bool send(Domokit_Transport* transport, const char* topic, const uint8_t* payload, unsigned int length);
+    void acknowledge(uint16_t packetId);
+    void service(Domokit_Transport* transport);
+    void restart();
+
+    uint8_t       getNbEnAttente();
+    unsigned long getNbRenvois();
+
+    // Persistance EEPROM
+    void save();
+    void restore();
+
+  private:
+    void transmit(Domokit_Transport* transport, QoS_Message* msg);
+
+    QoS_Message   _Fenetre[QOS_TAILLE_FENETRE];
+    unsigned long _Nb_Renvois;
+    bool          _Sans_Acquittement;   // transport sans PUBACK déjà signalé
+    bool          _A_Sauvegarder;       // fenêtre modifiée depuis la dernière sauvegarde
+    unsigned long _Sauvegarde_ms;       // date de la dernière sauvegarde
+};
+
+#endif
@@ -0,0 +1,134 @@
+/*
+ *  =============================================================================================================================================
+ *  Titre : DomoKit_Radio.cpp
+ *  Auteur : Thomas Broussard
+ *  ---------------------------------------------------------------------------------------------------------------------------------------------
+ *  Description :
+ *  Fenêtres d'émission radio et estimation du temps radio allumée
+ * =============================================================================================================================================
+ */
+
+#include "DomoKit.h"
+
+// ################################################################################
+// 									Constructeur
+// ################################################################################
+Domokit_Radio::Domokit_Radio()
+{
+  _Active = false;
+  _Ouverte = false;
+  _DTIM = 1;
+  _Periode_ms = 0;
+  _Debut_ms = 0;
+  _Ouverture_ms = 0;
+  _Allumee_ms = 0;
+  _Nb_Fenetres = 0;
+  _Nb_Reveils = 0;
+}
+
+/*===============================================================================
+  Nom 			: configure
+
+  Description	: Active les fenêtres d'émission et remet la mesure à zéro
+
+  Paramètre(s) 	: periode_ms : période souhaitée entre deux fenêtres
+                  dtim : intervalle d'écoute (en beacons) du modem sleep
+
+  Retour		: période retenue (multiple de l'intervalle DTIM)
+===============================================================================*/
+unsigned long Domokit_Radio::configure(unsigned long periode_ms, uint8_t dtim)
+{
+  uint32_t intervalle_us = (uint32_t)RADIO_INTERVALLE_BEACON_US * ((dtim > 0) ? dtim : 1);
+  uint32_t nb = ((uint64_t)periode_ms * 1000 + intervalle_us - 1) / intervalle_us;
+
+  _DTIM = (dtim > 0) ? dtim : 1;
+  _Periode_ms = (uint64_t)((nb > 0) ? nb : 1) * intervalle_us / 1000;
+  _Active = true;
+  _Ouverte = false;
+  _Debut_ms = millis();
+  _Allumee_ms = 0;
+  _Nb_Fenetres = 0;
+  _Nb_Reveils = 0;
+  return _Periode_ms;
+}
+
+bool Domokit_Radio::isEnabled()
+{
+  return _Active;
+}
+
+// Sans fenêtres d'émission, la radio est toujours disponible
+bool Domokit_Radio::isOpen()
+{
+  return !_Active || _Ouverte;
+}
+
+// ################################################################################
+// 									Fenêtres
+// ################################################################################
+
+void Domokit_Radio::open()
+{
+  if (!_Active || _Ouverte)
+    return;
+
+  _Ouverte = true;
+  _Ouverture_ms = millis();
+  _Nb_Fenetres++;
+}
+
+void Domokit_Radio::close()
+{
+  if (!_Ouverte)
+    return;
+
+  _Ouverte = false;
+  _Allumee_ms += millis() - _Ouverture_ms;
+}
+
+void Domokit_Radio::wake()
+{
+  if (!_Active || _Ouverte)
+    return;
+
+  _Nb_Reveils++;
+  _Allumee_ms += RADIO_DUREE_EVEIL_MS;
+}
+
+// ################################################################################
+// 									Getters
+// ################################################################################
+
+unsigned long Domokit_Radio::getPeriod()
+{
+  return _Periode_ms;
+}
+
+uint16_t Domokit_Radio::getDutyCycle()
+{
+  unsigned long maintenant = millis();
+  unsigned long duree = maintenant - _Debut_ms;
+  uint64_t allumee = _Allumee_ms;
+
+  if (!_Active || duree == 0)
+    return 1000;
+
+  if (_Ouverte)
+    allumee += maintenant - _Ouverture_ms;
+
+  // Beacons DTIM reçus pendant la mesure
+  allumee += (uint64_t)duree * 1000 / ((uint32_t)RADIO_INTERVALLE_BEACON_US * _DTIM) * RADIO_DUREE_BEACON_MS;
+
+  uint64_t pour_mille = allumee * 1000 / duree;
+  return (pour_mille > 1000) ? 1000 : (uint16_t)pour_mille;
+}
+
+unsigned long Domokit_Radio::getNbFenetres()
+{
+  return _Nb_Fenetres;
+}
+
+unsigned long Domokit_Radio::getNbReveils()
+{
+  return _Nb_Reveils;
+}
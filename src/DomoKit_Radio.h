@@ -0,0 +1,81 @@
+/*
+ *  =============================================================================================================================================
+ *  Titre : DomoKit_Radio.h
+ *  Auteur : Thomas Broussard
+ *  ---------------------------------------------------------------------------------------------------------------------------------------------
+ *  Description :
+ *  Fenêtres d'émission radio (objets alimentés en permanence, modem sleep).
+ *
+ *  Le wifi est placé en modem sleep : entre deux émissions, la radio ne se
+ *  réveille que pour les beacons DTIM (réception des messages du broker).
+ *  Les émissions de l'objet sont regroupées dans des fenêtres périodiques,
+ *  de période multiple de l'intervalle DTIM :
+ *    - valeurs envoyées aux tiles (seule la dernière valeur est conservée)
+ *    - tâches périodiques : métriques, présence, valeurs horodatées,
+ *      journal hors connexion, synchronisation de l'horloge, pings
+ *  Les topics en QoS 1 (topic_interruption par défaut) ne sont pas différés.
+ *
+ *  Le temps radio allumée est estimé : durée des fenêtres, réveils pour une
+ *  émission hors fenêtre (RADIO_DUREE_EVEIL_MS chacun) et beacons DTIM
+ *  (RADIO_DUREE_BEACON_MS chacun), d'où le rapport cyclique.
+ * =============================================================================================================================================
+ */
+
+#ifndef __DOMOKIT_RADIO_H__
+#define __DOMOKIT_RADIO_H__
+
+// ################################################################################
+// 									Librairies
+// ################################################################################
+  #include "Arduino.h"
+
+// ################################################################################
+// 				Defines , définition et variables globales
+// ################################################################################
+  #define RADIO_INTERVALLE_BEACON_US  102400  // 100 TU (intervalle de beacon usuel)
+  #define RADIO_DUREE_FENETRE_MS      100     // fenêtre ouverte : émissions, acquittements
+  #define RADIO_DUREE_EVEIL_MS        30      // radio allumée pour une émission hors fenêtre
+  #define RADIO_DUREE_BEACON_MS       3       // réception d'un beacon DTIM
+
+  // Tâches périodiques différées jusqu'à la prochaine fenêtre (voir Domokit::deferToWindow)
+  #define DIFFERE_METRIQUES   0x01
+  #define DIFFERE_PRESENCE    0x02
+  #define DIFFERE_MESURES     0x04
+  #define DIFFERE_BACKFILL    0x08
+  #define DIFFERE_HORLOGE     0x10
+
+// ################################################################################
+// 									Classes
+// ################################################################################
+class Domokit_Radio
+{
+  public:
+    Domokit_Radio();
+
+    // Période des fenêtres arrondie au multiple supérieur de l'intervalle DTIM
+    unsigned long configure(unsigned long periode_ms, uint8_t dtim);
+    bool     isEnabled();
+    bool     isOpen();
+
+    void     open();
+    void     close();
+    void     wake();      // émission hors fenêtre
+
+    unsigned long getPeriod();
+    uint16_t getDutyCycle();        // radio allumée, en pour mille depuis configure()
+    unsigned long getNbFenetres();
+    unsigned long getNbReveils();
+
+  private:
+    bool          _Active;
+    bool          _Ouverte;
+    uint8_t       _DTIM;
+    unsigned long _Periode_ms;
+    unsigned long _Debut_ms;          // début de la mesure
+    unsigned long _Ouverture_ms;      // ouverture de la fenêtre en cours
+    unsigned long _Allumee_ms;        // fenêtres fermées + réveils
+    unsigned long _Nb_Fenetres;
+    unsigned long _Nb_Reveils;
+};
+
+#endif
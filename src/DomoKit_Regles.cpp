@@ -0,0 +1,351 @@
+/*
+ *  =============================================================================================================================================
+ *  Titre : DomoKit_Regles.cpp
+ *  Auteur : Thomas Broussard
+ *  ---------------------------------------------------------------------------------------------------------------------------------------------
+ *  Description :
+ *  Moteur de règles local (vérification et exécution du bytecode)
+ * =============================================================================================================================================
+ */
+
+#include "DomoKit.h"
+
+// La trame REGLES;<programme en hexadécimal> doit tenir dans un message reçu
+// (TAILLE_MESSAGE, '\0' compris), et la taille est sauvegardée sur un octet en EEPROM
+#if (7 + 2 * REGLES_TAILLE_PROGRAMME) >= TAILLE_MESSAGE
+  #error "REGLES_TAILLE_PROGRAMME trop grand pour les messages du transport (TRANSPORT_TAILLE_PAYLOAD)"
+#endif
+#if REGLES_TAILLE_PROGRAMME > 255
+  #error "REGLES_TAILLE_PROGRAMME doit tenir sur un octet (sauvegarde EEPROM)"
+#endif
+
+// ################################################################################
+// 									Constructeur
+// ################################################################################
+Domokit_Regles::Domokit_Regles()
+{
+  _Taille = 0;
+  _Nb_Sorties = 0;
+  _Nb_Executions = 0;
+  _Nb_Erreurs = 0;
+  _Duree_Max_us = 0;
+}
+
+// ################################################################################
+// 									Sorties
+// ################################################################################
+
+// Autorise les règles à piloter une broche. Renvoie false si la table est pleine
+bool Domokit_Regles::addOutput(uint8_t broche)
+{
+  if (isOutput(broche))
+    return true;
+  if (_Nb_Sorties >= REGLES_NB_SORTIES)
+    return false;
+  _Sorties[_Nb_Sorties++] = broche;
+  return true;
+}
+
+bool Domokit_Regles::isOutput(uint8_t broche)
+{
+  for (uint8_t i = 0; i < _Nb_Sorties; i++)
+  {
+    if (_Sorties[i] == broche)
+      return true;
+  }
+  return false;
+}
+
+// ################################################################################
+// 									Chargement
+// ################################################################################
+
+// Nombre d'octets d'une instruction (opérandes compris), -1 si le code est inconnu
+int Domokit_Regles::tailleInstruction(uint8_t code)
+{
+  switch (code)
+  {
+    case REGLE_FIN :
+    case REGLE_DECLENCHEUR :
+    case REGLE_SOURCE :
+    case REGLE_VALEUR :
+      return 1;
+
+    case REGLE_ENTIER8 :
+    case REGLE_CAPTEUR :
+    case REGLE_TILE :
+    case REGLE_SAUT_SI_FAUX :
+    case REGLE_SAUT :
+    case REGLE_SORTIE :
+    case REGLE_EVENEMENT :
+      return 2;
+
+    case REGLE_PUBLIER :
+      return 3;
+
+    case REGLE_ENTIER32 :
+      return 5;
+
+    default :
+      if (code >= REGLE_EGAL && code <= REGLE_SOUSTRACTION)
+        return 1;
+      return -1;
+  }
+}
+
+/*===============================================================================
+  Nom 			: load
+
+  Description	: Vérifie puis charge un programme : instructions connues,
+                opérandes complets, sorties déclarées (addOutput), sauts vers
+                l'avant sur le début d'une instruction (ou la fin du programme)
+
+  Paramètre(s) 	: programme, taille : bytecode (taille 0 : efface le programme)
+
+  Retour		: REGLES_OK, sinon position de la première instruction invalide
+                (le programme en cours est conservé)
+===============================================================================*/
+int Domokit_Regles::load(const uint8_t* programme, size_t taille)
+{
+  uint8_t debuts[(REGLES_TAILLE_PROGRAMME + 8) / 8];   // début d'une instruction (1 bit par octet)
+  size_t pc = 0;
+
+  if (taille > REGLES_TAILLE_PROGRAMME)
+    return REGLES_TAILLE_PROGRAMME;
+
+  memset(debuts, 0, sizeof(debuts));
+  while (pc < taille)
+  {
+    int n = tailleInstruction(programme[pc]);
+    if (n < 0 || pc + n > taille)
+      return (int)pc;
+    if (programme[pc] == REGLE_SORTIE && !isOutput(programme[pc + 1]))
+      return (int)pc;
+    debuts[pc / 8] |= 1 << (pc % 8);
+    pc += n;
+  }
+  debuts[taille / 8] |= 1 << (taille % 8);
+
+  // Destination des sauts
+  for (pc = 0; pc < taille; pc += tailleInstruction(programme[pc]))
+  {
+    if (programme[pc] != REGLE_SAUT_SI_FAUX && programme[pc] != REGLE_SAUT)
+      continue;
+
+    size_t destination = pc + 2 + programme[pc + 1];
+    if (destination > taille || (debuts[destination / 8] & (1 << (destination % 8))) == 0)
+      return (int)pc;
+  }
+
+  memcpy(_Programme, programme, taille);
+  _Taille = taille;
+  return REGLES_OK;
+}
+
+void Domokit_Regles::clear()
+{
+  _Taille = 0;
+}
+
+// ################################################################################
+// 									Exécution
+// ################################################################################
+
+/*===============================================================================
+  Nom 			: run
+
+  Description	: Exécute le programme pour un déclencheur. Le programme est
+                interrompu (erreur) si la pile déborde ou est vide.
+
+  Paramètre(s) 	: declencheur : évènement, échantillon ou commande reçue
+                  hote : données et actions accessibles aux règles
+
+  Retour		: false en cas d'erreur d'exécution
+===============================================================================*/
+bool Domokit_Regles::run(const Regles_Declencheur& declencheur, Domokit_Regles_Hote* hote)
+{
+  int32_t pile[REGLES_TAILLE_PILE];
+  uint8_t nb = 0;
+  size_t pc = 0;
+  uint32_t debut = micros();
+  bool ok = true;
+
+  if (_Taille == 0)
+    return true;
+
+  // Accès à la pile : une erreur interrompt le programme
+  #define EMPILER(x)  do { if (nb >= REGLES_TAILLE_PILE) { ok = false; break; } pile[nb++] = (x); } while (0)
+  #define DEPILER(x)  do { if (nb == 0) { ok = false; break; } (x) = pile[--nb]; } while (0)
+
+  while (ok && pc < _Taille)
+  {
+    uint8_t code = _Programme[pc];
+    const uint8_t* operandes = &_Programme[pc + 1];
+    int32_t a = 0, b = 0;
+
+    pc += tailleInstruction(code);
+
+    switch (code)
+    {
+      case REGLE_FIN :
+        pc = _Taille;
+      break;
+
+      case REGLE_ENTIER8 :      EMPILER((int8_t)operandes[0]); break;
+      case REGLE_ENTIER32 :
+        EMPILER((int32_t)(((uint32_t)operandes[0] << 24) | ((uint32_t)operandes[1] << 16) | ((uint32_t)operandes[2] << 8) | operandes[3]));
+      break;
+      case REGLE_CAPTEUR :      EMPILER(hote->regleCapteur(operandes[0])); break;
+      case REGLE_TILE :         EMPILER(hote->regleTile(operandes[0])); break;
+      case REGLE_DECLENCHEUR :  EMPILER(declencheur.type); break;
+      case REGLE_SOURCE :       EMPILER(declencheur.source); break;
+      case REGLE_VALEUR :       EMPILER(declencheur.valeur); break;
+
+      case REGLE_NON :
+        DEPILER(a);
+        EMPILER(a == 0);
+      break;
+
+      case REGLE_SAUT_SI_FAUX :
+        DEPILER(a);
+        if (ok && a == 0)
+          pc += operandes[0];
+      break;
+
+      case REGLE_SAUT :
+        pc += operandes[0];
+      break;
+
+      case REGLE_SORTIE :
+        DEPILER(a);
+        if (ok) hote->regleSortie(operandes[0], a);
+      break;
+
+      case REGLE_PUBLIER :
+        DEPILER(a);
+        if (ok) hote->reglePublier(operandes[0], a, operandes[1]);
+      break;
+
+      case REGLE_EVENEMENT :
+        DEPILER(a);
+        if (ok) hote->regleEvenement(operandes[0], a);
+      break;
+
+      // Opérations à deux opérandes : a (empilé en premier) et b
+      default :
+        DEPILER(b);
+        DEPILER(a);
+        if (!ok)
+          break;
+        switch (code)
+        {
+          case REGLE_EGAL :           EMPILER(a == b); break;
+          case REGLE_DIFFERENT :      EMPILER(a != b); break;
+          case REGLE_INFERIEUR :      EMPILER(a < b); break;
+          case REGLE_INFERIEUR_EGAL : EMPILER(a <= b); break;
+          case REGLE_SUPERIEUR :      EMPILER(a > b); break;
+          case REGLE_SUPERIEUR_EGAL : EMPILER(a >= b); break;
+          case REGLE_ET :             EMPILER(a != 0 && b != 0); break;
+          case REGLE_OU :             EMPILER(a != 0 || b != 0); break;
+          case REGLE_ADDITION :       EMPILER((int32_t)((uint32_t)a + (uint32_t)b)); break;
+          case REGLE_SOUSTRACTION :   EMPILER((int32_t)((uint32_t)a - (uint32_t)b)); break;
+        }
+      break;
+    }
+  }
+
+  #undef EMPILER
+  #undef DEPILER
+
+  uint32_t duree = micros() - debut;
+  if (duree > _Duree_Max_us) _Duree_Max_us = duree;
+  _Nb_Executions++;
+  if (!ok) _Nb_Erreurs++;
+  return ok;
+}
+
+// ################################################################################
+// 									Persistance EEPROM
+// ################################################################################
+
+// Sauvegarde le programme : magic, taille, programme
+void Domokit_Regles::save()
+{
+  EEPROM.begin(EEPROM_TAILLE);
+  EEPROM.write(EEPROM_ADDR_REGLES, REGLES_MAGIC);
+  EEPROM.write(EEPROM_ADDR_REGLES + 1, (uint8_t)_Taille);
+  for (size_t i = 0; i < _Taille; i++)
+    EEPROM.write(EEPROM_ADDR_REGLES + 2 + i, _Programme[i]);
+  EEPROM.commit();
+}
+
+// Recharge le programme sauvegardé (vérifié comme un programme reçu)
+bool Domokit_Regles::restore()
+{
+  uint8_t programme[REGLES_TAILLE_PROGRAMME];
+  size_t taille;
+
+  EEPROM.begin(EEPROM_TAILLE);
+  if (EEPROM.read(EEPROM_ADDR_REGLES) != REGLES_MAGIC)
+    return false;
+
+  taille = EEPROM.read(EEPROM_ADDR_REGLES + 1);
+  if (taille > REGLES_TAILLE_PROGRAMME)
+    return false;
+  for (size_t i = 0; i < taille; i++)
+    programme[i] = EEPROM.read(EEPROM_ADDR_REGLES + 2 + i);
+
+  return load(programme, taille) == REGLES_OK;
+}
+
+// ################################################################################
+// 									Getters
+// ################################################################################
+size_t Domokit_Regles::getTaille()
+{
+  return _Taille;
+}
+
+unsigned long Domokit_Regles::getNbExecutions()
+{
+  return _Nb_Executions;
+}
+
+unsigned long Domokit_Regles::getNbErreurs()
+{
+  return _Nb_Erreurs;
+}
+
+uint32_t Domokit_Regles::getDureeMax()
+{
+  return _Duree_Max_us;
+}
+
+// ################################################################################
+// 									Fonctions
+// ################################################################################
+int32_t Regles_TexteToInt(const char* texte, size_t taille)
+{
+  int32_t valeur = 0;
+  bool negatif = false;
+  size_t i = 0;
+
+  if (taille == 2 && memcmp(texte, PROTOCOLE_ON, 2) == 0)
+    return 1;
+  if (taille == 3 && memcmp(texte, PROTOCOLE_OFF, 3) == 0)
+    return 0;
+
+  if (i < taille && (texte[i] == '-' || texte[i] == '+'))
+    negatif = (texte[i++] == '-');
+
+  // Le point décimal est ignoré : "21.53" -> 2153
+  for (; i < taille; i++)
+  {
+    if (texte[i] == '.')
+      continue;
+    if (texte[i] < '0' || texte[i] > '9')
+      break;
+    valeur = valeur * 10 + (texte[i] - '0');
+  }
+  return negatif ? -valeur : valeur;
+}
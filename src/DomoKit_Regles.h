@@ -0,0 +1,150 @@
+/*
+ *  =============================================================================================================================================
+ *  Titre : DomoKit_Regles.h
+ *  Auteur : Thomas Broussard
+ *  ---------------------------------------------------------------------------------------------------------------------------------------------
+ *  Description :
+ *  Moteur de règles local : un programme compilé par le serveur (bytecode)
+ *  est exécuté par l'objet à chaque évènement, échantillon de capteur ou
+ *  commande reçue, sans aller-retour par le serveur. Les règles continuent
+ *  de fonctionner si le serveur MQTT est injoignable (programme sauvegardé
+ *  en EEPROM).
+ *
+ *  Chargement : instruction REGLES;<programme en hexadécimal>
+ *               (REGLES seul efface le programme)
+ *  Réponse    : REGLES;OK;taille ou REGLES;ERREUR;position (topic_donnees)
+ *
+ *  Sorties : seules les broches déclarées par l'application (Domokit::addRuleOutput,
+ *  avant begin()) peuvent être pilotées. Un programme qui écrit sur une autre
+ *  broche est refusé au chargement (REGLES;ERREUR;position de l'instruction).
+ *
+ *  Machine à pile d'entiers 32 bits. Les sauts ne vont que vers l'avant :
+ *  un programme s'exécute toujours en un nombre d'étapes borné par sa taille.
+ *  Les opérandes sont sur 1 octet, sauf REGLE_ENTIER32 (4 octets big-endian).
+ *
+ *  Exemple : "si la commande reçue pour la tile 2 vaut 1, allumer la sortie 5
+ *  (déclarée par addRuleOutput(5)) et publier 1 sur la tile 3" :
+ *    DECLENCHEUR, ENTIER8 2, EGAL, SOURCE, ENTIER8 2, EGAL, ET,
+ *    VALEUR, ET, SAUT_SI_FAUX 9, ENTIER8 1, SORTIE 5, ENTIER8 1, PUBLIER 3 0, FIN
+ * =============================================================================================================================================
+ */
+
+#ifndef __DOMOKIT_REGLES_H__
+#define __DOMOKIT_REGLES_H__
+
+// ################################################################################
+// 									Librairies
+// ################################################################################
+  #include "Arduino.h"
+
+// ################################################################################
+// 				Defines , définition et variables globales
+// ################################################################################
+  #define REGLES_TAILLE_PROGRAMME 192   // octets de bytecode (trame hexadécimale : 2 caractères par octet,
+                                        // REGLES;<hexa> doit tenir dans TRANSPORT_TAILLE_PAYLOAD)
+  #define REGLES_TAILLE_PILE      8
+  #define REGLES_NB_SORTIES       8     // broches pilotables par les règles (voir addOutput)
+  #define REGLES_MAGIC            0xD2  // programme valide en EEPROM
+  #define REGLES_OK               -1    // programme chargé (voir load)
+
+  // Jeu d'instructions (opérandes entre parenthèses)
+  #define REGLE_FIN           0x00
+  #define REGLE_ENTIER8       0x01  // (valeur signée) -> empile
+  #define REGLE_ENTIER32      0x02  // (valeur signée, 4 octets) -> empile
+  #define REGLE_CAPTEUR       0x03  // (canal) -> empile la valeur filtrée du canal
+  #define REGLE_TILE          0x04  // (id tile) -> empile la dernière valeur envoyée à la tile
+  #define REGLE_DECLENCHEUR   0x05  // empile le type de déclencheur (DECLENCHEUR_...)
+  #define REGLE_SOURCE        0x06  // empile la source du déclencheur (source, canal ou id tile)
+  #define REGLE_VALEUR        0x07  // empile la valeur du déclencheur
+
+  #define REGLE_EGAL          0x10  // a b -> a == b
+  #define REGLE_DIFFERENT     0x11
+  #define REGLE_INFERIEUR     0x12
+  #define REGLE_INFERIEUR_EGAL 0x13
+  #define REGLE_SUPERIEUR     0x14
+  #define REGLE_SUPERIEUR_EGAL 0x15
+  #define REGLE_ET            0x16
+  #define REGLE_OU            0x17
+  #define REGLE_NON           0x18
+  #define REGLE_ADDITION      0x19
+  #define REGLE_SOUSTRACTION  0x1A
+
+  #define REGLE_SAUT_SI_FAUX  0x20  // (décalage) dépile, saute vers l'avant si 0
+  #define REGLE_SAUT          0x21  // (décalage) saute vers l'avant
+
+  #define REGLE_SORTIE        0x30  // (broche) dépile la valeur de la sortie (0 = LOW)
+  #define REGLE_PUBLIER       0x31  // (id tile, décimales) dépile la valeur publiée sur la tile
+  #define REGLE_EVENEMENT     0x32  // (source) dépile la valeur publiée comme une interruption
+
+// Déclencheurs de l'exécution du programme
+typedef enum {DECLENCHEUR_EVENEMENT, DECLENCHEUR_CAPTEUR, DECLENCHEUR_COMMANDE} Regles_Type_Declencheur;
+
+typedef struct
+{
+  uint8_t type;
+  uint8_t source;
+  int32_t valeur;
+} Regles_Declencheur;
+
+// ################################################################################
+// 									Classes
+// ################################################################################
+
+// --------------------------------------------------------------------------------
+// Données et actions accessibles aux règles (implémentées par Domokit)
+// --------------------------------------------------------------------------------
+class Domokit_Regles_Hote
+{
+  public:
+    virtual ~Domokit_Regles_Hote() {}
+
+    virtual int32_t regleCapteur(uint8_t canal) = 0;
+    virtual int32_t regleTile(uint8_t tile) = 0;
+    virtual void    regleSortie(uint8_t broche, int32_t valeur) = 0;
+    virtual void    reglePublier(uint8_t tile, int32_t valeur, uint8_t decimales) = 0;
+    virtual void    regleEvenement(uint8_t source, int32_t valeur) = 0;
+};
+
+// --------------------------------------------------------------------------------
+// Programme et machine virtuelle
+// --------------------------------------------------------------------------------
+class Domokit_Regles
+{
+  public:
+    Domokit_Regles();
+
+    bool addOutput(uint8_t broche);
+    bool isOutput(uint8_t broche);
+
+    int  load(const uint8_t* programme, size_t taille);
+    void clear();
+    bool run(const Regles_Declencheur& declencheur, Domokit_Regles_Hote* hote);
+
+    void save();
+    bool restore();
+
+    size_t        getTaille();
+    unsigned long getNbExecutions();
+    unsigned long getNbErreurs();
+    uint32_t      getDureeMax();    // µs
+
+  private:
+    static int tailleInstruction(uint8_t code);
+
+    uint8_t       _Programme[REGLES_TAILLE_PROGRAMME];
+    size_t        _Taille;
+    uint8_t       _Sorties[REGLES_NB_SORTIES];
+    uint8_t       _Nb_Sorties;
+    unsigned long _Nb_Executions;
+    unsigned long _Nb_Erreurs;
+    uint32_t      _Duree_Max_us;
+};
+
+// ################################################################################
+// 									Fonctions
+// ################################################################################
+
+// Valeur d'un texte de tile : ON = 1, OFF = 0, nombre en virgule fixe ("21.53" -> 2153)
+int32_t Regles_TexteToInt(const char* texte, size_t taille);
+
+#endif
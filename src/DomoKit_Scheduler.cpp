@@ -0,0 +1,285 @@
+/*
+ *  =============================================================================================================================================
+ *  Titre : DomoKit_Scheduler.cpp
+ *  Auteur : Thomas Broussard
+ *  ---------------------------------------------------------------------------------------------------------------------------------------------
+ *  Description :
+ *  Ordonnanceur coopératif (tas binaire trié par échéance)
+ * =============================================================================================================================================
+ */
+
+#include "DomoKit.h"
+
+// ################################################################################
+// 									Constructeur
+// ################################################################################
+Domokit_Scheduler::Domokit_Scheduler()
+{
+  for (uint8_t i = 0; i < SCHEDULER_NB_TACHES; i++)
+  {
+    _Taches[i].utilise = false;
+    _Taches[i].active = false;
+  }
+  _Taille_Tas = 0;
+}
+
+// ################################################################################
+// 									Gestion des tâches
+// ################################################################################
+
+/*===============================================================================
+  Nom 			: every
+
+  Description	: Enregistre une tâche périodique
+
+  Paramètre(s) 	: nom : nom de la tâche (statistiques)
+                  periode_ms : période d'exécution
+                  fonction : fonction à exécuter
+
+  Retour		: identifiant de la tâche (SCHEDULER_AUCUNE_TACHE si table pleine)
+===============================================================================*/
+int Domokit_Scheduler::every(const char* nom, unsigned long periode_ms, Scheduler_Fonction fonction)
+{
+  return add(nom, periode_ms, periode_ms, fonction);
+}
+
+/*===============================================================================
+  Nom 			: once
+
+  Description	: Enregistre une tâche exécutée une seule fois après un délai
+
+  Retour		: identifiant de la tâche (SCHEDULER_AUCUNE_TACHE si table pleine)
+===============================================================================*/
+int Domokit_Scheduler::once(const char* nom, unsigned long delai_ms, Scheduler_Fonction fonction)
+{
+  return add(nom, delai_ms, 0, fonction);
+}
+
+int Domokit_Scheduler::add(const char* nom, unsigned long delai_ms, unsigned long periode_ms, Scheduler_Fonction fonction)
+{
+  for (uint8_t id = 0; id < SCHEDULER_NB_TACHES; id++)
+  {
+    Scheduler_Tache* tache = &_Taches[id];
+    if (tache->utilise)
+      continue;
+
+    tache->utilise        = true;
+    tache->active         = false;
+    tache->nom            = nom;
+    tache->fonction       = fonction;
+    tache->periode_ms     = periode_ms;
+    tache->echeance_ms    = millis() + delai_ms;
+    tache->nb_executions  = 0;
+    tache->retard_max_ms  = 0;
+    tache->retard_moy_ms  = 0;
+  #ifdef DOMOKIT_PROFIL
+    tache->profil         = profil_domokit.registerSite(nom);
+  #endif
+    push(id);
+    return id;
+  }
+
+  DEBUG_PRINTLN("Scheduler : table des tâches pleine");
+  return SCHEDULER_AUCUNE_TACHE;
+}
+
+// Supprime une tâche
+void Domokit_Scheduler::cancel(int id)
+{
+  if (id < 0 || id >= SCHEDULER_NB_TACHES || !_Taches[id].utilise)
+    return;
+
+  remove(id);
+  _Taches[id].utilise = false;
+}
+
+// Modifie la période d'une tâche (prise en compte à la prochaine échéance)
+void Domokit_Scheduler::setPeriod(int id, unsigned long periode_ms)
+{
+  if (id < 0 || id >= SCHEDULER_NB_TACHES || !_Taches[id].utilise)
+    return;
+
+  _Taches[id].periode_ms = periode_ms;
+}
+
+// Demande l'exécution d'une tâche dès le prochain appel à run()
+void Domokit_Scheduler::trigger(int id)
+{
+  if (id < 0 || id >= SCHEDULER_NB_TACHES || !_Taches[id].utilise)
+    return;
+
+  remove(id);
+  _Taches[id].echeance_ms = millis();
+  push(id);
+}
+
+/*===============================================================================
+  Nom 			: run
+
+  Description	: Exécute les tâches arrivées à échéance (à appeler dans loop())
+                Chaque tâche est exécutée au plus une fois par appel, afin
+                qu'une tâche en retard ne monopolise pas la boucle principale.
+
+  Retour		: temps (ms) avant la prochaine échéance
+===============================================================================*/
+unsigned long Domokit_Scheduler::run()
+{
+  uint8_t nb_max = _Taille_Tas;
+  unsigned long maintenant = millis();
+
+  while (nb_max-- > 0 && _Taille_Tas > 0)
+  {
+    uint8_t id = _Tas[0];
+    Scheduler_Tache* tache = &_Taches[id];
+
+    if ((long)(maintenant - tache->echeance_ms) < 0)
+      break;
+
+    remove(id);
+
+    // Statistiques de gigue
+    unsigned long retard = maintenant - tache->echeance_ms;
+    if (retard > tache->retard_max_ms) tache->retard_max_ms = retard;
+    tache->retard_moy_ms = (tache->nb_executions == 0) ? retard : (tache->retard_moy_ms * 7 + retard) / 8;
+    tache->nb_executions++;
+
+    // Copie de la fonction : la tâche peut se supprimer (ou être remplacée) pendant son exécution
+    Scheduler_Fonction fonction = tache->fonction;
+  #ifdef DOMOKIT_PROFIL
+    int8_t profil = tache->profil;
+  #endif
+
+    // Replanification avant l'exécution : la tâche peut se supprimer elle-même
+    if (tache->periode_ms > 0)
+    {
+      tache->echeance_ms += tache->periode_ms;
+      // Retard supérieur à une période : on ne rattrape pas les exécutions manquées
+      if ((long)(maintenant - tache->echeance_ms) >= 0)
+        tache->echeance_ms = maintenant + tache->periode_ms;
+      push(id);
+    }
+    else
+    {
+      tache->utilise = false;
+    }
+
+    {
+      PROFIL_PORTEE_SITE(profil);
+      fonction();
+    }
+    maintenant = millis();
+  }
+
+  if (_Taille_Tas == 0)
+    return (unsigned long)-1;
+
+  long reste = (long)(_Taches[_Tas[0]].echeance_ms - millis());
+  return (reste > 0) ? (unsigned long)reste : 0;
+}
+
+// Renvoie une tâche (statistiques), NULL si l'identifiant est invalide
+const Scheduler_Tache* Domokit_Scheduler::getTache(int id)
+{
+  if (id < 0 || id >= SCHEDULER_NB_TACHES || !_Taches[id].utilise)
+    return NULL;
+  return &_Taches[id];
+}
+
+// Affiche les statistiques de gigue de toutes les tâches
+void Domokit_Scheduler::printStats(Print& sortie)
+{
+  for (uint8_t id = 0; id < SCHEDULER_NB_TACHES; id++)
+  {
+    Scheduler_Tache* tache = &_Taches[id];
+    if (!tache->utilise)
+      continue;
+
+    sortie.print(tache->nom);
+    sortie.print("\texécutions="); sortie.print(tache->nb_executions);
+    sortie.print("\tretard max="); sortie.print(tache->retard_max_ms);
+    sortie.print("ms\tretard moyen="); sortie.print(tache->retard_moy_ms);
+    sortie.println("ms");
+  }
+}
+
+// ################################################################################
+// 									Tas binaire
+// ################################################################################
+
+// Vrai si la tâche en position a doit s'exécuter avant celle en position b
+bool Domokit_Scheduler::before(uint8_t a, uint8_t b)
+{
+  return (long)(_Taches[_Tas[a]].echeance_ms - _Taches[_Tas[b]].echeance_ms) < 0;
+}
+
+void Domokit_Scheduler::swap(uint8_t a, uint8_t b)
+{
+  uint8_t tmp = _Tas[a];
+  _Tas[a] = _Tas[b];
+  _Tas[b] = tmp;
+  _Position[_Tas[a]] = a;
+  _Position[_Tas[b]] = b;
+}
+
+void Domokit_Scheduler::up(uint8_t position)
+{
+  while (position > 0)
+  {
+    uint8_t parent = (position - 1) / 2;
+    if (!before(position, parent))
+      break;
+    swap(position, parent);
+    position = parent;
+  }
+}
+
+void Domokit_Scheduler::down(uint8_t position)
+{
+  for (;;)
+  {
+    uint8_t plus_petit = position;
+    uint8_t gauche = 2 * position + 1;
+    uint8_t droite = gauche + 1;
+
+    if (gauche < _Taille_Tas && before(gauche, plus_petit)) plus_petit = gauche;
+    if (droite < _Taille_Tas && before(droite, plus_petit)) plus_petit = droite;
+    if (plus_petit == position)
+      break;
+    swap(position, plus_petit);
+    position = plus_petit;
+  }
+}
+
+// Ajoute une tâche dans le tas
+void Domokit_Scheduler::push(int id)
+{
+  if (_Taches[id].active)
+    return;
+
+  _Tas[_Taille_Tas] = id;
+  _Position[id] = _Taille_Tas;
+  _Taille_Tas++;
+  _Taches[id].active = true;
+  up(_Position[id]);
+}
+
+// Retire une tâche du tas
+void Domokit_Scheduler::remove(int id)
+{
+  if (!_Taches[id].active)
+    return;
+
+  uint8_t position = _Position[id];
+  _Taches[id].active = false;
+  _Taille_Tas--;
+
+  // Le dernier élément du tas prend la place de la tâche retirée
+  if (position != _Taille_Tas)
+  {
+    uint8_t deplace = _Tas[_Taille_Tas];
+    _Tas[position] = deplace;
+    _Position[deplace] = position;
+    up(position);
+    down(_Position[deplace]);
+  }
+}
@@ -0,0 +1,90 @@
+/*
+ *  =============================================================================================================================================
+ *  Titre : DomoKit_Scheduler.h
+ *  Auteur : Thomas Broussard
+ *  ---------------------------------------------------------------------------------------------------------------------------------------------
+ *  Description :
+ *  Ordonnanceur coopératif de la librairie Domokit.
+ *  Les tâches (périodiques ou à exécution unique) sont rangées dans un tas
+ *  binaire trié par échéance : la prochaine tâche à exécuter est toujours en
+ *  tête, sans parcourir toute la table. Le retard de chaque exécution
+ *  (gigue) est mesuré par tâche.
+ * =============================================================================================================================================
+ */
+
+#ifndef __DOMOKIT_SCHEDULER_H__
+#define __DOMOKIT_SCHEDULER_H__
+
+// ################################################################################
+// 									Librairies
+// ################################################################################
+  #include "Arduino.h"
+  #include <functional>
+  #include "DomoKit_Profil.h"
+
+// ################################################################################
+// 				Defines , définition et variables globales
+// ################################################################################
+  #define SCHEDULER_NB_TACHES   24  // nombre max de tâches enregistrées
+  #define SCHEDULER_AUCUNE_TACHE  -1
+
+// Fonction exécutée par une tâche
+typedef std::function<void(void)> Scheduler_Fonction;
+
+// Tâche de l'ordonnanceur
+typedef struct
+{
+  bool               utilise;
+  bool               active;
+  const char*        nom;
+  Scheduler_Fonction fonction;
+  unsigned long      periode_ms;    // 0 = exécution unique
+  unsigned long      echeance_ms;   // date de la prochaine exécution
+
+  // Statistiques de gigue (retard par rapport à l'échéance)
+  unsigned long      nb_executions;
+  unsigned long      retard_max_ms;
+  unsigned long      retard_moy_ms; // moyenne glissante (1/8)
+
+#ifdef DOMOKIT_PROFIL
+  int8_t             profil;        // site de profilage (nom de la tâche)
+#endif
+} Scheduler_Tache;
+
+// ################################################################################
+// 									Classes
+// ################################################################################
+class Domokit_Scheduler
+{
+  public:
+    Domokit_Scheduler();
+
+    int  every(const char* nom, unsigned long periode_ms, Scheduler_Fonction fonction);
+    int  once(const char* nom, unsigned long delai_ms, Scheduler_Fonction fonction);
+    void cancel(int id);
+    void setPeriod(int id, unsigned long periode_ms);
+    void trigger(int id);
+
+    unsigned long run();
+
+    const Scheduler_Tache* getTache(int id);
+    void printStats(Print& sortie);
+
+  private:
+    int  add(const char* nom, unsigned long delai_ms, unsigned long periode_ms, Scheduler_Fonction fonction);
+    void push(int id);
+    void remove(int id);
+    void up(uint8_t position);
+    void down(uint8_t position);
+    bool before(uint8_t a, uint8_t b);
+    void swap(uint8_t a, uint8_t b);
+
+    Scheduler_Tache _Taches[SCHEDULER_NB_TACHES];
+
+    // Tas binaire des tâches actives (indices dans _Taches)
+    uint8_t _Tas[SCHEDULER_NB_TACHES];
+    uint8_t _Position[SCHEDULER_NB_TACHES]; // position de chaque tâche dans le tas
+    uint8_t _Taille_Tas;
+};
+
+#endif
@@ -0,0 +1,487 @@
+/*
+ *  =============================================================================================================================================
+ *  Titre : DomoKit_Trace.cpp
+ *  Auteur : Thomas Broussard
+ *  ---------------------------------------------------------------------------------------------------------------------------------------------
+ *  Description :
+ *  Enregistrement du trafic MQTT (trace binaire) et rejeu dans un transport loopback
+ * =============================================================================================================================================
+ */
+
+#include "DomoKit.h"
+
+// Encode un entier en varint, renvoie le nombre d'octets écrits (5 max)
+static size_t Trace_Varint(uint8_t* dest, uint32_t valeur)
+{
+  size_t n = 0;
+  while (valeur >= 0x80)
+  {
+    dest[n++] = (uint8_t)(valeur | 0x80);
+    valeur >>= 7;
+  }
+  dest[n++] = (uint8_t)valeur;
+  return n;
+}
+
+// Empreinte d'un topic (FNV-1a) : la table des topics ne conserve pas les chaînes
+static uint32_t Trace_Hash(const char* topic, size_t taille)
+{
+  uint32_t hash = 2166136261UL;
+  for (size_t i = 0; i < taille; i++)
+    hash = (hash ^ (uint8_t)topic[i]) * 16777619UL;
+  return hash;
+}
+
+// ################################################################################
+// 									Sorties
+// ################################################################################
+
+Trace_Print::Trace_Print(Print& sortie) : _Sortie(sortie)
+{
+}
+
+void Trace_Print::write(const uint8_t* donnees, size_t taille)
+{
+  _Sortie.write(donnees, taille);
+}
+
+Trace_Flux::Trace_Flux(Domokit_Transport* transport)
+{
+  _Transport = transport;
+  _Topic = "";
+  _Taille = 0;
+  _Numero = 0;
+  _Nb_Blocs = 0;
+  _Nb_Pertes = 0;
+}
+
+// Le bloc et le topic doivent tenir dans le tampon du transport (TRANSPORT_TAILLE_PAQUET)
+void Trace_Flux::setTopic(const char* topic)
+{
+  _Topic = (topic != NULL && strlen(topic) < TRANSPORT_TAILLE_TOPIC) ? topic : "";
+}
+
+void Trace_Flux::write(const uint8_t* donnees, size_t taille)
+{
+  while (taille > 0)
+  {
+    // Octet 0 du bloc : numéro du bloc
+    if (_Taille == 0)
+      _Bloc[_Taille++] = _Numero;
+
+    size_t n = sizeof(_Bloc) - _Taille;
+    if (n > taille)
+      n = taille;
+    memcpy(&_Bloc[_Taille], donnees, n);
+    _Taille += n;
+    donnees += n;
+    taille -= n;
+
+    if (_Taille == sizeof(_Bloc))
+      flush();
+  }
+}
+
+// Publie le bloc en cours (QoS 0, sur le transport réel : le bloc n'est pas tracé)
+void Trace_Flux::flush()
+{
+  if (_Taille <= 1)
+    return;
+
+  if (_Topic[0] != '\0' && _Transport->connected() && _Transport->publish(_Topic, _Bloc, _Taille))
+    _Nb_Blocs++;
+  else
+    _Nb_Pertes += _Taille - 1;
+
+  _Numero++;
+  _Taille = 0;
+}
+
+unsigned long Trace_Flux::getNbBlocs()
+{
+  return _Nb_Blocs;
+}
+
+unsigned long Trace_Flux::getNbPertes()
+{
+  return _Nb_Pertes;
+}
+
+// ################################################################################
+// 									Enregistrement
+// ################################################################################
+
+Transport_Trace::Transport_Trace(Domokit_Transport* transport)
+{
+  _Transport = transport;
+  _Nb_Trames = 0;
+  _Nb_Octets = 0;
+  setOutput(NULL);
+
+  // Les évènements du transport réel sont relayés à l'objet (réceptions tracées)
+  _Transport->setCallback([this] (char* topic, uint8_t* payload, unsigned int length) {
+    this->record(TRACE_RECU, topic, payload, length);
+    _Date_Reception_us = _Transport->getDateReception();
+    if (_Callback_Reception) _Callback_Reception(topic, payload, length);
+  });
+  _Transport->setConnectCallback([this] () {
+    if (_Callback_Connexion) _Callback_Connexion();
+  });
+  _Transport->setAckCallback([this] (uint16_t packetId) {
+    if (_Callback_Acquittement) _Callback_Acquittement(packetId);
+  });
+}
+
+void Transport_Trace::setOutput(Domokit_Trace_Sortie* sortie)
+{
+  _Sortie = sortie;
+  _Date_ms = millis();
+  _Date_Flush_ms = _Date_ms;
+  _Prochain_Topic = 0;
+  memset(_Topics_Hash, 0, sizeof(_Topics_Hash));
+  memset(_Topics_Taille, 0, sizeof(_Topics_Taille));
+
+  output((const uint8_t*)TRACE_MAGIC, TRACE_TAILLE_MAGIC);
+}
+
+void Transport_Trace::output(const uint8_t* donnees, size_t taille)
+{
+  if (_Sortie == NULL)
+    return;
+  _Sortie->write(donnees, taille);
+  _Nb_Octets += taille;
+}
+
+/*===============================================================================
+  Nom 			: record
+
+  Description	: Ecrit une trame dans la trace (voir le format dans DomoKit_Trace.h)
+
+  Paramètre(s) 	: direction : TRACE_EMIS ou TRACE_RECU
+                  topic, payload, length : trame
+
+  Retour		: aucun
+===============================================================================*/
+void Transport_Trace::record(uint8_t direction, const char* topic, const uint8_t* payload, unsigned int length)
+{
+  uint8_t entete[1 + 5 + 5];
+  size_t n = 0;
+  size_t taille_topic = strlen(topic);
+  uint32_t hash = Trace_Hash(topic, taille_topic);
+  unsigned long maintenant = millis();
+  uint8_t index;
+
+  if (_Sortie == NULL)
+    return;
+
+  // Topic déjà transmis ? sinon, il remplace la case la plus ancienne
+  for (index = 0; index < TRACE_NB_TOPICS; index++)
+  {
+    if (_Topics_Taille[index] == taille_topic && _Topics_Hash[index] == hash)
+      break;
+  }
+  bool connu = (index < TRACE_NB_TOPICS);
+  if (!connu)
+  {
+    index = _Prochain_Topic;
+    _Prochain_Topic = (_Prochain_Topic + 1) % TRACE_NB_TOPICS;
+    _Topics_Hash[index] = hash;
+    _Topics_Taille[index] = taille_topic;
+  }
+
+  entete[n++] = direction | (connu ? TRACE_TOPIC_CONNU : 0) | (index << 2);
+  n += Trace_Varint(&entete[n], maintenant - _Date_ms);
+  _Date_ms = maintenant;
+
+  if (!connu)
+  {
+    n += Trace_Varint(&entete[n], taille_topic);
+    output(entete, n);
+    output((const uint8_t*)topic, taille_topic);
+    n = 0;
+  }
+
+  n += Trace_Varint(&entete[n], length);
+  output(entete, n);
+  output(payload, length);
+  _Nb_Trames++;
+}
+
+void Transport_Trace::setServer(const char* serveur, uint16_t port)
+{
+  _Transport->setServer(serveur, port);
+}
+
+bool Transport_Trace::connect(const char* id, const char* user, const char* password)
+{
+  if (hasWill())
+    _Transport->setWill(_Testament_Topic, _Testament_Message);
+  return _Transport->connect(id, user, password);
+}
+
+bool Transport_Trace::connected()
+{
+  return _Transport->connected();
+}
+
+bool Transport_Trace::publish(const char* topic, const uint8_t* payload, unsigned int length)
+{
+  this->record(TRACE_EMIS, topic, payload, length);
+  return _Transport->publish(topic, payload, length);
+}
+
+bool Transport_Trace::publish(const char* topic, const uint8_t* payload, unsigned int length, uint8_t qos, uint16_t* packetId)
+{
+  this->record(TRACE_EMIS, topic, payload, length);
+  return _Transport->publish(topic, payload, length, qos, packetId);
+}
+
+bool Transport_Trace::publishRetained(const char* topic, const uint8_t* payload, unsigned int length)
+{
+  this->record(TRACE_EMIS, topic, payload, length);
+  return _Transport->publishRetained(topic, payload, length);
+}
+
+bool Transport_Trace::subscribe(const char* topic)
+{
+  return _Transport->subscribe(topic);
+}
+
+bool Transport_Trace::loop()
+{
+  bool connecte = _Transport->loop();
+
+  // Sortie par blocs : bloc incomplet publié périodiquement
+  if (_Sortie != NULL && millis() - _Date_Flush_ms >= TRACE_PERIODE_FLUSH_MS)
+  {
+    _Date_Flush_ms = millis();
+    _Sortie->flush();
+  }
+  return connecte;
+}
+
+int Transport_Trace::state()
+{
+  return _Transport->state();
+}
+
+int Transport_Trace::available()
+{
+  return _Transport->available();
+}
+
+int Transport_Trace::availableForWrite()
+{
+  return _Transport->availableForWrite();
+}
+
+void Transport_Trace::disconnect()
+{
+  _Transport->disconnect();
+}
+
+unsigned long Transport_Trace::getNbTrames()
+{
+  return _Nb_Trames;
+}
+
+unsigned long Transport_Trace::getNbOctets()
+{
+  return _Nb_Octets;
+}
+
+// ################################################################################
+// 									Rejeu
+// ################################################################################
+
+Trace_Rejeu::Trace_Rejeu()
+{
+  _Facteur = 1;
+  _Ancien = NULL;
+  _Nouveau = NULL;
+  begin(NULL, 0);
+}
+
+bool Trace_Rejeu::begin(const uint8_t* trace, size_t taille)
+{
+  _Trace = trace;
+  _Taille = taille;
+  _Position = TRACE_TAILLE_MAGIC;
+  _En_Attente = false;
+  _Date_ms = 0;
+  _Demarre = false;
+  _Fin = false;
+  _Erreur = false;
+  _Nb_Injectes = 0;
+  _Nb_Emis = 0;
+  memset(_Topics_Position, 0, sizeof(_Topics_Position));
+  memset(_Topics_Taille, 0, sizeof(_Topics_Taille));
+
+  if (trace == NULL || taille < TRACE_TAILLE_MAGIC || memcmp(trace, TRACE_MAGIC, TRACE_TAILLE_MAGIC) != 0)
+  {
+    _Fin = true;
+    _Erreur = (trace != NULL);
+    return false;
+  }
+  return true;
+}
+
+void Trace_Rejeu::setSpeed(uint16_t facteur)
+{
+  _Facteur = facteur;
+}
+
+void Trace_Rejeu::setTopicRewrite(const char* ancien, const char* nouveau)
+{
+  _Ancien = ancien;
+  _Nouveau = nouveau;
+}
+
+bool Trace_Rejeu::readVarint(uint32_t* valeur)
+{
+  *valeur = 0;
+  for (uint8_t decalage = 0; decalage < 35; decalage += 7)
+  {
+    if (_Position >= _Taille)
+      return false;
+    uint8_t octet = _Trace[_Position++];
+    *valeur |= (uint32_t)(octet & 0x7F) << decalage;
+    if ((octet & 0x80) == 0)
+      return true;
+  }
+  return false;
+}
+
+// Décode l'enregistrement suivant (topic et payload restent dans la trace)
+bool Trace_Rejeu::readRecord()
+{
+  uint32_t delai, taille;
+  uint8_t entete = _Trace[_Position++];
+
+  _Direction = entete & 0x01;
+  _Topic = (entete >> 2) & (TRACE_NB_TOPICS - 1);
+
+  if (!readVarint(&delai))
+    return false;
+  _Date_ms += delai;
+
+  if (!(entete & TRACE_TOPIC_CONNU))
+  {
+    if (!readVarint(&taille) || taille >= TRANSPORT_TAILLE_TOPIC || _Position + taille > _Taille)
+      return false;
+    _Topics_Position[_Topic] = _Position;
+    _Topics_Taille[_Topic] = taille;
+    _Position += taille;
+  }
+  else if (_Topics_Taille[_Topic] == 0)
+  {
+    return false;
+  }
+
+  if (!readVarint(&_Payload_Taille) || _Position + _Payload_Taille > _Taille)
+    return false;
+  _Payload_Position = _Position;
+  _Position += _Payload_Taille;
+  return true;
+}
+
+// Topic de l'enregistrement en attente, avec la réécriture éventuelle
+void Trace_Rejeu::makeTopic(char* topic, size_t taille)
+{
+  size_t n = _Topics_Taille[_Topic];
+  if (n >= taille)
+    n = taille - 1;
+  memcpy(topic, &_Trace[_Topics_Position[_Topic]], n);
+  topic[n] = '\0';
+
+  if (_Ancien == NULL || _Nouveau == NULL)
+    return;
+
+  char* occurrence = strstr(topic, _Ancien);
+  if (occurrence == NULL)
+    return;
+
+  char suite[TRANSPORT_TAILLE_TOPIC];
+  strncpy(suite, occurrence + strlen(_Ancien), sizeof(suite) - 1);
+  suite[sizeof(suite) - 1] = '\0';
+  snprintf(occurrence, taille - (occurrence - topic), "%s%s", _Nouveau, suite);
+}
+
+/*===============================================================================
+  Nom 			: service
+
+  Description	: Injecte dans le transport les trames reçues par l'objet
+                enregistré dont la date (divisée par le facteur d'accélération)
+                est atteinte. Une trame refusée (file du transport pleine) est
+                réessayée à l'appel suivant.
+
+  Paramètre(s) 	: transport : transport loopback de l'objet hôte
+
+  Retour		: false à la fin de la trace
+===============================================================================*/
+bool Trace_Rejeu::service(Transport_Loopback* transport)
+{
+  char topic[TRANSPORT_TAILLE_TOPIC];
+
+  if (!_Demarre)
+  {
+    _Debut_ms = millis();
+    _Demarre = true;
+  }
+
+  while (!_Fin)
+  {
+    if (!_En_Attente)
+    {
+      if (_Position >= _Taille)
+      {
+        _Fin = true;
+        break;
+      }
+      if (!readRecord())
+      {
+        _Erreur = true;
+        _Fin = true;
+        break;
+      }
+      _En_Attente = true;
+    }
+
+    if (_Facteur > 0 && millis() - _Debut_ms < _Date_ms / _Facteur)
+      return true;
+
+    if (_Direction == TRACE_RECU)
+    {
+      makeTopic(topic, sizeof(topic));
+      if (!transport->inject(topic, &_Trace[_Payload_Position], _Payload_Taille))
+        return true;
+      _Nb_Injectes++;
+    }
+    else
+    {
+      _Nb_Emis++;
+    }
+    _En_Attente = false;
+  }
+  return false;
+}
+
+bool Trace_Rejeu::isFinished()
+{
+  return _Fin;
+}
+
+bool Trace_Rejeu::hasError()
+{
+  return _Erreur;
+}
+
+unsigned long Trace_Rejeu::getNbInjectes()
+{
+  return _Nb_Injectes;
+}
+
+unsigned long Trace_Rejeu::getNbEmis()
+{
+  return _Nb_Emis;
+}
@@ -0,0 +1,202 @@
+/*
+ *  =============================================================================================================================================
+ *  Titre : DomoKit_Trace.h
+ *  Auteur : Thomas Broussard
+ *  ---------------------------------------------------------------------------------------------------------------------------------------------
+ *  Description :
+ *  Enregistrement du trafic MQTT de l'objet et rejeu déterministe.
+ *
+ *  - Transport_Trace : transport intercalé entre l'objet et son transport
+ *    (Domokit::setTransport), qui écrit chaque trame émise ou reçue dans
+ *    une sortie de trace, telle qu'elle passe sur le réseau (payload crypté).
+ *  - Sorties : Trace_Print (Serial, fichier sur hôte...) et Trace_Flux, qui
+ *    publie la trace par blocs sur un topic (ex : topic_debug) directement
+ *    sur le transport réel, sans être elle-même enregistrée.
+ *  - Trace_Rejeu : injecte les trames reçues d'une trace dans un
+ *    Transport_Loopback, à la vitesse d'origine ou accélérée : le trafic
+ *    réel devient un banc d'essai reproductible pour le décodage.
+ *    La trace contient déjà les messages de l'objet renvoyés par le broker
+ *    (topics auxquels il est abonné) : au rejeu, le transport hôte ne doit
+ *    pas les redistribuer une seconde fois (voir test/test_trace.cpp).
+ *
+ *  Format (entiers en varint : 7 bits par octet, bit 7 = octet suivant) :
+ *    en-tête        : "DKT1"
+ *    enregistrement : entête (1) | délai depuis l'enregistrement précédent (ms)
+ *                     | [taille topic | topic] | taille payload | payload
+ *    entête         : bit 0 = sens (TRACE_EMIS / TRACE_RECU), bit 1 = topic
+ *                     déjà transmis, bits 2 à 5 = case de la table des topics
+ *  Un topic n'est transmis que la première fois qu'il occupe sa case.
+ *  Bloc de Trace_Flux : numéro de bloc (1) | octets de la trace
+ *  (un numéro manquant signale un bloc perdu : la suite n'est plus décodable).
+ * =============================================================================================================================================
+ */
+
+#ifndef __DOMOKIT_TRACE_H__
+#define __DOMOKIT_TRACE_H__
+
+// ################################################################################
+// 									Librairies
+// ################################################################################
+  #include "Arduino.h"
+  #include "DomoKit_Transport.h"
+
+// ################################################################################
+// 				Defines , définition et variables globales
+// ################################################################################
+  #define TRACE_MAGIC               "DKT1"
+  #define TRACE_TAILLE_MAGIC        4
+  #define TRACE_NB_TOPICS           16
+  #define TRACE_EMIS                0
+  #define TRACE_RECU                1
+  #define TRACE_TOPIC_CONNU         0x02
+  #define TRACE_TAILLE_BLOC         TRANSPORT_TAILLE_PAYLOAD  // bloc de Trace_Flux : un message du transport
+  #define TRACE_PERIODE_FLUSH_MS    1000    // bloc incomplet publié au plus tard après ce délai
+
+// ################################################################################
+// 									Classes
+// ################################################################################
+
+// --------------------------------------------------------------------------------
+// Sortie d'une trace
+// --------------------------------------------------------------------------------
+class Domokit_Trace_Sortie
+{
+  public:
+    virtual ~Domokit_Trace_Sortie() {}
+
+    virtual void write(const uint8_t* donnees, size_t taille) = 0;
+    virtual void flush() {}
+};
+
+// Trace écrite dans un flux (Serial, fichier sur hôte...)
+class Trace_Print : public Domokit_Trace_Sortie
+{
+  public:
+    Trace_Print(Print& sortie);
+
+    void write(const uint8_t* donnees, size_t taille);
+
+  private:
+    Print& _Sortie;
+};
+
+// Trace publiée par blocs sur un topic
+class Trace_Flux : public Domokit_Trace_Sortie
+{
+  public:
+    Trace_Flux(Domokit_Transport* transport);
+
+    void setTopic(const char* topic);   // ignoré s'il dépasse TRANSPORT_TAILLE_TOPIC
+    void write(const uint8_t* donnees, size_t taille);
+    void flush();
+
+    unsigned long getNbBlocs();
+    unsigned long getNbPertes();      // octets perdus (pas de topic, pas de connexion)
+
+  private:
+    Domokit_Transport* _Transport;
+    const char*        _Topic;
+    uint8_t            _Bloc[TRACE_TAILLE_BLOC];
+    size_t             _Taille;
+    uint8_t            _Numero;
+    unsigned long      _Nb_Blocs;
+    unsigned long      _Nb_Pertes;
+};
+
+// --------------------------------------------------------------------------------
+// Enregistrement : transport intercalé devant le transport réel
+// --------------------------------------------------------------------------------
+class Transport_Trace : public Domokit_Transport
+{
+  public:
+    Transport_Trace(Domokit_Transport* transport);
+
+    // Nouvelle trace (en-tête et table des topics réinitialisés), NULL : arrêt
+    void setOutput(Domokit_Trace_Sortie* sortie);
+
+    void setServer(const char* serveur, uint16_t port);
+    bool connect(const char* id, const char* user, const char* password);
+    bool connected();
+    bool publish(const char* topic, const uint8_t* payload, unsigned int length);
+    bool publish(const char* topic, const uint8_t* payload, unsigned int length, uint8_t qos, uint16_t* packetId);
+    bool publishRetained(const char* topic, const uint8_t* payload, unsigned int length);
+    bool subscribe(const char* topic);
+    bool loop();
+    int  state();
+    int  available();
+    int  availableForWrite();
+    void disconnect();
+
+    unsigned long getNbTrames();
+    unsigned long getNbOctets();      // taille de la trace
+
+  private:
+    void record(uint8_t direction, const char* topic, const uint8_t* payload, unsigned int length);
+    void output(const uint8_t* donnees, size_t taille);
+
+    Domokit_Transport*    _Transport;
+    Domokit_Trace_Sortie* _Sortie;
+    unsigned long         _Date_ms;          // dernier enregistrement
+    unsigned long         _Date_Flush_ms;
+    uint32_t              _Topics_Hash[TRACE_NB_TOPICS];
+    uint16_t              _Topics_Taille[TRACE_NB_TOPICS];
+    uint8_t               _Prochain_Topic;
+    unsigned long         _Nb_Trames;
+    unsigned long         _Nb_Octets;
+};
+
+// --------------------------------------------------------------------------------
+// Rejeu d'une trace (en mémoire) dans un transport loopback
+// --------------------------------------------------------------------------------
+class Trace_Rejeu
+{
+  public:
+    Trace_Rejeu();
+
+    bool begin(const uint8_t* trace, size_t taille);   // false si l'en-tête est invalide
+    void setSpeed(uint16_t facteur);                    // 1 : vitesse d'origine, N : N fois plus vite, 0 : sans attente
+    void setTopicRewrite(const char* ancien, const char* nouveau);  // ex : @mac de l'objet enregistré -> @mac de l'objet hôte
+
+    // Injecte les trames reçues arrivées à échéance (à appeler avec poll()),
+    // false à la fin de la trace
+    bool service(Transport_Loopback* transport);
+
+    bool          isFinished();
+    bool          hasError();         // trace tronquée ou invalide
+    unsigned long getNbInjectes();
+    unsigned long getNbEmis();        // trames émises par l'objet enregistré (non rejouées)
+
+  private:
+    bool readVarint(uint32_t* valeur);
+    bool readRecord();
+    void makeTopic(char* topic, size_t taille);
+
+    const uint8_t* _Trace;
+    size_t         _Taille;
+    size_t         _Position;
+
+    // Table des topics : position et taille dans la trace
+    size_t         _Topics_Position[TRACE_NB_TOPICS];
+    uint16_t       _Topics_Taille[TRACE_NB_TOPICS];
+
+    // Enregistrement en attente d'injection
+    bool           _En_Attente;
+    uint8_t        _Direction;
+    uint8_t        _Topic;
+    size_t         _Payload_Position;
+    uint32_t       _Payload_Taille;
+
+    uint64_t       _Date_ms;          // date de l'enregistrement dans la trace
+    unsigned long  _Debut_ms;
+    bool           _Demarre;
+    uint16_t       _Facteur;
+    const char*    _Ancien;
+    const char*    _Nouveau;
+
+    bool           _Fin;
+    bool           _Erreur;
+    unsigned long  _Nb_Injectes;
+    unsigned long  _Nb_Emis;
+};
+
+#endif
@@ -0,0 +1,555 @@
+/*
+ *  =============================================================================================================================================
+ *  Titre : DomoKit_Transport.cpp
+ *  Auteur : Thomas Broussard
+ *  ---------------------------------------------------------------------------------------------------------------------------------------------
+ *  Description :
+ *  Implémentation des transports MQTT de l'objet Domokit
+ * =============================================================================================================================================
+ */
+
+#include "DomoKit.h"
+
+// ################################################################################
+// 						              Transport PubSubClient
+// ################################################################################
+
+Transport_PubSub::Transport_PubSub() : _Client_MQTT(_Client_TCP)
+{
+  // Le buffer par défaut (256 octets) rejetterait les trames groupées (SNAPSHOT,
+  // BACKFILL, MESURES...) à l'émission comme à la réception (PubSubClient >= 2.8)
+  _Client_MQTT.setBufferSize(TRANSPORT_TAILLE_PAQUET);
+}
+
+void Transport_PubSub::setServer(const char* serveur, uint16_t port)
+{
+  _Client_MQTT.setServer(serveur, port);
+  _Client_MQTT.setCallback([this] (char* topic, byte* payload, unsigned int length) {
+    if (_Callback_Reception) _Callback_Reception(topic, payload, length);
+  });
+}
+
+bool Transport_PubSub::connect(const char* id, const char* user, const char* password)
+{
+  bool connecte;
+
+  if (hasWill())
+    connecte = _Client_MQTT.connect(id, user, password, _Testament_Topic, 1, true, _Testament_Message);
+  else
+    connecte = _Client_MQTT.connect(id, user, password);
+
+  if (!connecte)
+    return false;
+
+  if (_Callback_Connexion) _Callback_Connexion();
+  return true;
+}
+
+bool Transport_PubSub::connected()
+{
+  return _Client_MQTT.connected();
+}
+
+bool Transport_PubSub::publish(const char* topic, const uint8_t* payload, unsigned int length)
+{
+  return _Client_MQTT.publish(topic, payload, length);
+}
+
+bool Transport_PubSub::publishRetained(const char* topic, const uint8_t* payload, unsigned int length)
+{
+  return _Client_MQTT.publish(topic, payload, length, true);
+}
+
+bool Transport_PubSub::subscribe(const char* topic)
+{
+  return _Client_MQTT.subscribe(topic);
+}
+
+bool Transport_PubSub::loop()
+{
+  // Date de détection des données reçues (latence jusqu'au callback)
+  if (_Client_TCP.available() > 0)
+    _Date_Reception_us = micros();
+  return _Client_MQTT.loop();
+}
+
+int Transport_PubSub::available()
+{
+  return _Client_TCP.available();
+}
+
+int Transport_PubSub::availableForWrite()
+{
+  return _Client_TCP.availableForWrite();
+}
+
+void Transport_PubSub::disconnect()
+{
+  _Client_MQTT.disconnect();
+}
+
+int Transport_PubSub::state()
+{
+  return _Client_MQTT.state();
+}
+
+#ifdef DOMOKIT_TRANSPORT_ASYNC
+// ################################################################################
+// 						              Transport asynchrone
+// ################################################################################
+
+Transport_Async::Transport_Async()
+{
+  _Id[0] = '\0';
+  _User[0] = '\0';
+  _Password[0] = '\0';
+  _Connexion_En_Cours = false;
+  _Connexion_Etablie  = false;
+  _Tete = 0;
+  _Queue = 0;
+  _Rejet_Message = false;
+  _Tete_Ack = 0;
+  _Queue_Ack = 0;
+
+  _Client_MQTT.onConnect([this] (bool sessionPresent) {
+    _Connexion_En_Cours = false;
+    _Connexion_Etablie  = true;
+  });
+  _Client_MQTT.onDisconnect([this] (AsyncMqttClientDisconnectReason reason) {
+    _Connexion_En_Cours = false;
+  });
+  _Client_MQTT.onMessage([this] (char* topic, char* payload, AsyncMqttClientMessageProperties properties, size_t len, size_t index, size_t total) {
+    this->onMessage(topic, payload, len, index, total);
+  });
+  _Client_MQTT.onPublish([this] (uint16_t packetId) {
+    uint8_t suivant = (_Tete_Ack + 1) % TRANSPORT_NB_ACQUITTEMENTS;
+    if (suivant != _Queue_Ack)
+    {
+      _Acquittements[_Tete_Ack] = packetId;
+      _Tete_Ack = suivant;
+    }
+  });
+}
+
+void Transport_Async::setServer(const char* serveur, uint16_t port)
+{
+  _Client_MQTT.setServer(serveur, port);
+}
+
+/*===============================================================================
+  Nom 			: connect
+
+  Description	: Lance la connexion au broker sans attendre la réponse.
+                La connexion est signalée par connected(), et le callback de
+                connexion est appelé depuis loop() (contexte principal).
+
+  Retour		: true si l'objet est déjà connecté
+===============================================================================*/
+bool Transport_Async::connect(const char* id, const char* user, const char* password)
+{
+  if (_Client_MQTT.connected())
+    return true;
+
+  if (!_Connexion_En_Cours)
+  {
+    // AsyncMqttClient conserve les pointeurs : on garde une copie locale
+    strncpy(_Id, id, sizeof(_Id) - 1);             _Id[sizeof(_Id) - 1] = '\0';
+    strncpy(_User, user, sizeof(_User) - 1);       _User[sizeof(_User) - 1] = '\0';
+    strncpy(_Password, password, sizeof(_Password) - 1); _Password[sizeof(_Password) - 1] = '\0';
+
+    _Client_MQTT.setClientId(_Id);
+    _Client_MQTT.setCredentials(_User, _Password);
+    if (hasWill())
+      _Client_MQTT.setWill(_Testament_Topic, 1, true, _Testament_Message);
+
+    _Connexion_En_Cours = true;
+    _Client_MQTT.connect();
+  }
+  return false;
+}
+
+bool Transport_Async::connected()
+{
+  return _Client_MQTT.connected();
+}
+
+bool Transport_Async::publish(const char* topic, const uint8_t* payload, unsigned int length)
+{
+  if (!_Client_MQTT.connected())
+    return false;
+  return _Client_MQTT.publish(topic, 0, false, (const char*)payload, length) != 0;
+}
+
+bool Transport_Async::publish(const char* topic, const uint8_t* payload, unsigned int length, uint8_t qos, uint16_t* packetId)
+{
+  *packetId = 0;
+  if (!_Client_MQTT.connected())
+    return false;
+
+  uint16_t id = _Client_MQTT.publish(topic, qos, false, (const char*)payload, length);
+  if (qos > 0)
+    *packetId = id;
+  return id != 0;
+}
+
+bool Transport_Async::publishRetained(const char* topic, const uint8_t* payload, unsigned int length)
+{
+  if (!_Client_MQTT.connected())
+    return false;
+  return _Client_MQTT.publish(topic, 0, true, (const char*)payload, length) != 0;
+}
+
+bool Transport_Async::subscribe(const char* topic)
+{
+  return _Client_MQTT.subscribe(topic, 0) != 0;
+}
+
+// Réception d'un fragment de message (contexte réseau) : mise en file uniquement
+void Transport_Async::onMessage(char* topic, char* payload, size_t len, size_t index, size_t total)
+{
+  uint8_t suivant = (_Tete + 1) % TRANSPORT_NB_MESSAGES;
+
+  // Message trop long ou file pleine : la décision est prise au premier fragment
+  // et s'applique à tous les fragments suivants du même message
+  if (index == 0)
+    _Rejet_Message = (total > TRANSPORT_TAILLE_PAYLOAD || strlen(topic) >= TRANSPORT_TAILLE_TOPIC || suivant == _Queue);
+
+  if (_Rejet_Message)
+    return;
+
+  Transport_Message* msg = &_File[_Tete];
+  if (index == 0)
+  {
+    strcpy(msg->topic, topic);
+    msg->length = total;
+    msg->date_us = micros();
+  }
+  memcpy(msg->payload + index, payload, len);
+
+  // Dernier fragment : le message devient visible pour loop()
+  if (index + len == total)
+    _Tete = suivant;
+}
+
+/*===============================================================================
+  Nom 			: loop
+
+  Description	: Distribue les évènements en attente (connexion, messages reçus)
+                dans le contexte de la boucle principale
+===============================================================================*/
+bool Transport_Async::loop()
+{
+  if (_Connexion_Etablie)
+  {
+    _Connexion_Etablie = false;
+    if (_Callback_Connexion) _Callback_Connexion();
+  }
+
+  while (_Queue != _Tete)
+  {
+    Transport_Message* msg = &_File[_Queue];
+    _Date_Reception_us = msg->date_us;
+    if (_Callback_Reception) _Callback_Reception(msg->topic, msg->payload, msg->length);
+    _Queue = (_Queue + 1) % TRANSPORT_NB_MESSAGES;
+  }
+
+  while (_Queue_Ack != _Tete_Ack)
+  {
+    if (_Callback_Acquittement) _Callback_Acquittement(_Acquittements[_Queue_Ack]);
+    _Queue_Ack = (_Queue_Ack + 1) % TRANSPORT_NB_ACQUITTEMENTS;
+  }
+  return _Client_MQTT.connected();
+}
+
+int Transport_Async::available()
+{
+  return (_Tete + TRANSPORT_NB_MESSAGES - _Queue) % TRANSPORT_NB_MESSAGES;
+}
+
+void Transport_Async::disconnect()
+{
+  // fermeture immédiate : le broker ne répond plus
+  _Client_MQTT.disconnect(true);
+  _Connexion_En_Cours = false;
+}
+
+int Transport_Async::state()
+{
+  if (_Client_MQTT.connected()) return TRANSPORT_CONNECTE;
+  if (_Connexion_En_Cours)      return TRANSPORT_CONNEXION_EN_COURS;
+  return TRANSPORT_DECONNECTE;
+}
+#endif
+
+// ################################################################################
+// 						              Transport loopback
+// ################################################################################
+
+Transport_Loopback::Transport_Loopback()
+{
+  _Connecte = false;
+  _Lien_Actif = true;
+  _Nb_Publications = 0;
+  _Nb_Pertes = 0;
+  _Nb_Receptions = 0;
+  _Nb_Filtres = 0;
+  _Nb_Retenus = 0;
+  _Taux_Perte = 0;
+  _Prochain_PacketId = 1;
+  _Nb_Abonnements = 0;
+  _Tete = 0;
+  _Queue = 0;
+  _Tete_Ack = 0;
+  _Queue_Ack = 0;
+}
+
+void Transport_Loopback::setServer(const char* serveur, uint16_t port)
+{
+}
+
+bool Transport_Loopback::connect(const char* id, const char* user, const char* password)
+{
+  if (!_Lien_Actif)
+    return false;
+
+  _Connecte = true;
+  _Nb_Abonnements = 0;
+  if (_Callback_Connexion) _Callback_Connexion();
+  return true;
+}
+
+bool Transport_Loopback::connected()
+{
+  return _Connecte;
+}
+
+bool Transport_Loopback::publish(const char* topic, const uint8_t* payload, unsigned int length)
+{
+  if (!_Connecte)
+    return false;
+
+  _Nb_Publications++;
+
+  // Perte simulée : la publication semble réussie mais n'arrive jamais
+  if (_Taux_Perte > 0 && random(100) < _Taux_Perte)
+  {
+    _Nb_Pertes++;
+    return true;
+  }
+  return push(topic, payload, length);
+}
+
+bool Transport_Loopback::publish(const char* topic, const uint8_t* payload, unsigned int length, uint8_t qos, uint16_t* packetId)
+{
+  *packetId = 0;
+  if (qos == 0)
+    return publish(topic, payload, length);
+
+  if (!_Connecte)
+    return false;
+
+  *packetId = _Prochain_PacketId++;
+  if (_Prochain_PacketId == 0) _Prochain_PacketId = 1;
+  _Nb_Publications++;
+
+  // Perte simulée du message (ou de son PUBACK) : aucun acquittement
+  if (_Taux_Perte > 0 && random(100) < _Taux_Perte)
+  {
+    _Nb_Pertes++;
+    return true;
+  }
+
+  if (!push(topic, payload, length))
+    return true;
+
+  uint8_t suivant = (_Tete_Ack + 1) % TRANSPORT_NB_ACQUITTEMENTS;
+  if (suivant != _Queue_Ack)
+  {
+    _Acquittements[_Tete_Ack] = *packetId;
+    _Tete_Ack = suivant;
+  }
+  return true;
+}
+
+bool Transport_Loopback::publishRetained(const char* topic, const uint8_t* payload, unsigned int length)
+{
+  if (!publish(topic, payload, length))
+    return false;
+  _Nb_Retenus++;
+  return true;
+}
+
+bool Transport_Loopback::subscribe(const char* topic)
+{
+  if (_Nb_Abonnements >= TRANSPORT_NB_ABONNEMENTS || strlen(topic) >= TRANSPORT_TAILLE_TOPIC)
+    return false;
+
+  strcpy(_Abonnements[_Nb_Abonnements++], topic);
+  return true;
+}
+
+// Place libre dans la file (un message plein par case)
+int Transport_Loopback::availableForWrite()
+{
+  return (TRANSPORT_NB_MESSAGES - 1 - available()) * TRANSPORT_TAILLE_PAYLOAD;
+}
+
+void Transport_Loopback::disconnect()
+{
+  _Connecte = false;
+  _Queue_Ack = _Tete_Ack;
+}
+
+// Injection d'un message, comme s'il provenait du broker
+bool Transport_Loopback::inject(const char* topic, const char* payload)
+{
+  return push(topic, (const uint8_t*)payload, strlen(payload));
+}
+
+// Injection d'un message binaire (ex : blocs OTA, rejeu d'une trace)
+bool Transport_Loopback::inject(const char* topic, const uint8_t* payload, unsigned int length)
+{
+  return push(topic, payload, length);
+}
+
+// Simule une coupure (false) ou un rétablissement (true) du lien réseau
+void Transport_Loopback::setLinkState(bool actif)
+{
+  _Lien_Actif = actif;
+  if (!actif)
+  {
+    // le broker publie le testament de l'objet déconnecté
+    if (_Connecte && hasWill())
+    {
+      push(_Testament_Topic, (const uint8_t*)_Testament_Message, strlen(_Testament_Message));
+      _Nb_Retenus++;
+    }
+
+    // les acquittements en attente sont perdus avec la connexion
+    _Connecte = false;
+    _Queue_Ack = _Tete_Ack;
+  }
+}
+
+// Taux de perte simulé des publications (0 à 100 %)
+void Transport_Loopback::setPacketLoss(uint8_t pourcentage)
+{
+  _Taux_Perte = pourcentage;
+}
+
+unsigned long Transport_Loopback::getNbPublications()
+{
+  return _Nb_Publications;
+}
+
+unsigned long Transport_Loopback::getNbPertes()
+{
+  return _Nb_Pertes;
+}
+
+unsigned long Transport_Loopback::getNbReceptions()
+{
+  return _Nb_Receptions;
+}
+
+unsigned long Transport_Loopback::getNbFiltres()
+{
+  return _Nb_Filtres;
+}
+
+unsigned long Transport_Loopback::getNbRetenus()
+{
+  return _Nb_Retenus;
+}
+
+bool Transport_Loopback::push(const char* topic, const uint8_t* payload, unsigned int length)
+{
+  uint8_t suivant = (_Tete + 1) % TRANSPORT_NB_MESSAGES;
+  if (suivant == _Queue || length > TRANSPORT_TAILLE_PAYLOAD || strlen(topic) >= TRANSPORT_TAILLE_TOPIC)
+    return false;
+
+  strcpy(_File[_Tete].topic, topic);
+  memcpy(_File[_Tete].payload, payload, length);
+  _File[_Tete].length = length;
+  _File[_Tete].date_us = micros();
+  _Tete = suivant;
+  return true;
+}
+
+bool Transport_Loopback::loop()
+{
+  while (_Connecte && _Queue != _Tete)
+  {
+    Transport_Message* msg = &_File[_Queue];
+    _Queue = (_Queue + 1) % TRANSPORT_NB_MESSAGES;
+    _Date_Reception_us = msg->date_us;
+
+    uint8_t i;
+    for (i = 0; i < _Nb_Abonnements; i++)
+    {
+      if (Transport_TopicMatch(_Abonnements[i], msg->topic))
+      {
+        _Nb_Receptions++;
+        if (_Callback_Reception) _Callback_Reception(msg->topic, msg->payload, msg->length);
+        break;
+      }
+    }
+    if (i == _Nb_Abonnements)
+      _Nb_Filtres++;
+  }
+
+  while (_Connecte && _Queue_Ack != _Tete_Ack)
+  {
+    uint16_t packetId = _Acquittements[_Queue_Ack];
+    _Queue_Ack = (_Queue_Ack + 1) % TRANSPORT_NB_ACQUITTEMENTS;
+    if (_Callback_Acquittement) _Callback_Acquittement(packetId);
+  }
+  return _Connecte;
+}
+
+int Transport_Loopback::available()
+{
+  return (_Tete + TRANSPORT_NB_MESSAGES - _Queue) % TRANSPORT_NB_MESSAGES;
+}
+
+int Transport_Loopback::state()
+{
+  return _Connecte ? TRANSPORT_CONNECTE : TRANSPORT_DECONNECTE;
+}
+
+// ################################################################################
+// 						Fonctions externes aux classes
+// ################################################################################
+
+/*===============================================================================
+  Nom 			: Transport_TopicMatch
+
+  Description	: Vérifie qu'un topic correspond à un filtre d'abonnement MQTT
+
+  Paramètre(s) 	: filtre : filtre d'abonnement (ex : domokit/instruction/tile/<@mac>/#)
+                  topic : topic à tester
+
+  Retour		: true si le topic correspond au filtre
+===============================================================================*/
+bool Transport_TopicMatch(const char* filtre, const char* topic)
+{
+  while (*filtre != '\0')
+  {
+    if (*filtre == '#')
+      return true;
+
+    if (*filtre == '+')
+    {
+      while (*topic != '\0' && *topic != '/') topic++;
+      filtre++;
+      continue;
+    }
+
+    if (*filtre != *topic)
+      return false;
+
+    filtre++;
+    topic++;
+  }
+  return *topic == '\0';
+}
@@ -0,0 +1,283 @@
+/*
+ *  =============================================================================================================================================
+ *  Titre : DomoKit_Transport.h
+ *  Auteur : Thomas Broussard
+ *  ---------------------------------------------------------------------------------------------------------------------------------------------
+ *  Description :
+ *  Couche de transport MQTT utilisée par l'objet Domokit.
+ *  - Transport_PubSub   : client PubSubClient (bloquant pendant connect/publish)
+ *  - Transport_Async    : client AsyncMqttClient (non bloquant, réception mise en file)
+ *  - Transport_Loopback : transport en mémoire, sans réseau (tests / simulation)
+ * =============================================================================================================================================
+ */
+
+#ifndef __DOMOKIT_TRANSPORT_H__
+#define __DOMOKIT_TRANSPORT_H__
+
+// ################################################################################
+// 									Configuration
+// ################################################################################
+// Choix du transport par défaut (décommenter pour utiliser le client asynchrone)
+// nécessite la librairie AsyncMqttClient (https://github.com/marvinroger/async-mqtt-client)
+//#define DOMOKIT_TRANSPORT_ASYNC
+
+// ################################################################################
+// 									Librairies
+// ################################################################################
+  #include "Arduino.h"
+  #include <functional>
+  #include <ESP8266WiFi.h>
+  #include <PubSubClient.h>
+#ifdef DOMOKIT_TRANSPORT_ASYNC
+  #include <AsyncMqttClient.h>
+#endif
+
+// ################################################################################
+// 				Defines , définition et variables globales
+// ################################################################################
+  // Dimensionnement des files de messages (transport asynchrone et loopback)
+  #define TRANSPORT_NB_MESSAGES       8
+  #define TRANSPORT_TAILLE_TOPIC      96
+  #define TRANSPORT_TAILLE_PAYLOAD    512
+  #define TRANSPORT_NB_ABONNEMENTS    8
+  #define TRANSPORT_NB_ACQUITTEMENTS  8
+
+  // Taille d'un paquet MQTT complet : en-tête fixe (5) + longueur du topic (2)
+  // + packet ID (2) + topic + payload. Sert au buffer de PubSubClient (256 par défaut)
+  #define TRANSPORT_TAILLE_PAQUET     (TRANSPORT_TAILLE_TOPIC + TRANSPORT_TAILLE_PAYLOAD + 9)
+
+  // Identifiants MQTT (copiés par les transports qui conservent les pointeurs)
+  #define TRANSPORT_TAILLE_IDENTIFIANT 64
+  #define TRANSPORT_TAILLE_TESTAMENT   16  // message du testament (last will)
+
+  // Etats du transport (mêmes valeurs que PubSubClient::state())
+  #define TRANSPORT_CONNEXION_EN_COURS  -5
+  #define TRANSPORT_DECONNECTE          -1
+  #define TRANSPORT_CONNECTE             0
+
+// Fonction appelée à la réception d'un message (topic, payload, taille)
+typedef std::function<void(char*, uint8_t*, unsigned int)> Transport_Callback_Reception;
+
+// Fonction appelée dès que la connexion au broker est établie
+typedef std::function<void(void)> Transport_Callback_Connexion;
+
+// Fonction appelée à l'acquittement (PUBACK) d'un message QoS 1 (packet ID)
+typedef std::function<void(uint16_t)> Transport_Callback_Acquittement;
+
+// Message stocké dans une file de transport
+typedef struct
+{
+  char          topic[TRANSPORT_TAILLE_TOPIC];
+  uint8_t       payload[TRANSPORT_TAILLE_PAYLOAD];
+  unsigned int  length;
+  uint32_t      date_us;  // micros() à la réception
+} Transport_Message;
+
+// ################################################################################
+// 									Classes
+// ################################################################################
+
+// --------------------------------------------------------------------------------
+// Interface commune à tous les transports
+// --------------------------------------------------------------------------------
+class Domokit_Transport
+{
+  public:
+    Domokit_Transport() : _Date_Reception_us(0) { _Testament_Topic[0] = '\0'; _Testament_Message[0] = '\0'; }
+    virtual ~Domokit_Transport() {}
+
+    virtual void setServer(const char* serveur, uint16_t port) = 0;
+    virtual bool connect(const char* id, const char* user, const char* password) = 0;
+    virtual bool connected() = 0;
+    virtual bool publish(const char* topic, const uint8_t* payload, unsigned int length) = 0;
+    virtual bool subscribe(const char* topic) = 0;
+    virtual bool loop() = 0;
+    virtual int  state() = 0;
+
+    // Publication avec QoS. Par défaut, seul le QoS 0 est supporté : packetId vaut 0
+    // et aucun acquittement ne sera reçu.
+    virtual bool publish(const char* topic, const uint8_t* payload, unsigned int length, uint8_t qos, uint16_t* packetId)
+    {
+      *packetId = 0;
+      return publish(topic, payload, length);
+    }
+
+    // Publication d'un message retenu par le broker (QoS 0). Par défaut, le
+    // message est publié sans être retenu.
+    virtual bool publishRetained(const char* topic, const uint8_t* payload, unsigned int length)
+    {
+      return publish(topic, payload, length);
+    }
+
+    // Nombre d'octets (ou de messages) en attente de traitement, -1 si inconnu
+    virtual int available() { return -1; }
+
+    // Place libre dans le tampon d'émission (octets), -1 si inconnue
+    virtual int availableForWrite() { return -1; }
+
+    // Ferme la connexion (ex : liaison morte détectée par l'objet)
+    virtual void disconnect() {}
+
+    // Testament (last will) enregistré auprès du broker à la prochaine connexion :
+    // message retenu publié par le broker si la connexion est perdue sans déconnexion
+    void setWill(const char* topic, const char* message)
+    {
+      strncpy(_Testament_Topic, topic, sizeof(_Testament_Topic) - 1);         _Testament_Topic[sizeof(_Testament_Topic) - 1] = '\0';
+      strncpy(_Testament_Message, message, sizeof(_Testament_Message) - 1);   _Testament_Message[sizeof(_Testament_Message) - 1] = '\0';
+    }
+    bool hasWill() { return _Testament_Topic[0] != '\0'; }
+
+    // Date (micros) de réception du message en cours de distribution
+    uint32_t getDateReception() { return _Date_Reception_us; }
+
+    void setCallback(Transport_Callback_Reception callback)          { _Callback_Reception = callback; }
+    void setConnectCallback(Transport_Callback_Connexion callback)   { _Callback_Connexion = callback; }
+    void setAckCallback(Transport_Callback_Acquittement callback)    { _Callback_Acquittement = callback; }
+
+  protected:
+    Transport_Callback_Reception    _Callback_Reception;
+    Transport_Callback_Connexion    _Callback_Connexion;
+    Transport_Callback_Acquittement _Callback_Acquittement;
+    uint32_t                        _Date_Reception_us;
+    char                            _Testament_Topic[TRANSPORT_TAILLE_TOPIC];
+    char                            _Testament_Message[TRANSPORT_TAILLE_TESTAMENT];
+};
+
+// --------------------------------------------------------------------------------
+// Transport PubSubClient (comportement historique de la librairie)
+// --------------------------------------------------------------------------------
+class Transport_PubSub : public Domokit_Transport
+{
+  public:
+    Transport_PubSub();
+    using Domokit_Transport::publish;
+
+    void setServer(const char* serveur, uint16_t port);
+    bool connect(const char* id, const char* user, const char* password);
+    bool connected();
+    bool publish(const char* topic, const uint8_t* payload, unsigned int length);
+    bool publishRetained(const char* topic, const uint8_t* payload, unsigned int length);
+    bool subscribe(const char* topic);
+    bool loop();
+    int  state();
+    int  available();
+    int  availableForWrite();
+    void disconnect();
+
+  private:
+    WiFiClient    _Client_TCP;
+    PubSubClient  _Client_MQTT;
+};
+
+#ifdef DOMOKIT_TRANSPORT_ASYNC
+// --------------------------------------------------------------------------------
+// Transport asynchrone : la connexion TCP ne bloque jamais la boucle principale.
+// Les messages reçus (contexte réseau) sont mis en file puis distribués par loop()
+// --------------------------------------------------------------------------------
+class Transport_Async : public Domokit_Transport
+{
+  public:
+    Transport_Async();
+
+    void setServer(const char* serveur, uint16_t port);
+    bool connect(const char* id, const char* user, const char* password);
+    bool connected();
+    bool publish(const char* topic, const uint8_t* payload, unsigned int length);
+    bool publish(const char* topic, const uint8_t* payload, unsigned int length, uint8_t qos, uint16_t* packetId);
+    bool publishRetained(const char* topic, const uint8_t* payload, unsigned int length);
+    bool subscribe(const char* topic);
+    bool loop();
+    int  state();
+    int  available();
+    void disconnect();
+
+  private:
+    void onMessage(char* topic, char* payload, size_t len, size_t index, size_t total);
+
+    AsyncMqttClient   _Client_MQTT;
+    char              _Id[TRANSPORT_TAILLE_IDENTIFIANT];
+    char              _User[TRANSPORT_TAILLE_IDENTIFIANT];
+    char              _Password[TRANSPORT_TAILLE_IDENTIFIANT];
+
+    volatile bool     _Connexion_En_Cours;
+    volatile bool     _Connexion_Etablie; // connexion à notifier depuis loop()
+
+    // File de réception (producteur : contexte réseau / consommateur : loop())
+    Transport_Message _File[TRANSPORT_NB_MESSAGES];
+    volatile uint8_t  _Tete;
+    volatile uint8_t  _Queue;
+    bool              _Rejet_Message;     // fragments du message en cours à ignorer
+
+    // File des acquittements QoS 1 (même principe que la file de réception)
+    uint16_t          _Acquittements[TRANSPORT_NB_ACQUITTEMENTS];
+    volatile uint8_t  _Tete_Ack;
+    volatile uint8_t  _Queue_Ack;
+};
+#endif
+
+// --------------------------------------------------------------------------------
+// Transport loopback : les messages publiés sont redistribués aux abonnements
+// locaux lors de loop(). inject() simule un message provenant du serveur.
+// --------------------------------------------------------------------------------
+class Transport_Loopback : public Domokit_Transport
+{
+  public:
+    Transport_Loopback();
+
+    void setServer(const char* serveur, uint16_t port);
+    bool connect(const char* id, const char* user, const char* password);
+    bool connected();
+    bool publish(const char* topic, const uint8_t* payload, unsigned int length);
+    bool publish(const char* topic, const uint8_t* payload, unsigned int length, uint8_t qos, uint16_t* packetId);
+    bool publishRetained(const char* topic, const uint8_t* payload, unsigned int length);
+    bool subscribe(const char* topic);
+    bool loop();
+    int  state();
+    int  available();
+    int  availableForWrite();
+    void disconnect();
+
+    // Simulation
+    bool inject(const char* topic, const char* payload);
+    bool inject(const char* topic, const uint8_t* payload, unsigned int length);
+    void setLinkState(bool actif);
+    void setPacketLoss(uint8_t pourcentage);
+    unsigned long getNbPublications();
+    unsigned long getNbPertes();
+    unsigned long getNbReceptions();  // messages distribués à l'objet (abonnements)
+    unsigned long getNbFiltres();     // messages écartés (aucun abonnement)
+    unsigned long getNbRetenus();     // messages retenus publiés (naissance, testament)
+
+  private:
+    bool push(const char* topic, const uint8_t* payload, unsigned int length);
+
+    bool              _Connecte;
+    bool              _Lien_Actif;
+    unsigned long     _Nb_Publications;
+    unsigned long     _Nb_Pertes;
+    unsigned long     _Nb_Receptions;
+    unsigned long     _Nb_Filtres;
+    unsigned long     _Nb_Retenus;
+    uint8_t           _Taux_Perte; // en %
+    uint16_t          _Prochain_PacketId;
+
+    uint16_t          _Acquittements[TRANSPORT_NB_ACQUITTEMENTS];
+    uint8_t           _Tete_Ack;
+    uint8_t           _Queue_Ack;
+
+    char              _Abonnements[TRANSPORT_NB_ABONNEMENTS][TRANSPORT_TAILLE_TOPIC];
+    uint8_t           _Nb_Abonnements;
+
+    Transport_Message _File[TRANSPORT_NB_MESSAGES];
+    uint8_t           _Tete;
+    uint8_t           _Queue;
+};
+
+// ################################################################################
+// 						Fonctions externes aux classes
+// ################################################################################
+
+// Vérifie qu'un topic correspond à un filtre MQTT (wildcards '+' et '#')
+bool Transport_TopicMatch(const char* filtre, const char* topic);
+
+#endif
@@ -0,0 +1,270 @@
+/*
+ *  =============================================================================================================================================
+ *  Titre : Objet.h
+ *  Auteur : Thomas Broussard
+ *  ---------------------------------------------------------------------------------------------------------------------------------------------
+ *  Description :
+ *  Objet Domokit complet exécuté sur hôte, pour les tests de bout en bout
+ *
+ *  - Transport_Hote : Transport_Loopback qui garde (si demandé) les messages
+ *    publiés par l'objet : le test joue le rôle du serveur
+ *  - Objet_Simule : objet Domokit relié à son transport, adresse MAC propre,
+ *    démarrage jusqu'à l'authentification (START injecté par le "serveur")
+ *  - Objets_Boucle() : fait tourner plusieurs objets sur la même horloge
+ *  - Flotte : objets reliés par un broker simulé ; les messages du serveur et
+ *    les publications de chaque objet sont présentés à tous les objets, dont
+ *    le transport ne distribue que ceux de leurs abonnements
+ *
+ *  Le test définit init_Tile() et callBack_Tile() comme une application ;
+ *  Objet_Courant désigne l'objet en train de tourner (celui qui les appelle).
+ * =============================================================================================================================================
+ */
+
+#ifndef __DOMOKIT_TEST_OBJET_H__
+#define __DOMOKIT_TEST_OBJET_H__
+
+#include "DomoKit.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+// Message publié par l'objet
+struct Publication
+{
+  std::string   topic;
+  std::string   payload;
+  unsigned long date_ms;
+};
+
+class Transport_Hote : public Transport_Loopback
+{
+  public:
+    Transport_Hote() : enregistrer(true), echo(true) {}
+
+    using Transport_Loopback::publish;
+    bool publish(const char* topic, const uint8_t* payload, unsigned int length)
+    {
+      if (enregistrer)
+        publications.push_back(Publication { topic, std::string((const char*)payload, length), millis() });
+      if (!echo)
+        return connected();
+      return Transport_Loopback::publish(topic, payload, length);
+    }
+
+    bool publish(const char* topic, const uint8_t* payload, unsigned int length, uint8_t qos, uint16_t* packetId)
+    {
+      if (!echo)
+        return Domokit_Transport::publish(topic, payload, length, qos, packetId);
+      if (enregistrer && qos > 0)
+        publications.push_back(Publication { topic, std::string((const char*)payload, length), millis() });
+      return Transport_Loopback::publish(topic, payload, length, qos, packetId);
+    }
+
+    // Nombre de messages publiés sur un topic commençant par prefixe
+    unsigned compter(const std::string& prefixe)
+    {
+      unsigned n = 0;
+      for (size_t i = 0; i < publications.size(); i++)
+        if (publications[i].topic.compare(0, prefixe.size(), prefixe) == 0) n++;
+      return n;
+    }
+
+    bool                     enregistrer;   // false : aucune allocation (mesure du tas)
+    bool                     echo;          // false : publications non redistribuées à l'objet
+                                            // (rejeu : la trace contient déjà celles du broker)
+    std::vector<Publication> publications;
+};
+
+// Adresse MAC de l'objet, lue par le constructeur de Domokit
+struct Objet_Mac
+{
+  Objet_Mac(uint16_t numero)
+  {
+    uint8_t mac[6] = { 0x5C, 0xCF, 0x7F, 0x00, (uint8_t)(numero >> 8), (uint8_t)numero };
+    memcpy(WiFi.mac, mac, sizeof(mac));
+  }
+};
+
+class Objet_Simule;
+static Objet_Simule* Objet_Courant = NULL;
+
+class Objet_Simule
+{
+  public:
+    Objet_Simule(const char* nom, uint16_t numero = 1) : _Mac(numero), domokit(nom)
+    {
+      domokit.setTransport(&transport);
+    }
+
+    // Tour de boucle de l'application
+    void poll()
+    {
+      Objet_Courant = this;
+      domokit.poll();
+    }
+
+    // Boucle de l'objet pendant ms (le temps simulé avance par pas)
+    void boucle(unsigned long ms, unsigned long pas_ms = 10)
+    {
+      for (unsigned long t = 0; t < ms; t += pas_ms)
+      {
+        delay(pas_ms);
+        poll();
+      }
+    }
+
+    // Message du serveur sur <topic de l'objet>[/suffixe]
+    // (sans allocation : utilisable pendant la mesure du tas)
+    bool recevoir(Domokit_TopicId id, const char* payload, const char* suffixe = NULL)
+    {
+      char t[TAILLE_TOPIC];
+      Protocole_Vue vue = domokit.getTopic(id);
+      snprintf(t, sizeof(t), "%.*s%s%s", (int)vue.len, vue.ptr, suffixe ? "/" : "", suffixe ? suffixe : "");
+      return transport.inject(t, payload);
+    }
+
+    // begin(), connexion au broker puis authentification (START)
+    bool demarrer(unsigned long max_ms = 30000)
+    {
+      Objet_Courant = this;
+      domokit.begin();
+      for (unsigned long t = 0; t < max_ms && domokit.getAuthAttempts() == 0; t += 10)
+        boucle(10);
+      recevoir(TOPIC_INSTRUCTION, PROTOCOLE_START);
+      boucle(10);
+      return domokit.getStateProgram();
+    }
+
+    std::string topic(Domokit_TopicId id)
+    {
+      Protocole_Vue vue = domokit.getTopic(id);
+      return std::string(vue.ptr, vue.len);
+    }
+
+  private:
+    Objet_Mac _Mac;
+
+  public:
+    Transport_Hote transport;
+    Domokit        domokit;
+};
+
+// Plusieurs objets sur la même horloge simulée
+inline void Objets_Boucle(std::vector<Objet_Simule*>& objets, unsigned long ms, unsigned long pas_ms = 10)
+{
+  for (unsigned long t = 0; t < ms; t += pas_ms)
+  {
+    delay(pas_ms);
+    for (size_t i = 0; i < objets.size(); i++)
+      objets[i]->poll();
+  }
+}
+
+// --------------------------------------------------------------------------------
+// Flotte d'objets reliés à un broker simulé
+// --------------------------------------------------------------------------------
+class Flotte
+{
+  public:
+    Flotte(const char* nom, unsigned nb)
+    {
+      for (unsigned i = 0; i < nb; i++)
+        objets.push_back(new Objet_Simule(nom, i + 1));
+      _Lus.assign(nb, 0);
+      presentes.assign(nb, 0);
+      instruction_diese.assign(nb, 0);
+    }
+
+    ~Flotte()
+    {
+      for (size_t i = 0; i < objets.size(); i++)
+        delete objets[i];
+    }
+
+    // Message du serveur, présenté à tous les objets
+    void serveur(const std::string& topic, const char* payload)
+    {
+      for (size_t i = 0; i < objets.size(); i++)
+        presenter(i, topic.c_str(), payload, strlen(payload));
+    }
+
+    // Tous les objets pendant ms sur la même horloge, publications relayées à chaque pas
+    void boucle(unsigned long ms, unsigned long pas_ms = 10)
+    {
+      for (unsigned long t = 0; t < ms; t += pas_ms)
+      {
+        delay(pas_ms);
+        for (size_t i = 0; i < objets.size(); i++)
+          objets[i]->poll();
+        relayer();
+      }
+    }
+
+    // Démarrage simultané (retour du secteur) : begin() de tous les objets
+    void begin()
+    {
+      for (size_t i = 0; i < objets.size(); i++)
+      {
+        Objet_Courant = objets[i];
+        objets[i]->domokit.begin();
+      }
+    }
+
+    unsigned nbAuthentifies()
+    {
+      unsigned n = 0;
+      for (size_t i = 0; i < objets.size(); i++)
+        if (objets[i]->domokit.getStateProgram()) n++;
+      return n;
+    }
+
+    std::vector<Objet_Simule*> objets;
+
+    // Publication d'un objet vue par le serveur (avant d'être relayée)
+    std::function<void(size_t, const Publication&)> recu_serveur;
+
+    // Messages présentés à chaque objet par le broker, et parmi eux ceux
+    // qu'un abonnement à <MAIN_TOPIC>/instruction/# lui aurait distribués
+    std::vector<unsigned long> presentes;
+    std::vector<unsigned long> instruction_diese;
+
+  private:
+    void presenter(size_t i, const char* topic, const char* payload, size_t taille, bool livrer = true)
+    {
+      // le broker ne distribue qu'aux clients connectés
+      if (!objets[i]->transport.connected())
+        return;
+
+      std::string filtre = objets[i]->topic(TOPIC_INSTRUCTION);
+      filtre = filtre.substr(0, filtre.rfind('/')) + "/#";
+
+      presentes[i]++;
+      if (Transport_TopicMatch(filtre.c_str(), topic))
+        instruction_diese[i]++;
+
+      // File du transport pleine : l'objet la vide avant la suite
+      while (livrer && !objets[i]->transport.inject(topic, (const uint8_t*)payload, taille))
+        objets[i]->poll();
+    }
+
+    void relayer()
+    {
+      for (size_t i = 0; i < objets.size(); i++)
+      {
+        std::vector<Publication>& publications = objets[i]->transport.publications;
+        for (; _Lus[i] < publications.size(); _Lus[i]++)
+        {
+          Publication p = publications[_Lus[i]];
+          if (recu_serveur)
+            recu_serveur(i, p);
+          // l'objet émetteur reçoit déjà sa copie par son propre transport (comptée seulement)
+          for (size_t j = 0; j < objets.size(); j++)
+            presenter(j, p.topic.c_str(), p.payload.data(), p.payload.size(), j != i);
+        }
+      }
+    }
+
+    std::vector<size_t> _Lus;
+};
+
+#endif
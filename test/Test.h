@@ -0,0 +1,47 @@
+/*
+ *  =============================================================================================================================================
+ *  Titre : Test.h
+ *  Auteur : Thomas Broussard
+ *  ---------------------------------------------------------------------------------------------------------------------------------------------
+ *  Description :
+ *  Mini-harnais des tests hôte de la librairie Domokit (aucune dépendance)
+ *
+ *  - VERIFIE(condition) : compte un échec si la condition est fausse (le test continue)
+ *  - TEST(nom) / LANCE(nom) : déclare puis exécute un cas de test
+ *  - FIN_TESTS() : affiche le bilan, renvoie le code de sortie du programme
+ *  - Chrono_us() : horloge monotone pour les mesures de performance
+ * =============================================================================================================================================
+ */
+
+#ifndef __DOMOKIT_TEST_H__
+#define __DOMOKIT_TEST_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <chrono>
+
+static int Test_Verifications = 0;
+static int Test_Echecs = 0;
+
+#define VERIFIE(condition) \
+  do { \
+    Test_Verifications++; \
+    if (!(condition)) { \
+      Test_Echecs++; \
+      printf("  ECHEC %s:%d : %s\n", __FILE__, __LINE__, #condition); \
+    } \
+  } while (0)
+
+#define TEST(nom)   static void nom()
+#define LANCE(nom)  do { printf("- %s\n", #nom); nom(); } while (0)
+
+#define FIN_TESTS() \
+  (printf("%d vérification(s), %d échec(s)\n", Test_Verifications, Test_Echecs), Test_Echecs == 0 ? 0 : 1)
+
+static inline uint64_t Chrono_us()
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+           std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#endif
@@ -0,0 +1,125 @@
+/*
+ *  Bouchon minimal du cœur Arduino ESP8266 pour les tests hôte.
+ *  Ne déclare que ce qu'utilisent les en-têtes de la librairie ;
+ *  les définitions sont dans Stubs.cpp.
+ */
+#ifndef __STUB_ARDUINO_H__
+#define __STUB_ARDUINO_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <functional>
+#include <string>
+
+typedef uint8_t byte;
+typedef bool    boolean;
+typedef uint8_t uint8;
+
+#define HIGH   1
+#define LOW    0
+#define INPUT  0
+#define OUTPUT 1
+#define HEX    16
+#define ICACHE_RAM_ATTR
+#define IRAM_ATTR
+
+class String
+{
+  public:
+    String() {}
+    String(const char* c) { if (c) s = c; }
+    String(const std::string& x) : s(x) {}
+    String(char c) { s = c; }
+    String(int v, int base = 10)           { format(base == 16 ? "%x" : "%d", v); }
+    String(unsigned int v, int base = 10)  { format(base == 16 ? "%x" : "%u", v); }
+    String(long v, int = 10)               { format("%ld", v); }
+    String(unsigned long v, int = 10)      { format("%lu", v); }
+    String(unsigned char v, int base = 10) { format(base == 16 ? "%x" : "%u", v); }
+    String(float v, int = 2)               { format("%f", v); }
+
+    const char*  c_str() const  { return s.c_str(); }
+    unsigned int length() const { return s.size(); }
+    void         reserve(unsigned) {}
+
+    String& operator+=(const String& o) { s += o.s; return *this; }
+    String& operator+=(const char* o)   { s += o; return *this; }
+    String& operator+=(char o)          { s += o; return *this; }
+    bool operator==(const String& o) const { return s == o.s; }
+    bool operator==(const char* o) const   { return s == o; }
+    bool operator!=(const String& o) const { return s != o.s; }
+    bool operator!=(const char* o) const   { return s != o; }
+
+    bool   equals(const String& o) const     { return s == o.s; }
+    bool   startsWith(const String& o) const { return s.compare(0, o.s.size(), o.s) == 0; }
+    String substring(unsigned a) const       { return a > s.size() ? String() : String(s.substr(a)); }
+    String substring(unsigned a, unsigned b) const { return String(s.substr(a, b - a)); }
+    char   charAt(unsigned i) const          { return s[i]; }
+    int    indexOf(char c) const             { size_t p = s.find(c); return p == std::string::npos ? -1 : (int)p; }
+    long   toInt() const                     { return atol(s.c_str()); }
+    void   toCharArray(char* b, unsigned n) const { strncpy(b, s.c_str(), n); }
+
+    std::string s;
+
+  private:
+    template<class T> void format(const char* f, T v) { char b[40]; snprintf(b, sizeof(b), f, v); s = b; }
+};
+
+inline String operator+(const String& a, const String& b) { return String(a.s + b.s); }
+inline String operator+(const String& a, const char* b)   { return String(a.s + b); }
+inline String operator+(const char* a, const String& b)   { return String(a + b.s); }
+inline String operator+(const String& a, char b)          { return String(a.s + b); }
+
+class Print
+{
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t) = 0;
+    virtual size_t write(const uint8_t* b, size_t n) { for (size_t i = 0; i < n; i++) write(b[i]); return n; }
+    template<class T> size_t print(T)        { return 0; }
+    template<class T> size_t print(T, int)   { return 0; }
+    template<class T> size_t println(T)      { return 0; }
+    size_t println()                         { return 0; }
+};
+
+class HardwareSerial : public Print
+{
+  public:
+    size_t write(uint8_t) { return 1; }
+    void   begin(int) {}
+};
+extern HardwareSerial Serial;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void yield();
+void pinMode(int broche, int mode);
+void digitalWrite(int broche, int valeur);
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long graine);
+void noInterrupts();
+void interrupts();
+
+class EspClass
+{
+  public:
+    uint32_t getCycleCount();
+    uint32_t getCpuFreqMHz();
+    uint32_t getFreeHeap();
+    uint32_t getChipId();
+    bool     flashRead(uint32_t adresse, uint32_t* dest, size_t taille);
+    bool     flashWrite(uint32_t adresse, uint32_t* src, size_t taille);
+    bool     flashEraseSector(uint32_t secteur);
+    void     restart();
+    uint32_t getSketchSize();
+    uint32_t getFreeSketchSpace();
+    uint32_t random();
+};
+extern EspClass ESP;
+
+template<class T> T min(T a, T b) { return a < b ? a : b; }
+
+#endif
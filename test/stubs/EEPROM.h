@@ -0,0 +1,27 @@
+/*
+ *  Bouchon de l'EEPROM ESP8266 (tests hôte) : contenu en mémoire,
+ *  nb_commits compte les écritures en flash (un effacement de secteur chacune)
+ */
+#ifndef __STUB_EEPROM_H__
+#define __STUB_EEPROM_H__
+
+#include "Arduino.h"
+
+class EEPROMClass
+{
+  public:
+    EEPROMClass() : nb_commits(0) { memset(donnees, 0xFF, sizeof(donnees)); }
+
+    void    begin(size_t taille);
+    uint8_t read(int adresse);
+    void    write(int adresse, uint8_t valeur);
+    bool    commit();
+    template<class T> T& get(int, T& t) { return t; }
+    template<class T> const T& put(int, const T& t) { return t; }
+
+    uint8_t       donnees[4096];
+    unsigned long nb_commits;
+};
+extern EEPROMClass EEPROM;
+
+#endif
@@ -0,0 +1,66 @@
+/*
+ *  Bouchon de la pile WiFi ESP8266 (tests hôte : aucune connexion réelle).
+ *  statut et mac sont réglables par les tests (objets simulés).
+ */
+#ifndef __STUB_ESP8266WIFI_H__
+#define __STUB_ESP8266WIFI_H__
+
+#include "Arduino.h"
+#include <memory>
+
+#define WL_CONNECTED 3
+
+enum WiFiMode_t { WIFI_OFF, WIFI_STA };
+enum WiFiSleepType_t { WIFI_NONE_SLEEP, WIFI_LIGHT_SLEEP, WIFI_MODEM_SLEEP };
+
+class IPAddress {};
+inline Print& operator<<(Print& p, IPAddress) { return p; }
+
+struct WiFiEventStationModeConnected {};
+struct WiFiEventStationModeGotIP {};
+struct WiFiEventHandlerOpaque {};
+typedef std::shared_ptr<WiFiEventHandlerOpaque> WiFiEventHandler;
+
+class WiFiClass
+{
+  public:
+    WiFiClass() : statut(WL_CONNECTED) { memset(mac, 0, sizeof(mac)); }
+
+    WiFiEventHandler onStationModeConnected(std::function<void(const WiFiEventStationModeConnected&)>);
+    WiFiEventHandler onStationModeGotIP(std::function<void(const WiFiEventStationModeGotIP&)>);
+    void      macAddress(uint8_t* mac);
+    void      mode(WiFiMode_t mode);
+    void      hostname(char* nom);
+    String    hostname();
+    void      begin(char* ssid, char* password);
+    int       status();
+    String    SSID();
+    IPAddress localIP();
+    void      disconnect();
+    int32_t   RSSI();
+    bool      setSleepMode(WiFiSleepType_t type, uint8_t intervalle = 0);
+    void      forceSleepWake();
+    void      forceSleepBegin();
+
+    int       statut;
+    uint8_t   mac[6];
+};
+extern WiFiClass WiFi;
+
+class Client : public Print
+{
+  public:
+    size_t      write(uint8_t) { return 1; }
+    virtual int  available() { return 0; }
+    virtual int  availableForWrite() { return 0; }
+    virtual bool connected() { return false; }
+    virtual void stop() {}
+};
+
+class WiFiClient : public Client
+{
+  public:
+    void setNoDelay(bool) {}
+};
+
+#endif
@@ -0,0 +1,28 @@
+/*
+ *  Bouchon de PubSubClient (tests hôte : utiliser Transport_Loopback)
+ */
+#ifndef __STUB_PUBSUBCLIENT_H__
+#define __STUB_PUBSUBCLIENT_H__
+
+#include "Arduino.h"
+#include <ESP8266WiFi.h>
+
+class PubSubClient
+{
+  public:
+    PubSubClient(Client&) {}
+    PubSubClient& setServer(const char*, uint16_t) { return *this; }
+    PubSubClient& setCallback(std::function<void(char*, uint8_t*, unsigned int)>) { return *this; }
+    bool setBufferSize(uint16_t) { return true; }
+    bool connect(const char*, const char*, const char*) { return false; }
+    bool connect(const char*, const char*, const char*, const char*, uint8_t, bool, const char*) { return false; }
+    bool connected() { return false; }
+    bool publish(const char*, const uint8_t*, unsigned int) { return false; }
+    bool publish(const char*, const uint8_t*, unsigned int, bool) { return false; }
+    bool subscribe(const char*) { return false; }
+    bool loop() { return false; }
+    int  state() { return -1; }
+    void disconnect() {}
+};
+
+#endif
@@ -0,0 +1,82 @@
+/*
+ *  Définitions des bouchons Arduino / ESP8266 pour les tests hôte.
+ *  millis() et micros() suivent l'horloge du système ; Stub_Avance_ms()
+ *  permet à un test d'avancer le temps sans attendre.
+ */
+#include "Arduino.h"
+#include "EEPROM.h"
+#include "ESP8266WiFi.h"
+#include "Updater.h"
+#include <chrono>
+
+HardwareSerial Serial;
+EspClass       ESP;
+EEPROMClass    EEPROM;
+WiFiClass      WiFi;
+UpdaterClass   Update;
+
+static uint64_t Decalage_us = 0;
+
+void Stub_Avance_ms(unsigned long ms)
+{
+  Decalage_us += (uint64_t)ms * 1000;
+}
+
+static uint64_t Horloge_us()
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+           std::chrono::steady_clock::now().time_since_epoch()).count() + Decalage_us;
+}
+
+unsigned long millis() { return (unsigned long)(Horloge_us() / 1000); }
+unsigned long micros() { return (unsigned long)Horloge_us(); }
+void delay(unsigned long ms) { Stub_Avance_ms(ms); }
+void yield() {}
+void pinMode(int, int) {}
+void digitalWrite(int, int) {}
+long random(long max) { return max > 0 ? rand() % max : 0; }
+long random(long min, long max) { return max > min ? min + rand() % (max - min) : min; }
+void randomSeed(unsigned long graine) { srand(graine); }
+void noInterrupts() {}
+void interrupts() {}
+
+uint32_t EspClass::getCycleCount() { return (uint32_t)(Horloge_us() * 80); }
+uint32_t EspClass::getCpuFreqMHz() { return 80; }
+uint32_t EspClass::getFreeHeap() { return 40000; }
+uint32_t EspClass::getChipId() { return 0x123456; }
+bool     EspClass::flashRead(uint32_t, uint32_t*, size_t) { return false; }
+bool     EspClass::flashWrite(uint32_t, uint32_t*, size_t) { return false; }
+bool     EspClass::flashEraseSector(uint32_t) { return false; }
+void     EspClass::restart() {}
+uint32_t EspClass::getSketchSize() { return 0; }
+uint32_t EspClass::getFreeSketchSpace() { return 0; }
+uint32_t EspClass::random() { return (uint32_t)rand(); }
+
+void    EEPROMClass::begin(size_t) {}
+uint8_t EEPROMClass::read(int adresse) { return donnees[adresse]; }
+void    EEPROMClass::write(int adresse, uint8_t valeur) { donnees[adresse] = valeur; }
+bool    EEPROMClass::commit() { nb_commits++; return true; }
+
+WiFiEventHandler WiFiClass::onStationModeConnected(std::function<void(const WiFiEventStationModeConnected&)>) { return WiFiEventHandler(); }
+WiFiEventHandler WiFiClass::onStationModeGotIP(std::function<void(const WiFiEventStationModeGotIP&)>) { return WiFiEventHandler(); }
+void      WiFiClass::macAddress(uint8_t* adresse) { memcpy(adresse, mac, 6); }
+void      WiFiClass::mode(WiFiMode_t) {}
+void      WiFiClass::hostname(char*) {}
+String    WiFiClass::hostname() { return String(); }
+void      WiFiClass::begin(char*, char*) {}
+int       WiFiClass::status() { return statut; }
+String    WiFiClass::SSID() { return String(); }
+IPAddress WiFiClass::localIP() { return IPAddress(); }
+void      WiFiClass::disconnect() {}
+int32_t   WiFiClass::RSSI() { return -60; }
+bool      WiFiClass::setSleepMode(WiFiSleepType_t, uint8_t) { return true; }
+void      WiFiClass::forceSleepWake() {}
+void      WiFiClass::forceSleepBegin() {}
+
+bool   UpdaterClass::begin(size_t, int) { return false; }
+size_t UpdaterClass::write(uint8_t*, size_t) { return 0; }
+bool   UpdaterClass::end(bool) { return false; }
+bool   UpdaterClass::setMD5(const char*) { return false; }
+void   UpdaterClass::printError(Print&) {}
+bool   UpdaterClass::isRunning() { return false; }
+size_t UpdaterClass::remaining() { return 0; }
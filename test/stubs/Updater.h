@@ -0,0 +1,24 @@
+/*
+ *  Bouchon de l'Updater ESP8266 (tests hôte : les cibles OTA sont simulées)
+ */
+#ifndef __STUB_UPDATER_H__
+#define __STUB_UPDATER_H__
+
+#include "Arduino.h"
+
+#define U_FLASH 0
+
+class UpdaterClass
+{
+  public:
+    bool    begin(size_t taille, int commande = U_FLASH);
+    size_t  write(uint8_t* donnees, size_t taille);
+    bool    end(bool forcer = false);
+    bool    setMD5(const char* md5);
+    void    printError(Print& sortie);
+    bool    isRunning();
+    size_t  remaining();
+};
+extern UpdaterClass Update;
+
+#endif
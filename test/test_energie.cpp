@@ -0,0 +1,190 @@
+/*
+ *  =============================================================================================================================================
+ *  Titre : test_energie.cpp
+ *  Auteur : Thomas Broussard
+ *  ---------------------------------------------------------------------------------------------------------------------------------------------
+ *  Description :
+ *  Test hôte du bilan énergétique (DomoKit_Energie.h) sur un objet complet :
+ *  les compteurs d'octets et de messages sont comparés au trafic vu par le
+ *  transport (commandes injectées par le "serveur", réponses et pings de
+ *  l'objet), puis la répartition du temps et la charge estimée
+ * =============================================================================================================================================
+ */
+
+#include "Objet.h"
+#include "Test.h"
+
+// ################################################################################
+// 									Application
+// ################################################################################
+void init_Tile()
+{
+  Objet_Courant->domokit.setTileSwitch("Lampe", "lampe");
+  Objet_Courant->domokit.setTileGraph("Etat", "etat", 0, 100);
+}
+
+void callBack_Tile(String TileTopic, String payload)
+{
+  if (TileTopic == "lampe")
+    Objet_Courant->domokit.SendtoTile("etat", payload == PROTOCOLE_ON ? "100" : "0");
+}
+
+// Courants distincts par état : la charge identifie la durée de chaque état
+class Modele_Unitaire : public Domokit_Modele_Energie
+{
+  public:
+    uint32_t getCurrent(uint8_t etat)
+    {
+      static const uint32_t courants[NB_ETATS_ENERGIE] = { 1, 10, 100, 1000, 10000 };
+      return (etat < NB_ETATS_ENERGIE) ? courants[etat] : 0;
+    }
+};
+
+// Objet démarré, bilan remis à zéro ; pas d'écho : l'objet ne reçoit que les
+// commandes injectées par le test et les pings renvoyés par le "broker"
+class Objet_Energie : public Objet_Simule
+{
+  public:
+    Objet_Energie() : Objet_Simule("Energie"), publications(0), lues(0), receptions(0), pings(0), octets_injectes(0)
+    {
+      transport.echo = false;
+    }
+
+    void boucle(unsigned long ms)
+    {
+      for (unsigned long t = 0; t < ms; t += 10)
+      {
+        Objet_Simule::boucle(10);
+        for (; lues < transport.publications.size(); lues++)
+        {
+          const Publication& pub = transport.publications[lues];
+          if (pub.topic == topic(TOPIC_PING) && transport.inject(pub.topic.c_str(), (const uint8_t*)pub.payload.data(), pub.payload.size()))
+          {
+            octets_injectes += pub.topic.size() + pub.payload.size() + ENERGIE_ENTETE_MESSAGE;
+            pings++;
+          }
+        }
+      }
+    }
+
+    bool demarrer()
+    {
+      bool demarre = Objet_Simule::demarrer();
+      domokit.getEnergy().reset();
+      publications = transport.publications.size();
+      lues = publications;
+      receptions = transport.getNbReceptions();
+      return demarre;
+    }
+
+    // Commande du serveur sur la tile lampe
+    void commande(bool on)
+    {
+      const char* payload = on ? PROTOCOLE_ON : PROTOCOLE_OFF;
+      if (recevoir(TOPIC_TILE, payload, "lampe"))
+        octets_injectes += topic(TOPIC_TILE).size() + strlen("/lampe") + strlen(payload) + ENERGIE_ENTETE_MESSAGE;
+    }
+
+    // Trafic émis depuis demarrer(), compté comme le bilan (topic + payload + en-tête).
+    // Publications retenues et QoS 1 passent aussi par Transport_Hote::publish
+    unsigned long messagesEmis()
+    {
+      return transport.publications.size() - publications;
+    }
+
+    unsigned long octetsEmis()
+    {
+      unsigned long octets = 0;
+      for (size_t i = publications; i < transport.publications.size(); i++)
+        octets += transport.publications[i].topic.size() + transport.publications[i].payload.size() + ENERGIE_ENTETE_MESSAGE;
+      return octets;
+    }
+
+    size_t        publications;
+    size_t        lues;
+    unsigned long receptions;
+    unsigned long pings;             // pings renvoyés depuis demarrer()
+    unsigned long octets_injectes;
+};
+
+// ################################################################################
+// 									Tests
+// ################################################################################
+
+/*
+ * 2 min de commandes (une toutes les periode_ms) : chaque commande est reçue
+ * puis suivie d'une réponse sur la tile etat ; pings toutes les 5 s, renvoyés
+ * par le broker (sans réponse, la liaison serait coupée puis reconnectée).
+ */
+TEST(Compteurs_Trafic)
+{
+  const unsigned long periodes[] = { 1000, 200 };
+  const unsigned long duree_ms = 120000;
+  uint32_t emission_precedente = 0, courant_precedent = 0;
+
+  for (size_t p = 0; p < sizeof(periodes) / sizeof(periodes[0]); p++)
+  {
+    Objet_Energie objet;
+    Modele_Unitaire modele;
+    Domokit_Energie& energie = objet.domokit.getEnergy();
+    unsigned long nb_commandes = 0;
+
+    VERIFIE(objet.demarrer());
+    objet.domokit.setEnergyModel(&modele);
+
+    for (unsigned long t = 0; t < duree_ms; t += periodes[p])
+    {
+      objet.commande(nb_commandes % 2 == 0);
+      nb_commandes++;
+      objet.boucle(periodes[p]);
+    }
+
+    // Compteurs : exactement le trafic vu par le transport
+    unsigned long recus = objet.transport.getNbReceptions() - objet.receptions;
+    unsigned long nb_pings = objet.pings;
+    VERIFIE(nb_pings >= duree_ms / 5000 - 1);
+    VERIFIE(recus == nb_commandes + nb_pings);
+    VERIFIE(energie.getNbMessagesRecus() == recus);
+    VERIFIE(energie.getOctetsRecus() == objet.octets_injectes);
+    VERIFIE(energie.getNbMessagesEmis() == objet.messagesEmis());
+    VERIFIE(energie.getOctetsEmis() == objet.octetsEmis());
+    VERIFIE(energie.getNbMessagesEmis() >= nb_commandes + nb_pings);
+    VERIFIE(energie.getNbConnexionsWifi() == 0 && energie.getNbConnexionsMQTT() == 0);
+
+    // Répartition du temps : émission estimée à partir des octets émis, radio
+    // toujours allumée sans fenêtres d'émission (pas de veille ni de CPU seul)
+    energie.compute(objet.domokit.getRadio().getDutyCycle());
+    uint32_t emission = ((uint64_t)objet.octetsEmis() * ENERGIE_EMISSION_US_OCTET
+                         + (uint64_t)objet.messagesEmis() * ENERGIE_EMISSION_US_MESSAGE) / 1000;
+    uint32_t total = 0;
+    uint64_t charge = 0;
+    for (uint8_t etat = 0; etat < NB_ETATS_ENERGIE; etat++)
+    {
+      total += energie.getDuration(etat);
+      charge += (uint64_t)energie.getDuration(etat) * modele.getCurrent(etat);
+    }
+    VERIFIE(energie.getDuration(ENERGIE_EMISSION) == emission);
+    VERIFIE(energie.getDuration(ENERGIE_VEILLE) == 0 && energie.getDuration(ENERGIE_CPU) == 0);
+    VERIFIE(total >= duree_ms && total <= duree_ms + 100);
+    VERIFIE(energie.getAverageCurrent() == charge / total);
+
+    // Plus de trafic : plus de temps d'émission, courant moyen plus élevé
+    VERIFIE(emission > emission_precedente);
+    VERIFIE(energie.getAverageCurrent() > courant_precedent);
+    emission_precedente = emission;
+    courant_precedent = energie.getAverageCurrent();
+
+    // Modèle par défaut
+    objet.domokit.setEnergyModel(NULL);
+    energie.compute(objet.domokit.getRadio().getDutyCycle());
+    printf("  commande toutes les %4lu ms : %4lu messages émis (%6lu octets), %4lu reçus (%5lu octets), émission %4u ms, %lu µA moyens\n",
+           periodes[p], energie.getNbMessagesEmis(), energie.getOctetsEmis(), energie.getNbMessagesRecus(), energie.getOctetsRecus(),
+           (unsigned)emission, (unsigned long)energie.getAverageCurrent());
+  }
+}
+
+int main()
+{
+  LANCE(Compteurs_Trafic);
+  return FIN_TESTS();
+}
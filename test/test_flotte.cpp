@@ -0,0 +1,236 @@
+/*
+ *  =============================================================================================================================================
+ *  Titre : test_flotte.cpp
+ *  Auteur : Thomas Broussard
+ *  ---------------------------------------------------------------------------------------------------------------------------------------------
+ *  Description :
+ *  Tests hôte d'une flotte d'objets complets reliés par un broker simulé
+ *  (Flotte, voir Objet.h) : trafic reçu par objet quand la flotte grandit
+ *  (abonnements par objet et diffusion), étalement des demandes
+ *  d'authentification après une coupure de courant
+ * =============================================================================================================================================
+ */
+
+#include "Objet.h"
+#include "Test.h"
+
+// ################################################################################
+// 									Application
+// ################################################################################
+void init_Tile()
+{
+  Objet_Courant->domokit.setTileSwitch("Lampe", "lampe");
+  Objet_Courant->domokit.setTileGraph("Etat", "etat", 0, 100);
+}
+
+void callBack_Tile(String TileTopic, String payload)
+{
+  if (TileTopic == "lampe")
+    Objet_Courant->domokit.SendtoTile("etat", payload == PROTOCOLE_ON ? "100" : "0");
+}
+
+// Serveur : START en réponse à chaque demande d'authentification
+static void Serveur_Authentifie(Flotte& flotte)
+{
+  flotte.recu_serveur = [&flotte] (size_t i, const Publication& p) {
+    if (p.topic == flotte.objets[i]->topic(TOPIC_CONNEXION))
+      flotte.serveur(flotte.objets[i]->topic(TOPIC_INSTRUCTION), PROTOCOLE_START);
+  };
+}
+
+/*
+ * Serveur limité à capacite authentifications par seconde : au-delà, la
+ * demande est ignorée (serveur saturé) ou, si attente, reçoit ATTENTE;ms
+ * avec le prochain créneau libre (créneaux de 1000 / capacite ms réservés
+ * l'un après l'autre).
+ */
+struct Serveur_Limite
+{
+  Serveur_Limite(Flotte& f, unsigned c, bool a) : flotte(f), capacite(c), attente(a), seconde(~0UL), traitees(0), debut_ms(millis()), creneau_ms(millis())
+  {
+    flotte.recu_serveur = [this] (size_t i, const Publication& p) { this->recevoir(i, p); };
+  }
+
+  void recevoir(size_t i, const Publication& p)
+  {
+    if (p.topic != flotte.objets[i]->topic(TOPIC_CONNEXION))
+      return;
+
+    unsigned long s = (p.date_ms - debut_ms) / 1000;
+    if (s >= par_seconde.size())
+      par_seconde.resize(s + 1, 0);
+    par_seconde[s]++;
+    if (s != seconde)
+    {
+      seconde = s;
+      traitees = 0;
+    }
+
+    std::string instruction = flotte.objets[i]->topic(TOPIC_INSTRUCTION);
+    if (traitees < capacite)
+    {
+      traitees++;
+      flotte.serveur(instruction, PROTOCOLE_START);
+    }
+    else if (attente)
+    {
+      char trame[32];
+      creneau_ms = std::max(creneau_ms, p.date_ms + 1000) + 1000 / capacite;
+      snprintf(trame, sizeof(trame), "%s;%lu", PROTOCOLE_ATTENTE, creneau_ms - p.date_ms);
+      flotte.serveur(instruction, trame);
+    }
+  }
+
+  unsigned long demandes()
+  {
+    unsigned long n = 0;
+    for (size_t s = 0; s < par_seconde.size(); s++) n += par_seconde[s];
+    return n;
+  }
+
+  unsigned pic()
+  {
+    unsigned n = 0;
+    for (size_t s = 0; s < par_seconde.size(); s++) n = std::max(n, par_seconde[s]);
+    return n;
+  }
+
+  Flotte&               flotte;
+  unsigned              capacite;
+  bool                  attente;
+  unsigned long         seconde;
+  unsigned              traitees;
+  unsigned long         debut_ms;
+  unsigned long         creneau_ms;    // dernier créneau réservé
+  std::vector<unsigned> par_seconde;   // demandes reçues pendant chaque seconde
+};
+
+// ################################################################################
+// 									Tests
+// ################################################################################
+
+/*
+ * Pendant 1 min : une commande de tile par objet toutes les 10 s, un SNAPSHOT
+ * diffusé à toute la flotte toutes les 30 s. Chaque objet reçoit le même
+ * nombre de messages quelle que soit la taille de la flotte ; avec l'ancien
+ * abonnement à instruction/#, il aurait reçu les commandes et échos de tous.
+ */
+TEST(Trafic_Par_Objet)
+{
+  const unsigned tailles[] = { 1, 4, 16, 64 };
+  double reference = 0, reference_diese = 0;
+
+  for (size_t t = 0; t < sizeof(tailles) / sizeof(tailles[0]); t++)
+  {
+    unsigned nb = tailles[t];
+    Flotte flotte("Flotte", nb);
+    std::vector<unsigned long> receptions(nb), presentes(nb), diese(nb);
+
+    for (unsigned i = 0; i < nb; i++)
+      flotte.objets[i]->domokit.enableBroadcast();
+    Serveur_Authentifie(flotte);
+    srand(41);
+    flotte.begin();
+    flotte.boucle(AUTH_DELAI_INITIAL_MS + 500);
+    VERIFIE(flotte.nbAuthentifies() == nb);
+
+    for (unsigned i = 0; i < nb; i++)
+    {
+      receptions[i] = flotte.objets[i]->transport.getNbReceptions();
+      presentes[i] = flotte.presentes[i];
+      diese[i] = flotte.instruction_diese[i];
+    }
+
+    std::string diffusion = flotte.objets[0]->topic(TOPIC_DIFFUSION);
+    for (unsigned s = 0; s < 60; s++)
+    {
+      if (s % 10 == 0)
+        for (unsigned i = 0; i < nb; i++)
+          flotte.serveur(flotte.objets[i]->topic(TOPIC_TILE) + "/lampe", (s % 20) ? PROTOCOLE_OFF : PROTOCOLE_ON);
+      if (s % 30 == 0)
+        flotte.serveur(diffusion, PROTOCOLE_SNAPSHOT);
+      flotte.boucle(1000);
+    }
+
+    unsigned long min_recus = ~0UL, max_recus = 0;
+    double recus = 0, vus = 0, avec_diese = 0;   // moyennes par objet
+    for (unsigned i = 0; i < nb; i++)
+    {
+      unsigned long r = flotte.objets[i]->transport.getNbReceptions() - receptions[i];
+      min_recus = std::min(min_recus, r);
+      max_recus = std::max(max_recus, r);
+      recus += r;
+      vus += flotte.presentes[i] - presentes[i];
+      avec_diese += flotte.instruction_diese[i] - diese[i];
+    }
+    recus /= nb;
+    vus /= nb;
+    avec_diese /= nb;
+    if (t == 0)
+    {
+      reference = recus;
+      reference_diese = avec_diese;
+    }
+
+    // Trafic constant par objet ; avec instruction/#, proportionnel à la flotte
+    // (hors SNAPSHOT diffusés, reçus une seule fois dans les deux cas)
+    VERIFIE(min_recus == max_recus);
+    VERIFIE(recus == reference);
+    VERIFIE(avec_diese >= nb * (reference_diese - 2));
+    printf("  %2u objets : %.0f messages reçus par objet (%.0f avec instruction/#) sur %.0f messages du broker\n",
+           nb, recus, avec_diese, vus);
+  }
+}
+
+/*
+ * Retour du secteur : 100 objets démarrent ensemble face à un serveur qui
+ * authentifie 10 objets par seconde. Référence (ancien comportement) : tous
+ * les objets renvoient leur demande ensemble toutes les PERIODE_CONNEXION_MS.
+ */
+TEST(Etalement_Authentification)
+{
+  const unsigned nb = 100, capacite = 10;
+
+  // Référence calculée : par vague, capacite objets authentifiés
+  unsigned long ref_demandes = 0, ref_vagues = 0;
+  for (unsigned reste = nb; reste > 0; reste -= std::min(reste, capacite), ref_vagues++)
+    ref_demandes += reste;
+  printf("  %-18s : %lu demandes (pic %u/s), tous authentifiés en %lu s\n",
+         "référence", ref_demandes, nb, (ref_vagues - 1) * PERIODE_CONNEXION_MS / 1000);
+
+  unsigned long demandes_sans_attente = 0;
+  for (int attente = 0; attente <= 1; attente++)
+  {
+    Flotte flotte("Flotte", nb);
+    Serveur_Limite serveur(flotte, capacite, attente);
+    unsigned long debut = millis();
+    uint16_t tentatives_max = 0;
+
+    srand(43);
+    flotte.begin();
+    while (flotte.nbAuthentifies() < nb && millis() - debut < 10UL * AUTH_DELAI_MAX_MS)
+      flotte.boucle(100);
+    unsigned long duree = millis() - debut;
+
+    for (unsigned i = 0; i < nb; i++)
+      tentatives_max = std::max(tentatives_max, flotte.objets[i]->domokit.getAuthAttempts());
+
+    VERIFIE(flotte.nbAuthentifies() == nb);
+    VERIFIE(serveur.demandes() < ref_demandes);
+    VERIFIE(serveur.pic() <= nb * 2 / 3);
+    if (attente)
+      VERIFIE(serveur.demandes() <= demandes_sans_attente);
+    else
+      demandes_sans_attente = serveur.demandes();
+
+    printf("  %-17s : %lu demandes (pic %u/s, %u max par objet), tous authentifiés en %.1f s\n",
+           attente ? "backoff + ATTENTE" : "backoff", serveur.demandes(), serveur.pic(), tentatives_max, duree / 1000.0);
+  }
+}
+
+int main()
+{
+  LANCE(Trafic_Par_Objet);
+  LANCE(Etalement_Authentification);
+  return FIN_TESTS();
+}
@@ -0,0 +1,407 @@
+/*
+ *  =============================================================================================================================================
+ *  Titre : test_journal.cpp
+ *  Auteur : Thomas Broussard
+ *  ---------------------------------------------------------------------------------------------------------------------------------------------
+ *  Description :
+ *  Tests hôte du journal hors connexion (DomoKit_Journal.cpp) sur une flash NOR
+ *  simulée : lecture / confirmation / retour arrière, anneau avec pertes,
+ *  reprise après coupure d'alimentation dans begin(), puis mesure de
+ *  l'amplification d'écriture et du débit de renvoi (trames BACKFILL)
+ * =============================================================================================================================================
+ */
+
+#include "DomoKit.h"
+#include "Test.h"
+#include <vector>
+
+// ################################################################################
+// 									Flash simulée
+// ################################################################################
+
+/*
+ * Flash NOR : l'effacement remet un secteur à 0xFF, l'écriture ne fait passer
+ * des bits que de 1 à 0. Une coupure d'alimentation est simulée par un budget
+ * d'octets : l'écriture qui l'épuise n'est faite qu'en partie, puis la flash
+ * refuse toute opération jusqu'au "redémarrage" (retablir()).
+ */
+class Flash_Simulee : public Domokit_Flash
+{
+  public:
+    Flash_Simulee(uint32_t nb_secteurs) : memoire(nb_secteurs * JOURNAL_TAILLE_SECTEUR, 0xFF), _Nb_Secteurs(nb_secteurs)
+    {
+      retablir();
+    }
+
+    bool read(uint32_t adresse, uint32_t* dest, size_t taille)
+    {
+      if (coupee || adresse + taille > memoire.size() || (adresse & 3) != 0)
+        return false;
+      memcpy(dest, &memoire[adresse], taille);
+      nb_lectures++;
+      return true;
+    }
+
+    bool write(uint32_t adresse, const uint32_t* src, size_t taille)
+    {
+      const uint8_t* octets = (const uint8_t*)src;
+
+      if (coupee || adresse + taille > memoire.size() || (adresse & 3) != 0 || (taille & 3) != 0)
+        return false;
+      for (size_t i = 0; i < taille; i++)
+      {
+        if (budget == 0)
+        {
+          coupee = true;
+          return false;
+        }
+        budget--;
+        memoire[adresse + i] &= octets[i];
+      }
+      return true;
+    }
+
+    bool erase(uint32_t secteur)
+    {
+      if (coupee || secteur >= _Nb_Secteurs)
+        return false;
+      memset(&memoire[secteur * JOURNAL_TAILLE_SECTEUR], 0xFF, JOURNAL_TAILLE_SECTEUR);
+      if (couper_apres_effacement)
+        budget = 0;
+      return true;
+    }
+
+    uint32_t getNbSecteurs() { return _Nb_Secteurs; }
+
+    // Coupure après n octets écrits
+    void couperApres(unsigned long n) { budget = n; }
+    void retablir() { coupee = false; couper_apres_effacement = false; budget = (unsigned long)-1; }
+
+    std::vector<uint8_t> memoire;
+    unsigned long nb_lectures = 0;
+    unsigned long budget;
+    bool coupee;
+    bool couper_apres_effacement;
+
+  private:
+    uint32_t _Nb_Secteurs;
+};
+
+// Valeur de test : "v<n>" (taille variable)
+static const char* Valeur(unsigned n)
+{
+  static char texte[16];
+  snprintf(texte, sizeof(texte), "v%u", n);
+  return texte;
+}
+
+// ################################################################################
+// 									Tests
+// ################################################################################
+
+TEST(Montage)
+{
+  Flash_Simulee flash(4);
+  Flash_Simulee petite(1);
+  Domokit_Journal journal;
+
+  // Sans zone dédiée, le journal reste inactif
+  VERIFIE(!journal.begin(NULL));
+  VERIFIE(!journal.isActive());
+  VERIFIE(!journal.append(0, 1, "x"));
+  VERIFIE(!journal.begin(&petite));
+
+  // Zone vierge : un seul secteur est initialisé
+  VERIFIE(journal.begin(&flash));
+  VERIFIE(journal.isActive() && journal.getNbEnAttente() == 0 && journal.getNbEffacements() == 1);
+  for (uint32_t s = 1; s < 4; s++)
+    VERIFIE(flash.memoire[s * JOURNAL_TAILLE_SECTEUR] == 0xFF);
+}
+
+TEST(Confirmation_RetourArriere)
+{
+  Flash_Simulee flash(4);
+  Domokit_Journal journal;
+  Journal_Enregistrement e;
+
+  journal.begin(&flash);
+  for (unsigned i = 0; i < 10; i++)
+    VERIFIE(journal.append(i % 3, 1000 + i, Valeur(i)));
+  VERIFIE(journal.getNbEnAttente() == 10);
+
+  // 4 lus et confirmés
+  for (unsigned i = 0; i < 4; i++)
+    VERIFIE(journal.read(&e) && e.date == 1000 + i && strcmp(e.valeur, Valeur(i)) == 0 && !e.ancien);
+  journal.commit();
+  VERIFIE(journal.getNbEnAttente() == 6);
+
+  // 3 lus puis abandonnés (publication échouée) : relus à l'identique
+  for (unsigned i = 4; i < 7; i++)
+    VERIFIE(journal.read(&e) && e.date == 1000 + i);
+  journal.rewind();
+  VERIFIE(journal.getNbEnAttente() == 6);
+  VERIFIE(journal.read(&e) && e.date == 1004 && e.tile == 4 % 3);
+
+  // Redémarrage : le renvoi reprend après le dernier enregistrement confirmé
+  Domokit_Journal redemarre;
+  VERIFIE(redemarre.begin(&flash));
+  VERIFIE(redemarre.getNbEnAttente() == 6);
+  for (unsigned i = 4; i < 10; i++)
+    VERIFIE(redemarre.read(&e) && e.date == 1000 + i && e.ancien);
+  VERIFIE(!redemarre.read(&e));
+
+  // Enregistrements ajoutés après le redémarrage : date connue
+  redemarre.append(1, 5000, "nouveau");
+  VERIFIE(redemarre.read(&e) && !e.ancien && strcmp(e.valeur, "nouveau") == 0);
+  redemarre.commit();
+  VERIFIE(redemarre.getNbEnAttente() == 0);
+
+  // Tout est confirmé : rien à renvoyer après un nouveau démarrage
+  Domokit_Journal vide;
+  VERIFIE(vide.begin(&flash) && vide.getNbEnAttente() == 0 && !vide.read(&e));
+}
+
+// Une valeur de tile est enregistrée entière ; une valeur plus longue est rejetée, jamais tronquée
+TEST(Valeurs_Longues)
+{
+  Flash_Simulee flash(2);
+  Domokit_Journal journal;
+  Journal_Enregistrement e;
+  char longue[JOURNAL_TAILLE_VALEUR + 2];
+
+  VERIFIE(JOURNAL_TAILLE_VALEUR == TAILLE_VALEUR_TILE - 1);
+  journal.begin(&flash);
+
+  memset(longue, 'a', JOURNAL_TAILLE_VALEUR);
+  longue[JOURNAL_TAILLE_VALEUR - 1] = 'z';
+  longue[JOURNAL_TAILLE_VALEUR] = '\0';
+  VERIFIE(journal.append(0, 1, longue));
+  VERIFIE(journal.append(0, 2, ""));
+
+  longue[JOURNAL_TAILLE_VALEUR] = 'x';
+  longue[JOURNAL_TAILLE_VALEUR + 1] = '\0';
+  VERIFIE(!journal.append(0, 3, longue));
+  VERIFIE(journal.getNbRejets() == 1 && journal.getNbEnAttente() == 2);
+
+  longue[JOURNAL_TAILLE_VALEUR] = '\0';
+  VERIFIE(journal.read(&e) && strcmp(e.valeur, longue) == 0);
+  VERIFIE(journal.read(&e) && e.valeur[0] == '\0' && e.date == 2);
+  VERIFIE(!journal.read(&e));
+
+  // Relu à l'identique après un redémarrage
+  Domokit_Journal redemarre;
+  VERIFIE(redemarre.begin(&flash) && redemarre.read(&e) && strcmp(e.valeur, longue) == 0);
+}
+
+// L'anneau réutilise le plus ancien secteur : ses enregistrements non renvoyés sont perdus
+TEST(Anneau_Pertes)
+{
+  const unsigned nb = 3000;
+  Flash_Simulee flash(3);
+  Domokit_Journal journal;
+  Journal_Enregistrement e;
+
+  journal.begin(&flash);
+  for (unsigned i = 0; i < nb; i++)
+    VERIFIE(journal.append(i % 8, i, Valeur(i)));
+
+  VERIFIE(journal.getNbPertes() > 0);
+  VERIFIE(journal.getNbEnAttente() + journal.getNbPertes() == nb);
+
+  // Les enregistrements restants sont les plus récents, dans l'ordre
+  unsigned attendu = nb - journal.getNbEnAttente();
+  unsigned lus = 0;
+  bool ordre = true;
+  while (journal.read(&e))
+  {
+    ordre = ordre && (e.date == attendu + lus) && strcmp(e.valeur, Valeur(e.date)) == 0;
+    lus++;
+  }
+  VERIFIE(ordre);
+  VERIFIE(lus == journal.getNbEnAttente());
+  journal.commit();
+
+  // Perte pendant une lecture en cours : le curseur revient au plus ancien conservé
+  Flash_Simulee flash2(2);
+  Domokit_Journal journal2;
+  journal2.begin(&flash2);
+  for (unsigned i = 0; i < 300; i++)
+    journal2.append(0, i, Valeur(i));
+  journal2.read(&e);
+  VERIFIE(e.date == 0);
+  for (unsigned i = 300; i < 1000; i++)
+    journal2.append(0, i, Valeur(i));
+  VERIFIE(journal2.getNbPertes() > 0);
+  VERIFIE(journal2.read(&e) && e.date == 1000 - journal2.getNbEnAttente());
+}
+
+/*
+ * Coupure pendant append (à chaque octet d'un enregistrement), pendant
+ * l'ouverture d'un secteur et pendant la confirmation : après redémarrage,
+ * begin() retrouve tous les enregistrements complets, ignore celui qui a
+ * été interrompu, et les écritures suivantes sont relues correctement.
+ */
+TEST(Coupure_Alimentation)
+{
+  Journal_Enregistrement e;
+
+  for (unsigned coupure = 0; coupure <= 16; coupure++)
+  {
+    Flash_Simulee flash(3);
+    Domokit_Journal journal;
+    journal.begin(&flash);
+    for (unsigned i = 0; i < 5; i++)
+      journal.append(0, i, Valeur(i));
+
+    flash.couperApres(coupure);
+    bool ecrit = journal.append(0, 5, "interrompu!!");   // 8 + 12 octets
+    flash.retablir();
+
+    Domokit_Journal redemarre;
+    VERIFIE(redemarre.begin(&flash));
+    unsigned attendus = ecrit ? 6 : 5;
+    VERIFIE(redemarre.getNbEnAttente() == attendus);
+    VERIFIE(redemarre.append(1, 6, "apres"));
+
+    unsigned lus = 0;
+    bool ok = true;
+    while (redemarre.read(&e))
+    {
+      if (lus < 5)
+        ok = ok && e.date == lus;
+      lus++;
+    }
+    VERIFIE(ok && lus == attendus + 1);
+    VERIFIE(strcmp(e.valeur, "apres") == 0);
+  }
+
+  // Coupure entre l'effacement d'un secteur et l'écriture de son en-tête
+  {
+    Flash_Simulee flash(3);
+    Domokit_Journal journal;
+    journal.begin(&flash);
+    unsigned n = 0;
+    flash.couper_apres_effacement = true;
+    while (journal.append(0, n, Valeur(n)))
+      n++;
+    VERIFIE(flash.coupee && n > 0);
+    flash.retablir();
+
+    Domokit_Journal redemarre;
+    VERIFIE(redemarre.begin(&flash));
+    VERIFIE(redemarre.getNbEnAttente() == n);
+    VERIFIE(redemarre.append(0, 9999, "apres"));
+    unsigned lus = 0;
+    while (redemarre.read(&e))
+      lus++;
+    VERIFIE(lus == n + 1 && e.date == 9999);
+  }
+
+  // Coupure pendant la confirmation : les enregistrements lus sont renvoyés à nouveau
+  {
+    Flash_Simulee flash(2);
+    Domokit_Journal journal;
+    journal.begin(&flash);
+    for (unsigned i = 0; i < 4; i++)
+      journal.append(0, i, Valeur(i));
+    journal.read(&e);
+    journal.read(&e);
+    flash.couperApres(0);
+    journal.commit();
+    flash.retablir();
+
+    Domokit_Journal redemarre;
+    VERIFIE(redemarre.begin(&flash) && redemarre.getNbEnAttente() == 4);
+  }
+}
+
+// ################################################################################
+// 									Performances
+// ################################################################################
+
+// Octets écrits en flash (en-têtes, remplissage, marquage, secteurs) par octet utile
+TEST(Amplification_Ecriture)
+{
+  const unsigned nb = 20000;
+  const char* valeurs[] = { "21.5", "ON", "1013.25", "-4" };
+
+  for (unsigned lot = 1; lot <= 100; lot *= 10)
+  {
+    Flash_Simulee flash(8);
+    Domokit_Journal journal;
+    Journal_Enregistrement e;
+
+    journal.begin(&flash);
+    for (unsigned i = 0; i < nb; i++)
+    {
+      journal.append(i % 8, i, valeurs[i % 4]);
+      if ((i + 1) % lot == 0)
+      {
+        while (journal.read(&e)) {}
+        journal.commit();
+      }
+    }
+
+    double amplification = journal.getOctetsEcrits() / (double)journal.getOctetsUtiles();
+    VERIFIE(amplification < 2.5);
+    VERIFIE(journal.getNbPertes() == 0);
+    printf("  confirmation tous les %3u : amplification %.2f, %.1f secteurs effacés / 1000 valeurs\n",
+           lot, amplification, journal.getNbEffacements() * 1000.0 / nb);
+  }
+}
+
+// Renvoi à la reconnexion : mêmes trames que Domokit::publishBackfill
+TEST(Debit_Backfill)
+{
+  const size_t taille_entree = 1 + 3 + 1 + 11 + 1 + JOURNAL_TAILLE_VALEUR;
+  Flash_Simulee flash(JOURNAL_NB_SECTEURS_MAX);
+  Domokit_Journal journal;
+  Journal_Enregistrement e;
+  char trame[TAILLE_SNAPSHOT];
+
+  journal.begin(&flash);
+  unsigned nb = 0;
+  while (journal.getNbPertes() == 0)
+    journal.append(nb % 8, nb, Valeur(nb)), nb++;
+  unsigned long en_attente = journal.getNbEnAttente();
+  unsigned long lectures = flash.nb_lectures;
+
+  unsigned long nb_trames = 0, nb_entrees = 0, octets = 0;
+  uint64_t debut = Chrono_us();
+  for (;;)
+  {
+    size_t taille = Protocole_EncodeBackfillHeader(trame, sizeof(trame));
+    int entrees = 0;
+    while (taille + taille_entree < sizeof(trame) && journal.read(&e))
+    {
+      taille = Protocole_AppendBackfillEntry(trame, sizeof(trame), taille, e.tile, (int32_t)(nb - e.date), e.valeur);
+      entrees++;
+    }
+    if (entrees == 0)
+      break;
+    journal.commit();
+    nb_trames++;
+    nb_entrees += entrees;
+    octets += taille;
+  }
+  uint64_t duree = Chrono_us() - debut;
+
+  VERIFIE(nb_entrees == en_attente);
+  VERIFIE(journal.getNbEnAttente() == 0);
+  printf("  %lu valeurs en %lu trames BACKFILL (%.1f valeurs/trame, %lu octets), %.1f lectures flash/valeur\n",
+         nb_entrees, nb_trames, nb_entrees / (double)nb_trames, octets, (flash.nb_lectures - lectures) / (double)nb_entrees);
+  printf("  hôte : %.2f M valeurs/s ; objet (1 trame / %u ms) : vidage en %.1f s\n",
+         duree ? nb_entrees / (double)duree : 0.0, JOURNAL_PERIODE_BACKFILL_MS, nb_trames * JOURNAL_PERIODE_BACKFILL_MS / 1000.0);
+}
+
+int main()
+{
+  LANCE(Montage);
+  LANCE(Confirmation_RetourArriere);
+  LANCE(Valeurs_Longues);
+  LANCE(Anneau_Pertes);
+  LANCE(Coupure_Alimentation);
+  LANCE(Amplification_Ecriture);
+  LANCE(Debit_Backfill);
+  return FIN_TESTS();
+}
@@ -0,0 +1,575 @@
+/*
+ *  =============================================================================================================================================
+ *  Titre : test_ota.cpp
+ *  Auteur : Thomas Broussard
+ *  ---------------------------------------------------------------------------------------------------------------------------------------------
+ *  Description :
+ *  Tests hôte de la mise à jour par MQTT (DomoKit_OTA.cpp) sur une flash simulée :
+ *  rejet des blocs au CRC faux, reprise, acquittements par fenêtre, échec MD5,
+ *  décodeur de delta, puis estimation du temps de mise à jour, et delta
+ *  calculé par tools/delta entre deux vraies images (construites par le Makefile)
+ * =============================================================================================================================================
+ */
+
+#include "DomoKit.h"
+#include "Test.h"
+#include "../tools/Delta.h"
+#include <vector>
+
+// ################################################################################
+// 									MD5 (RFC 1321)
+// ################################################################################
+static void MD5(const uint8_t* donnees, size_t taille, char hexa[33])
+{
+  static const uint32_t K[64] =
+  {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+  };
+  static const uint8_t R[64] =
+  {
+    7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+    5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20,
+    4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+    6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21
+  };
+
+  uint32_t h[4] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 };
+  std::vector<uint8_t> message(donnees, donnees + taille);
+  uint64_t bits = (uint64_t)taille * 8;
+
+  message.push_back(0x80);
+  while (message.size() % 64 != 56)
+    message.push_back(0);
+  for (int i = 0; i < 8; i++)
+    message.push_back((uint8_t)(bits >> (8 * i)));
+
+  for (size_t bloc = 0; bloc < message.size(); bloc += 64)
+  {
+    uint32_t w[16];
+    for (int i = 0; i < 16; i++)
+      w[i] = message[bloc + 4 * i] | (message[bloc + 4 * i + 1] << 8) | (message[bloc + 4 * i + 2] << 16) | ((uint32_t)message[bloc + 4 * i + 3] << 24);
+
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3];
+    for (int i = 0; i < 64; i++)
+    {
+      uint32_t f, g;
+      if (i < 16)      { f = (b & c) | (~b & d); g = i; }
+      else if (i < 32) { f = (d & b) | (~d & c); g = (5 * i + 1) % 16; }
+      else if (i < 48) { f = b ^ c ^ d;          g = (3 * i + 5) % 16; }
+      else             { f = c ^ (b | ~d);       g = (7 * i) % 16; }
+      uint32_t t = d;
+      d = c;
+      c = b;
+      uint32_t x = a + f + K[i] + w[g];
+      b = b + ((x << R[i]) | (x >> (32 - R[i])));
+      a = t;
+    }
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+  }
+
+  for (int i = 0; i < 16; i++)
+    snprintf(hexa + 2 * i, 3, "%02x", (h[i / 4] >> (8 * (i % 4))) & 0xFF);
+}
+
+// ################################################################################
+// 									Flash simulée
+// ################################################################################
+
+// Cible : zone de la nouvelle application, MD5 vérifié par end() comme l'Updater
+class Cible_Simulee : public Domokit_OTA_Cible
+{
+  public:
+    Cible_Simulee() : nb_debuts(0), nb_abandons(0), active(false), _Ouverte(false), _Taille(0) { _MD5[0] = '\0'; }
+
+    bool begin(uint32_t taille, const char* md5)
+    {
+      if (taille > 1024 * 1024)
+        return false;
+      image.clear();
+      _Taille = taille;
+      strncpy(_MD5, md5, sizeof(_MD5) - 1);
+      _MD5[sizeof(_MD5) - 1] = '\0';
+      _Ouverte = true;
+      active = false;
+      nb_debuts++;
+      return true;
+    }
+
+    size_t write(const uint8_t* donnees, size_t taille)
+    {
+      if (!_Ouverte || image.size() + taille > _Taille)
+        return 0;
+      image.insert(image.end(), donnees, donnees + taille);
+      return taille;
+    }
+
+    bool end()
+    {
+      char md5[33];
+      if (!_Ouverte || image.size() != _Taille)
+        return false;
+      _Ouverte = false;
+      MD5(image.data(), image.size(), md5);
+      active = (strcmp(md5, _MD5) == 0);
+      return active;
+    }
+
+    void abort()
+    {
+      _Ouverte = false;
+      nb_abandons++;
+    }
+
+    std::vector<uint8_t> image;
+    int  nb_debuts;
+    int  nb_abandons;
+    bool active;    // image vérifiée, activée au prochain démarrage
+
+  private:
+    bool     _Ouverte;
+    uint32_t _Taille;
+    char     _MD5[33];
+};
+
+// Source : image en cours d'exécution (lecture par mots de 4 octets, 0xFF au-delà)
+class Source_Simulee : public Domokit_OTA_Source
+{
+  public:
+    bool read(uint32_t adresse, uint32_t* dest, size_t taille)
+    {
+      if ((adresse & 3) != 0 || (taille & 3) != 0)
+        return false;
+      uint8_t* octets = (uint8_t*)dest;
+      for (size_t i = 0; i < taille; i++)
+        octets[i] = (adresse + i < image.size()) ? image[adresse + i] : 0xFF;
+      nb_lectures++;
+      return true;
+    }
+
+    uint32_t size() { return image.size(); }
+
+    std::vector<uint8_t> image;
+    unsigned long nb_lectures = 0;
+};
+
+// ################################################################################
+// 									Serveur simulé
+// ################################################################################
+
+static std::vector<uint8_t> Image(size_t taille, uint32_t graine)
+{
+  std::vector<uint8_t> image(taille);
+  for (size_t i = 0; i < taille; i++)
+  {
+    graine = graine * 1103515245 + 12345;
+    image[i] = (uint8_t)(graine >> 16);
+  }
+  return image;
+}
+
+static Protocole_Vue Vue(const char* str)
+{
+  Protocole_Vue vue = { str, strlen(str) };
+  return vue;
+}
+
+// Encode le bloc index de donnees (OTA_TAILLE_BLOC octets max)
+static std::vector<uint8_t> Bloc(const std::vector<uint8_t>& donnees, uint16_t index)
+{
+  size_t debut = (size_t)index * OTA_TAILLE_BLOC;
+  size_t taille = std::min((size_t)OTA_TAILLE_BLOC, donnees.size() - debut);
+  std::vector<uint8_t> trame(PROTOCOLE_ENTETE_BLOC_OTA + taille);
+  Protocole_EncodeBlocOTA(trame.data(), trame.size(), index, donnees.data() + debut, taille);
+  return trame;
+}
+
+static uint16_t NbBlocs(const std::vector<uint8_t>& donnees)
+{
+  return (donnees.size() + OTA_TAILLE_BLOC - 1) / OTA_TAILLE_BLOC;
+}
+
+// Transfert complet, en respectant la fenêtre : renvoie le nombre d'allers-retours (ACK)
+static unsigned long Transfert(Domokit_OTA& ota, const std::vector<uint8_t>& donnees)
+{
+  unsigned long nb_ack = 0;
+  uint16_t nb = NbBlocs(donnees);
+
+  while (ota.getStatut() == OTA_EN_COURS && ota.getBlocAttendu() < nb)
+  {
+    uint16_t debut = ota.getBlocAttendu();
+    for (uint16_t i = debut; i < nb && i < debut + OTA_FENETRE; i++)
+    {
+      std::vector<uint8_t> trame = Bloc(donnees, i);
+      Resultat_Bloc_OTA resultat = ota.write(trame.data(), trame.size());
+      if (resultat == OTA_BLOC_ACQUITTER)
+      {
+        nb_ack++;
+        break;
+      }
+      if (resultat == OTA_BLOC_ERREUR)
+        return nb_ack;
+    }
+  }
+  return nb_ack;
+}
+
+// ################################################################################
+// 						Encodeur de delta (côté serveur, tools/Delta.h)
+// ################################################################################
+
+// Deltas construits à la main (cas d'erreur du décodeur)
+static void EnteteDelta(std::vector<uint8_t>& delta, uint32_t ancienne, uint32_t nouvelle)
+{
+  delta.insert(delta.end(), OTA_DELTA_MAGIC, OTA_DELTA_MAGIC + 4);
+  Delta_Ajouter32(delta, ancienne);
+  Delta_Ajouter32(delta, nouvelle);
+}
+
+// Image construite par le Makefile
+static bool Lire(const char* chemin, std::vector<uint8_t>& donnees)
+{
+  FILE* f = fopen(chemin, "rb");
+  if (f == NULL)
+    return false;
+  uint8_t tampon[4096];
+  size_t n;
+  donnees.clear();
+  while ((n = fread(tampon, 1, sizeof(tampon), f)) > 0)
+    donnees.insert(donnees.end(), tampon, tampon + n);
+  fclose(f);
+  return true;
+}
+
+// ################################################################################
+// 									Tests
+// ################################################################################
+
+// Vérifie le MD5 du test lui-même (vecteur de la RFC 1321)
+TEST(Reference_MD5)
+{
+  char md5[33];
+  MD5((const uint8_t*)"abc", 3, md5);
+  VERIFIE(strcmp(md5, "900150983cd24fb0d6963f7d28e17f72") == 0);
+}
+
+TEST(Transfert_Complet)
+{
+  Cible_Simulee cible;
+  Domokit_OTA ota;
+  std::vector<uint8_t> image = Image(10 * OTA_TAILLE_BLOC + 17, 1);
+  char md5[33];
+
+  MD5(image.data(), image.size(), md5);
+  ota.setCible(&cible);
+  VERIFIE(ota.begin(image.size(), Vue(md5), false));
+
+  unsigned long nb_ack = Transfert(ota, image);
+  VERIFIE(ota.getRecu() == image.size());
+  VERIFIE(ota.end());
+  VERIFIE(ota.getStatut() == OTA_TERMINE);
+  VERIFIE(cible.active && cible.image == image);
+  VERIFIE(nb_ack == (unsigned long)(NbBlocs(image) + OTA_FENETRE - 1) / OTA_FENETRE);
+  VERIFIE(ota.getNbRejets() == 0);
+}
+
+// Un ACK tous les OTA_FENETRE blocs, et sur le dernier bloc
+TEST(Acquittements_Fenetre)
+{
+  Cible_Simulee cible;
+  Domokit_OTA ota;
+  std::vector<uint8_t> image = Image(6 * OTA_TAILLE_BLOC, 2);
+  char md5[33];
+
+  MD5(image.data(), image.size(), md5);
+  ota.setCible(&cible);
+  ota.begin(image.size(), Vue(md5), false);
+
+  for (uint16_t i = 0; i < NbBlocs(image); i++)
+  {
+    std::vector<uint8_t> trame = Bloc(image, i);
+    Resultat_Bloc_OTA attendu = ((i + 1) % OTA_FENETRE == 0 || i + 1 == NbBlocs(image)) ? OTA_BLOC_ACQUITTER : OTA_BLOC_ACCEPTE;
+    VERIFIE(ota.write(trame.data(), trame.size()) == attendu);
+    VERIFIE(ota.getBlocAttendu() == i + 1);
+  }
+  VERIFIE(ota.end());
+}
+
+// Bloc au CRC faux : rien n'est écrit, le serveur reprend au bloc attendu
+TEST(Rejet_CRC)
+{
+  Cible_Simulee cible;
+  Domokit_OTA ota;
+  std::vector<uint8_t> image = Image(3 * OTA_TAILLE_BLOC, 3);
+  char md5[33];
+
+  MD5(image.data(), image.size(), md5);
+  ota.setCible(&cible);
+  ota.begin(image.size(), Vue(md5), false);
+
+  std::vector<uint8_t> trame = Bloc(image, 0);
+  VERIFIE(ota.write(trame.data(), trame.size()) == OTA_BLOC_ACCEPTE);
+
+  trame = Bloc(image, 1);
+  trame[PROTOCOLE_ENTETE_BLOC_OTA + 5] ^= 0x01;
+  VERIFIE(ota.write(trame.data(), trame.size()) == OTA_BLOC_ACQUITTER);
+  VERIFIE(ota.getBlocAttendu() == 1 && ota.getRecu() == OTA_TAILLE_BLOC && cible.image.size() == OTA_TAILLE_BLOC);
+  VERIFIE(ota.getNbRejets() == 1);
+
+  // Bloc manquant (2 avant 1), puis bloc déjà reçu (0)
+  trame = Bloc(image, 2);
+  VERIFIE(ota.write(trame.data(), trame.size()) == OTA_BLOC_ACQUITTER);
+  trame = Bloc(image, 0);
+  VERIFIE(ota.write(trame.data(), trame.size()) == OTA_BLOC_IGNORE);
+  VERIFIE(ota.getNbRejets() == 2);
+
+  Transfert(ota, image);
+  VERIFIE(ota.end() && cible.image == image);
+}
+
+// Connexion perdue : la même annonce reprend au bloc attendu, une autre image recommence
+TEST(Reprise)
+{
+  Cible_Simulee cible;
+  Domokit_OTA ota;
+  std::vector<uint8_t> image = Image(8 * OTA_TAILLE_BLOC, 4);
+  std::vector<uint8_t> autre = Image(8 * OTA_TAILLE_BLOC, 5);
+  char md5[33];
+  char md5_autre[33];
+
+  MD5(image.data(), image.size(), md5);
+  MD5(autre.data(), autre.size(), md5_autre);
+  ota.setCible(&cible);
+  ota.begin(image.size(), Vue(md5), false);
+
+  for (uint16_t i = 0; i < 5; i++)
+  {
+    std::vector<uint8_t> trame = Bloc(image, i);
+    ota.write(trame.data(), trame.size());
+  }
+
+  VERIFIE(ota.begin(image.size(), Vue(md5), false));
+  VERIFIE(ota.getBlocAttendu() == 5 && cible.nb_debuts == 1);
+
+  Transfert(ota, image);
+  VERIFIE(ota.end() && cible.image == image);
+
+  // Nouvelle image annoncée pendant une session : la session est abandonnée
+  ota.begin(image.size(), Vue(md5), false);
+  std::vector<uint8_t> trame = Bloc(image, 0);
+  ota.write(trame.data(), trame.size());
+  VERIFIE(ota.begin(autre.size(), Vue(md5_autre), false));
+  VERIFIE(ota.getBlocAttendu() == 0 && cible.nb_abandons == 1);
+  Transfert(ota, autre);
+  VERIFIE(ota.end() && cible.image == autre);
+}
+
+TEST(Echec_MD5)
+{
+  Cible_Simulee cible;
+  Domokit_OTA ota;
+  std::vector<uint8_t> image = Image(2 * OTA_TAILLE_BLOC, 6);
+
+  ota.setCible(&cible);
+  ota.begin(image.size(), Vue("00000000000000000000000000000000"), false);
+  Transfert(ota, image);
+  VERIFIE(ota.getRecu() == image.size());
+  VERIFIE(!ota.end());
+  VERIFIE(ota.getStatut() == OTA_ECHEC && ota.getErreur() == OTA_ERREUR_VERIFICATION);
+  VERIFIE(!cible.active);
+
+  // Image incomplète : refusée sans vérifier le MD5
+  char md5[33];
+  MD5(image.data(), image.size(), md5);
+  ota.begin(image.size(), Vue(md5), false);
+  std::vector<uint8_t> trame = Bloc(image, 0);
+  ota.write(trame.data(), trame.size());
+  VERIFIE(!ota.end() && ota.getErreur() == OTA_ERREUR_VERIFICATION);
+
+  // Plus de données que la taille annoncée
+  ota.begin(OTA_TAILLE_BLOC / 2, Vue(md5), false);
+  VERIFIE(ota.write(trame.data(), trame.size()) == OTA_BLOC_ERREUR);
+  VERIFIE(ota.getErreur() == OTA_ERREUR_TAILLE);
+}
+
+// Nouvelle image = ancienne modifiée + insertion + suppression + extension
+TEST(Delta)
+{
+  Cible_Simulee cible;
+  Source_Simulee source;
+  Domokit_OTA ota;
+  char md5[33];
+
+  source.image = Image(20000, 7);
+  std::vector<uint8_t> nouvelle(source.image.begin(), source.image.begin() + 6000);
+  for (size_t i = 100; i < 6000; i += 250)
+    nouvelle[i] ^= 0x5A;
+  std::vector<uint8_t> insertion = Image(300, 8);
+  nouvelle.insert(nouvelle.end(), insertion.begin(), insertion.end());
+  nouvelle.insert(nouvelle.end(), source.image.begin() + 8000, source.image.end()); // 2000 octets supprimés
+  nouvelle[nouvelle.size() - 1] += 1;
+  std::vector<uint8_t> fin = Image(500, 9);
+  nouvelle.insert(nouvelle.end(), fin.begin(), fin.end());
+
+  std::vector<uint8_t> delta;
+  EnteteDelta(delta, source.image.size(), nouvelle.size());
+  Delta_Commande(delta, &source.image[0], &nouvelle[0], 6000, insertion.data(), insertion.size(), 2000);
+  Delta_Commande(delta, &source.image[8000], &nouvelle[6300], 12000, fin.data(), fin.size(), 0);
+
+  MD5(nouvelle.data(), nouvelle.size(), md5);
+  ota.setCible(&cible);
+  ota.setSource(&source);
+  VERIFIE(ota.begin(delta.size(), Vue(md5), true));
+  Transfert(ota, delta);
+  VERIFIE(ota.getRecu() == delta.size());
+  VERIFIE(ota.end());
+  VERIFIE(cible.active && cible.image == nouvelle);
+  VERIFIE(delta.size() < nouvelle.size() / 10);
+  printf("  delta : %u octets pour une image de %u octets, %lu lectures de %u octets\n",
+         (unsigned)delta.size(), (unsigned)nouvelle.size(), source.nb_lectures, OTA_DELTA_TAILLE_CACHE);
+
+  // Delta calculé pour une autre image de référence : rejeté dès l'en-tête
+  std::vector<uint8_t> faux;
+  EnteteDelta(faux, source.image.size() + 4, nouvelle.size());
+  Delta_Commande(faux, &source.image[0], &nouvelle[0], 100, NULL, 0, 0);
+  ota.begin(faux.size(), Vue(md5), true);
+  std::vector<uint8_t> trame = Bloc(faux, 0);
+  VERIFIE(ota.write(trame.data(), trame.size()) == OTA_BLOC_ERREUR);
+  VERIFIE(ota.getErreur() == OTA_ERREUR_ECRITURE);
+
+  // Mauvais magic
+  faux[0] = 'X';
+  ota.begin(faux.size() + 1, Vue(md5), true);
+  trame = Bloc(faux, 0);
+  VERIFIE(ota.write(trame.data(), trame.size()) == OTA_BLOC_ERREUR);
+
+  // Commande qui produirait plus que la nouvelle image
+  std::vector<uint8_t> long_delta;
+  EnteteDelta(long_delta, source.image.size(), 100);
+  Delta_Commande(long_delta, &source.image[0], &source.image[0], 200, NULL, 0, 0);
+  ota.begin(long_delta.size(), Vue(md5), true);
+  trame = Bloc(long_delta, 0);
+  VERIFIE(ota.write(trame.data(), trame.size()) == OTA_BLOC_ERREUR);
+
+  // Delta tronqué : la nouvelle image n'est pas complète
+  ota.begin(delta.size() - 10, Vue(md5), true);
+  std::vector<uint8_t> tronque(delta.begin(), delta.end() - 10);
+  Transfert(ota, tronque);
+  VERIFIE(!ota.end() && ota.getErreur() == OTA_ERREUR_VERIFICATION);
+  VERIFIE(!cible.active);
+}
+
+// ################################################################################
+// 									Performances
+// ################################################################################
+
+// Liaison des estimations : chaque fenêtre coûte un aller-retour, plus la durée d'émission des octets
+static const double rtt_ms = 50.0;
+static const double debit_octets_s = 100000.0;
+
+static double Estimation_s(unsigned long nb_ack, const std::vector<uint8_t>& donnees)
+{
+  double octets = (double)donnees.size() + NbBlocs(donnees) * (PROTOCOLE_ENTETE_BLOC_OTA + 64); // + en-têtes MQTT et topic
+  return nb_ack * rtt_ms / 1000.0 + octets / debit_octets_s;
+}
+
+/*
+ * Temps de mise à jour d'une image de 400 Ko : temps de traitement mesuré sur
+ * l'hôte (CRC + écriture), et temps de transfert estimé pour une liaison donnée.
+ */
+TEST(Benchmark_TempsMiseAJour)
+{
+  Cible_Simulee cible;
+  Domokit_OTA ota;
+  std::vector<uint8_t> image = Image(400 * 1024, 10);
+  char md5[33];
+
+  MD5(image.data(), image.size(), md5);
+  ota.setCible(&cible);
+
+  uint64_t debut = Chrono_us();
+  ota.begin(image.size(), Vue(md5), false);
+  unsigned long nb_ack = Transfert(ota, image);
+  uint64_t duree = Chrono_us() - debut;
+  VERIFIE(ota.end());
+
+  unsigned long nb_blocs = NbBlocs(image);
+  double estime_s = Estimation_s(nb_ack, image);
+
+  printf("  %lu blocs de %u octets, %lu ACK, traitement hôte %.1f ms (%.1f Mo/s)\n",
+         nb_blocs, OTA_TAILLE_BLOC, nb_ack, duree / 1000.0, duree ? image.size() / (double)duree : 0.0);
+  printf("  estimation (RTT %.0f ms, %.0f ko/s) : %.1f s, dont %.1f s d'attente des ACK\n",
+         rtt_ms, debit_octets_s / 1000.0, estime_s, nb_ack * rtt_ms / 1000.0);
+}
+
+/*
+ * Delta calculé par tools/delta entre deux vraies images : l'objet complet
+ * compilé pour l'hôte (sans symboles), puis la même application avec une
+ * constante modifiée, puis une autre application. Taux de compression,
+ * temps d'application mesuré sur l'hôte (décodage, lectures de l'ancienne
+ * image, écriture) et temps de mise à jour estimé, complet et différentiel.
+ */
+TEST(Delta_Images_Reelles)
+{
+  const char* paires[][3] =
+  {
+    { "bin/image_1", "bin/image_2", "constante modifiée" },
+    { "bin/image_1", "bin/image_3", "autre application" }
+  };
+
+  for (size_t p = 0; p < sizeof(paires) / sizeof(paires[0]); p++)
+  {
+    Cible_Simulee cible;
+    Source_Simulee source;
+    Domokit_OTA ota;
+    std::vector<uint8_t> nouvelle;
+    char md5[33];
+
+    VERIFIE(Lire(paires[p][0], source.image) && Lire(paires[p][1], nouvelle));
+    if (source.image.empty() || nouvelle.empty())
+      continue;
+
+    uint64_t debut = Chrono_us();
+    std::vector<uint8_t> delta = Delta_Calcule(source.image, nouvelle);
+    uint64_t calcul = Chrono_us() - debut;
+
+    MD5(nouvelle.data(), nouvelle.size(), md5);
+    ota.setCible(&cible);
+    ota.setSource(&source);
+    debut = Chrono_us();
+    VERIFIE(ota.begin(delta.size(), Vue(md5), true));
+    unsigned long nb_ack = Transfert(ota, delta);
+    VERIFIE(ota.end());
+    uint64_t application = Chrono_us() - debut;
+    VERIFIE(cible.active && cible.image == nouvelle);
+    if (p == 0)
+      VERIFIE(delta.size() < nouvelle.size() / 4);
+
+    unsigned long nb_ack_complet = (NbBlocs(nouvelle) + OTA_FENETRE - 1) / OTA_FENETRE;
+    printf("  %s : %u -> %u octets, delta %u octets (%.1f %%), calcul %.0f ms, application %.1f ms (%lu lectures)\n",
+           paires[p][2], (unsigned)source.image.size(), (unsigned)nouvelle.size(), (unsigned)delta.size(),
+           100.0 * delta.size() / nouvelle.size(), calcul / 1000.0, application / 1000.0, source.nb_lectures);
+    printf("    estimation : %.1f s au lieu de %.1f s pour l'image complète\n",
+           Estimation_s(nb_ack, delta), Estimation_s(nb_ack_complet, nouvelle));
+  }
+}
+
+int main()
+{
+  LANCE(Reference_MD5);
+  LANCE(Transfert_Complet);
+  LANCE(Acquittements_Fenetre);
+  LANCE(Rejet_CRC);
+  LANCE(Reprise);
+  LANCE(Echec_MD5);
+  LANCE(Delta);
+  LANCE(Benchmark_TempsMiseAJour);
+  LANCE(Delta_Images_Reelles);
+  return FIN_TESTS();
+}
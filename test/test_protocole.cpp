@@ -0,0 +1,374 @@
+/*
+ *  =============================================================================================================================================
+ *  Titre : test_protocole.cpp
+ *  Auteur : Thomas Broussard
+ *  ---------------------------------------------------------------------------------------------------------------------------------------------
+ *  Description :
+ *  Tests hôte du codec du protocole Domokit (DomoKit_Protocole.cpp, compilé tel quel) :
+ *  aller-retour encodage/décodage, débordement des buffers, trames malformées,
+ *  puis mesure du débit de décodage des trames set_tile
+ * =============================================================================================================================================
+ */
+
+#include "DomoKit_Protocole.h"
+#include "Test.h"
+
+// Vue sur une chaîne terminée par '\0'
+static Protocole_Vue Vue(const char* str)
+{
+  Protocole_Vue vue = { str, strlen(str) };
+  return vue;
+}
+
+// ################################################################################
+// 									Aller-retour
+// ################################################################################
+
+TEST(AllerRetour_Connexion)
+{
+  char buffer[64];
+  Trame_Connexion trame;
+
+  size_t n = Protocole_EncodeConnexion(buffer, sizeof(buffer), "AA:BB:CC:DD:EE:FF", "Lampe", false);
+  VERIFIE(n == strlen("AA:BB:CC:DD:EE:FF;Lampe"));
+  VERIFIE(Protocole_DecodeConnexion(buffer, n, &trame));
+  VERIFIE(Protocole_VueEgale(trame.mac, "AA:BB:CC:DD:EE:FF"));
+  VERIFIE(Protocole_VueEgale(trame.nom_client, "Lampe"));
+  VERIFIE(!trame.alias);
+
+  n = Protocole_EncodeConnexion(buffer, sizeof(buffer), "AA:BB:CC:DD:EE:FF", "Lampe", true);
+  VERIFIE(Protocole_DecodeConnexion(buffer, n, &trame));
+  VERIFIE(trame.alias);
+}
+
+TEST(AllerRetour_Presence)
+{
+  char buffer[64];
+  bool en_ligne = false;
+  Trame_Connexion trame;
+
+  size_t n = Protocole_EncodePresence(buffer, sizeof(buffer), "AA:BB", "Prise", true);
+  VERIFIE(Protocole_DecodePresence(buffer, n, &en_ligne, &trame));
+  VERIFIE(en_ligne);
+  VERIFIE(Protocole_VueEgale(trame.mac, "AA:BB"));
+  VERIFIE(Protocole_VueEgale(trame.nom_client, "Prise"));
+  VERIFIE(trame.alias);
+
+  VERIFIE(Protocole_DecodePresence(PROTOCOLE_HORS_LIGNE, strlen(PROTOCOLE_HORS_LIGNE), &en_ligne, &trame));
+  VERIFIE(!en_ligne);
+}
+
+TEST(AllerRetour_SetTile)
+{
+  char buffer[64];
+  Trame_SetTile trame;
+
+  size_t n = Protocole_EncodeSetTile(buffer, sizeof(buffer), 12, "valeur", "21.5;C");
+  VERIFIE(Protocole_DecodeSetTile(buffer, n, &trame));
+  VERIFIE(trame.id == 12);
+  VERIFIE(Protocole_VueEgale(trame.attribut, "valeur"));
+  VERIFIE(Protocole_VueEgale(trame.valeur, "21.5;C")); // le dernier champ garde les séparateurs
+}
+
+TEST(AllerRetour_WifiData)
+{
+  char buffer[96];
+  Trame_WifiData trame;
+
+  size_t n = Protocole_EncodeWifiData(buffer, sizeof(buffer), "maison", "secret", "0123456789abcdef");
+  VERIFIE(Protocole_DecodeInstruction(buffer, n) == INSTRUCTION_WIFI_DATA);
+  VERIFIE(Protocole_DecodeWifiData(buffer, n, &trame));
+  VERIFIE(Protocole_VueEgale(trame.ssid, "maison"));
+  VERIFIE(Protocole_VueEgale(trame.password, "secret"));
+  VERIFIE(Protocole_VueEgale(trame.clef, "0123456789abcdef"));
+
+  n = Protocole_EncodeWifiData(buffer, sizeof(buffer), "maison", "secret", "");
+  VERIFIE(Protocole_DecodeWifiData(buffer, n, &trame));
+  VERIFIE(trame.clef.len == 0);
+}
+
+TEST(AllerRetour_Instructions)
+{
+  char buffer[32];
+  int32_t valeur = 0;
+  Trame_Icone icone;
+
+  size_t n = Protocole_EncodeAlias(buffer, sizeof(buffer), 7);
+  VERIFIE(Protocole_DecodeInstruction(buffer, n) == INSTRUCTION_ALIAS);
+  VERIFIE(Protocole_DecodeAlias(buffer, n, &valeur) && valeur == 7);
+
+  n = Protocole_EncodeAttente(buffer, sizeof(buffer), 30000);
+  VERIFIE(Protocole_DecodeInstruction(buffer, n) == INSTRUCTION_ATTENTE);
+  VERIFIE(Protocole_DecodeAttente(buffer, n, &valeur) && valeur == 30000);
+
+  n = Protocole_EncodePing(buffer, sizeof(buffer), 42);
+  VERIFIE(Protocole_DecodePing(buffer, n, &valeur) && valeur == 42);
+
+  n = Protocole_EncodeIcone(buffer, sizeof(buffer), "lamp", "#FF0000");
+  VERIFIE(Protocole_DecodeIcone(buffer, n, &icone));
+  VERIFIE(Protocole_VueEgale(icone.icone, "lamp") && Protocole_VueEgale(icone.couleur, "#FF0000"));
+
+  VERIFIE(Protocole_DecodeInstruction("START", 5) == INSTRUCTION_START);
+  VERIFIE(Protocole_DecodeInstruction("STOP", 4) == INSTRUCTION_STOP);
+  VERIFIE(Protocole_DecodeInstruction("CONNECT", 7) == INSTRUCTION_CONNECT);
+  VERIFIE(Protocole_DecodeInstruction("SNAPSHOT", 8) == INSTRUCTION_SNAPSHOT);
+  VERIFIE(Protocole_DecodeInstruction("OTA_FIN", 7) == INSTRUCTION_OTA_FIN);
+  VERIFIE(Protocole_DecodeInstruction("OTA_ANNULE", 10) == INSTRUCTION_OTA_ANNULE);
+}
+
+TEST(AllerRetour_Groupees)
+{
+  char buffer[128];
+  size_t position = 0;
+  Trame_Snapshot snapshot;
+  Trame_Backfill backfill;
+  Trame_Mesure mesure;
+
+  size_t n = Protocole_EncodeSnapshotHeader(buffer, sizeof(buffer));
+  n = Protocole_AppendSnapshotEntry(buffer, sizeof(buffer), n, 0, "temperature", "21.5");
+  n = Protocole_AppendSnapshotEntry(buffer, sizeof(buffer), n, 1, "relais", "ON");
+  VERIFIE(n > 0);
+  VERIFIE(Protocole_NextSnapshotEntry(buffer, n, &position, &snapshot));
+  VERIFIE(snapshot.id == 0 && Protocole_VueEgale(snapshot.topic, "temperature") && Protocole_VueEgale(snapshot.valeur, "21.5"));
+  VERIFIE(Protocole_NextSnapshotEntry(buffer, n, &position, &snapshot));
+  VERIFIE(snapshot.id == 1 && Protocole_VueEgale(snapshot.topic, "relais") && Protocole_VueEgale(snapshot.valeur, "ON"));
+  VERIFIE(!Protocole_NextSnapshotEntry(buffer, n, &position, &snapshot));
+
+  position = 0;
+  n = Protocole_EncodeBackfillHeader(buffer, sizeof(buffer));
+  n = Protocole_AppendBackfillEntry(buffer, sizeof(buffer), n, 3, 120, "19.0");
+  VERIFIE(Protocole_NextBackfillEntry(buffer, n, &position, &backfill));
+  VERIFIE(backfill.id == 3 && backfill.age == 120 && Protocole_VueEgale(backfill.valeur, "19.0"));
+  VERIFIE(!Protocole_NextBackfillEntry(buffer, n, &position, &backfill));
+
+  position = 0;
+  n = Protocole_EncodeMesuresHeader(buffer, sizeof(buffer));
+  n = Protocole_AppendMesureEntry(buffer, sizeof(buffer), n, 2, 1700000000123LL, "-4");
+  VERIFIE(Protocole_NextMesureEntry(buffer, n, &position, &mesure));
+  VERIFIE(mesure.id == 2 && mesure.date == 1700000000123LL && Protocole_VueEgale(mesure.valeur, "-4"));
+  VERIFIE(!Protocole_NextMesureEntry(buffer, n, &position, &mesure));
+}
+
+TEST(AllerRetour_Heure)
+{
+  char buffer[96];
+  Trame_Heure heure;
+
+  size_t n = Protocole_EncodeHeure(buffer, sizeof(buffer), 1700000000000LL);
+  VERIFIE(Protocole_DecodeInstruction(buffer, n) == INSTRUCTION_HEURE);
+  VERIFIE(Protocole_DecodeHeure(buffer, n, &heure));
+  VERIFIE(heure.t1 == 1700000000000LL && heure.t2 == -1);
+
+  n = Protocole_EncodeReponseHeure(buffer, sizeof(buffer), 1, 2, INT64_MAX);
+  VERIFIE(Protocole_DecodeHeure(buffer, n, &heure));
+  VERIFIE(heure.t1 == 1 && heure.t2 == 2 && heure.t3 == INT64_MAX);
+}
+
+TEST(AllerRetour_OTA)
+{
+  char buffer[96];
+  uint8_t bloc[64];
+  uint8_t donnees[32];
+  Trame_OTA ota;
+  Trame_BlocOTA trame;
+
+  size_t n = Protocole_EncodeOTA(buffer, sizeof(buffer), 300000, "0123456789abcdef0123456789abcdef", true);
+  VERIFIE(Protocole_DecodeInstruction(buffer, n) == INSTRUCTION_OTA);
+  VERIFIE(Protocole_DecodeOTA(buffer, n, &ota));
+  VERIFIE(ota.taille == 300000 && ota.delta && ota.md5.len == 32);
+
+  for (size_t i = 0; i < sizeof(donnees); i++)
+    donnees[i] = (uint8_t)(i * 7);
+  n = Protocole_EncodeBlocOTA(bloc, sizeof(bloc), 513, donnees, sizeof(donnees));
+  VERIFIE(n == PROTOCOLE_ENTETE_BLOC_OTA + sizeof(donnees));
+  VERIFIE(Protocole_DecodeBlocOTA(bloc, n, &trame));
+  VERIFIE(trame.index == 513 && trame.taille == sizeof(donnees) && memcmp(trame.donnees, donnees, sizeof(donnees)) == 0);
+
+  bloc[PROTOCOLE_ENTETE_BLOC_OTA + 3] ^= 0x10; // donnée corrompue : CRC faux
+  VERIFIE(!Protocole_DecodeBlocOTA(bloc, n, &trame));
+
+  // CRC-32 de référence ("123456789" -> 0xCBF43926)
+  VERIFIE(Protocole_CRC32(0, (const uint8_t*)"123456789", 9) == 0xCBF43926);
+}
+
+TEST(AllerRetour_Regles)
+{
+  char buffer[64];
+  uint8_t programme[] = { 0x00, 0x7F, 0xA5, 0xFF };
+  uint8_t decode[8];
+  size_t taille = 0;
+
+  size_t n = Protocole_EncodeRegles(buffer, sizeof(buffer), programme, sizeof(programme));
+  VERIFIE(n == strlen("REGLES;007FA5FF") && strcmp(buffer, "REGLES;007FA5FF") == 0);
+  VERIFIE(Protocole_DecodeRegles(buffer, n, decode, sizeof(decode), &taille));
+  VERIFIE(taille == sizeof(programme) && memcmp(decode, programme, taille) == 0);
+
+  VERIFIE(Protocole_DecodeRegles("REGLES", 6, decode, sizeof(decode), &taille) && taille == 0);
+}
+
+// ################################################################################
+// 									Débordement
+// ################################################################################
+
+// Chaque encodeur renvoie 0 si la trame ne tient pas, et la taille exacte avec un octet de plus
+TEST(Debordement)
+{
+  char buffer[64];
+  char petit[64];
+  uint8_t bloc[16];
+  uint8_t programme[4] = { 1, 2, 3, 4 };
+
+  size_t n = Protocole_EncodeSetTile(buffer, sizeof(buffer), -123, "valeur", "ON");
+  VERIFIE(Protocole_EncodeSetTile(petit, n, -123, "valeur", "ON") == 0);
+  VERIFIE(Protocole_EncodeSetTile(petit, n + 1, -123, "valeur", "ON") == n && strcmp(petit, buffer) == 0);
+
+  n = Protocole_EncodeConnexion(buffer, sizeof(buffer), "AA:BB", "Lampe", true);
+  VERIFIE(Protocole_EncodeConnexion(petit, n, "AA:BB", "Lampe", true) == 0);
+
+  n = Protocole_EncodeReponseHeure(buffer, sizeof(buffer), 1700000000000LL, 1700000000001LL, 1700000000002LL);
+  for (size_t i = 0; i < n; i++)
+    VERIFIE(Protocole_EncodeReponseHeure(petit, i, 1700000000000LL, 1700000000001LL, 1700000000002LL) == 0);
+
+  n = Protocole_EncodeRegles(buffer, sizeof(buffer), programme, sizeof(programme));
+  VERIFIE(Protocole_EncodeRegles(petit, n, programme, sizeof(programme)) == 0);
+
+  // Entrée de trame groupée refusée : l'appelant garde la trame précédente
+  n = Protocole_EncodeSnapshotHeader(buffer, 16);
+  VERIFIE(Protocole_AppendSnapshotEntry(buffer, 16, n, 1, "temperature", "21.5") == 0);
+
+  VERIFIE(Protocole_EncodeBlocOTA(bloc, sizeof(bloc), 0, (const uint8_t*)"0123456789", 11) == 0);
+  VERIFIE(Protocole_EncodeAlias(petit, 0, 1) == 0);
+}
+
+// ################################################################################
+// 									Trames malformées
+// ################################################################################
+
+TEST(Malformees)
+{
+  Trame_Connexion connexion;
+  Trame_SetTile set_tile;
+  Trame_WifiData wifi;
+  Trame_Heure heure;
+  Trame_OTA ota;
+  Trame_BlocOTA bloc;
+  int32_t valeur;
+  uint8_t programme[2];
+  size_t taille;
+  size_t position = 0;
+  Trame_Snapshot snapshot;
+
+  VERIFIE(Protocole_DecodeInstruction("", 0) == INSTRUCTION_INCONNUE);
+  VERIFIE(Protocole_DecodeInstruction("STARTX", 6) == INSTRUCTION_INCONNUE);
+  VERIFIE(Protocole_DecodeInstruction("START;1", 7) == INSTRUCTION_INCONNUE);
+  VERIFIE(Protocole_DecodeInstruction("start", 5) == INSTRUCTION_INCONNUE);
+  VERIFIE(Protocole_DecodeInstruction("STA", 3) == INSTRUCTION_INCONNUE);
+
+  VERIFIE(!Protocole_DecodeConnexion("AA:BB", 5, &connexion));
+  VERIFIE(!Protocole_DecodeConnexion(";Lampe", 6, &connexion));
+
+  VERIFIE(!Protocole_DecodeSetTile("1;valeur", 8, &set_tile));
+  VERIFIE(!Protocole_DecodeSetTile("x;valeur;ON", 11, &set_tile));
+  VERIFIE(!Protocole_DecodeSetTile("-1;valeur;ON", 12, &set_tile));
+  VERIFIE(!Protocole_DecodeSetTile("1;;ON", 5, &set_tile));
+  VERIFIE(!Protocole_DecodeSetTile("99999999999;valeur;ON", 21, &set_tile)); // hors limites 32 bits
+
+  VERIFIE(!Protocole_DecodeWifiData("WIFI_DATA;ssid", 14, &wifi));
+  VERIFIE(!Protocole_DecodeWifiData("WIFI;ssid;pwd", 13, &wifi));
+
+  VERIFIE(!Protocole_DecodeAlias("ALIAS;", 6, &valeur));
+  VERIFIE(!Protocole_DecodeAlias("ALIAS;-2", 8, &valeur));
+  VERIFIE(!Protocole_DecodeAttente("ATTENTE;+", 9, &valeur));
+
+  VERIFIE(!Protocole_DecodeHeure("HEURE", 5, &heure));
+  VERIFIE(!Protocole_DecodeHeure("HEURE;1;2", 9, &heure));
+  VERIFIE(!Protocole_DecodeHeure("HEURE;1;-2;3", 12, &heure));
+  VERIFIE(!Protocole_DecodeHeure("HEURE;99999999999999999999", 26, &heure)); // hors limites 64 bits
+
+  VERIFIE(!Protocole_DecodeOTA("OTA;100;abc", 11, &ota));
+  VERIFIE(!Protocole_DecodeOTA("OTA;0;0123456789abcdef0123456789abcdef", 38, &ota));
+  VERIFIE(!Protocole_DecodeOTA("OTA;100;0123456789abcdef0123456789abcdef;XX", 43, &ota));
+  VERIFIE(!Protocole_DecodeBlocOTA((const uint8_t*)"\0\0\0\0\0\0", 6, &bloc));
+
+  VERIFIE(!Protocole_DecodeRegles("REGLES;0", 8, programme, sizeof(programme), &taille));
+  VERIFIE(!Protocole_DecodeRegles("REGLES;0G", 9, programme, sizeof(programme), &taille));
+  VERIFIE(!Protocole_DecodeRegles("REGLES;000102", 13, programme, sizeof(programme), &taille));
+  VERIFIE(!Protocole_DecodeRegles("REGLE;00", 8, programme, sizeof(programme), &taille));
+
+  // Trame groupée : mauvais en-tête, lignes incomplètes ignorées
+  VERIFIE(!Protocole_NextSnapshotEntry("BACKFILL\n1;2;3", 14, &position, &snapshot));
+  position = 0;
+  VERIFIE(Protocole_NextSnapshotEntry("SNAPSHOT\n1;2\n\n3;t;v", 19, &position, &snapshot));
+  VERIFIE(snapshot.id == 3);
+  VERIFIE(!Protocole_NextSnapshotEntry("SNAPSHOT\n1;2\n\n3;t;v", 19, &position, &snapshot));
+
+  VERIFIE(Protocole_VueToInt(Vue("2147483647"), -1) == INT32_MAX);
+  VERIFIE(Protocole_VueToInt(Vue("2147483648"), -1) == -1);
+  VERIFIE(Protocole_VueToInt64(Vue("9223372036854775807"), -1) == INT64_MAX);
+  VERIFIE(Protocole_VueToInt64(Vue("9223372036854775808"), -1) == -1);
+}
+
+// ################################################################################
+// 									Performances
+// ################################################################################
+
+// Débit de décodage d'une trame set_tile (vues sans copie + conversion de l'id)
+TEST(Benchmark_DecodeSetTile)
+{
+  static const char trame[] = "12;valeur;21.5";
+  const size_t nb = 20000000;
+  volatile int32_t somme = 0;
+  Trame_SetTile sortie;
+
+  uint64_t debut = Chrono_us();
+  for (size_t i = 0; i < nb; i++)
+  {
+    // taille lue via volatile : empêche le compilateur de sortir l'appel de la boucle
+    volatile size_t taille = sizeof(trame) - 1;
+    if (Protocole_DecodeSetTile(trame, taille, &sortie))
+      somme = somme + sortie.id;
+  }
+  uint64_t duree = Chrono_us() - debut;
+
+  VERIFIE(somme == (int32_t)(12 * nb));
+  printf("  decodage set_tile : %.1f M trames/s (%.1f ns/trame)\n",
+         duree ? nb / (double)duree : 0.0, duree * 1000.0 / nb);
+}
+
+// Débit d'encodage d'une entrée de trame MESURES (entier 64 bits compris)
+TEST(Benchmark_EncodeMesure)
+{
+  char buffer[64];
+  const size_t nb = 5000000;
+  volatile size_t total = 0;
+
+  uint64_t debut = Chrono_us();
+  for (size_t i = 0; i < nb; i++)
+  {
+    size_t n = Protocole_EncodeMesuresHeader(buffer, sizeof(buffer));
+    total = total + Protocole_AppendMesureEntry(buffer, sizeof(buffer), n, 3, 1700000000000LL + i, "21.5");
+  }
+  uint64_t duree = Chrono_us() - debut;
+
+  VERIFIE(total > 0);
+  printf("  encodage mesure : %.1f M trames/s (%.1f ns/trame)\n",
+         duree ? nb / (double)duree : 0.0, duree * 1000.0 / nb);
+}
+
+int main()
+{
+  LANCE(AllerRetour_Connexion);
+  LANCE(AllerRetour_Presence);
+  LANCE(AllerRetour_SetTile);
+  LANCE(AllerRetour_WifiData);
+  LANCE(AllerRetour_Instructions);
+  LANCE(AllerRetour_Groupees);
+  LANCE(AllerRetour_Heure);
+  LANCE(AllerRetour_OTA);
+  LANCE(AllerRetour_Regles);
+  LANCE(Debordement);
+  LANCE(Malformees);
+  LANCE(Benchmark_DecodeSetTile);
+  LANCE(Benchmark_EncodeMesure);
+  return FIN_TESTS();
+}
@@ -0,0 +1,268 @@
+/*
+ *  =============================================================================================================================================
+ *  Titre : test_qos.cpp
+ *  Auteur : Thomas Broussard
+ *  ---------------------------------------------------------------------------------------------------------------------------------------------
+ *  Description :
+ *  Tests hôte de la fenêtre QoS 1 (DomoKit_QoS.cpp) sur le transport loopback
+ *  avec perte de paquets simulée : chaque message est acquitté après renvois,
+ *  reprise après coupure du lien, fenêtre pleine, sauvegarde EEPROM limitée
+ *  (compilé avec DOMOKIT_QOS_PERSISTANT), puis mesure du nombre d'émissions
+ *  et du délai de livraison selon le taux de perte
+ * =============================================================================================================================================
+ */
+
+#include "DomoKit.h"
+#include "Test.h"
+#include <vector>
+
+#define TOPIC_CRITIQUE  "domokit/interruption/test"
+
+// ################################################################################
+// 									Banc d'essai
+// ################################################################################
+
+// Fenêtre QoS 1 reliée au loopback, comme dans Domokit::Create_Topics
+class Banc_QoS
+{
+  public:
+    Banc_QoS(uint8_t perte)
+    {
+      transport.setPacketLoss(perte);
+      transport.setAckCallback([this] (uint16_t packetId) { inflight.acknowledge(packetId); });
+      transport.setCallback([this] (char* topic, uint8_t* payload, unsigned int length) {
+        recus.push_back(std::string((const char*)payload, length));
+      });
+      transport.connect("test", "", "");
+      transport.subscribe(TOPIC_CRITIQUE);
+    }
+
+    bool envoyer(unsigned numero)
+    {
+      char payload[16];
+      int taille = snprintf(payload, sizeof(payload), "m%u", numero);
+      return inflight.send(&transport, TOPIC_CRITIQUE, (const uint8_t*)payload, taille);
+    }
+
+    // Boucle de l'objet pendant ms : réception des PUBACK puis renvois échus
+    void attendre(unsigned long ms, unsigned long pas_ms = 100)
+    {
+      for (unsigned long t = 0; t < ms; t += pas_ms)
+      {
+        transport.loop();
+        inflight.service(&transport);
+        delay(pas_ms);
+      }
+      transport.loop();
+    }
+
+    // Vrai si chaque message 0..nb-1 a été reçu au moins une fois
+    bool tousRecus(unsigned nb)
+    {
+      std::vector<bool> vu(nb, false);
+      for (size_t i = 0; i < recus.size(); i++)
+      {
+        unsigned n = atoi(recus[i].c_str() + 1);
+        if (n < nb) vu[n] = true;
+      }
+      for (unsigned i = 0; i < nb; i++)
+        if (!vu[i]) return false;
+      return true;
+    }
+
+    Transport_Loopback       transport;
+    Domokit_Inflight         inflight;
+    std::vector<std::string> recus;
+};
+
+// ################################################################################
+// 									Tests
+// ################################################################################
+
+TEST(Sans_Perte)
+{
+  Banc_QoS banc(0);
+
+  for (unsigned i = 0; i < QOS_TAILLE_FENETRE; i++)
+    VERIFIE(banc.envoyer(i));
+  VERIFIE(banc.inflight.getNbEnAttente() == QOS_TAILLE_FENETRE);
+
+  banc.transport.loop();
+  VERIFIE(banc.inflight.getNbEnAttente() == 0);
+  VERIFIE(banc.inflight.getNbRenvois() == 0);
+  VERIFIE(banc.tousRecus(QOS_TAILLE_FENETRE));
+}
+
+// Fenêtre pleine : le message est refusé (MQTT_Send renvoie false)
+TEST(Fenetre_Pleine)
+{
+  Banc_QoS banc(100);
+
+  for (unsigned i = 0; i < QOS_TAILLE_FENETRE; i++)
+    VERIFIE(banc.envoyer(i));
+  VERIFIE(!banc.envoyer(QOS_TAILLE_FENETRE));
+
+  // Le lien revient : la place se libère après renvoi
+  banc.transport.setPacketLoss(0);
+  banc.attendre(QOS_DELAI_INITIAL_MS + 200);
+  VERIFIE(banc.inflight.getNbEnAttente() == 0);
+  VERIFIE(banc.envoyer(QOS_TAILLE_FENETRE));
+}
+
+// 30 % de perte (message ou PUBACK) : tous les messages finissent acquittés
+TEST(Perte_Paquets)
+{
+  const unsigned nb = 200;
+  Banc_QoS banc(30);
+  unsigned envoyes = 0;
+
+  srand(27);
+  while (envoyes < nb || banc.inflight.getNbEnAttente() > 0)
+  {
+    while (envoyes < nb && banc.envoyer(envoyes))
+      envoyes++;
+    banc.attendre(500);
+  }
+
+  VERIFIE(banc.inflight.getNbEnAttente() == 0);
+  VERIFIE(banc.inflight.getNbRenvois() > 0);
+  VERIFIE(banc.transport.getNbPertes() > 0);
+  VERIFIE(banc.transport.getNbPublications() == nb + banc.inflight.getNbRenvois());
+  VERIFIE(banc.tousRecus(nb));
+}
+
+// Coupure du lien : les messages restent dans la fenêtre et partent à la reconnexion
+TEST(Coupure_Lien)
+{
+  Banc_QoS banc(0);
+
+  banc.transport.setLinkState(false);
+  VERIFIE(banc.envoyer(0) && banc.envoyer(1));
+  banc.attendre(5000);
+  VERIFIE(banc.inflight.getNbEnAttente() == 2 && banc.recus.empty());
+
+  banc.transport.setLinkState(true);
+  banc.transport.connect("test", "", "");
+  banc.transport.subscribe(TOPIC_CRITIQUE);
+  banc.inflight.restart();
+  banc.attendre(100);
+  VERIFIE(banc.inflight.getNbEnAttente() == 0);
+  VERIFIE(banc.tousRecus(2));
+}
+
+// Transport sans PUBACK (comme Transport_PubSub) : livré dès l'envoi, jamais renvoyé
+class Transport_Sans_QoS1 : public Transport_Loopback
+{
+  public:
+    using Transport_Loopback::publish;
+    bool publish(const char* topic, const uint8_t* payload, unsigned int length, uint8_t qos, uint16_t* packetId)
+    {
+      return Domokit_Transport::publish(topic, payload, length, qos, packetId);
+    }
+};
+
+TEST(Transport_Sans_Acquittement)
+{
+  Transport_Sans_QoS1 transport;
+  Domokit_Inflight inflight;
+
+  transport.connect("test", "", "");
+  transport.setPacketLoss(100);
+  VERIFIE(inflight.send(&transport, TOPIC_CRITIQUE, (const uint8_t*)"m0", 2));
+  VERIFIE(inflight.getNbEnAttente() == 0);
+  VERIFIE(transport.getNbPertes() == 1);   // perdu sans renvoi : QoS 0 de fait
+}
+
+// Sauvegarde EEPROM : à la déconnexion ou une fois par période, jamais à chaque message
+TEST(Persistance)
+{
+  Banc_QoS banc(100);
+  unsigned long commits = EEPROM.nb_commits;
+
+  // Première modification sauvegardée, puis plus rien tant que la fenêtre ne change pas
+  for (unsigned i = 0; i < QOS_TAILLE_FENETRE; i++)
+    banc.envoyer(i);
+  banc.attendre(QOS_PERIODE_SAUVEGARDE_MS * 2);
+  VERIFIE(EEPROM.nb_commits == commits + 1);
+  VERIFIE(banc.inflight.getNbRenvois() > 0);
+
+  // Redémarrage : les messages non acquittés sont restaurés puis livrés
+  {
+    Banc_QoS apres(0);
+    apres.inflight.restore();
+    VERIFIE(apres.inflight.getNbEnAttente() == QOS_TAILLE_FENETRE);
+    apres.attendre(100);
+    VERIFIE(apres.inflight.getNbEnAttente() == 0 && apres.tousRecus(QOS_TAILLE_FENETRE));
+    commits = EEPROM.nb_commits;
+
+    // Déconnexion : la fenêtre modifiée (acquittements) est sauvegardée aussitôt
+    apres.transport.setLinkState(false);
+    apres.attendre(100);
+    VERIFIE(EEPROM.nb_commits == commits + 1);
+    apres.attendre(QOS_PERIODE_SAUVEGARDE_MS * 2);
+    VERIFIE(EEPROM.nb_commits == commits + 1);
+  }
+
+  Banc_QoS vide(0);
+  vide.inflight.restore();
+  VERIFIE(vide.inflight.getNbEnAttente() == 0);
+
+  // Un message critique par seconde pendant 5 min : au plus une sauvegarde par période
+  commits = EEPROM.nb_commits;
+  for (unsigned i = 0; i < 300; i++)
+  {
+    vide.envoyer(i);
+    vide.attendre(1000);
+  }
+  VERIFIE(vide.tousRecus(300));
+  VERIFIE(EEPROM.nb_commits - commits <= 300000 / QOS_PERIODE_SAUVEGARDE_MS + 1);
+}
+
+// ################################################################################
+// 									Performances
+// ################################################################################
+
+// Émissions par message et délai de livraison (délai croissant 1 s, 2 s, 4 s...)
+TEST(Mesure_Perte)
+{
+  const unsigned nb = 400;
+  const uint8_t taux[] = { 0, 10, 30, 50 };
+
+  srand(1);
+  for (size_t t = 0; t < sizeof(taux); t++)
+  {
+    Banc_QoS banc(taux[t]);
+    unsigned long duree_ms = 0, pire_ms = 0;
+    unsigned long commits = EEPROM.nb_commits;
+
+    // Un message à la fois : délai de livraison de chaque message
+    for (unsigned i = 0; i < nb; i++)
+    {
+      unsigned long debut = millis();
+      banc.envoyer(i);
+      banc.transport.loop();
+      while (banc.inflight.getNbEnAttente() > 0)
+        banc.attendre(100);
+      unsigned long d = millis() - debut;
+      duree_ms += d;
+      if (d > pire_ms) pire_ms = d;
+    }
+
+    VERIFIE(banc.tousRecus(nb));
+    printf("  perte %2u %% : %.2f émissions/message, livraison moyenne %.2f s, pire %.1f s, %lu sauvegardes EEPROM\n",
+           taux[t], banc.transport.getNbPublications() / (double)nb, duree_ms / 1000.0 / nb, pire_ms / 1000.0,
+           EEPROM.nb_commits - commits);
+  }
+}
+
+int main()
+{
+  LANCE(Sans_Perte);
+  LANCE(Fenetre_Pleine);
+  LANCE(Perte_Paquets);
+  LANCE(Coupure_Lien);
+  LANCE(Transport_Sans_Acquittement);
+  LANCE(Persistance);
+  LANCE(Mesure_Perte);
+  return FIN_TESTS();
+}
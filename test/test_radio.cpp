@@ -0,0 +1,138 @@
+/*
+ *  =============================================================================================================================================
+ *  Titre : test_radio.cpp
+ *  Auteur : Thomas Broussard
+ *  ---------------------------------------------------------------------------------------------------------------------------------------------
+ *  Description :
+ *  Test hôte des fenêtres d'émission radio (DomoKit_Radio.cpp) sur un objet
+ *  complet : l'application envoie une valeur quand elle veut, les valeurs
+ *  ne partent que dans les fenêtres, les interruptions (QoS 1) partent
+ *  aussitôt ; rapport cyclique de la radio selon la période des fenêtres
+ * =============================================================================================================================================
+ */
+
+#include "Objet.h"
+#include "Test.h"
+#include <deque>
+#include <math.h>
+
+#define DTIM  3
+
+// ################################################################################
+// 									Application
+// ################################################################################
+void init_Tile()
+{
+  Objet_Courant->domokit.setTileGraph("Température", "temperature", 0, 40);
+}
+
+void callBack_Tile(String TileTopic, String payload)
+{
+}
+
+// ################################################################################
+// 									Tests
+// ################################################################################
+
+/*
+ * 5 min de fonctionnement : une valeur toutes les 200 ms, une interruption
+ * toutes les 30 s. Sans fenêtres, la radio reste allumée (1000 pour mille).
+ */
+TEST(Rapport_Cyclique)
+{
+  const unsigned long periodes[] = { 0, 1000, 5000, 30000 };
+  const unsigned long duree_ms = 300000;
+  uint16_t precedent = 1000;
+
+  for (size_t p = 0; p < sizeof(periodes) / sizeof(periodes[0]); p++)
+  {
+    Objet_Simule objet("Radio");
+    std::deque<std::pair<unsigned long, unsigned long> > attente;   // valeurs pas encore publiées : numéro, date
+    unsigned long periode = 0, latence_max = 0, hors_fenetre = 0, nb_valeurs = 0, nb_envois = 0;
+    unsigned long envois_ouverte = 0, nb_interruptions = 0, interruptions_fermee = 0;
+    char valeur[16];
+
+    VERIFIE(objet.demarrer());
+    if (periodes[p] > 0)
+    {
+      periode = objet.domokit.enableRadioWindows(periodes[p], DTIM);
+      unsigned long nb_dtim = (periode * 1000 + RADIO_INTERVALLE_BEACON_US * DTIM / 2) / (RADIO_INTERVALLE_BEACON_US * DTIM);
+      VERIFIE(periode >= periodes[p] && labs((long)(periode * 1000) - (long)(nb_dtim * RADIO_INTERVALLE_BEACON_US * DTIM)) < 1000);
+    }
+
+    std::string topic_valeur = objet.topic(TOPIC_TILE) + "/temperature";
+    size_t lues = objet.transport.publications.size();
+    for (unsigned long t = 0; t < duree_ms; t += 10)
+    {
+      Domokit_Radio& radio = objet.domokit.getRadio();
+      bool ouverte = radio.isOpen();
+      unsigned long fenetres = radio.getNbFenetres();
+
+      if (t % 200 == 0)
+      {
+        snprintf(valeur, sizeof(valeur), "%lu", t / 200);
+        attente.push_back(std::make_pair(t / 200, millis()));
+        objet.domokit.SendtoTile("temperature", valeur);
+        nb_envois++;
+        envois_ouverte += ouverte;
+      }
+      if (t % 30000 == 0)
+      {
+        objet.domokit.MQTT_Send(objet.domokit.topic_interruption, "bouton");
+        nb_interruptions++;
+        interruptions_fermee += !ouverte;
+      }
+      objet.boucle(10);
+
+      // Valeurs publiées pendant ce pas : fenêtre ouverte avant le pas ou ouverte pendant le pas.
+      // Latence : date de publication - date de la plus ancienne valeur remplacée
+      for (; lues < objet.transport.publications.size(); lues++)
+      {
+        const Publication& pub = objet.transport.publications[lues];
+        if (pub.topic != topic_valeur)
+          continue;
+        nb_valeurs++;
+        unsigned long numero = strtoul(pub.payload.c_str(), NULL, 10);
+        for (; !attente.empty() && attente.front().first <= numero; attente.pop_front())
+          latence_max = std::max(latence_max, pub.date_ms - attente.front().second);
+        if (!ouverte && radio.getNbFenetres() == fenetres)
+          hors_fenetre++;
+      }
+    }
+
+    Domokit_Radio& radio = objet.domokit.getRadio();
+    unsigned long interruptions = objet.transport.compter(objet.domokit.topic_interruption);
+    VERIFIE(interruptions == nb_interruptions);
+    VERIFIE(hors_fenetre == 0);
+
+    if (periode == 0)
+    {
+      VERIFIE(radio.getDutyCycle() == 1000);
+      VERIFIE(nb_valeurs == nb_envois);
+      printf("  sans fenêtres     : radio allumée 1000 pour mille, %lu valeurs publiées\n", nb_valeurs);
+      continue;
+    }
+
+    // Fenêtre fermée : seule la dernière valeur part, dans la fenêtre suivante
+    VERIFIE(nb_valeurs <= radio.getNbFenetres() + envois_ouverte);
+    VERIFIE(nb_valeurs < nb_envois);
+    VERIFIE(latence_max <= periode + 2 * RADIO_DUREE_FENETRE_MS);
+    VERIFIE(radio.getNbReveils() >= interruptions_fermee);
+
+    // Rapport cyclique attendu : fenêtres, réveils et beacons DTIM sur la durée de la mesure
+    double attendu = (radio.getNbFenetres() * RADIO_DUREE_FENETRE_MS + radio.getNbReveils() * RADIO_DUREE_EVEIL_MS
+                      + duree_ms * 1000.0 / (RADIO_INTERVALLE_BEACON_US * DTIM) * RADIO_DUREE_BEACON_MS) * 1000.0 / duree_ms;
+    VERIFIE(radio.getDutyCycle() < precedent);
+    precedent = radio.getDutyCycle();
+    VERIFIE(fabs(radio.getDutyCycle() - attendu) <= 2 + attendu / 50);
+
+    printf("  fenêtres %5lu ms : radio allumée %3u pour mille, %4lu fenêtres, %2lu réveils, %4lu valeurs publiées sur %lu (latence max %.1f s)\n",
+           periode, radio.getDutyCycle(), radio.getNbFenetres(), radio.getNbReveils(), nb_valeurs, nb_envois, latence_max / 1000.0);
+  }
+}
+
+int main()
+{
+  LANCE(Rapport_Cyclique);
+  return FIN_TESTS();
+}
@@ -0,0 +1,104 @@
+/*
+ *  =============================================================================================================================================
+ *  Titre : test_tas.cpp
+ *  Auteur : Thomas Broussard
+ *  ---------------------------------------------------------------------------------------------------------------------------------------------
+ *  Description :
+ *  Test hôte du budget mémoire (DomoKit_Memoire.h) : après l'initialisation,
+ *  un objet complet compilé avec DOMOKIT_SANS_STRING ne fait plus aucune
+ *  allocation sur le tas (poll(), commandes de tiles, télémétrie, présence,
+ *  métriques, SNAPSHOT). Les allocations sont comptées par operator new.
+ *
+ *  Sans DOMOKIT_SANS_STRING, callBack_Tile(String, String) construit deux
+ *  String à chaque commande : ce test n'est compilé qu'avec l'option.
+ * =============================================================================================================================================
+ */
+
+#include "Objet.h"
+#include "Test.h"
+#include <new>
+
+#ifndef DOMOKIT_SANS_STRING
+  #error "test_tas se compile avec -DDOMOKIT_SANS_STRING"
+#endif
+
+// ################################################################################
+// 									Compteur d'allocations
+// ################################################################################
+static unsigned long Nb_Allocations = 0;
+
+void* operator new(size_t taille)
+{
+  Nb_Allocations++;
+  void* p = malloc(taille ? taille : 1);
+  if (p == NULL)
+    throw std::bad_alloc();
+  return p;
+}
+void* operator new[](size_t taille)   { return operator new(taille); }
+void  operator delete(void* p) noexcept   { free(p); }
+void  operator delete[](void* p) noexcept { free(p); }
+void  operator delete(void* p, size_t) noexcept   { free(p); }
+void  operator delete[](void* p, size_t) noexcept { free(p); }
+
+// ################################################################################
+// 									Application
+// ################################################################################
+static unsigned Nb_Commandes = 0;
+static char     Derniere_Commande[TAILLE_VALEUR_TILE];
+
+void init_Tile()
+{
+  Objet_Courant->domokit.setTileSwitch("Lampe", "lampe");
+  Objet_Courant->domokit.setTileGraph("Température", "temperature", 0, 40);
+}
+
+void callBack_Tile(const char* TileTopic, const char* payload)
+{
+  if (strcmp(TileTopic, "lampe") == 0)
+  {
+    Nb_Commandes++;
+    strncpy(Derniere_Commande, payload, sizeof(Derniere_Commande) - 1);
+  }
+}
+
+// ################################################################################
+// 									Tests
+// ################################################################################
+TEST(Aucune_Allocation_Apres_Init)
+{
+  Objet_Simule objet("Tas");
+  char valeur[16];
+
+  objet.transport.enregistrer = false;
+  VERIFIE(objet.demarrer());
+
+  // Premier passage dans chaque tâche (chronologie du démarrage, métriques...)
+  objet.boucle(2 * PERIODE_METRIQUES_MS);
+
+  unsigned long allocations = Nb_Allocations;
+  unsigned long publications = objet.transport.getNbPublications();
+  for (unsigned s = 0; s < 120; s++)
+  {
+    // Commande de l'utilisateur, télémétrie de l'application, demande du serveur
+    objet.recevoir(TOPIC_TILE, (s & 1) ? PROTOCOLE_ON : PROTOCOLE_OFF, "lampe");
+    snprintf(valeur, sizeof(valeur), "%u.%u", 20 + s % 5, s % 10);
+    objet.domokit.SendtoTile("temperature", valeur);
+    if (s % 30 == 0)
+      objet.recevoir(TOPIC_INSTRUCTION, PROTOCOLE_SNAPSHOT);
+    objet.boucle(1000);
+  }
+  unsigned long nb = Nb_Allocations - allocations;
+
+  VERIFIE(Nb_Commandes == 120 && strcmp(Derniere_Commande, PROTOCOLE_ON) == 0);
+  VERIFIE(objet.transport.getNbPublications() > publications + 120);
+  VERIFIE(nb == 0);
+  printf("  2 min simulées : %lu allocation(s) après l'initialisation, %lu messages publiés\n",
+         nb, objet.transport.getNbPublications() - publications);
+}
+
+int main()
+{
+  LANCE(Aucune_Allocation_Apres_Init);
+  return FIN_TESTS();
+}
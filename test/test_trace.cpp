@@ -0,0 +1,160 @@
+/*
+ *  =============================================================================================================================================
+ *  Titre : test_trace.cpp
+ *  Auteur : Thomas Broussard
+ *  ---------------------------------------------------------------------------------------------------------------------------------------------
+ *  Description :
+ *  Test hôte de l'enregistrement et du rejeu (DomoKit_Trace.cpp) : une
+ *  session d'un objet complet est enregistrée par Transport_Trace, puis
+ *  rejouée par Trace_Rejeu dans un objet neuf (autre @mac) sur le transport
+ *  loopback. Les deux objets doivent produire les mêmes appels de
+ *  callBack_Tile et les mêmes publications sur leurs tiles.
+ * =============================================================================================================================================
+ */
+
+#include "Objet.h"
+#include "Test.h"
+
+#define GRAINE  50   // même tirage aléatoire (délai d'authentification) pour les deux objets
+
+// ################################################################################
+// 									Application
+// ################################################################################
+
+// Appels de callBack_Tile de la session en cours : "<topic>=<payload>"
+static std::vector<std::string> Appels;
+
+void init_Tile()
+{
+  Objet_Courant->domokit.setTileSwitch("Lampe", "lampe");
+  Objet_Courant->domokit.setTileText("Message", "message", true);
+  Objet_Courant->domokit.setTileGraph("Etat", "etat", 0, 100);
+}
+
+// L'application répond aux commandes : sa sortie ne dépend que du trafic reçu
+void callBack_Tile(String TileTopic, String payload)
+{
+  Appels.push_back(std::string(TileTopic.c_str()) + "=" + payload.c_str());
+  if (TileTopic == "lampe")
+    Objet_Courant->domokit.SendtoTile("etat", payload == PROTOCOLE_ON ? "100" : "0");
+}
+
+// Trace en mémoire
+class Memoire : public Print
+{
+  public:
+    size_t write(uint8_t octet) { octets.push_back(octet); return 1; }
+    std::vector<uint8_t> octets;
+};
+
+// @mac d'un objet : dernier élément de son topic d'instruction
+static std::string Mac(Objet_Simule& objet)
+{
+  std::string t = objet.topic(TOPIC_INSTRUCTION);
+  return t.substr(t.rfind('/') + 1);
+}
+
+// Publications de l'objet sur ses tiles, @mac remplacée (comparaison entre objets)
+static std::vector<std::string> Sortie_Tiles(Objet_Simule& objet)
+{
+  std::string prefixe = objet.topic(TOPIC_TILE);
+  std::string mac = Mac(objet);
+  std::vector<std::string> sortie;
+
+  for (size_t i = 0; i < objet.transport.publications.size(); i++)
+  {
+    const Publication& p = objet.transport.publications[i];
+    if (p.topic.compare(0, prefixe.size(), prefixe) != 0)
+      continue;
+    std::string t = p.topic;
+    size_t pos = t.find(mac);
+    if (pos != std::string::npos)
+      t.replace(pos, mac.size(), "<mac>");
+    sortie.push_back(t + " " + p.payload);
+  }
+  return sortie;
+}
+
+// ################################################################################
+// 									Tests
+// ################################################################################
+
+TEST(Enregistrement_Rejeu)
+{
+  Memoire memoire;
+  std::vector<std::string> appels_origine, sortie_origine;
+  std::string mac_origine;
+  unsigned long trames, receptions;
+
+  // Session d'origine : démarrage, commandes de l'utilisateur, SNAPSHOT du serveur
+  {
+    Objet_Simule objet("Trace", 1);
+    Transport_Trace trace(&objet.transport);
+    Trace_Print sortie(memoire);
+
+    Appels.clear();
+    srand(GRAINE);
+    objet.domokit.setTransport(&trace);
+    trace.setOutput(&sortie);
+    VERIFIE(objet.demarrer());
+
+    objet.boucle(1500);
+    objet.recevoir(TOPIC_TILE, PROTOCOLE_ON, "lampe");
+    objet.boucle(700);
+    objet.recevoir(TOPIC_TILE, "bonjour", "message");
+    objet.boucle(2300);
+    objet.recevoir(TOPIC_TILE, PROTOCOLE_OFF, "lampe");
+    objet.recevoir(TOPIC_TILE, "inconnue", "absente");
+    objet.boucle(4000);
+    objet.recevoir(TOPIC_INSTRUCTION, PROTOCOLE_SNAPSHOT);
+    objet.boucle(1200);
+    objet.recevoir(TOPIC_TILE, PROTOCOLE_ON, "lampe");
+    objet.boucle(3000);
+    trace.setOutput(NULL);
+
+    appels_origine = Appels;
+    sortie_origine = Sortie_Tiles(objet);
+    mac_origine = Mac(objet);
+    trames = trace.getNbTrames();
+    receptions = objet.transport.getNbReceptions();
+  }
+
+  // 5 commandes (dont une tile inconnue) et 3 échos par le broker des valeurs de "etat"
+  VERIFIE(appels_origine.size() == 8);
+  VERIFIE(sortie_origine.size() == 3);
+
+  // Rejeu à la vitesse d'origine dans un objet neuf
+  Objet_Simule objet("Trace", 2);
+  Trace_Rejeu rejeu;
+
+  std::string mac;
+
+  Appels.clear();
+  srand(GRAINE);
+  objet.transport.echo = false;
+  Objet_Courant = &objet;
+  objet.domokit.begin();
+
+  mac = Mac(objet);
+  VERIFIE(mac != mac_origine);
+  VERIFIE(rejeu.begin(memoire.octets.data(), memoire.octets.size()));
+  rejeu.setTopicRewrite(mac_origine.c_str(), mac.c_str());
+  while (rejeu.service(&objet.transport))
+    objet.boucle(10);
+  objet.boucle(3000);
+
+  VERIFIE(!rejeu.hasError());
+  VERIFIE(rejeu.getNbInjectes() == receptions);
+  VERIFIE(objet.transport.getNbReceptions() == receptions);
+  VERIFIE(rejeu.getNbInjectes() + rejeu.getNbEmis() == trames);
+  VERIFIE(Appels == appels_origine);
+  VERIFIE(Sortie_Tiles(objet) == sortie_origine);
+  printf("  %lu trames, trace de %zu octets : %zu appels de callBack_Tile et %zu publications de tiles identiques\n",
+         trames, memoire.octets.size(), Appels.size(), sortie_origine.size());
+}
+
+int main()
+{
+  LANCE(Enregistrement_Rejeu);
+  return FIN_TESTS();
+}
@@ -0,0 +1,206 @@
+/*
+ *  =============================================================================================================================================
+ *  Titre : Delta.h
+ *  Auteur : Thomas Broussard
+ *  ---------------------------------------------------------------------------------------------------------------------------------------------
+ *  Description :
+ *  Calcul d'un delta DKD1 (mise à jour différentielle, format dans
+ *  src/DomoKit_OTA.h) entre deux images de firmware, côté serveur.
+ *
+ *  Les correspondances sont cherchées par empreinte de DELTA_TAILLE_EMPREINTE
+ *  octets de l'ancienne image, en essayant d'abord le même décalage que la
+ *  correspondance précédente (code déplacé d'un bloc). Une correspondance
+ *  exacte est prolongée tant que plus de la moitié des octets sont
+ *  identiques, comme bsdiff : les adresses modifiées par l'éditeur de liens
+ *  deviennent des octets de diff isolés au milieu de suites de zéros.
+ *
+ *  Utilisé par tools/delta.cpp et par les tests hôte (test/test_ota.cpp).
+ * =============================================================================================================================================
+ */
+
+#ifndef __DOMOKIT_OUTIL_DELTA_H__
+#define __DOMOKIT_OUTIL_DELTA_H__
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+// ################################################################################
+// 				Defines , définition et variables globales
+// ################################################################################
+  #define DELTA_MAGIC                 "DKD1"
+  #define DELTA_TAILLE_EMPREINTE      8       // octets hachés pour l'index de l'ancienne image
+  #define DELTA_BITS_INDEX            20      // index de 2^20 positions
+  #define DELTA_CORRESPONDANCE_MIN    16      // correspondance exacte minimale
+  #define DELTA_PROLONGATION_MAX      64      // prolongation abandonnée après autant d'octets sans gain
+
+// Correspondance retenue : taille octets de la nouvelle image à partir de
+// nouveau, codés en diff à partir de ancien
+struct Delta_Bloc
+{
+  size_t nouveau;
+  size_t ancien;
+  size_t taille;
+};
+
+// ################################################################################
+// 									Fonctions
+// ################################################################################
+
+static inline void Delta_Ajouter32(std::vector<uint8_t>& delta, uint32_t valeur)
+{
+  delta.push_back(valeur >> 24);
+  delta.push_back(valeur >> 16);
+  delta.push_back(valeur >> 8);
+  delta.push_back(valeur);
+}
+
+static inline uint32_t Delta_Empreinte(const uint8_t* donnees)
+{
+  uint64_t mot;
+  memcpy(&mot, donnees, sizeof(mot));
+  return (uint32_t)((mot * 0x9E3779B97F4A7C15ULL) >> (64 - DELTA_BITS_INDEX));
+}
+
+// Commande : diff octets (nouveau - ancien, suites de zéros compressées), extra octets, saut
+static inline void Delta_Commande(std::vector<uint8_t>& delta, const uint8_t* ancien, const uint8_t* nouveau,
+                                  uint32_t diff, const uint8_t* extra, uint32_t nb_extra, int32_t saut)
+{
+  Delta_Ajouter32(delta, diff);
+  Delta_Ajouter32(delta, nb_extra);
+  Delta_Ajouter32(delta, (uint32_t)saut);
+
+  for (uint32_t i = 0; i < diff; )
+  {
+    uint8_t d = nouveau[i] - ancien[i];
+    if (d != 0)
+    {
+      delta.push_back(d);
+      i++;
+      continue;
+    }
+    uint32_t n = 1;
+    while (i + n < diff && n < 256 && (uint8_t)(nouveau[i + n] - ancien[i + n]) == 0)
+      n++;
+    delta.push_back(0);
+    delta.push_back((uint8_t)(n - 1));
+    i += n;
+  }
+  delta.insert(delta.end(), extra, extra + nb_extra);
+}
+
+/*===============================================================================
+  Nom 			: Delta_Blocs
+
+  Description	: Cherche les correspondances entre les deux images (voir
+                l'en-tête), dans l'ordre de la nouvelle image
+
+  Paramètre(s) 	: ancienne : image en cours d'exécution sur l'objet
+                  nouvelle : image à installer
+
+  Retour		: correspondances, sans recouvrement dans la nouvelle image
+===============================================================================*/
+static inline std::vector<Delta_Bloc> Delta_Blocs(const std::vector<uint8_t>& ancienne, const std::vector<uint8_t>& nouvelle)
+{
+  std::vector<Delta_Bloc> blocs;
+  std::vector<int32_t> index((size_t)1 << DELTA_BITS_INDEX, -1);
+  size_t na = ancienne.size(), nn = nouvelle.size();
+  long decalage = 0;   // ancien - nouveau de la dernière correspondance
+
+  if (na < DELTA_TAILLE_EMPREINTE || nn < DELTA_TAILLE_EMPREINTE)
+    return blocs;
+
+  // Première occurrence de chaque empreinte de l'ancienne image
+  for (size_t i = 0; i + DELTA_TAILLE_EMPREINTE <= na; i++)
+  {
+    int32_t& case_index = index[Delta_Empreinte(&ancienne[i])];
+    if (case_index < 0)
+      case_index = (int32_t)i;
+  }
+
+  size_t scan = 0;
+  while (scan + DELTA_TAILLE_EMPREINTE <= nn)
+  {
+    long candidats[2] = { (long)scan + decalage, index[Delta_Empreinte(&nouvelle[scan])] };
+    size_t meilleure = 0, position = 0;
+
+    for (int c = 0; c < 2; c++)
+    {
+      if (candidats[c] < 0 || (size_t)candidats[c] >= na)
+        continue;
+      size_t p = (size_t)candidats[c], n = 0;
+      while (scan + n < nn && p + n < na && nouvelle[scan + n] == ancienne[p + n])
+        n++;
+      if (n > meilleure)
+      {
+        meilleure = n;
+        position = p;
+      }
+    }
+
+    if (meilleure < DELTA_CORRESPONDANCE_MIN)
+    {
+      scan++;
+      continue;
+    }
+
+    // Prolongation : score = identiques - différents, conservé tant qu'il augmente
+    size_t taille = meilleure;
+    long score = 0, meilleur_score = 0;
+    for (size_t i = meilleure; scan + i < nn && position + i < na && i - taille < DELTA_PROLONGATION_MAX; i++)
+    {
+      score += (nouvelle[scan + i] == ancienne[position + i]) ? 1 : -1;
+      if (score > meilleur_score)
+      {
+        meilleur_score = score;
+        taille = i + 1;
+      }
+    }
+
+    Delta_Bloc bloc = { scan, position, taille };
+    blocs.push_back(bloc);
+    decalage = (long)position - (long)scan;
+    scan += taille;
+  }
+  return blocs;
+}
+
+/*===============================================================================
+  Nom 			: Delta_Calcule
+
+  Description	: Calcule le delta DKD1 qui transforme ancienne en nouvelle
+
+  Paramètre(s) 	: ancienne : image relue sur l'objet (telle qu'en flash)
+                  nouvelle : image à installer
+
+  Retour		: delta (en-tête et commandes)
+===============================================================================*/
+static inline std::vector<uint8_t> Delta_Calcule(const std::vector<uint8_t>& ancienne, const std::vector<uint8_t>& nouvelle)
+{
+  std::vector<Delta_Bloc> blocs = Delta_Blocs(ancienne, nouvelle);
+  std::vector<uint8_t> delta;
+  const uint8_t* a = ancienne.data();
+  const uint8_t* n = nouvelle.data();
+
+  delta.insert(delta.end(), DELTA_MAGIC, DELTA_MAGIC + 4);
+  Delta_Ajouter32(delta, ancienne.size());
+  Delta_Ajouter32(delta, nouvelle.size());
+
+  // Octets avant la première correspondance : extra seul
+  size_t debut = blocs.empty() ? nouvelle.size() : blocs[0].nouveau;
+  size_t premier = blocs.empty() ? 0 : blocs[0].ancien;
+  if (debut > 0 || premier > 0)
+    Delta_Commande(delta, a, n, 0, n, debut, (int32_t)premier);
+
+  for (size_t i = 0; i < blocs.size(); i++)
+  {
+    const Delta_Bloc& b = blocs[i];
+    size_t fin = b.nouveau + b.taille;
+    size_t suivant = (i + 1 < blocs.size()) ? blocs[i + 1].nouveau : nouvelle.size();
+    long saut = (i + 1 < blocs.size()) ? (long)blocs[i + 1].ancien - (long)(b.ancien + b.taille) : 0;
+    Delta_Commande(delta, a + b.ancien, n + b.nouveau, b.taille, n + fin, suivant - fin, (int32_t)saut);
+  }
+  return delta;
+}
+
+#endif
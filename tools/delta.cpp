@@ -0,0 +1,65 @@
+/*
+ *  =============================================================================================================================================
+ *  Titre : delta.cpp
+ *  Auteur : Thomas Broussard
+ *  ---------------------------------------------------------------------------------------------------------------------------------------------
+ *  Description :
+ *  Outil serveur : delta DKD1 entre deux images de firmware (voir Delta.h)
+ *
+ *    g++ -std=c++11 -O2 -o delta tools/delta.cpp    (ou make -C test)
+ *    delta ancienne.bin nouvelle.bin nouvelle.dkd
+ *
+ *  Le serveur annonce ensuite OTA;<taille du delta>;<MD5 de nouvelle.bin>;DELTA
+ *  et envoie le delta par blocs. L'ancienne image doit être celle relue sur
+ *  l'objet (ESP.getSketchSize() octets depuis le début de la flash), sinon
+ *  le delta est refusé dès l'en-tête.
+ * =============================================================================================================================================
+ */
+
+#include "Delta.h"
+#include <stdio.h>
+
+static bool Lire(const char* chemin, std::vector<uint8_t>& donnees)
+{
+  FILE* f = fopen(chemin, "rb");
+  if (f == NULL)
+    return false;
+  uint8_t tampon[4096];
+  size_t n;
+  donnees.clear();
+  while ((n = fread(tampon, 1, sizeof(tampon), f)) > 0)
+    donnees.insert(donnees.end(), tampon, tampon + n);
+  fclose(f);
+  return true;
+}
+
+int main(int argc, char** argv)
+{
+  std::vector<uint8_t> ancienne, nouvelle;
+
+  if (argc != 4)
+  {
+    fprintf(stderr, "usage : %s ancienne.bin nouvelle.bin delta.dkd\n", argv[0]);
+    return 2;
+  }
+  if (!Lire(argv[1], ancienne) || !Lire(argv[2], nouvelle))
+  {
+    fprintf(stderr, "lecture impossible : %s\n", ancienne.empty() ? argv[1] : argv[2]);
+    return 1;
+  }
+
+  std::vector<uint8_t> delta = Delta_Calcule(ancienne, nouvelle);
+
+  FILE* f = fopen(argv[3], "wb");
+  if (f == NULL || fwrite(delta.data(), 1, delta.size(), f) != delta.size())
+  {
+    fprintf(stderr, "écriture impossible : %s\n", argv[3]);
+    return 1;
+  }
+  fclose(f);
+
+  printf("%s -> %s : delta de %u octets pour une image de %u octets (%.1f %%)\n",
+         argv[1], argv[2], (unsigned)delta.size(), (unsigned)nouvelle.size(),
+         100.0 * delta.size() / nouvelle.size());
+  return 0;
+}